@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "builderConfig.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+std::string trimCopy(const std::string& s)
+{
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+bool parseBool(const std::string& value, bool& out)
+{
+    std::string v = value;
+    std::transform(v.begin(), v.end(), v.begin(), ::tolower);
+    if (v == "1" || v == "true") out = true;
+    else if (v == "0" || v == "false") out = false;
+    else return false;
+    return true;
+}
+
+} // namespace
+
+bool parseTacticSources(const std::string& list, uint32_t& sources)
+{
+    uint32_t parsed = 0;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        name = trimCopy(name);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name.empty() || name == "none") continue;
+        if (name == "cublas") parsed |= TACTIC_SOURCE_CUBLAS;
+        else if (name == "cublas_lt" || name == "cublaslt") parsed |= TACTIC_SOURCE_CUBLAS_LT;
+        else
+        {
+            std::cerr << "Unknown tactic source : " << name << std::endl;
+            return false;
+        }
+    }
+    sources = parsed;
+    return true;
+}
+
+bool readBuilderSettings(const std::string& configPath, BuilderSettings& settings)
+{
+    std::ifstream file(configPath);
+    if (!file.good()) return true;
+
+    bool inGroup = false;
+    bool ok = true;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = trimCopy(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+        if (line.front() == '[' && line.back() == ']')
+        {
+            inGroup = (line.substr(1, line.size() - 2) == BUILDER_CONFIG_GROUP);
+            continue;
+        }
+        if (!inGroup) continue;
+
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        const std::string key = trimCopy(line.substr(0, eq));
+        const std::string value = trimCopy(line.substr(eq + 1));
+
+        if (key == BUILDER_CONFIG_TACTIC_SOURCES)
+        {
+            ok &= parseTacticSources(value, settings.tacticSources);
+        }
+        else if (key == BUILDER_CONFIG_TIMING_CACHE)
+        {
+            if (!parseBool(value, settings.timingCache))
+            {
+                std::cerr << "Invalid " << BUILDER_CONFIG_TIMING_CACHE << " : " << value
+                          << std::endl;
+                ok = false;
+            }
+        }
+        else if (key == BUILDER_CONFIG_TIMING_CACHE_FILE)
+        {
+            settings.timingCacheFile = value;
+        }
+        else if (key == BUILDER_CONFIG_YOLO_HEAD)
+        {
+            if (value == "plugin") settings.cpuYoloHead = false;
+            else if (value == "cpu") settings.cpuYoloHead = true;
+            else
+            {
+                std::cerr << "Invalid " << BUILDER_CONFIG_YOLO_HEAD << " : " << value
+                          << ", expected plugin or cpu" << std::endl;
+                ok = false;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown key " << key << " in [" << BUILDER_CONFIG_GROUP << "] of "
+                      << configPath << std::endl;
+        }
+    }
+    return ok;
+}
+
+std::string timingCacheKey(const int trtVersion, const std::string& deviceName,
+                           const int ccMajor, const int ccMinor)
+{
+    std::string device;
+    for (char c : deviceName)
+    {
+        if (std::isalnum(static_cast<unsigned char>(c))) device += std::tolower(c);
+        else if (!device.empty() && device.back() != '-') device += '-';
+    }
+    while (!device.empty() && device.back() == '-') device.pop_back();
+
+    std::stringstream key;
+    key << "trt" << trtVersion << "_" << (device.empty() ? "gpu" : device) << "_sm" << ccMajor
+        << ccMinor;
+    return key.str();
+}
+
+std::string timingCachePath(const std::string& engineDir, const std::string& key)
+{
+    std::string dir = engineDir;
+    if (!dir.empty() && dir.back() != '/') dir += '/';
+    return dir + "timing_" + key + ".cache";
+}
+
+bool readTimingCache(const std::string& path, const std::string& key, std::vector<char>& blob)
+{
+    blob.clear();
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) return false;
+
+    std::string header;
+    std::getline(file, header);
+    const std::string expected = std::string(TIMING_CACHE_MAGIC) + " " + key;
+    if (header != expected)
+    {
+        std::cerr << "Ignoring timing cache " << path << " with header \"" << header
+                  << "\", expected \"" << expected << "\"" << std::endl;
+        return false;
+    }
+
+    blob.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !blob.empty();
+}
+
+bool writeTimingCache(const std::string& path, const std::string& key, const void* data,
+                      const size_t length)
+{
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.good())
+        {
+            std::cerr << "Failed to open timing cache for writing : " << tmpPath << std::endl;
+            return false;
+        }
+        file << TIMING_CACHE_MAGIC << " " << key << "\n";
+        file.write(static_cast<const char*>(data), length);
+        if (!file.good())
+        {
+            std::cerr << "Failed to write timing cache : " << tmpPath << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "Failed to move timing cache to " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
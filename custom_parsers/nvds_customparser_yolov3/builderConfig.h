@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __BUILDER_CONFIG_H__
+#define __BUILDER_CONFIG_H__
+
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/* Path of the nvinfer config file, exported by the app so the engine build
+ * can read the [builder] group that nvinfer itself ignores. */
+#define BUILDER_CONFIG_ENV "HERMES_INFER_CONFIG"
+#define BUILDER_CONFIG_GROUP "builder"
+#define BUILDER_CONFIG_TACTIC_SOURCES "tactic-sources"
+#define BUILDER_CONFIG_TIMING_CACHE "timing-cache"
+#define BUILDER_CONFIG_TIMING_CACHE_FILE "timing-cache-file"
+#define BUILDER_CONFIG_YOLO_HEAD "yolo-head"
+
+/* First line of a persisted timing cache, followed by the cache key */
+#define TIMING_CACHE_MAGIC "HERMES-TIMING-CACHE"
+
+/* Bits of BuilderSettings::tacticSources, in nvinfer1::TacticSource order */
+#define TACTIC_SOURCE_CUBLAS (1U << 0)
+#define TACTIC_SOURCE_CUBLAS_LT (1U << 1)
+
+/**
+ * Engine build options that nvinfer has no property for. Workspace and
+ * precision come from the native workspace-size and network-mode keys.
+ */
+struct BuilderSettings
+{
+    uint32_t tacticSources{TACTIC_SOURCE_CUBLAS | TACTIC_SOURCE_CUBLAS_LT};
+    bool timingCache{true};
+    // empty: next to the engine, named after the cache key
+    std::string timingCacheFile;
+    // yolo-head=cpu: no YoloLayerV3 plugin, the raw conv outputs are marked
+    // as engine outputs for NvDsInferParseCustomYoloV3Cpu
+    bool cpuYoloHead{false};
+};
+
+/* Reads the [builder] group of an nvinfer config file. Missing file, group
+ * or keys leave the defaults in place; returns false on invalid values. */
+bool readBuilderSettings(const std::string& configPath, BuilderSettings& settings);
+
+/* Parses a tactic source list such as "cublas,cublas_lt". "none" and an
+ * empty list disable all sources. Returns false on unknown names. */
+bool parseTacticSources(const std::string& list, uint32_t& sources);
+
+/* Identifies the build environment a timing cache is valid for. Timings do
+ * not depend on batch size or precision, so those are not part of it. */
+std::string timingCacheKey(const int trtVersion, const std::string& deviceName,
+                           const int ccMajor, const int ccMinor);
+
+/* Default cache location: timing_<key>.cache in engineDir. */
+std::string timingCachePath(const std::string& engineDir, const std::string& key);
+
+/* Reads a cache written by writeTimingCache. Returns false, leaving blob
+ * empty, if the file is missing, malformed or was written for another key. */
+bool readTimingCache(const std::string& path, const std::string& key, std::vector<char>& blob);
+
+/* Writes the cache through a temporary file and rename, so a build that is
+ * interrupted never leaves a truncated cache behind. */
+bool writeTimingCache(const std::string& path, const std::string& key, const void* data,
+                      const size_t length);
+
+#endif // __BUILDER_CONFIG_H__
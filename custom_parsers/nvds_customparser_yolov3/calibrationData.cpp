@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "calibrationData.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+bool readCalibrationTable(const std::string& path, std::vector<char>& table)
+{
+    table.clear();
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) return false;
+
+    table.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (table.empty()) return false;
+
+    const std::string data(table.begin(), table.end());
+    const std::string header = data.substr(0, data.find('\n'));
+    if (header.find(CALIBRATION_TABLE_ALGORITHM) == std::string::npos)
+    {
+        std::cerr << "Ignoring calibration table " << path << " with header \"" << header
+                  << "\", expected " << CALIBRATION_TABLE_ALGORITHM << std::endl;
+        table.clear();
+        return false;
+    }
+    return true;
+}
+
+bool writeCalibrationTable(const std::string& path, const void* data, const size_t length)
+{
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.good())
+        {
+            std::cerr << "Failed to open calibration table for writing : " << tmpPath
+                      << std::endl;
+            return false;
+        }
+        file.write(static_cast<const char*>(data), length);
+        if (!file.good())
+        {
+            std::cerr << "Failed to write calibration table : " << tmpPath << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "Failed to move calibration table to " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
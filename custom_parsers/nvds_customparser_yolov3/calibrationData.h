@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CALIBRATION_DATA_H__
+#define __CALIBRATION_DATA_H__
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/* Calibration tables written by IInt8EntropyCalibrator2 start with a line
+ * such as "TRT-7103-EntropyCalibration2". */
+#define CALIBRATION_TABLE_ALGORITHM "EntropyCalibration2"
+
+/**
+ * Preprocessing applied to calibration frames. Mirrors the nvinfer
+ * [property] keys used for the detector so INT8 ranges are collected on the
+ * same input distribution that is seen at inference time.
+ */
+struct CalibrationInputInfo
+{
+    uint width{0};
+    uint height{0};
+    uint channels{3};
+    float netScaleFactor{1.0f / 255.0f};
+    bool bgr{false};
+    bool maintainAspectRatio{true};
+};
+
+/**
+ * Walks a directory of representative frames (jpg/jpeg/png/bmp) in sorted
+ * order and produces batches of planar float input, independent of
+ * TensorRT. A trailing partial batch is dropped, as TensorRT expects full
+ * calibration batches. Implemented in calibrationImages.cpp, the only part
+ * of the library that needs OpenCV; the tables below build on the host alone.
+ */
+class CalibrationBatchLoader
+{
+public:
+    CalibrationBatchLoader(const std::string& imageDir, const uint batchSize,
+                           const CalibrationInputInfo& inputInfo);
+
+    /* Fills batch with the next batchSize frames. Returns false when the
+     * directory is exhausted. */
+    bool next(std::vector<float>& batch);
+    void reset() { m_Cursor = 0; }
+
+    uint getBatchSize() const { return m_BatchSize; }
+    size_t getBatchVolume() const;
+    size_t getNumImages() const { return m_ImagePaths.size(); }
+    uint getNumBatches() const { return m_ImagePaths.size() / m_BatchSize; }
+
+    /* Letterboxes (or stretches) one decoded frame into a CHW float plane
+     * set of the network size. pixels is HWC 8-bit, in BGR order. */
+    static void preprocess(const unsigned char* pixels, const uint srcW, const uint srcH,
+                           const CalibrationInputInfo& inputInfo, float* out);
+
+private:
+    const uint m_BatchSize;
+    const CalibrationInputInfo m_InputInfo;
+    std::vector<std::string> m_ImagePaths;
+    size_t m_Cursor {0};
+};
+
+/* Reads a calibration table. Returns false if the file is missing, empty or
+ * was produced by a different calibration algorithm. */
+bool readCalibrationTable(const std::string& path, std::vector<char>& table);
+
+/* Writes a calibration table through a temporary file and rename, so an
+ * interrupted build never leaves a truncated table behind. */
+bool writeCalibrationTable(const std::string& path, const void* data, const size_t length);
+
+#endif // __CALIBRATION_DATA_H__
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "calibrationData.h"
+
+#include <algorithm>
+#include <cassert>
+#include <experimental/filesystem>
+#include <iostream>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace fs = std::experimental::filesystem;
+
+CalibrationBatchLoader::CalibrationBatchLoader(
+    const std::string& imageDir, const uint batchSize, const CalibrationInputInfo& inputInfo) :
+    m_BatchSize(batchSize),
+    m_InputInfo(inputInfo)
+{
+    assert(m_BatchSize > 0);
+    assert(m_InputInfo.channels == 3);
+
+    if (!fs::is_directory(imageDir))
+    {
+        std::cerr << "Calibration image directory does not exist : " << imageDir << std::endl;
+        return;
+    }
+
+    for (const auto& entry : fs::directory_iterator(imageDir))
+    {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp")
+        {
+            m_ImagePaths.push_back(entry.path().string());
+        }
+    }
+    std::sort(m_ImagePaths.begin(), m_ImagePaths.end());
+
+    std::cout << "Found " << m_ImagePaths.size() << " calibration images in " << imageDir
+              << " (" << getNumBatches() << " batches of " << m_BatchSize << ")" << std::endl;
+}
+
+size_t CalibrationBatchLoader::getBatchVolume() const
+{
+    return static_cast<size_t>(m_BatchSize) * m_InputInfo.channels * m_InputInfo.height
+        * m_InputInfo.width;
+}
+
+bool CalibrationBatchLoader::next(std::vector<float>& batch)
+{
+    if (m_Cursor + m_BatchSize > m_ImagePaths.size()) return false;
+
+    const size_t frameVolume = getBatchVolume() / m_BatchSize;
+    batch.assign(getBatchVolume(), 0.0f);
+
+    for (uint i = 0; i < m_BatchSize; ++i, ++m_Cursor)
+    {
+        cv::Mat frame = cv::imread(m_ImagePaths[m_Cursor], cv::IMREAD_COLOR);
+        if (frame.empty())
+        {
+            std::cerr << "Failed to read calibration image : " << m_ImagePaths[m_Cursor]
+                      << std::endl;
+            return false;
+        }
+        if (!frame.isContinuous()) frame = frame.clone();
+        preprocess(frame.data, frame.cols, frame.rows, m_InputInfo,
+                   batch.data() + i * frameVolume);
+    }
+    return true;
+}
+
+void CalibrationBatchLoader::preprocess(const unsigned char* pixels, const uint srcW,
+                                        const uint srcH, const CalibrationInputInfo& inputInfo,
+                                        float* out)
+{
+    uint dstW = inputInfo.width;
+    uint dstH = inputInfo.height;
+    if (inputInfo.maintainAspectRatio)
+    {
+        // nvinfer scales to fit and pads right/bottom with zeros
+        const float ratio = std::min(static_cast<float>(inputInfo.width) / srcW,
+                                     static_cast<float>(inputInfo.height) / srcH);
+        dstW = std::max(1u, std::min(inputInfo.width, static_cast<uint>(srcW * ratio)));
+        dstH = std::max(1u, std::min(inputInfo.height, static_cast<uint>(srcH * ratio)));
+    }
+
+    const cv::Mat src(srcH, srcW, CV_8UC3, const_cast<unsigned char*>(pixels));
+    cv::Mat resized;
+    cv::resize(src, resized, cv::Size(dstW, dstH), 0, 0, cv::INTER_LINEAR);
+
+    const size_t plane = static_cast<size_t>(inputInfo.width) * inputInfo.height;
+    std::fill(out, out + plane * inputInfo.channels, 0.0f);
+
+    for (uint y = 0; y < dstH; ++y)
+    {
+        const unsigned char* row = resized.ptr<unsigned char>(y);
+        for (uint x = 0; x < dstW; ++x)
+        {
+            const size_t idx = y * inputInfo.width + x;
+            for (uint c = 0; c < 3; ++c)
+            {
+                // decoded pixels are BGR; swap unless the model wants BGR
+                const uint srcC = inputInfo.bgr ? c : 2 - c;
+                out[c * plane + idx] = row[x * 3 + srcC] * inputInfo.netScaleFactor;
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "calibrator.h"
+#include "trt_utils.h"
+#include "yoloPlugins.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+Int8EntropyCalibrator::Int8EntropyCalibrator(
+    const std::string& imageDir, const std::string& cachePath,
+    const std::string& inputBlobName, const uint batchSize,
+    const CalibrationInputInfo& inputInfo, const bool explicitBatch) :
+    m_Loader(imageDir, batchSize, inputInfo),
+    m_CachePath(cachePath),
+    m_InputBlobName(inputBlobName),
+    m_ExplicitBatch(explicitBatch)
+{
+}
+
+Int8EntropyCalibrator::~Int8EntropyCalibrator()
+{
+    if (m_DeviceInput) CHECK(cudaFree(m_DeviceInput));
+}
+
+bool Int8EntropyCalibrator::getBatch(void* bindings[], const char* names[], int nbBindings)
+{
+    if (!m_Loader.next(m_HostBatch)) return false;
+
+    const size_t bytes = m_HostBatch.size() * sizeof(float);
+    if (!m_DeviceInput) CHECK(cudaMalloc(&m_DeviceInput, bytes));
+    CHECK(cudaMemcpy(m_DeviceInput, m_HostBatch.data(), bytes, cudaMemcpyHostToDevice));
+
+    assert(nbBindings == 1);
+    assert(!strcmp(names[0], m_InputBlobName.c_str()));
+    UNUSED(nbBindings);
+    UNUSED(names);
+    bindings[0] = m_DeviceInput;
+    return true;
+}
+
+const void* Int8EntropyCalibrator::readCalibrationCache(size_t& length)
+{
+    if (!readCalibrationTable(m_CachePath, m_Cache))
+    {
+        std::cout << "No usable INT8 calibration table at " << m_CachePath
+                  << ", calibrating from " << m_Loader.getNumImages() << " images" << std::endl;
+        length = 0;
+        return nullptr;
+    }
+    std::cout << "Using INT8 calibration table " << m_CachePath << std::endl;
+    length = m_Cache.size();
+    return m_Cache.data();
+}
+
+void Int8EntropyCalibrator::writeCalibrationCache(const void* cache, size_t length)
+{
+    if (writeCalibrationTable(m_CachePath, cache, length))
+    {
+        std::cout << "Wrote INT8 calibration table " << m_CachePath << std::endl;
+    }
+}
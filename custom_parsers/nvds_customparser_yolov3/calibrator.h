@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CALIBRATOR_H__
+#define __CALIBRATOR_H__
+
+#include <string>
+#include <vector>
+
+#include "NvInfer.h"
+#include "calibrationData.h"
+
+/**
+ * INT8 entropy calibrator fed by CalibrationBatchLoader. When a valid table
+ * already exists at the cache path it is handed to TensorRT as is and no
+ * image is decoded; otherwise the table produced by calibration is
+ * persisted there for the next build. Explicit batch networks take the
+ * calibration batch size from the calibration profile and expect a batch
+ * size of 1 to be reported here.
+ */
+class Int8EntropyCalibrator : public nvinfer1::IInt8EntropyCalibrator2
+{
+public:
+    Int8EntropyCalibrator(const std::string& imageDir, const std::string& cachePath,
+                          const std::string& inputBlobName, const uint batchSize,
+                          const CalibrationInputInfo& inputInfo,
+                          const bool explicitBatch = false);
+    ~Int8EntropyCalibrator() override;
+
+    int getBatchSize() const override { return m_ExplicitBatch ? 1 : m_Loader.getBatchSize(); }
+    bool getBatch(void* bindings[], const char* names[], int nbBindings) override;
+    const void* readCalibrationCache(size_t& length) override;
+    void writeCalibrationCache(const void* cache, size_t length) override;
+
+private:
+    CalibrationBatchLoader m_Loader;
+    const std::string m_CachePath;
+    const std::string m_InputBlobName;
+    const bool m_ExplicitBatch;
+    std::vector<float> m_HostBatch;
+    std::vector<char> m_Cache;
+    void* m_DeviceInput {nullptr};
+};
+
+#endif // __CALIBRATOR_H__
@@ -10,6 +10,7 @@
  */
 
 #include <cuda.h>
+#include <cuda_fp16.h>
 #include <cuda_runtime.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -17,8 +18,14 @@
 
 inline __device__ float sigmoidGPU(const float& x) { return 1.0f / (1.0f + __expf(-x)); }
 
+// scale_x_y (YOLOv4) stretches the sigmoid so centres can reach cell borders
+inline __device__ float scaledSigmoidGPU(const float& x, const float& scaleXY)
+{
+    return sigmoidGPU(x) * scaleXY - 0.5f * (scaleXY - 1.0f);
+}
+
 __global__ void gpuYoloLayerV3(const float* input, float* output, const uint gridSize, const uint numOutputClasses,
-                               const uint numBBoxes)
+                               const uint numBBoxes, const float scaleXY)
 {
     uint x_id = blockIdx.x * blockDim.x + threadIdx.x;
     uint y_id = blockIdx.y * blockDim.y + threadIdx.y;
@@ -33,10 +40,10 @@ __global__ void gpuYoloLayerV3(const float* input, float* output, const uint gri
     const int bbindex = y_id * gridSize + x_id;
 
     output[bbindex + numGridCells * (z_id * (5 + numOutputClasses) + 0)]
-        = sigmoidGPU(input[bbindex + numGridCells * (z_id * (5 + numOutputClasses) + 0)]);
+        = scaledSigmoidGPU(input[bbindex + numGridCells * (z_id * (5 + numOutputClasses) + 0)], scaleXY);
 
     output[bbindex + numGridCells * (z_id * (5 + numOutputClasses) + 1)]
-        = sigmoidGPU(input[bbindex + numGridCells * (z_id * (5 + numOutputClasses) + 1)]);
+        = scaledSigmoidGPU(input[bbindex + numGridCells * (z_id * (5 + numOutputClasses) + 1)], scaleXY);
 
     output[bbindex + numGridCells * (z_id * (5 + numOutputClasses) + 2)]
         = __expf(input[bbindex + numGridCells * (z_id * (5 + numOutputClasses) + 2)]);
@@ -55,11 +62,11 @@ __global__ void gpuYoloLayerV3(const float* input, float* output, const uint gri
 }
 
 cudaError_t cudaYoloLayerV3(const void* input, void* output, const uint& batchSize, const uint& gridSize,
-                            const uint& numOutputClasses, const uint& numBBoxes,
+                            const uint& numOutputClasses, const uint& numBBoxes, const float& scaleXY,
                             uint64_t outputSize, cudaStream_t stream);
 
 cudaError_t cudaYoloLayerV3(const void* input, void* output, const uint& batchSize, const uint& gridSize,
-                            const uint& numOutputClasses, const uint& numBBoxes,
+                            const uint& numOutputClasses, const uint& numBBoxes, const float& scaleXY,
                             uint64_t outputSize, cudaStream_t stream)
 {
     dim3 threads_per_block(16, 16, 4);
@@ -71,7 +78,58 @@ cudaError_t cudaYoloLayerV3(const void* input, void* output, const uint& batchSi
         gpuYoloLayerV3<<<number_of_blocks, threads_per_block, 0, stream>>>(
             reinterpret_cast<const float*>(input) + (batch * outputSize),
             reinterpret_cast<float*>(output) + (batch * outputSize), gridSize, numOutputClasses,
-            numBBoxes);
+            numBBoxes, scaleXY);
+    }
+    return cudaGetLastError();
+}
+
+__global__ void gpuYoloLayerV3Half(const __half* input, __half* output, const uint gridSize,
+                                   const uint numOutputClasses, const uint numBBoxes,
+                                   const float scaleXY)
+{
+    uint x_id = blockIdx.x * blockDim.x + threadIdx.x;
+    uint y_id = blockIdx.y * blockDim.y + threadIdx.y;
+    uint z_id = blockIdx.z * blockDim.z + threadIdx.z;
+
+    if ((x_id >= gridSize) || (y_id >= gridSize) || (z_id >= numBBoxes))
+    {
+        return;
+    }
+
+    const int numGridCells = gridSize * gridSize;
+    const int bbindex = y_id * gridSize + x_id;
+
+    // Activations are evaluated in fp32 and only stored as half
+    for (uint i = 0; i < 5 + numOutputClasses; ++i)
+    {
+        const int idx = bbindex + numGridCells * (z_id * (5 + numOutputClasses) + i);
+        const float x = __half2float(input[idx]);
+        const float y = (i == 0 || i == 1) ? scaledSigmoidGPU(x, scaleXY)
+            : (i == 2 || i == 3) ? __expf(x) : sigmoidGPU(x);
+        output[idx] = __float2half(y);
+    }
+}
+
+cudaError_t cudaYoloLayerV3Half(const void* input, void* output, const uint& batchSize,
+                                const uint& gridSize, const uint& numOutputClasses,
+                                const uint& numBBoxes, const float& scaleXY,
+                                uint64_t outputSize, cudaStream_t stream);
+
+cudaError_t cudaYoloLayerV3Half(const void* input, void* output, const uint& batchSize,
+                                const uint& gridSize, const uint& numOutputClasses,
+                                const uint& numBBoxes, const float& scaleXY,
+                                uint64_t outputSize, cudaStream_t stream)
+{
+    dim3 threads_per_block(16, 16, 4);
+    dim3 number_of_blocks((gridSize / threads_per_block.x) + 1,
+                          (gridSize / threads_per_block.y) + 1,
+                          (numBBoxes / threads_per_block.z) + 1);
+    for (unsigned int batch = 0; batch < batchSize; ++batch)
+    {
+        gpuYoloLayerV3Half<<<number_of_blocks, threads_per_block, 0, stream>>>(
+            reinterpret_cast<const __half*>(input) + (batch * outputSize),
+            reinterpret_cast<__half*>(output) + (batch * outputSize), gridSize, numOutputClasses,
+            numBBoxes, scaleXY);
     }
     return cudaGetLastError();
 }
@@ -22,13 +22,66 @@
 
 #include "nvdsinfer_custom_impl.h"
 #include "nvdsinfer_context.h"
+#include "builderConfig.h"
 #include "yoloPlugins.h"
 #include "yolo.h"
 
 #include <algorithm>
+#include <cstdlib>
 
 #define USE_CUDA_ENGINE_GET_API 1
 
+/* Directory of representative frames for INT8 calibration. Defaults to a
+ * "calibration" directory next to int8-calib-file. */
+#define CALIB_IMAGES_ENV "HERMES_CALIB_IMAGES"
+
+/* Batch size the explicit batch optimization profile is tuned for, between 1
+ * and batch-size. Defaults to batch-size. */
+#define OPT_BATCH_ENV "HERMES_OPT_BATCH"
+
+static std::string dirName (const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    return (slash == std::string::npos) ? "." : path.substr(0, slash);
+}
+
+static bool getBuilderInfo (NetworkInfo &networkInfo, const NvDsInferContextInitParams* initParams)
+{
+    // workspace-size is in MB
+    networkInfo.workspaceSize = static_cast<size_t>(initParams->workspaceSize) << 20;
+
+    std::string configPath;
+    if (getenv(BUILDER_CONFIG_ENV)) {
+        configPath = getenv(BUILDER_CONFIG_ENV);
+        if (!readBuilderSettings(configPath, networkInfo.builderSettings)) {
+            std::cerr << "Invalid [" << BUILDER_CONFIG_GROUP << "] settings in "
+                      << configPath << std::endl;
+            return false;
+        }
+    }
+
+    cudaDeviceProp prop;
+    if (cudaGetDeviceProperties(&prop, initParams->gpuID) != cudaSuccess) {
+        std::cerr << "Failed to query GPU " << initParams->gpuID
+                  << ", building without a timing cache" << std::endl;
+        return true;
+    }
+    networkInfo.timingCacheKey = timingCacheKey(getInferLibVersion(), prop.name,
+                                                prop.major, prop.minor);
+
+    const std::string& cacheFile = networkInfo.builderSettings.timingCacheFile;
+    if (cacheFile.empty()) {
+        // nvinfer serializes engines next to the model file
+        networkInfo.timingCachePath = timingCachePath(dirName(initParams->modelFilePath),
+                                                      networkInfo.timingCacheKey);
+    } else if (cacheFile[0] == '/' || configPath.empty()) {
+        networkInfo.timingCachePath = cacheFile;
+    } else {
+        networkInfo.timingCachePath = dirName(configPath) + "/" + cacheFile;
+    }
+    return true;
+}
+
 static bool getYoloNetworkInfo (NetworkInfo &networkInfo, const NvDsInferContextInitParams* initParams)
 {
     std::string yoloCfg = initParams->customNetworkConfigFilePath;
@@ -47,6 +100,11 @@ static bool getYoloNetworkInfo (NetworkInfo &networkInfo, const NvDsInferContext
             yoloType = "yolov3-tiny";
         else
             yoloType = "yolov3";
+    } else if (yoloCfg.find("yolov4") != std::string::npos) {
+        if (yoloCfg.find("yolov4-tiny") != std::string::npos)
+            yoloType = "yolov4-tiny";
+        else
+            yoloType = "yolov4";
     } else {
         std::cerr << "Yolo type is not defined from config file name:"
                   << yoloCfg << std::endl;
@@ -58,6 +116,28 @@ static bool getYoloNetworkInfo (NetworkInfo &networkInfo, const NvDsInferContext
     networkInfo.wtsFilePath     = initParams->modelFilePath;
     networkInfo.deviceType      = (initParams->useDLA ? "kDLA" : "kGPU");
     networkInfo.inputBlobName   = "data";
+    networkInfo.maxBatchSize    = std::max(1u, initParams->maxBatchSize);
+    if (getenv(OPT_BATCH_ENV)) {
+        networkInfo.optBatchSize = std::max(0, atoi(getenv(OPT_BATCH_ENV)));
+    }
+
+    networkInfo.int8CalibPath   = initParams->int8CalibrationFilePath;
+    networkInfo.calibBatchSize  = std::max(1u, initParams->maxBatchSize);
+    networkInfo.netScaleFactor  = initParams->networkScaleFactor;
+    networkInfo.bgrInput        = (initParams->networkInputFormat == NvDsInferFormat_BGR);
+    networkInfo.maintainAspectRatio = initParams->maintainAspectRatio;
+    if (getenv(CALIB_IMAGES_ENV)) {
+        networkInfo.calibImageDir = getenv(CALIB_IMAGES_ENV);
+    } else if (!networkInfo.int8CalibPath.empty()) {
+        size_t slash = networkInfo.int8CalibPath.find_last_of('/');
+        networkInfo.calibImageDir = (slash == std::string::npos)
+            ? "calibration"
+            : networkInfo.int8CalibPath.substr(0, slash + 1) + "calibration";
+    }
+
+    if (!getBuilderInfo(networkInfo, initParams)) {
+        return false;
+    }
 
     if (networkInfo.configFilePath.empty() ||
         networkInfo.wtsFilePath.empty()) {
@@ -105,7 +185,7 @@ bool NvDsInferYoloCudaEngineGet(nvinfer1::IBuilder * const builder,
     }
 
     Yolo yolo(networkInfo);
-    cudaEngine = yolo.createEngine (builder);
+    cudaEngine = yolo.createEngine (builder, dataType);
     if (cudaEngine == nullptr)
     {
         std::cerr << "Failed to build cuda engine on "
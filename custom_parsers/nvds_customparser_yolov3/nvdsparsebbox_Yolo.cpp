@@ -27,11 +27,47 @@
 #include <fstream>
 #include <iostream>
 #include <unordered_map>
+#include "hermes_log.h"
 #include "nvdsinfer_custom_impl.h"
 #include "trt_utils.h"
+#include "yoloDecodeCpu.h"
+#include "yoloParsePool.h"
 
 static const int NUM_CLASSES_YOLO = 1;
 
+/* Anchors of the [yolo] layers of each cfg, and the anchors every output
+ * head uses, largest stride first */
+struct YoloAnchors
+{
+    std::vector<float> anchors;
+    std::vector<std::vector<int>> masks;
+};
+
+static const YoloAnchors kYOLOV3 = {
+    {10.0, 13.0, 16.0,  30.0,  33.0, 23.0,  30.0,  61.0,  62.0,
+     45.0, 59.0, 119.0, 116.0, 90.0, 156.0, 198.0, 373.0, 326.0},
+    {{6, 7, 8},
+     {3, 4, 5},
+     {0, 1, 2}}};
+
+static const YoloAnchors kYOLOV3_TINY = {
+    {10, 14, 23, 27, 37, 58, 81, 82, 135, 169, 344, 319},
+    {{3, 4, 5},
+     //{0, 1, 2}}; // as per output result, select {1,2,3}
+     {1, 2, 3}}};
+
+static const YoloAnchors kYOLOV4 = {
+    {12.0, 16.0, 19.0, 36.0, 40.0, 28.0, 36.0, 75.0, 76.0,
+     55.0, 72.0, 146.0, 142.0, 110.0, 192.0, 243.0, 459.0, 401.0},
+    {{6, 7, 8},
+     {3, 4, 5},
+     {0, 1, 2}}};
+
+static const YoloAnchors kYOLOV4_TINY = {
+    {10, 14, 23, 27, 37, 58, 81, 82, 135, 169, 344, 319},
+    {{3, 4, 5},
+     {1, 2, 3}}};
+
 extern "C" bool NvDsInferParseCustomYoloV3(
     std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
     NvDsInferNetworkInfo const& networkInfo,
@@ -44,6 +80,24 @@ extern "C" bool NvDsInferParseCustomYoloV3Tiny(
     NvDsInferParseDetectionParams const& detectionParams,
     std::vector<NvDsInferParseObjectInfo>& objectList);
 
+extern "C" bool NvDsInferParseCustomYoloV3Cpu(
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    NvDsInferNetworkInfo const& networkInfo,
+    NvDsInferParseDetectionParams const& detectionParams,
+    std::vector<NvDsInferParseObjectInfo>& objectList);
+
+extern "C" bool NvDsInferParseCustomYoloV4(
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    NvDsInferNetworkInfo const& networkInfo,
+    NvDsInferParseDetectionParams const& detectionParams,
+    std::vector<NvDsInferParseObjectInfo>& objectList);
+
+extern "C" bool NvDsInferParseCustomYoloV4Tiny(
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    NvDsInferNetworkInfo const& networkInfo,
+    NvDsInferParseDetectionParams const& detectionParams,
+    std::vector<NvDsInferParseObjectInfo>& objectList);
+
 extern "C" bool NvDsInferParseCustomYoloV2(
     std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
     NvDsInferNetworkInfo const& networkInfo,
@@ -154,59 +208,6 @@ decodeYoloV2Tensor(
     return binfo;
 }
 
-static std::vector<NvDsInferParseObjectInfo>
-decodeYoloV3Tensor(
-    const float* detections, const std::vector<int> &mask, const std::vector<float> &anchors,
-    const uint gridSizeW, const uint gridSizeH, const uint stride, const uint numBBoxes,
-    const uint numOutputClasses, const uint& netW,
-    const uint& netH)
-{
-    std::vector<NvDsInferParseObjectInfo> binfo;
-    for (uint y = 0; y < gridSizeH; ++y) {
-        for (uint x = 0; x < gridSizeW; ++x) {
-            for (uint b = 0; b < numBBoxes; ++b)
-            {
-                const float pw = anchors[mask[b] * 2];
-                const float ph = anchors[mask[b] * 2 + 1];
-
-                const int numGridCells = gridSizeH * gridSizeW;
-                const int bbindex = y * gridSizeW + x;
-                const float bx
-                    = x + detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 0)];
-                const float by
-                    = y + detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 1)];
-                const float bw
-                    = pw * detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 2)];
-                const float bh
-                    = ph * detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 3)];
-
-                const float objectness
-                    = detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 4)];
-
-                float maxProb = 0.0f;
-                int maxIndex = -1;
-
-                for (uint i = 0; i < numOutputClasses; ++i)
-                {
-                    float prob
-                        = (detections[bbindex
-                                      + numGridCells * (b * (5 + numOutputClasses) + (5 + i))]);
-
-                    if (prob > maxProb)
-                    {
-                        maxProb = prob;
-                        maxIndex = i;
-                    }
-                }
-                maxProb = objectness * maxProb;
-
-                addBBoxProposal(bx, by, bw, bh, stride, netW, netH, maxIndex, maxProb, binfo);
-            }
-        }
-    }
-    return binfo;
-}
-
 static inline std::vector<const NvDsInferLayerInfo*>
 SortLayers(const std::vector<NvDsInferLayerInfo> & outputLayersInfo)
 {
@@ -221,6 +222,40 @@ SortLayers(const std::vector<NvDsInferLayerInfo> & outputLayersInfo)
     return outLayers;
 }
 
+static YoloHeadInfo
+YoloHead(const NvDsInferLayerInfo& layer, NvDsInferNetworkInfo const& networkInfo,
+         const std::vector<int>& mask, const std::vector<float>& anchors, const uint numBBoxes)
+{
+    assert(layer.inferDims.numDims == 3);
+    YoloHeadInfo head;
+    head.gridSizeH = layer.inferDims.d[1];
+    head.gridSizeW = layer.inferDims.d[2];
+    head.stride = DIVUP(networkInfo.width, head.gridSizeW);
+    assert(head.stride == DIVUP(networkInfo.height, head.gridSizeH));
+    head.numBBoxes = numBBoxes;
+    head.numClasses = NUM_CLASSES_YOLO;
+    head.mask = mask;
+    head.anchors = anchors;
+    return head;
+}
+
+static void
+ToParseObjects(const std::vector<YoloBox>& boxes, std::vector<NvDsInferParseObjectInfo>& objectList)
+{
+    objectList.clear();
+    objectList.reserve(boxes.size());
+    for (const YoloBox& b : boxes) {
+        NvDsInferParseObjectInfo obj;
+        obj.classId = b.classId;
+        obj.left = b.left;
+        obj.top = b.top;
+        obj.width = b.width;
+        obj.height = b.height;
+        obj.detectionConfidence = b.confidence;
+        objectList.push_back(obj);
+    }
+}
+
 static bool NvDsInferParseYoloV3(
     std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
     NvDsInferNetworkInfo const& networkInfo,
@@ -235,37 +270,32 @@ static bool NvDsInferParseYoloV3(
         SortLayers (outputLayersInfo);
 
     if (sortedLayers.size() != masks.size()) {
-        std::cerr << "ERROR: yoloV3 output layer.size: " << sortedLayers.size()
-                  << " does not match mask.size: " << masks.size() << std::endl;
+        HERMES_LOG(WildFireDetection::LOG_LEVEL_ERROR, "yoloV3 output layer count does not match masks",
+                   WildFireDetection::log_field("layers", sortedLayers.size()),
+                   WildFireDetection::log_field("masks", masks.size()));
         return false;
     }
 
     if (NUM_CLASSES_YOLO != detectionParams.numClassesConfigured)
     {
-        std::cerr << "WARNING: Num classes mismatch. Configured:"
-                  << detectionParams.numClassesConfigured
-                  << ", detected by network: " << NUM_CLASSES_YOLO << std::endl;
+        HERMES_LOG(WildFireDetection::LOG_LEVEL_WARNING, "Num classes mismatch",
+                   WildFireDetection::log_field("configured", detectionParams.numClassesConfigured),
+                   WildFireDetection::log_field("network", NUM_CLASSES_YOLO));
     }
 
-    std::vector<NvDsInferParseObjectInfo> objects;
-
+    // Heads are cut into row bands decoded on YoloParsePool, see decodeYoloV3Pooled
+    std::vector<const float*> buffers;
+    std::vector<YoloHeadInfo> heads;
     for (uint idx = 0; idx < masks.size(); ++idx) {
         const NvDsInferLayerInfo &layer = *sortedLayers[idx]; // 255 x Grid x Grid
-
-        assert(layer.inferDims.numDims == 3);
-        const uint gridSizeH = layer.inferDims.d[1];
-        const uint gridSizeW = layer.inferDims.d[2];
-        const uint stride = DIVUP(networkInfo.width, gridSizeW);
-        assert(stride == DIVUP(networkInfo.height, gridSizeH));
-
-        std::vector<NvDsInferParseObjectInfo> outObjs =
-            decodeYoloV3Tensor((const float*)(layer.buffer), masks[idx], anchors, gridSizeW, gridSizeH, stride, kNUM_BBOXES,
-                       NUM_CLASSES_YOLO, networkInfo.width, networkInfo.height);
-        objects.insert(objects.end(), outObjs.begin(), outObjs.end());
+        buffers.push_back((const float*)(layer.buffer));
+        heads.push_back(YoloHead(layer, networkInfo, masks[idx], anchors, kNUM_BBOXES));
     }
 
-
-    objectList = objects;
+    std::vector<YoloBox> boxes;
+    decodeYoloV3Pooled(YoloParsePool::instance(), buffers, heads,
+                       networkInfo.width, networkInfo.height, boxes);
+    ToParseObjects(boxes, objectList);
 
     return true;
 }
@@ -278,16 +308,43 @@ extern "C" bool NvDsInferParseCustomYoloV3(
     NvDsInferParseDetectionParams const& detectionParams,
     std::vector<NvDsInferParseObjectInfo>& objectList)
 {
-    static const std::vector<float> kANCHORS = {
-        10.0, 13.0, 16.0,  30.0,  33.0, 23.0,  30.0,  61.0,  62.0,
-        45.0, 59.0, 119.0, 116.0, 90.0, 156.0, 198.0, 373.0, 326.0};
-    static const std::vector<std::vector<int>> kMASKS = {
-        {6, 7, 8},
-        {3, 4, 5},
-        {0, 1, 2}};
     return NvDsInferParseYoloV3 (
         outputLayersInfo, networkInfo, detectionParams, objectList,
-        kANCHORS, kMASKS);
+        kYOLOV3.anchors, kYOLOV3.masks);
+}
+
+/* Host fallback for engines whose yolo heads are plain conv outputs, built
+ * with yolo-head=cpu in the [builder] group so no YoloLayerV3 plugin is
+ * added. Activations are applied on the CPU by yoloDecodeCpu before the
+ * usual decode. */
+extern "C" bool NvDsInferParseCustomYoloV3Cpu(
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    NvDsInferNetworkInfo const& networkInfo,
+    NvDsInferParseDetectionParams const& detectionParams,
+    std::vector<NvDsInferParseObjectInfo>& objectList)
+{
+    const uint kNUM_BBOXES = 3;
+
+    const std::vector<const NvDsInferLayerInfo*> sortedLayers =
+        SortLayers (outputLayersInfo);
+
+    if (sortedLayers.size() != kYOLOV3.masks.size()) {
+        HERMES_LOG(WildFireDetection::LOG_LEVEL_ERROR, "yoloV3 output layer count does not match masks",
+                   WildFireDetection::log_field("layers", sortedLayers.size()),
+                   WildFireDetection::log_field("masks", kYOLOV3.masks.size()));
+        return false;
+    }
+
+    std::vector<YoloBox> boxes;
+    for (uint idx = 0; idx < kYOLOV3.masks.size(); ++idx) {
+        const NvDsInferLayerInfo &layer = *sortedLayers[idx];
+        decodeYoloV3RawVectorized((const float*)(layer.buffer),
+                                  YoloHead(layer, networkInfo, kYOLOV3.masks[idx], kYOLOV3.anchors, kNUM_BBOXES),
+                                  networkInfo.width, networkInfo.height, boxes);
+    }
+    ToParseObjects(boxes, objectList);
+
+    return true;
 }
 
 extern "C" bool NvDsInferParseCustomYoloV3Tiny(
@@ -296,16 +353,33 @@ extern "C" bool NvDsInferParseCustomYoloV3Tiny(
     NvDsInferParseDetectionParams const& detectionParams,
     std::vector<NvDsInferParseObjectInfo>& objectList)
 {
-    static const std::vector<float> kANCHORS = {
-        10, 14, 23, 27, 37, 58, 81, 82, 135, 169, 344, 319};
-    static const std::vector<std::vector<int>> kMASKS = {
-        {3, 4, 5},
-        //{0, 1, 2}}; // as per output result, select {1,2,3}
-        {1, 2, 3}};
+    return NvDsInferParseYoloV3 (
+        outputLayersInfo, networkInfo, detectionParams, objectList,
+        kYOLOV3_TINY.anchors, kYOLOV3_TINY.masks);
+}
+
+/* YOLOv4 heads share the v3 decode; scale_x_y is already applied to x/y by
+ * the YoloLayerV3 plugin. */
+extern "C" bool NvDsInferParseCustomYoloV4(
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    NvDsInferNetworkInfo const& networkInfo,
+    NvDsInferParseDetectionParams const& detectionParams,
+    std::vector<NvDsInferParseObjectInfo>& objectList)
+{
+    return NvDsInferParseYoloV3 (
+        outputLayersInfo, networkInfo, detectionParams, objectList,
+        kYOLOV4.anchors, kYOLOV4.masks);
+}
 
+extern "C" bool NvDsInferParseCustomYoloV4Tiny(
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    NvDsInferNetworkInfo const& networkInfo,
+    NvDsInferParseDetectionParams const& detectionParams,
+    std::vector<NvDsInferParseObjectInfo>& objectList)
+{
     return NvDsInferParseYoloV3 (
         outputLayersInfo, networkInfo, detectionParams, objectList,
-        kANCHORS, kMASKS);
+        kYOLOV4_TINY.anchors, kYOLOV4_TINY.masks);
 }
 
 static bool NvDsInferParseYoloV2(
@@ -320,16 +394,16 @@ static bool NvDsInferParseYoloV2(
     const uint kNUM_BBOXES = 5;
 
     if (outputLayersInfo.empty()) {
-        std::cerr << "Could not find output layer in bbox parsing" << std::endl;;
+        HERMES_LOG(WildFireDetection::LOG_LEVEL_ERROR, "Could not find output layer in bbox parsing");
         return false;
     }
     const NvDsInferLayerInfo &layer = outputLayersInfo[0];
 
     if (NUM_CLASSES_YOLO != detectionParams.numClassesConfigured)
     {
-        std::cerr << "WARNING: Num classes mismatch. Configured:"
-                  << detectionParams.numClassesConfigured
-                  << ", detected by network: " << NUM_CLASSES_YOLO << std::endl;
+        HERMES_LOG(WildFireDetection::LOG_LEVEL_WARNING, "Num classes mismatch",
+                   WildFireDetection::log_field("configured", detectionParams.numClassesConfigured),
+                   WildFireDetection::log_field("network", NUM_CLASSES_YOLO));
     }
 
     assert(layer.inferDims.numDims == 3);
@@ -378,9 +452,9 @@ extern "C" bool NvDsInferParseCustomYoloTLT(
 
     if(outputLayersInfo.size() != 4)
     {
-        std::cerr << "Mismatch in the number of output buffers."
-                  << "Expected 4 output buffers, detected in the network :"
-                  << outputLayersInfo.size() << std::endl;
+        HERMES_LOG(WildFireDetection::LOG_LEVEL_ERROR, "Mismatch in the number of output buffers",
+                   WildFireDetection::log_field("expected", 4),
+                   WildFireDetection::log_field("network", outputLayersInfo.size()));
         return false;
     }
 
@@ -424,6 +498,9 @@ extern "C" bool NvDsInferParseCustomYoloTLT(
 /* Check that the custom function has been defined correctly */
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV3);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV3Tiny);
+CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV3Cpu);
+CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV4);
+CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV4Tiny);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV2);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV2Tiny);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloTLT);
@@ -68,35 +68,12 @@ std::vector<float> loadWeights(const std::string weightsFilePath, const std::str
 {
     assert(fileExists(weightsFilePath));
     std::cout << "Loading pre-trained weights..." << std::endl;
-    std::ifstream file(weightsFilePath, std::ios_base::binary);
-    assert(file.good());
-    std::string line;
-
-    if (networkType == "yolov2")
-    {
-        // Remove 4 int32 bytes of data from the stream belonging to the header
-        file.ignore(4 * 4);
-    }
-    else if ((networkType == "yolov3") || (networkType == "yolov3-tiny")
-             || (networkType == "yolov2-tiny"))
-    {
-        // Remove 5 int32 bytes of data from the stream belonging to the header
-        file.ignore(4 * 5);
-    }
-    else
-    {
-        std::cout << "Invalid network type" << std::endl;
-        assert(0);
-    }
-
     std::vector<float> weights;
-    char floatWeight[4];
-    while (!file.eof())
+    std::string error;
+    if (!readDarknetWeights(weightsFilePath, networkType, weights, error))
     {
-        file.read(floatWeight, 4);
-        assert(file.gcount() == 4);
-        weights.push_back(*reinterpret_cast<float*>(floatWeight));
-        if (file.peek() == std::istream::traits_type::eof()) break;
+        std::cout << error << std::endl;
+        assert(0);
     }
     std::cout << "Loading weights of " << networkType << " complete!"
               << std::endl;
@@ -108,7 +85,9 @@ std::string dimsToString(const nvinfer1::Dims d)
 {
     std::stringstream s;
     assert(d.nbDims >= 1);
-    for (int i = 0; i < d.nbDims - 1; ++i)
+    // leave out the dynamic batch dimension of explicit batch networks
+    const int first = (d.nbDims == 4 && d.d[0] == -1) ? 1 : 0;
+    for (int i = first; i < d.nbDims - 1; ++i)
     {
         s << std::setw(4) << d.d[i] << " x";
     }
@@ -133,12 +112,17 @@ void displayDimType(const nvinfer1::Dims d)
     std::cout << std::endl;
 }
 
-int getNumChannels(nvinfer1::ITensor* t)
+int getChannelAxis(nvinfer1::ITensor* t)
 {
     nvinfer1::Dims d = t->getDimensions();
-    assert(d.nbDims == 3);
+    assert(d.nbDims == 3 || d.nbDims == 4);
+
+    return d.nbDims - 3;
+}
 
-    return d.d[0];
+int getNumChannels(nvinfer1::ITensor* t)
+{
+    return t->getDimensions().d[getChannelAxis(t)];
 }
 
 uint64_t get3DTensorVolume(nvinfer1::Dims inputDims)
@@ -223,16 +207,141 @@ nvinfer1::ILayer* netAddConvLinear(int layerIdx, std::map<std::string, std::stri
     return conv;
 }
 
+nvinfer1::ILayer* netAddActivation(int layerIdx, const std::string& activation,
+                                   nvinfer1::ITensor* input,
+                                   nvinfer1::INetworkDefinition* network)
+{
+    if (activation == "linear")
+    {
+        // identity, nothing to add
+        return nullptr;
+    }
+    else if (activation == "leaky")
+    {
+        nvinfer1::IActivationLayer* leaky = network->addActivation(
+            *input, nvinfer1::ActivationType::kLEAKY_RELU);
+        assert(leaky != nullptr);
+        leaky->setAlpha(0.1);
+        std::string leakyLayerName = "leaky_" + std::to_string(layerIdx);
+        leaky->setName(leakyLayerName.c_str());
+        return leaky;
+    }
+    else if (activation == "logistic")
+    {
+        nvinfer1::IActivationLayer* sigmoid = network->addActivation(
+            *input, nvinfer1::ActivationType::kSIGMOID);
+        assert(sigmoid != nullptr);
+        std::string sigmoidLayerName = "logistic_" + std::to_string(layerIdx);
+        sigmoid->setName(sigmoidLayerName.c_str());
+        return sigmoid;
+    }
+    else if (activation == "swish")
+    {
+        // x * sigmoid(x)
+        nvinfer1::IActivationLayer* sigmoid = network->addActivation(
+            *input, nvinfer1::ActivationType::kSIGMOID);
+        assert(sigmoid != nullptr);
+        std::string sigmoidLayerName = "swish_sigmoid_" + std::to_string(layerIdx);
+        sigmoid->setName(sigmoidLayerName.c_str());
+        nvinfer1::IElementWiseLayer* swish = network->addElementWise(
+            *input, *sigmoid->getOutput(0), nvinfer1::ElementWiseOperation::kPROD);
+        assert(swish != nullptr);
+        std::string swishLayerName = "swish_" + std::to_string(layerIdx);
+        swish->setName(swishLayerName.c_str());
+        return swish;
+    }
+    else if (activation == "mish")
+    {
+        // x * tanh(softplus(x)), TensorRT has no native mish
+        nvinfer1::IActivationLayer* softplus = network->addActivation(
+            *input, nvinfer1::ActivationType::kSOFTPLUS);
+        assert(softplus != nullptr);
+        softplus->setAlpha(1.0);
+        softplus->setBeta(1.0);
+        std::string softplusLayerName = "mish_softplus_" + std::to_string(layerIdx);
+        softplus->setName(softplusLayerName.c_str());
+        nvinfer1::IActivationLayer* tanh = network->addActivation(
+            *softplus->getOutput(0), nvinfer1::ActivationType::kTANH);
+        assert(tanh != nullptr);
+        std::string tanhLayerName = "mish_tanh_" + std::to_string(layerIdx);
+        tanh->setName(tanhLayerName.c_str());
+        nvinfer1::IElementWiseLayer* mish = network->addElementWise(
+            *input, *tanh->getOutput(0), nvinfer1::ElementWiseOperation::kPROD);
+        assert(mish != nullptr);
+        std::string mishLayerName = "mish_" + std::to_string(layerIdx);
+        mish->setName(mishLayerName.c_str());
+        return mish;
+    }
+
+    std::cout << "Unsupported activation --> \"" << activation << "\"" << std::endl;
+    assert(0);
+    return nullptr;
+}
+
+nvinfer1::ILayer* netAddConvFolded(int layerIdx, std::map<std::string, std::string>& block,
+                                   const FoldedConv& folded, int& inputChannels,
+                                   nvinfer1::ITensor* input,
+                                   nvinfer1::INetworkDefinition* network)
+{
+    assert(block.at("type") == "convolutional");
+    assert(block.find("activation") != block.end());
+    assert(block.find("filters") != block.end());
+    assert(block.find("pad") != block.end());
+    assert(block.find("size") != block.end());
+    assert(block.find("stride") != block.end());
+
+    int filters = std::stoi(block.at("filters"));
+    int padding = std::stoi(block.at("pad"));
+    int kernelSize = std::stoi(block.at("size"));
+    int stride = std::stoi(block.at("stride"));
+    int pad;
+    if (padding)
+        pad = (kernelSize - 1) / 2;
+    else
+        pad = 0;
+    assert((int)folded.filters == filters && (int)folded.kernelSize == kernelSize
+           && (int)folded.inputChannels == inputChannels);
+
+    // FP16 containers are handed over as they are, TensorRT converts on build
+    const nvinfer1::DataType type = folded.fp16 ? nvinfer1::DataType::kHALF
+                                                : nvinfer1::DataType::kFLOAT;
+    nvinfer1::Weights convWt{type, folded.kernel, (int64_t)folded.kernelCount()};
+    nvinfer1::Weights convBias{type, folded.bias, filters};
+    nvinfer1::IConvolutionLayer* conv = network->addConvolution(
+        *input, filters, nvinfer1::DimsHW{kernelSize, kernelSize}, convWt, convBias);
+    assert(conv != nullptr);
+    std::string convLayerName = "conv_" + std::to_string(layerIdx);
+    conv->setName(convLayerName.c_str());
+    conv->setStride(nvinfer1::DimsHW{stride, stride});
+    conv->setPadding(nvinfer1::DimsHW{pad, pad});
+
+    nvinfer1::ILayer* act = netAddActivation(layerIdx, block.at("activation"),
+                                             conv->getOutput(0), network);
+    return act ? act : conv;
+}
+
 nvinfer1::ILayer* netAddConvBNLeaky(int layerIdx, std::map<std::string, std::string>& block,
                                     std::vector<float>& weights,
                                     std::vector<nvinfer1::Weights>& trtWeights, int& weightPtr,
                                     int& inputChannels, nvinfer1::ITensor* input,
                                     nvinfer1::INetworkDefinition* network)
+{
+    assert(block.at("activation") == "leaky");
+    return netAddConvBNActivation(layerIdx, block, weights, trtWeights, weightPtr,
+                                  inputChannels, input, network);
+}
+
+nvinfer1::ILayer* netAddConvBNActivation(int layerIdx, std::map<std::string, std::string>& block,
+                                         std::vector<float>& weights,
+                                         std::vector<nvinfer1::Weights>& trtWeights,
+                                         int& weightPtr, int& inputChannels,
+                                         nvinfer1::ITensor* input,
+                                         nvinfer1::INetworkDefinition* network)
 {
     assert(block.at("type") == "convolutional");
     assert(block.find("batch_normalize") != block.end());
     assert(block.at("batch_normalize") == "1");
-    assert(block.at("activation") == "leaky");
+    assert(block.find("activation") != block.end());
     assert(block.find("filters") != block.end());
     assert(block.find("pad") != block.end());
     assert(block.find("size") != block.end());
@@ -249,7 +358,7 @@ nvinfer1::ILayer* netAddConvBNLeaky(int layerIdx, std::map<std::string, std::str
         batchNormalize = false;
         bias = true;
     }
-    // all conv_bn_leaky layers assume bias is false
+    // all conv_bn_activation layers assume bias is false
     assert(batchNormalize == true && bias == false);
     UNUSED(batchNormalize);
     UNUSED(bias);
@@ -354,21 +463,44 @@ nvinfer1::ILayer* netAddConvBNLeaky(int layerIdx, std::map<std::string, std::str
     bn->setName(bnLayerName.c_str());
     /***** ACTIVATION LAYER *****/
     /****************************/
-    nvinfer1::ITensor* bnOutput = bn->getOutput(0);
-    nvinfer1::IActivationLayer* leaky = network->addActivation(
-        *bnOutput, nvinfer1::ActivationType::kLEAKY_RELU);
-    leaky->setAlpha(0.1);
-    assert(leaky != nullptr);
-    std::string leakyLayerName = "leaky_" + std::to_string(layerIdx);
-    leaky->setName(leakyLayerName.c_str());
-
-    return leaky;
+    nvinfer1::ILayer* act = netAddActivation(layerIdx, block.at("activation"),
+                                             bn->getOutput(0), network);
+
+    return act ? act : bn;
 }
 
 nvinfer1::ILayer* netAddUpsample(int layerIdx, std::map<std::string, std::string>& block,
                                  std::vector<float>& weights,
                                  std::vector<nvinfer1::Weights>& trtWeights, int& inputChannels,
                                  nvinfer1::ITensor* input, nvinfer1::INetworkDefinition* network)
+{
+#if NV_TENSORRT_MAJOR >= 6
+    assert(block.at("type") == "upsample");
+    const int channelAxis = getChannelAxis(input);
+    const float stride = std::stof(block.at("stride"));
+    // nearest resize, no constants and no wasted multiply-adds. Scales
+    // rather than output dimensions, which would pin a dynamic batch.
+    nvinfer1::IResizeLayer* resize = network->addResize(*input);
+    assert(resize != nullptr);
+    std::vector<float> scales(channelAxis + 1, 1.0f);
+    scales.push_back(stride);
+    scales.push_back(stride);
+    resize->setScales(scales.data(), scales.size());
+    resize->setResizeMode(nvinfer1::ResizeMode::kNEAREST);
+    std::string resizeLayerName = "upsample_" + std::to_string(layerIdx);
+    resize->setName(resizeLayerName.c_str());
+    return resize;
+#else
+    return netAddUpsampleMatMul(layerIdx, block, weights, trtWeights, inputChannels, input,
+                                network);
+#endif
+}
+
+nvinfer1::ILayer* netAddUpsampleMatMul(int layerIdx, std::map<std::string, std::string>& block,
+                                       std::vector<float>& weights,
+                                       std::vector<nvinfer1::Weights>& trtWeights,
+                                       int& inputChannels, nvinfer1::ITensor* input,
+                                       nvinfer1::INetworkDefinition* network)
 {
     assert(block.at("type") == "upsample");
     nvinfer1::Dims inpDims = input->getDimensions();
@@ -455,6 +587,67 @@ nvinfer1::ILayer* netAddUpsample(int layerIdx, std::map<std::string, std::string
     return mm2;
 }
 
+nvinfer1::ILayer* netAddRouteGroup(int layerIdx, int groups, int groupId,
+                                   std::vector<nvinfer1::Weights>& trtWeights,
+                                   nvinfer1::ITensor* input, nvinfer1::INetworkDefinition* network)
+{
+    nvinfer1::Dims inpDims = input->getDimensions();
+    const int channelAxis = getChannelAxis(input);
+    const int channels = inpDims.d[channelAxis];
+    assert(groups > 0 && channels % groups == 0);
+    assert(groupId >= 0 && groupId < groups);
+    int groupChannels = channels / groups;
+
+    nvinfer1::Dims start = inpDims;
+    nvinfer1::Dims size = inpDims;
+    nvinfer1::Dims stride = inpDims;
+    for (int i = 0; i < inpDims.nbDims; ++i)
+    {
+        start.d[i] = 0;
+        stride.d[i] = 1;
+    }
+    start.d[channelAxis] = groupId * groupChannels;
+    size.d[channelAxis] = groupChannels;
+    if (channelAxis > 0) size.d[0] = 1;
+
+    nvinfer1::ISliceLayer* slice = network->addSlice(*input, start, size, stride);
+    assert(slice != nullptr);
+    std::string sliceLayerName = "route_group_" + std::to_string(layerIdx);
+    slice->setName(sliceLayerName.c_str());
+
+    if (channelAxis > 0)
+    {
+        // The batch is only known at runtime: size = shape(input) * keep + group
+        int* keep = new int[inpDims.nbDims];
+        int* group = new int[inpDims.nbDims];
+        for (int i = 0; i < inpDims.nbDims; ++i)
+        {
+            keep[i] = (i == channelAxis) ? 0 : 1;
+            group[i] = (i == channelAxis) ? groupChannels : 0;
+        }
+        nvinfer1::Dims shapeDims{1, {inpDims.nbDims}};
+        nvinfer1::Weights keepWt{nvinfer1::DataType::kINT32, keep, inpDims.nbDims};
+        nvinfer1::Weights groupWt{nvinfer1::DataType::kINT32, group, inpDims.nbDims};
+        trtWeights.push_back(keepWt);
+        trtWeights.push_back(groupWt);
+
+        nvinfer1::IShapeLayer* shape = network->addShape(*input);
+        assert(shape != nullptr);
+        nvinfer1::IConstantLayer* keepConst = network->addConstant(shapeDims, keepWt);
+        nvinfer1::IConstantLayer* groupConst = network->addConstant(shapeDims, groupWt);
+        assert(keepConst != nullptr && groupConst != nullptr);
+        nvinfer1::IElementWiseLayer* masked = network->addElementWise(
+            *shape->getOutput(0), *keepConst->getOutput(0), nvinfer1::ElementWiseOperation::kPROD);
+        assert(masked != nullptr);
+        nvinfer1::IElementWiseLayer* sliceSize = network->addElementWise(
+            *masked->getOutput(0), *groupConst->getOutput(0), nvinfer1::ElementWiseOperation::kSUM);
+        assert(sliceSize != nullptr);
+        slice->setInput(2, *sliceSize->getOutput(0));
+    }
+
+    return slice;
+}
+
 void printLayerInfo(std::string layerIndex, std::string layerName, std::string layerInput,
                     std::string layerOutput, std::string weightPtr)
 {
@@ -33,6 +33,7 @@
 #include <fstream>
 
 #include "NvInfer.h"
+#include "yoloWeights.h"
 
 #define UNUSED(expr) (void)(expr)
 #define DIVUP(n, d) ((n) + (d)-1) / (d)
@@ -43,6 +44,9 @@ bool fileExists(const std::string fileName, bool verbose = true);
 std::vector<float> loadWeights(const std::string weightsFilePath, const std::string& networkType);
 std::string dimsToString(const nvinfer1::Dims d);
 void displayDimType(const nvinfer1::Dims d);
+// Axis of the channel dimension, 1 in explicit batch (NCHW) networks and 0
+// with an implicit batch (CHW)
+int getChannelAxis(nvinfer1::ITensor* t);
 int getNumChannels(nvinfer1::ITensor* t);
 uint64_t get3DTensorVolume(nvinfer1::Dims inputDims);
 
@@ -54,15 +58,43 @@ nvinfer1::ILayer* netAddConvLinear(int layerIdx, std::map<std::string, std::stri
                                    std::vector<nvinfer1::Weights>& trtWeights, int& weightPtr,
                                    int& inputChannels, nvinfer1::ITensor* input,
                                    nvinfer1::INetworkDefinition* network);
+// Activations understood in cfg files: linear, leaky, logistic, swish, mish.
+// Returns nullptr for linear.
+nvinfer1::ILayer* netAddActivation(int layerIdx, const std::string& activation,
+                                   nvinfer1::ITensor* input,
+                                   nvinfer1::INetworkDefinition* network);
+nvinfer1::ILayer* netAddConvBNActivation(int layerIdx, std::map<std::string, std::string>& block,
+                                         std::vector<float>& weights,
+                                         std::vector<nvinfer1::Weights>& trtWeights,
+                                         int& weightPtr, int& inputChannels,
+                                         nvinfer1::ITensor* input,
+                                         nvinfer1::INetworkDefinition* network);
+// Convolution with batch norm folded in (or none), and its activation, from a
+// .hwts container. The weights stay owned by the container.
+nvinfer1::ILayer* netAddConvFolded(int layerIdx, std::map<std::string, std::string>& block,
+                                   const FoldedConv& folded, int& inputChannels,
+                                   nvinfer1::ITensor* input,
+                                   nvinfer1::INetworkDefinition* network);
 nvinfer1::ILayer* netAddConvBNLeaky(int layerIdx, std::map<std::string, std::string>& block,
                                     std::vector<float>& weights,
                                     std::vector<nvinfer1::Weights>& trtWeights, int& weightPtr,
                                     int& inputChannels, nvinfer1::ITensor* input,
                                     nvinfer1::INetworkDefinition* network);
+// Nearest neighbour upsample, an IResizeLayer when TensorRT provides one and
+// the matrix multiply formulation otherwise
 nvinfer1::ILayer* netAddUpsample(int layerIdx, std::map<std::string, std::string>& block,
                                  std::vector<float>& weights,
                                  std::vector<nvinfer1::Weights>& trtWeights, int& inputChannels,
                                  nvinfer1::ITensor* input, nvinfer1::INetworkDefinition* network);
+nvinfer1::ILayer* netAddUpsampleMatMul(int layerIdx, std::map<std::string, std::string>& block,
+                                       std::vector<float>& weights,
+                                       std::vector<nvinfer1::Weights>& trtWeights,
+                                       int& inputChannels, nvinfer1::ITensor* input,
+                                       nvinfer1::INetworkDefinition* network);
+// Channel slice used by route layers with groups/group_id (CSP blocks)
+nvinfer1::ILayer* netAddRouteGroup(int layerIdx, int groups, int groupId,
+                                   std::vector<nvinfer1::Weights>& trtWeights,
+                                   nvinfer1::ITensor* input, nvinfer1::INetworkDefinition* network);
 void printLayerInfo(std::string layerIndex, std::string layerName, std::string layerInput,
                     std::string layerOutput, std::string weightPtr);
 
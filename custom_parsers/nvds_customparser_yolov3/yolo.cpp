@@ -22,7 +22,10 @@
 
 #include "yolo.h"
 #include "yoloPlugins.h"
+#include "calibrator.h"
+#include "yoloLayersCpu.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <iterator>
@@ -33,6 +36,8 @@ Yolo::Yolo(const NetworkInfo& networkInfo)
       m_WtsFilePath(networkInfo.wtsFilePath), // yolov3.weights
       m_DeviceType(networkInfo.deviceType), // kDLA, kGPU
       m_InputBlobName(networkInfo.inputBlobName), // data
+      m_NetworkInfo(networkInfo),
+      m_ExplicitBatch(networkInfo.networkType.find("yolov2") == std::string::npos),
       m_InputH(0),
       m_InputW(0),
       m_InputC(0),
@@ -44,29 +49,155 @@ Yolo::~Yolo()
     destroyNetworkUtils();
 }
 
-nvinfer1::ICudaEngine *Yolo::createEngine (nvinfer1::IBuilder* builder)
+nvinfer1::ICudaEngine *Yolo::createEngine (nvinfer1::IBuilder* builder, nvinfer1::DataType dataType)
 {
     assert (builder);
 
-    std::vector<float> weights = loadWeights(m_WtsFilePath, m_NetworkType);
-    std::vector<nvinfer1::Weights> trtWeights;
+    // NvDsInferParseCustomYoloV3Cpu knows the yolov3 anchors only, and no
+    // scale_x_y: other networks keep the plugin heads
+    if (m_NetworkInfo.builderSettings.cpuYoloHead && m_NetworkType != "yolov3") {
+        std::cerr << BUILDER_CONFIG_YOLO_HEAD << "=cpu is only supported for yolov3, not "
+                  << m_NetworkType << std::endl;
+        return nullptr;
+    }
 
-    nvinfer1::INetworkDefinition *network = builder->createNetwork();
+    nvinfer1::INetworkDefinition *network = m_ExplicitBatch
+        ? builder->createNetworkV2(1U << static_cast<uint32_t>(
+              nvinfer1::NetworkDefinitionCreationFlag::kEXPLICIT_BATCH))
+        : builder->createNetwork();
     if (parseModel(*network) != NVDSINFER_SUCCESS) {
         network->destroy();
         return nullptr;
     }
 
+    nvinfer1::IBuilderConfig *config = builder->createBuilderConfig();
+    config->setMaxWorkspaceSize(m_NetworkInfo.workspaceSize > 0
+        ? m_NetworkInfo.workspaceSize : builder->getMaxWorkspaceSize());
+#if NV_TENSORRT_MAJOR > 7 || (NV_TENSORRT_MAJOR == 7 && NV_TENSORRT_MINOR >= 2)
+    nvinfer1::TacticSources tacticSources = 0;
+    if (m_NetworkInfo.builderSettings.tacticSources & TACTIC_SOURCE_CUBLAS) {
+        tacticSources |= 1U << static_cast<uint32_t>(nvinfer1::TacticSource::kCUBLAS);
+    }
+    if (m_NetworkInfo.builderSettings.tacticSources & TACTIC_SOURCE_CUBLAS_LT) {
+        tacticSources |= 1U << static_cast<uint32_t>(nvinfer1::TacticSource::kCUBLAS_LT);
+    }
+    config->setTacticSources(tacticSources);
+#endif
+    if (m_DeviceType == "kDLA") {
+        config->setDefaultDeviceType(nvinfer1::DeviceType::kDLA);
+        config->setDLACore(builder->getDLACore());
+        config->setFlag(nvinfer1::BuilderFlag::kGPU_FALLBACK);
+    }
+
+    // One profile covers every batch size up to the nvinfer batch-size
+    const int maxBatch = std::max(1u, m_NetworkInfo.maxBatchSize);
+    const int optBatch = m_NetworkInfo.optBatchSize > 0
+        ? std::min(maxBatch, static_cast<int>(m_NetworkInfo.optBatchSize)) : maxBatch;
+    const int c = m_InputC, h = m_InputH, w = m_InputW;
+    if (m_ExplicitBatch) {
+        nvinfer1::IOptimizationProfile *profile = builder->createOptimizationProfile();
+        profile->setDimensions(m_InputBlobName.c_str(), nvinfer1::OptProfileSelector::kMIN,
+                               nvinfer1::Dims4{1, c, h, w});
+        profile->setDimensions(m_InputBlobName.c_str(), nvinfer1::OptProfileSelector::kOPT,
+                               nvinfer1::Dims4{optBatch, c, h, w});
+        profile->setDimensions(m_InputBlobName.c_str(), nvinfer1::OptProfileSelector::kMAX,
+                               nvinfer1::Dims4{maxBatch, c, h, w});
+        config->addOptimizationProfile(profile);
+        std::cout << "Optimization profile: batch 1.." << maxBatch << ", tuned for "
+                  << optBatch << std::endl;
+    }
+
+    // Precision, the calibrator has to outlive the build
+    std::unique_ptr<Int8EntropyCalibrator> calibrator;
+    if (dataType == nvinfer1::DataType::kHALF) {
+        if (!builder->platformHasFastFp16()) {
+            std::cout << "WARNING: Platform has no fast FP16, building anyway" << std::endl;
+        }
+        config->setFlag(nvinfer1::BuilderFlag::kFP16);
+    } else if (dataType == nvinfer1::DataType::kINT8) {
+        if (m_NetworkInfo.int8CalibPath.empty()) {
+            std::cerr << "INT8 mode requires int8-calib-file to be set" << std::endl;
+            config->destroy();
+            network->destroy();
+            return nullptr;
+        }
+        if (!builder->platformHasFastInt8()) {
+            std::cout << "WARNING: Platform has no fast INT8, building anyway" << std::endl;
+        }
+        CalibrationInputInfo inputInfo;
+        inputInfo.width = m_InputW;
+        inputInfo.height = m_InputH;
+        inputInfo.channels = m_InputC;
+        inputInfo.netScaleFactor = m_NetworkInfo.netScaleFactor;
+        inputInfo.bgr = m_NetworkInfo.bgrInput;
+        inputInfo.maintainAspectRatio = m_NetworkInfo.maintainAspectRatio;
+        calibrator.reset(new Int8EntropyCalibrator(
+            m_NetworkInfo.calibImageDir, m_NetworkInfo.int8CalibPath, m_InputBlobName,
+            m_NetworkInfo.calibBatchSize, inputInfo, m_ExplicitBatch));
+        config->setFlag(nvinfer1::BuilderFlag::kINT8);
+        config->setInt8Calibrator(calibrator.get());
+        if (m_ExplicitBatch) {
+            // calibration batches have a fixed size of their own
+            const int calibBatch = std::max(1u, m_NetworkInfo.calibBatchSize);
+            nvinfer1::IOptimizationProfile *calibProfile = builder->createOptimizationProfile();
+            for (auto selector : {nvinfer1::OptProfileSelector::kMIN,
+                                  nvinfer1::OptProfileSelector::kOPT,
+                                  nvinfer1::OptProfileSelector::kMAX}) {
+                calibProfile->setDimensions(m_InputBlobName.c_str(), selector,
+                                            nvinfer1::Dims4{calibBatch, c, h, w});
+            }
+            config->setCalibrationProfile(calibProfile);
+        }
+        // layers without INT8 tactics, such as the yolo plugin, fall back to FP16
+        if (builder->platformHasFastFp16()) {
+            config->setFlag(nvinfer1::BuilderFlag::kFP16);
+        }
+    }
+
+    // Layer timings are shared by every engine built on this GPU and TensorRT
+    // version, whatever the batch size or precision
+    const bool useTimingCache = m_NetworkInfo.builderSettings.timingCache
+        && !m_NetworkInfo.timingCachePath.empty();
+#if NV_TENSORRT_MAJOR >= 8
+    nvinfer1::ITimingCache *timingCache = nullptr;
+    if (useTimingCache) {
+        std::vector<char> blob;
+        if (readTimingCache(m_NetworkInfo.timingCachePath, m_NetworkInfo.timingCacheKey, blob)) {
+            std::cout << "Using timing cache " << m_NetworkInfo.timingCachePath << std::endl;
+        }
+        timingCache = config->createTimingCache(blob.data(), blob.size());
+        if (timingCache) config->setTimingCache(*timingCache, false);
+    }
+#else
+    if (useTimingCache) {
+        std::cout << "Timing cache needs TensorRT 8, all tactics are timed" << std::endl;
+    }
+#endif
+
     // Build the engine
     std::cout << "Building the TensorRT Engine..." << std::endl;
-    nvinfer1::ICudaEngine * engine = builder->buildCudaEngine(*network);
+    nvinfer1::ICudaEngine * engine = builder->buildEngineWithConfig(*network, *config);
     if (engine) {
         std::cout << "Building complete!" << std::endl;
     } else {
         std::cerr << "Building engine failed!" << std::endl;
     }
 
+#if NV_TENSORRT_MAJOR >= 8
+    if (timingCache) {
+        nvinfer1::IHostMemory *serialized = timingCache->serialize();
+        if (serialized && writeTimingCache(m_NetworkInfo.timingCachePath,
+                                           m_NetworkInfo.timingCacheKey,
+                                           serialized->data(), serialized->size())) {
+            std::cout << "Wrote timing cache " << m_NetworkInfo.timingCachePath << std::endl;
+        }
+        if (serialized) serialized->destroy();
+        timingCache->destroy();
+    }
+#endif
+
     // destroy
+    config->destroy();
     network->destroy();
     return engine;
 }
@@ -77,7 +208,21 @@ NvDsInferStatus Yolo::parseModel(nvinfer1::INetworkDefinition& network) {
     m_ConfigBlocks = parseConfigFile(m_ConfigFilePath);
     parseConfigBlocks();
 
-    std::vector<float> weights = loadWeights(m_WtsFilePath, m_NetworkType);
+    // Hermes containers hold the convolutions ready to use, Darknet weights
+    // are folded while the network is built
+    std::vector<float> weights;
+    if (isYoloWeightsFile(m_WtsFilePath)) {
+        std::string error;
+        std::cout << "Loading pre-folded weights..." << std::endl;
+        if (!m_FoldedWeights.load(m_WtsFilePath, hashConfigFile(m_ConfigFilePath), error)) {
+            std::cerr << error << std::endl;
+            return NVDSINFER_CONFIG_FAILED;
+        }
+        std::cout << "Loaded " << m_FoldedWeights.layers().size() << " convolutions ("
+                  << (m_FoldedWeights.fp16() ? "FP16" : "FP32") << ")" << std::endl;
+    } else {
+        weights = loadWeights(m_WtsFilePath, m_NetworkType);
+    }
     // build yolo network
     std::cout << "Building Yolo network..." << std::endl;
     NvDsInferStatus status = buildYoloNetwork(weights, network);
@@ -96,10 +241,16 @@ NvDsInferStatus Yolo::buildYoloNetwork(
     int weightPtr = 0;
     int channels = m_InputC;
 
+    // explicit batch networks carry a dynamic batch dimension in front
+    const bool explicitBatch = !network.hasImplicitBatchDimension();
+    nvinfer1::Dims inputDims = nvinfer1::DimsCHW{static_cast<int>(m_InputC),
+        static_cast<int>(m_InputH), static_cast<int>(m_InputW)};
+    if (explicitBatch) {
+        inputDims = nvinfer1::Dims4{-1, static_cast<int>(m_InputC),
+            static_cast<int>(m_InputH), static_cast<int>(m_InputW)};
+    }
     nvinfer1::ITensor* data =
-        network.addInput(m_InputBlobName.c_str(), nvinfer1::DataType::kFLOAT,
-            nvinfer1::DimsCHW{static_cast<int>(m_InputC),
-                static_cast<int>(m_InputH), static_cast<int>(m_InputW)});
+        network.addInput(m_InputBlobName.c_str(), nvinfer1::DataType::kFLOAT, inputDims);
     assert(data != nullptr && data->getDimensions().nbDims > 0);
 
     nvinfer1::ITensor* previous = data;
@@ -119,11 +270,23 @@ NvDsInferStatus Yolo::buildYoloNetwork(
             nvinfer1::ILayer* out;
             std::string layerType;
             // check if batch_norm enabled
-            if (m_ConfigBlocks.at(i).find("batch_normalize") !=
+            const int prevWeightPtr = weightPtr;
+            if (m_FoldedWeights.isOpen()) {
+                const FoldedConv* folded = m_FoldedWeights.layer(i);
+                if (!folded || (int)folded->inputChannels != channels) {
+                    std::cerr << "No weights for convolution " << i << " in " << m_WtsFilePath
+                              << std::endl;
+                    return NVDSINFER_CONFIG_FAILED;
+                }
+                out = netAddConvFolded(i, m_ConfigBlocks.at(i), *folded, channels, previous,
+                                       &network);
+                layerType = "conv-folded-" + m_ConfigBlocks.at(i).at("activation");
+            }
+            else if (m_ConfigBlocks.at(i).find("batch_normalize") !=
                 m_ConfigBlocks.at(i).end()) {
-                out = netAddConvBNLeaky(i, m_ConfigBlocks.at(i), weights,
+                out = netAddConvBNActivation(i, m_ConfigBlocks.at(i), weights,
                     m_TrtWeights, weightPtr, channels, previous, &network);
-                layerType = "conv-bn-leaky";
+                layerType = "conv-bn-" + m_ConfigBlocks.at(i).at("activation");
             }
             else
             {
@@ -131,6 +294,8 @@ NvDsInferStatus Yolo::buildYoloNetwork(
                     m_TrtWeights, weightPtr, channels, previous, &network);
                 layerType = "conv-linear";
             }
+            assert(m_FoldedWeights.isOpen() || (uint64_t)(weightPtr - prevWeightPtr)
+                   == convWeightCount(m_ConfigBlocks.at(i), getNumChannels(previous)));
             previous = out->getOutput(0);
             assert(previous != nullptr);
             channels = getNumChannels(previous);
@@ -161,19 +326,43 @@ NvDsInferStatus Yolo::buildYoloNetwork(
             printLayerInfo(layerIndex, "skip", inputVol, outputVol, "    -");
         } else if (m_ConfigBlocks.at(i).at("type") == "yolo") {
             nvinfer1::Dims prevTensorDims = previous->getDimensions();
-            assert(prevTensorDims.d[1] == prevTensorDims.d[2]);
+            const int hAxis = getChannelAxis(previous) + 1;
+            assert(prevTensorDims.d[hAxis] == prevTensorDims.d[hAxis + 1]);
             TensorInfo& curYoloTensor = m_OutputTensors.at(outputTensorCount);
-            curYoloTensor.gridSize = prevTensorDims.d[1];
+            curYoloTensor.gridSize = prevTensorDims.d[hAxis];
             curYoloTensor.stride = m_InputW / curYoloTensor.gridSize;
             m_OutputTensors.at(outputTensorCount).volume = curYoloTensor.gridSize
                 * curYoloTensor.gridSize
                 * (curYoloTensor.numBBoxes * (5 + curYoloTensor.numClasses));
             std::string layerName = "yolo_" + std::to_string(i);
             curYoloTensor.blobName = layerName;
-            nvinfer1::IPluginV2* yoloPlugin
-                = new YoloLayerV3(m_OutputTensors.at(outputTensorCount).numBBoxes,
-                                  m_OutputTensors.at(outputTensorCount).numClasses,
-                                  m_OutputTensors.at(outputTensorCount).gridSize);
+            if (m_NetworkInfo.builderSettings.cpuYoloHead) {
+                // The conv output is the engine output, NvDsInferParseCustomYoloV3Cpu
+                // applies the activations on the host
+                std::string inputVol = dimsToString(previous->getDimensions());
+                previous->setName(layerName.c_str());
+                network.markOutput(*previous);
+                channels = getNumChannels(previous);
+                tensorOutputs.push_back(previous);
+                printLayerInfo(layerIndex, "yolo(cpu)", inputVol, inputVol, std::to_string(weightPtr));
+                ++outputTensorCount;
+                continue;
+            }
+            nvinfer1::IPluginV2* yoloPlugin = nullptr;
+            if (explicitBatch) {
+                YoloLayerParams params;
+                params.numBoxes = curYoloTensor.numBBoxes;
+                params.numClasses = curYoloTensor.numClasses;
+                params.gridSize = curYoloTensor.gridSize;
+                params.scaleXY = curYoloTensor.scaleXY;
+                yoloPlugin = new YoloLayerV3Dynamic(params);
+            } else {
+                yoloPlugin
+                    = new YoloLayerV3(m_OutputTensors.at(outputTensorCount).numBBoxes,
+                                      m_OutputTensors.at(outputTensorCount).numClasses,
+                                      m_OutputTensors.at(outputTensorCount).gridSize,
+                                      m_OutputTensors.at(outputTensorCount).scaleXY);
+            }
             assert(yoloPlugin != nullptr);
             nvinfer1::IPluginV2Layer* yolo =
                 network.addPluginV2(&previous, 1, *yoloPlugin);
@@ -190,6 +379,7 @@ NvDsInferStatus Yolo::buildYoloNetwork(
             printLayerInfo(layerIndex, "yolo", inputVol, outputVol, std::to_string(weightPtr));
             ++outputTensorCount;
         } else if (m_ConfigBlocks.at(i).at("type") == "region") {
+            assert(!explicitBatch);
             nvinfer1::Dims prevTensorDims = previous->getDimensions();
             assert(prevTensorDims.d[1] == prevTensorDims.d[2]);
             TensorInfo& curRegionTensor = m_OutputTensors.at(outputTensorCount);
@@ -224,6 +414,7 @@ NvDsInferStatus Yolo::buildYoloNetwork(
             for (auto& anchor : curRegionTensor.anchors) anchor *= curRegionTensor.stride;
             ++outputTensorCount;
         } else if (m_ConfigBlocks.at(i).at("type") == "reorg") {
+            assert(!explicitBatch);
             std::string inputVol = dimsToString(previous->getDimensions());
             nvinfer1::IPluginV2* reorgPlugin = createReorgPlugin(2);
             assert(reorgPlugin != nullptr);
@@ -257,6 +448,29 @@ NvDsInferStatus Yolo::buildYoloNetwork(
                 }
             }
             assert (!idxLayers.empty());
+            // CSP style route: one input, keep channel group group_id of groups
+            if (m_ConfigBlocks.at(i).find("groups") != m_ConfigBlocks.at(i).end()) {
+                assert(idxLayers.size() == 1);
+                int idxLayer = idxLayers[0];
+                if (idxLayer < 0) {
+                    idxLayer = tensorOutputs.size() + idxLayer;
+                }
+                assert (idxLayer >= 0 && idxLayer < (int)tensorOutputs.size());
+                int groups = std::stoi(m_ConfigBlocks.at(i).at("groups"));
+                int groupId = m_ConfigBlocks.at(i).find("group_id") != m_ConfigBlocks.at(i).end()
+                    ? std::stoi(m_ConfigBlocks.at(i).at("group_id")) : 0;
+                std::string inputVol = dimsToString(tensorOutputs[idxLayer]->getDimensions());
+                nvinfer1::ILayer* out = netAddRouteGroup(i - 1, groups, groupId,
+                    m_TrtWeights, tensorOutputs[idxLayer], &network);
+                previous = out->getOutput(0);
+                assert(previous != nullptr);
+                std::string outputVol = dimsToString(previous->getDimensions());
+                channels = getNumChannels(previous);
+                tensorOutputs.push_back(out->getOutput(0));
+                printLayerInfo(layerIndex, "route-group", inputVol, outputVol,
+                               std::to_string(weightPtr));
+                continue;
+            }
             std::vector<nvinfer1::ITensor*> concatInputs;
             for (int idxLayer : idxLayers) {
                 if (idxLayer < 0) {
@@ -271,7 +485,7 @@ NvDsInferStatus Yolo::buildYoloNetwork(
             std::string concatLayerName = "route_" + std::to_string(i - 1);
             concat->setName(concatLayerName.c_str());
             // concatenate along the channel dimension
-            concat->setAxis(0);
+            concat->setAxis(getChannelAxis(concatInputs[0]));
             previous = concat->getOutput(0);
             assert(previous != nullptr);
             std::string outputVol = dimsToString(previous->getDimensions());
@@ -307,7 +521,20 @@ NvDsInferStatus Yolo::buildYoloNetwork(
         }
     }
 
-    if ((int)weights.size() != weightPtr)
+    if (m_FoldedWeights.isOpen())
+    {
+        // every convolution looked its weights up, the count is all that is left
+        uint convolutions = std::count_if(m_ConfigBlocks.begin(), m_ConfigBlocks.end(),
+            [](const std::map<std::string, std::string>& block) {
+                return block.at("type") == "convolutional"; });
+        if (convolutions != m_FoldedWeights.layers().size())
+        {
+            std::cerr << m_WtsFilePath << " holds " << m_FoldedWeights.layers().size()
+                      << " convolutions, the cfg has " << convolutions << std::endl;
+            return NVDSINFER_CONFIG_FAILED;
+        }
+    }
+    else if ((int)weights.size() != weightPtr)
     {
         std::cout << "Number of unused weights left : " << weights.size() - weightPtr << std::endl;
         assert(0);
@@ -328,38 +555,7 @@ std::vector<std::map<std::string, std::string>>
 Yolo::parseConfigFile (const std::string cfgFilePath)
 {
     assert(fileExists(cfgFilePath));
-    std::ifstream file(cfgFilePath);
-    assert(file.good());
-    std::string line;
-    std::vector<std::map<std::string, std::string>> blocks;
-    std::map<std::string, std::string> block;
-
-    while (getline(file, line))
-    {
-        if (line.size() == 0) continue;
-        if (line.front() == '#') continue;
-        line = trim(line);
-        if (line.front() == '[')
-        {
-            if (block.size() > 0)
-            {
-                blocks.push_back(block);
-                block.clear();
-            }
-            std::string key = "type";
-            std::string value = trim(line.substr(1, line.size() - 2));
-            block.insert(std::pair<std::string, std::string>(key, value));
-        }
-        else
-        {
-            int cpos = line.find('=');
-            std::string key = trim(line.substr(0, cpos));
-            std::string value = trim(line.substr(cpos + 1));
-            block.insert(std::pair<std::string, std::string>(key, value));
-        }
-    }
-    blocks.push_back(block);
-    return blocks;
+    return parseDarknetConfig(cfgFilePath);
 }
 
 void Yolo::parseConfigBlocks()
@@ -409,7 +605,8 @@ void Yolo::parseConfigBlocks()
                 }
             }
 
-            if ((m_NetworkType == "yolov3") || (m_NetworkType == "yolov3-tiny"))
+            if ((m_NetworkType == "yolov3") || (m_NetworkType == "yolov3-tiny")
+                || (m_NetworkType == "yolov4") || (m_NetworkType == "yolov4-tiny"))
             {
                 assert((block.find("mask") != block.end())
                        && std::string("Missing 'mask' param in " + block.at("type") + " layer")
@@ -438,6 +635,10 @@ void Yolo::parseConfigBlocks()
                 ? outputTensor.masks.size()
                 : std::stoul(trim(block.at("num")));
             outputTensor.numClasses = std::stoul(block.at("classes"));
+            if (block.find("scale_x_y") != block.end())
+            {
+                outputTensor.scaleXY = std::stof(block.at("scale_x_y"));
+            }
             m_OutputTensors.push_back(outputTensor);
         }
     }
@@ -450,5 +651,6 @@ void Yolo::destroyNetworkUtils() {
             free(const_cast<void*>(m_TrtWeights[i].values));
     }
     m_TrtWeights.clear();
+    m_FoldedWeights.close();
 }
 
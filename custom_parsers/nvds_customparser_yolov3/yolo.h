@@ -29,6 +29,7 @@
 #include <memory>
 
 #include "NvInfer.h"
+#include "builderConfig.h"
 #include "trt_utils.h"
 
 #include "nvdsinfer_custom_impl.h"
@@ -43,6 +44,22 @@ struct NetworkInfo
     std::string wtsFilePath;
     std::string deviceType;
     std::string inputBlobName;
+    // Explicit batch optimization profile: batches of 1..maxBatchSize, tuned
+    // for optBatchSize (0 means maxBatchSize)
+    uint maxBatchSize{1};
+    uint optBatchSize{0};
+    // Builder configuration, 0 keeps the workspace nvinfer set on the builder
+    size_t workspaceSize{0};
+    BuilderSettings builderSettings;
+    std::string timingCacheKey;
+    std::string timingCachePath;
+    // INT8 calibration, only used when building an INT8 engine
+    std::string int8CalibPath;
+    std::string calibImageDir;
+    uint calibBatchSize{1};
+    float netScaleFactor{1.0f};
+    bool bgrInput{false};
+    bool maintainAspectRatio{false};
 };
 
 /**
@@ -55,6 +72,7 @@ struct TensorInfo
     uint gridSize{0};
     uint numClasses{0};
     uint numBBoxes{0};
+    float scaleXY{1.0f};
     uint64_t volume{0};
     std::vector<uint> masks;
     std::vector<float> anchors;
@@ -66,14 +84,16 @@ class Yolo : public IModelParser {
 public:
     Yolo(const NetworkInfo& networkInfo);
     ~Yolo() override;
-    bool hasFullDimsSupported() const override { return false; }
+    bool hasFullDimsSupported() const override { return m_ExplicitBatch; }
     const char* getModelName() const override {
         return m_ConfigFilePath.empty() ? m_NetworkType.c_str()
                                         : m_ConfigFilePath.c_str();
     }
     NvDsInferStatus parseModel(nvinfer1::INetworkDefinition& network) override;
 
-    nvinfer1::ICudaEngine *createEngine (nvinfer1::IBuilder* builder);
+    nvinfer1::ICudaEngine *createEngine (
+        nvinfer1::IBuilder* builder,
+        nvinfer1::DataType dataType = nvinfer1::DataType::kFLOAT);
 
 protected:
     const std::string m_NetworkType;
@@ -81,6 +101,9 @@ protected:
     const std::string m_WtsFilePath;
     const std::string m_DeviceType;
     const std::string m_InputBlobName;
+    const NetworkInfo m_NetworkInfo;
+    // the region and reorg plugins of yolov2 only run with an implicit batch
+    const bool m_ExplicitBatch;
     std::vector<TensorInfo> m_OutputTensors;
     std::vector<std::map<std::string, std::string>> m_ConfigBlocks;
     uint m_InputH;
@@ -90,6 +113,8 @@ protected:
 
     // TRT specific members
     std::vector<nvinfer1::Weights> m_TrtWeights;
+    // Pre-folded convolutions when the model file is a .hwts container
+    YoloWeightsFile m_FoldedWeights;
 
 private:
     NvDsInferStatus buildYoloNetwork(
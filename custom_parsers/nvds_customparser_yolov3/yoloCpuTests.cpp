@@ -0,0 +1,938 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Host tests of the parser library pieces that build without TensorRT:
+ *
+ *   yolo-cpu-tests [--seed 1] [--cfg yolov3-fire.cfg] [--weights yolov3-fire.weights]
+ *
+ * The layer references of yoloLayersCpu are checked against straightforward
+ * double precision formulas on random tensors, and the weight counts of the
+ * convolutions against a hand counted cfg and against the size of the
+ * shipped yolov3-fire weights (a Git LFS pointer is read for its size). The
+ * serialized yolo plugin params go through a round trip and the blobs an
+ * engine may hold from other plugin versions are refused. INT8 calibration
+ * tables, TensorRT timing caches and .hwts weight containers are written and
+ * read back in a scratch directory. Every
+ * failed comparison is printed; exits 1 when any test fails.
+ * yolo-layers-check compares the TensorRT layers themselves with these
+ * references on a GPU. */
+
+#include <getopt.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "builderConfig.h"
+#include "calibrationData.h"
+#include "yoloLayersCpu.h"
+#include "yoloPluginParams.h"
+#include "yoloWeights.h"
+
+namespace {
+
+std::vector<float> randomTensor(const size_t size, const float spread, std::mt19937& rng)
+{
+    std::normal_distribution<float> dist(0.0f, spread);
+    std::vector<float> tensor(size);
+    for (float& value : tensor) value = dist(rng);
+    return tensor;
+}
+
+bool near(const double a, const double b, const double tolerance)
+{
+    return std::fabs(a - b) <= tolerance * std::max(1.0, std::fabs(b));
+}
+
+/* Nearest upsampling and the matrix formulation it replaced give the same
+ * tensor, bit for bit: the matrices only hold zeros and ones */
+bool testUpsample(std::mt19937& rng)
+{
+    bool ok = true;
+    const uint shapes[][3] = {{1, 1, 1}, {3, 13, 13}, {8, 26, 26}, {2, 5, 5}};
+    for (const auto& shape : shapes)
+    {
+        for (const uint stride : {1u, 2u, 3u})
+        {
+            const uint c = shape[0], h = shape[1], w = shape[2];
+            const std::vector<float> input = randomTensor(c * h * w, 4.0f, rng);
+            std::vector<float> nearest(c * h * w * stride * stride, NAN);
+            std::vector<float> matMul(nearest.size(), NAN);
+            upsampleNearestCpu(input.data(), nearest.data(), c, h, w, stride);
+            upsampleMatMulCpu(input.data(), matMul.data(), c, h, w, stride);
+
+            for (size_t i = 0; i < nearest.size(); ++i)
+            {
+                const uint x = i % (w * stride), y = i / (w * stride) % (h * stride),
+                           ch = i / (w * stride * h * stride);
+                const float expected = input[(ch * h + y / stride) * w + x / stride];
+                if (nearest[i] != expected || matMul[i] != expected)
+                {
+                    printf("FAIL upsample %ux%ux%u stride %u: (%u, %u, %u) is %g nearest, %g "
+                           "matmul, expected %g\n",
+                           c, h, w, stride, ch, y, x, nearest[i], matMul[i], expected);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    // non-square inputs are nearest only, the matrix formulation never took them
+    const std::vector<float> input = randomTensor(2 * 4 * 7, 4.0f, rng);
+    std::vector<float> output(2 * 8 * 14);
+    upsampleNearestCpu(input.data(), output.data(), 2, 4, 7, 2);
+    for (uint ch = 0; ch < 2 && ok; ++ch)
+    {
+        for (uint y = 0; y < 8 && ok; ++y)
+        {
+            for (uint x = 0; x < 14 && ok; ++x)
+            {
+                if (output[(ch * 8 + y) * 14 + x] != input[(ch * 4 + y / 2) * 7 + x / 2])
+                {
+                    printf("FAIL upsample 2x4x7: (%u, %u, %u)\n", ch, y, x);
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+double activationReference(const std::string& activation, const double x)
+{
+    if (activation == "leaky") return x > 0 ? x : 0.1 * x;
+    if (activation == "logistic") return 1.0 / (1.0 + std::exp(-x));
+    if (activation == "swish") return x / (1.0 + std::exp(-x));
+    // mish, softplus written out so that large x stays finite
+    const double softplus = x > 30 ? x : std::log(1.0 + std::exp(x));
+    return x * std::tanh(softplus);
+}
+
+bool testActivations(std::mt19937& rng)
+{
+    bool ok = true;
+    // random values, plus the tails where exp() overflows or vanishes
+    std::vector<float> values = randomTensor(4096, 6.0f, rng);
+    for (const float edge : {0.0f, -0.0f, 1e-6f, -1e-6f, 20.0f, -20.0f, 88.0f, 89.0f, -89.0f,
+                             1000.0f, -1000.0f})
+    {
+        values.push_back(edge);
+    }
+
+    for (const std::string activation : {"leaky", "logistic", "swish", "mish"})
+    {
+        std::vector<float> data = values;
+        if (!activationCpu(activation, data.data(), data.size()))
+        {
+            printf("FAIL %s: not supported\n", activation.c_str());
+            ok = false;
+            continue;
+        }
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            const double expected = activationReference(activation, values[i]);
+            if (!std::isfinite(data[i]) || !near(data[i], expected, 1e-5))
+            {
+                printf("FAIL %s(%g) is %g, expected %g\n", activation.c_str(), values[i],
+                       data[i], expected);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    std::vector<float> data = values;
+    ok &= activationCpu("linear", data.data(), data.size()) && data == values;
+    if (activationCpu("relu6", data.data(), data.size()))
+    {
+        printf("FAIL relu6: accepted\n");
+        ok = false;
+    }
+    return ok;
+}
+
+/* Groups of a route block are whole channel planes, taken in order */
+bool testRouteGroup(std::mt19937& rng)
+{
+    bool ok = true;
+    const uint c = 8, h = 3, w = 5;
+    const std::vector<float> input = randomTensor(c * h * w, 4.0f, rng);
+    for (const uint groups : {1u, 2u, 4u})
+    {
+        for (uint groupId = 0; groupId < groups; ++groupId)
+        {
+            const uint groupChannels = c / groups;
+            std::vector<float> output(groupChannels * h * w, NAN);
+            routeGroupCpu(input.data(), output.data(), c, h, w, groups, groupId);
+            for (size_t i = 0; i < output.size(); ++i)
+            {
+                if (output[i] != input[groupId * groupChannels * h * w + i])
+                {
+                    printf("FAIL route groups %u group_id %u: value %zu\n", groups, groupId, i);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+std::map<std::string, std::string> convBlock(const std::string& filters, const std::string& size,
+                                             const bool batchNormalize)
+{
+    std::map<std::string, std::string> block {{"type", "convolutional"},
+                                              {"filters", filters},
+                                              {"size", size},
+                                              {"stride", "1"},
+                                              {"pad", "1"},
+                                              {"activation", "leaky"}};
+    if (batchNormalize) block["batch_normalize"] = "1";
+    return block;
+}
+
+/* A yolov4-tiny like cfg, counted by hand: route groups halve the channels,
+ * a concatenation adds them, the head has biases instead of batch norm */
+std::vector<std::map<std::string, std::string>> tinyConfig(uint64_t& weightCount)
+{
+    std::vector<std::map<std::string, std::string>> blocks;
+    blocks.push_back({{"type", "net"}, {"channels", "3"}});
+    blocks.push_back(convBlock("32", "3", true));   // 32 * 4 + 32 * 3 * 9 = 992
+    blocks.push_back({{"type", "maxpool"}, {"size", "2"}, {"stride", "2"}});
+    blocks.push_back(convBlock("64", "3", true));   // 64 * 4 + 64 * 32 * 9 = 18688
+    blocks.push_back({{"type", "route"}, {"layers", "-1"}, {"groups", "2"}, {"group_id", "1"}});
+    blocks.push_back(convBlock("32", "3", true));   // 32 * 4 + 32 * 32 * 9 = 9344
+    blocks.back()["activation"] = "mish";
+    blocks.push_back({{"type", "route"}, {"layers", "-1,-2"}});
+    blocks.push_back(convBlock("18", "1", false));  // 18 + 18 * 64 = 1170
+    blocks.back()["activation"] = "linear";
+    blocks.push_back({{"type", "yolo"}});
+    weightCount = 992 + 18688 + 9344 + 1170;
+    return blocks;
+}
+
+/* Every convolution takes exactly its count from the weights file: the
+ * counts add up to the file, the container refuses one value less or more */
+bool testWeightCounts()
+{
+    bool ok = true;
+    const std::map<std::string, std::string> bn = convBlock("16", "3", true);
+    const std::map<std::string, std::string> bias = convBlock("16", "3", false);
+    if (convWeightCount(bn, 8) != 16 * 4 + 16 * 8 * 9 || convWeightCount(bias, 8) != 16 + 16 * 8 * 9)
+    {
+        printf("FAIL conv weight count: %llu with batch norm, %llu with biases\n",
+               (unsigned long long)convWeightCount(bn, 8),
+               (unsigned long long)convWeightCount(bias, 8));
+        ok = false;
+    }
+
+    uint64_t expected;
+    const std::vector<std::map<std::string, std::string>> blocks = tinyConfig(expected);
+    std::map<uint, uint> channels;
+    std::string error;
+    if (!convInputChannels(blocks, channels, error))
+    {
+        printf("FAIL input channels: %s\n", error.c_str());
+        return false;
+    }
+    const std::map<uint, uint> expectedChannels {{1, 3}, {3, 32}, {5, 32}, {7, 64}};
+    if (channels != expectedChannels)
+    {
+        printf("FAIL input channels of the tiny cfg\n");
+        ok = false;
+    }
+    uint64_t count = 0;
+    for (const auto& conv : channels) count += convWeightCount(blocks[conv.first], conv.second);
+    if (count != expected)
+    {
+        printf("FAIL tiny cfg takes %llu weights, expected %llu\n", (unsigned long long)count,
+               (unsigned long long)expected);
+        ok = false;
+    }
+
+    const std::string path = "/tmp/yolo-cpu-tests-" + std::to_string(getpid()) + ".hwts";
+    for (const int64_t extra : {0, -1, 1})
+    {
+        const std::vector<float> weights(expected + extra, 0.5f);
+        const bool written = writeYoloWeights(path, blocks, weights, 0, false, error);
+        if (written != (extra == 0))
+        {
+            printf("FAIL %llu weights for a cfg of %llu: %s\n",
+                   (unsigned long long)weights.size(), (unsigned long long)expected,
+                   written ? "accepted" : error.c_str());
+            ok = false;
+        }
+    }
+    unlink(path.c_str());
+    return ok;
+}
+
+/* Size in bytes of a weights file, or of the object a Git LFS pointer
+ * stands for when the weights were not pulled */
+bool weightsFileSize(const std::string& path, uint64_t& size)
+{
+    std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+    if (!file.good()) return false;
+    size = file.tellg();
+    file.seekg(0);
+    std::string line;
+    if (!std::getline(file, line) || line.compare(0, 24, "version https://git-lfs.") != 0)
+    {
+        return true;
+    }
+    while (std::getline(file, line))
+    {
+        if (line.compare(0, 5, "size ") == 0)
+        {
+            size = std::stoull(line.substr(5));
+            return true;
+        }
+    }
+    return false;
+}
+
+/* The shipped cfg consumes its weights file to the last value, after the
+ * 20 byte header of yolov3 weights */
+bool testShippedWeights(const std::string& cfgPath, const std::string& weightsPath)
+{
+    const std::vector<std::map<std::string, std::string>> blocks = parseDarknetConfig(cfgPath);
+    std::map<uint, uint> channels;
+    std::string error;
+    if (blocks.empty() || !convInputChannels(blocks, channels, error))
+    {
+        printf("FAIL %s: %s\n", cfgPath.c_str(), blocks.empty() ? "no blocks" : error.c_str());
+        return false;
+    }
+    uint64_t count = 0;
+    for (const auto& conv : channels) count += convWeightCount(blocks[conv.first], conv.second);
+
+    uint64_t size;
+    if (!weightsFileSize(weightsPath, size))
+    {
+        printf("FAIL cannot size %s\n", weightsPath.c_str());
+        return false;
+    }
+    if (count * sizeof(float) + 4 * 5 != size)
+    {
+        printf("FAIL %s takes %llu weights, %s holds %llu bytes\n", cfgPath.c_str(),
+               (unsigned long long)count, weightsPath.c_str(), (unsigned long long)size);
+        return false;
+    }
+    return true;
+}
+
+/* Serialized params come back field for field, the serializer writes no
+ * more than it sizes, and blobs of another layout are refused */
+bool testPluginParams()
+{
+    bool ok = true;
+    YoloLayerParams params;
+    params.numBoxes = 3;
+    params.numClasses = 1;
+    params.gridSize = 52;
+    params.scaleXY = 1.05f;
+    params.dataType = 1;
+
+    const size_t size = params.getSerializationSize();
+    std::vector<char> blob(size + 8, 0x5a);
+    params.serialize(blob.data());
+    uint32_t version;
+    memcpy(&version, blob.data(), sizeof(version));
+    if (version != YOLO_PLUGIN_PARAMS_VERSION
+        || std::count(blob.begin() + size, blob.end(), 0x5a) != 8)
+    {
+        printf("FAIL params blob: version %u, %zu bytes sized\n", version, size);
+        ok = false;
+    }
+
+    YoloLayerParams read;
+    if (!YoloLayerParams::deserialize(blob.data(), size, read) || read.numBoxes != 3
+        || read.numClasses != 1 || read.gridSize != 52 || read.scaleXY != 1.05f
+        || read.dataType != 1 || read.outputSize() != 52 * 52 * 3 * 6)
+    {
+        printf("FAIL params round trip\n");
+        ok = false;
+    }
+
+    // what deserialize must not take, the params passed in stay untouched
+    YoloLayerParams untouched;
+    untouched.numBoxes = 7;
+    auto refused = [&](const char* what, const void* data, const size_t length) {
+        if (YoloLayerParams::deserialize(data, length, untouched) || untouched.numBoxes != 7)
+        {
+            printf("FAIL params %s accepted\n", what);
+            ok = false;
+        }
+    };
+    refused("null", nullptr, size);
+    refused("truncated", blob.data(), size - 1);
+    refused("padded", blob.data(), size + 1);
+
+    // the plugin before versioning: boxes, classes, grid, then a 64 bit output size
+    std::vector<char> legacy(3 * sizeof(uint32_t) + sizeof(uint64_t));
+    const uint32_t legacyFields[] = {3, 1, 52};
+    const uint64_t legacyOutputSize = 52 * 52 * 3 * 6;
+    memcpy(legacy.data(), legacyFields, sizeof(legacyFields));
+    memcpy(legacy.data() + sizeof(legacyFields), &legacyOutputSize, sizeof(legacyOutputSize));
+    refused("legacy blob", legacy.data(), legacy.size());
+    // a legacy blob padded to the current length starts with a box count, not a version
+    legacy.resize(size, 0);
+    refused("legacy blob at the current length", legacy.data(), legacy.size());
+
+    std::vector<char> other = blob;
+    const uint32_t nextVersion = YOLO_PLUGIN_PARAMS_VERSION + 1;
+    memcpy(other.data(), &nextVersion, sizeof(nextVersion));
+    refused("next version", other.data(), size);
+
+    YoloLayerParams empty = params;
+    empty.gridSize = 0;
+    empty.serialize(other.data());
+    refused("empty layer", other.data(), size);
+    return ok;
+}
+
+/* The yolo layer keeps its input shape, when it is the shape of the params */
+bool testOutputDims()
+{
+    bool ok = true;
+    YoloLayerParams params;
+    params.numBoxes = 3;
+    params.numClasses = 1;
+    params.gridSize = 13;
+
+    auto check = [&](const std::vector<int>& input, const bool expected) {
+        int output[8] = {0};
+        const bool result = yoloLayerOutputDims(params, input.data(), input.size(), output);
+        if (result != expected
+            || (result && !std::equal(input.begin(), input.end(), output)))
+        {
+            std::string dims;
+            for (const int d : input) dims += " " + std::to_string(d);
+            printf("FAIL output dims of%s: %s\n", dims.c_str(),
+                   result ? "accepted" : "refused");
+            ok = false;
+        }
+    };
+    check({18, 13, 13}, true);
+    check({4, 18, 13, 13}, true);
+    check({-1, 18, 13, 13}, true);
+    check({0, 18, 13, 13}, false);
+    check({4, 21, 13, 13}, false);
+    check({4, 18, 26, 13}, false);
+    check({4, 18, 13, 26}, false);
+    check({18, 13}, false);
+    check({1, 4, 18, 13, 13}, false);
+    return ok;
+}
+
+/* Calibration tables: what TensorRT wrote comes back byte for byte, tables
+ * of another calibrator are ignored, a failed write keeps the old table */
+bool testCalibrationTable()
+{
+    bool ok = true;
+    char dirTemplate[] = "/tmp/yolo-cpu-tests-XXXXXX";
+    if (!mkdtemp(dirTemplate))
+    {
+        printf("FAIL cannot create a scratch directory\n");
+        return false;
+    }
+    const std::string dir = dirTemplate;
+    const std::string path = dir + "/yolov3-calibration.table";
+    std::vector<char> table;
+
+    if (readCalibrationTable(path, table) || !table.empty())
+    {
+        printf("FAIL missing calibration table read\n");
+        ok = false;
+    }
+
+    // header, then a hex scale per tensor, as IInt8EntropyCalibrator2 writes them
+    const std::string written = "TRT-7103-EntropyCalibration2\n"
+                                "data: 3c010a14\n"
+                                "yolo_83: 3d8e5c2a\n";
+    if (!writeCalibrationTable(path, written.data(), written.size())
+        || !readCalibrationTable(path, table)
+        || std::string(table.begin(), table.end()) != written)
+    {
+        printf("FAIL calibration table round trip\n");
+        ok = false;
+    }
+    if (access((path + ".tmp").c_str(), F_OK) == 0)
+    {
+        printf("FAIL calibration table left its temporary file\n");
+        ok = false;
+    }
+
+    // a rewrite replaces the table whole
+    const std::string rewritten = "TRT-7103-EntropyCalibration2\ndata: 3c000000\n";
+    if (!writeCalibrationTable(path, rewritten.data(), rewritten.size())
+        || !readCalibrationTable(path, table)
+        || std::string(table.begin(), table.end()) != rewritten)
+    {
+        printf("FAIL calibration table rewrite\n");
+        ok = false;
+    }
+
+    // writing into a missing directory fails without touching anything
+    if (writeCalibrationTable(dir + "/missing/table", written.data(), written.size()))
+    {
+        printf("FAIL calibration table written into a missing directory\n");
+        ok = false;
+    }
+
+    auto ignored = [&](const char* what, const std::string& contents) {
+        const std::string other = dir + "/other.table";
+        std::ofstream(other, std::ios_base::binary | std::ios_base::trunc) << contents;
+        if (readCalibrationTable(other, table) || !table.empty())
+        {
+            printf("FAIL %s calibration table used\n", what);
+            ok = false;
+        }
+        unlink(other.c_str());
+    };
+    ignored("empty", "");
+    ignored("MinMax", "TRT-7103-MinMaxCalibration\ndata: 3c010a14\n");
+    ignored("legacy entropy", "TRT-7103-EntropyCalibration\ndata: 3c010a14\n");
+    // the algorithm has to be in the header line, not further down
+    ignored("headerless", "data: 3c010a14\nEntropyCalibration2: 0\n");
+
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+    return ok;
+}
+
+/* Timing caches: named after the build environment, read back only for the
+ * key they were written with */
+bool testTimingCache()
+{
+    bool ok = true;
+    const std::string key = timingCacheKey(7103, "NVIDIA Tegra X1 (nvgpu)", 5, 3);
+    if (key != "trt7103_nvidia-tegra-x1-nvgpu_sm53"
+        || timingCacheKey(8201, " ", 8, 7) != "trt8201_gpu_sm87")
+    {
+        printf("FAIL timing cache key %s\n", key.c_str());
+        ok = false;
+    }
+    if (timingCachePath("/engines", key) != "/engines/timing_" + key + ".cache"
+        || timingCachePath("/engines/", key) != "/engines/timing_" + key + ".cache"
+        || timingCachePath("", key) != "timing_" + key + ".cache")
+    {
+        printf("FAIL timing cache path %s\n", timingCachePath("/engines", key).c_str());
+        ok = false;
+    }
+
+    char dirTemplate[] = "/tmp/yolo-cpu-tests-XXXXXX";
+    if (!mkdtemp(dirTemplate))
+    {
+        printf("FAIL cannot create a scratch directory\n");
+        return false;
+    }
+    const std::string dir = dirTemplate;
+    const std::string path = timingCachePath(dir, key);
+    std::vector<char> blob;
+
+    if (readTimingCache(path, key, blob) || !blob.empty())
+    {
+        printf("FAIL missing timing cache read\n");
+        ok = false;
+    }
+
+    // serialized caches are binary, newlines and zeros included
+    const std::vector<char> timings {'\0', '\n', 't', '\xff', '\n', '\0', '\r'};
+    if (!writeTimingCache(path, key, timings.data(), timings.size())
+        || !readTimingCache(path, key, blob) || blob != timings)
+    {
+        printf("FAIL timing cache round trip\n");
+        ok = false;
+    }
+    if (access((path + ".tmp").c_str(), F_OK) == 0)
+    {
+        printf("FAIL timing cache left its temporary file\n");
+        ok = false;
+    }
+
+    // another TensorRT or GPU times its tactics again
+    for (const std::string& other : {timingCacheKey(8201, "NVIDIA Tegra X1 (nvgpu)", 5, 3),
+                                    timingCacheKey(7103, "Xavier", 7, 2), std::string()})
+    {
+        if (readTimingCache(path, other, blob) || !blob.empty())
+        {
+            printf("FAIL timing cache of %s read for \"%s\"\n", key.c_str(), other.c_str());
+            ok = false;
+        }
+    }
+
+    // a header without timings is no cache
+    if (!writeTimingCache(path, key, timings.data(), 0) || readTimingCache(path, key, blob))
+    {
+        printf("FAIL empty timing cache read\n");
+        ok = false;
+    }
+
+    if (writeTimingCache(dir + "/missing/timing.cache", key, timings.data(), timings.size()))
+    {
+        printf("FAIL timing cache written into a missing directory\n");
+        ok = false;
+    }
+
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+    return ok;
+}
+
+/* Half precision conversions round to nearest even and saturate to
+ * infinity; every half survives the way through float and back */
+bool testHalfConversion()
+{
+    bool ok = true;
+    const std::pair<float, uint16_t> cases[] = {
+        {0.0f, 0x0000},    {-0.0f, 0x8000},          {1.0f, 0x3c00},   {-2.0f, 0xc000},
+        {65504.0f, 0x7bff}, {65520.0f, 0x7c00},      {1e6f, 0x7c00},   {-1e6f, 0xfc00},
+        {5.9604645e-8f, 0x0001}, {1e-8f, 0x0000},    {1.00048828125f, 0x3c00},
+        {1.00146484375f, 0x3c02}, {INFINITY, 0x7c00}};
+    for (const auto& c : cases)
+    {
+        if (floatToHalf(c.first) != c.second)
+        {
+            printf("FAIL half of %g is 0x%04x, expected 0x%04x\n", c.first,
+                   floatToHalf(c.first), c.second);
+            ok = false;
+        }
+    }
+    if ((floatToHalf(NAN) & 0x7c00) != 0x7c00 || !(floatToHalf(NAN) & 0x3ff))
+    {
+        printf("FAIL half of NaN is 0x%04x\n", floatToHalf(NAN));
+        ok = false;
+    }
+    for (uint32_t half = 0; half <= 0xffff; ++half)
+    {
+        const bool nan = (half & 0x7c00) == 0x7c00 && (half & 0x3ff);
+        if (!nan && floatToHalf(halfToFloat(half)) != half)
+        {
+            printf("FAIL half 0x%04x comes back as 0x%04x\n", half,
+                   floatToHalf(halfToFloat(half)));
+            ok = false;
+            break;
+        }
+    }
+    return ok;
+}
+
+bool writeFile(const std::string& path, const void* data, const size_t size)
+{
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+    file.write(static_cast<const char*>(data), size);
+    return file.good();
+}
+
+std::vector<char> readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios_base::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file),
+                             std::istreambuf_iterator<char>());
+}
+
+/* Folded value of tensor index k of a layer, in double, from the Darknet
+ * weights the layer starts at */
+double foldedReference(const std::map<std::string, std::string>& block, const float* src,
+                       const uint filters, const uint64_t perFilter, const bool bias,
+                       const uint64_t k)
+{
+    const uint f = bias ? k : k / perFilter;
+    if (!block.count("batch_normalize"))
+    {
+        return bias ? src[f] : src[filters + k];
+    }
+    const double scale = src[filters + f] / std::sqrt((double)src[3 * filters + f] + 1e-5);
+    return bias ? src[f] - src[2 * filters + f] * scale : src[4 * filters + k] * scale;
+}
+
+/* The converter path: Darknet cfg and weights on disk to a .hwts container,
+ * loaded back in FP32 and FP16 and compared with batch norm folded in double.
+ * A container of another cfg, with a flipped byte or cut short, is refused. */
+bool testWeightsContainer(std::mt19937& rng)
+{
+    bool ok = true;
+    char dirTemplate[] = "/tmp/yolo-cpu-tests-XXXXXX";
+    if (!mkdtemp(dirTemplate))
+    {
+        printf("FAIL cannot create a scratch directory\n");
+        return false;
+    }
+    const std::string dir = dirTemplate;
+    const std::string cfgPath = dir + "/yolov4-tiny-test.cfg";
+    const std::string darknetPath = dir + "/yolov4-tiny-test.weights";
+    const std::string fp32Path = dir + "/fp32.hwts", fp16Path = dir + "/fp16.hwts";
+    const std::string brokenPath = dir + "/broken.hwts";
+
+    uint64_t count;
+    const std::vector<std::map<std::string, std::string>> expectedBlocks = tinyConfig(count);
+    std::string cfg = "# written by yolo-cpu-tests\n";
+    for (const auto& block : expectedBlocks)
+    {
+        cfg += "\n[" + block.at("type") + "]\n";
+        for (const auto& entry : block)
+        {
+            if (entry.first != "type") cfg += entry.first + " = " + entry.second + "\n";
+        }
+    }
+    writeFile(cfgPath, cfg.data(), cfg.size());
+    const std::vector<std::map<std::string, std::string>> blocks = parseDarknetConfig(cfgPath);
+    if (blocks != expectedBlocks)
+    {
+        printf("FAIL cfg parsed into %zu blocks, wrote %zu\n", blocks.size(),
+               expectedBlocks.size());
+        ok = false;
+    }
+    const uint64_t cfgHash = hashConfigFile(cfgPath);
+    cfg += "# edited\n";
+    writeFile(cfgPath + ".edited", cfg.data(), cfg.size());
+    if (hashConfigFile(cfgPath + ".edited") == cfgHash)
+    {
+        printf("FAIL an edited cfg hashes the same\n");
+        ok = false;
+    }
+
+    // batch norm variances have to be positive, everything else is any value
+    std::map<uint, uint> channels;
+    std::string error;
+    convInputChannels(blocks, channels, error);
+    std::vector<float> weights = randomTensor(count, 0.5f, rng);
+    std::uniform_real_distribution<float> variance(0.05f, 2.0f);
+    uint64_t offset = 0;
+    for (const auto& conv : channels)
+    {
+        const uint filters = std::stoi(blocks[conv.first].at("filters"));
+        if (blocks[conv.first].count("batch_normalize"))
+        {
+            for (uint f = 0; f < filters; ++f) weights[offset + 3 * filters + f] = variance(rng);
+        }
+        offset += convWeightCount(blocks[conv.first], conv.second);
+    }
+    const int32_t darknetHeader[5] = {0, 2, 5, 32013, 0};
+    std::vector<char> darknet(sizeof(darknetHeader) + weights.size() * sizeof(float));
+    memcpy(darknet.data(), darknetHeader, sizeof(darknetHeader));
+    memcpy(darknet.data() + sizeof(darknetHeader), weights.data(), weights.size() * sizeof(float));
+    writeFile(darknetPath, darknet.data(), darknet.size());
+
+    std::vector<float> read;
+    if (!readDarknetWeights(darknetPath, "yolov4-tiny", read, error) || read != weights)
+    {
+        printf("FAIL Darknet weights read back: %s\n", error.c_str());
+        ok = false;
+    }
+    writeFile(brokenPath, darknet.data(), darknet.size() - 2);
+    if (readDarknetWeights(brokenPath, "yolov4-tiny", read, error)
+        || readDarknetWeights(darknetPath, "yolov9", read, error))
+    {
+        printf("FAIL truncated weights or unknown network type read\n");
+        ok = false;
+    }
+
+    for (const bool fp16 : {false, true})
+    {
+        const std::string& path = fp16 ? fp16Path : fp32Path;
+        YoloWeightsFile container;
+        if (!writeYoloWeights(path, blocks, weights, cfgHash, fp16, error)
+            || !container.load(path, cfgHash, error))
+        {
+            printf("FAIL %s container: %s\n", fp16 ? "FP16" : "FP32", error.c_str());
+            ok = false;
+            continue;
+        }
+        if (!isYoloWeightsFile(path) || container.fp16() != fp16
+            || container.layers().size() != channels.size())
+        {
+            printf("FAIL %s container header\n", fp16 ? "FP16" : "FP32");
+            ok = false;
+            continue;
+        }
+
+        // FP32 keeps the float folding, FP16 its 11 bits of precision
+        const double tolerance = fp16 ? 1e-3 : 1e-5;
+        offset = 0;
+        for (const auto& conv : channels)
+        {
+            const std::map<std::string, std::string>& block = blocks[conv.first];
+            const FoldedConv* layer = container.layer(conv.first);
+            if (!layer || layer->inputChannels != conv.second
+                || layer->filters != (uint)std::stoi(block.at("filters"))
+                || layer->kernelSize != (uint)std::stoi(block.at("size")))
+            {
+                printf("FAIL %s layer of block %u\n", fp16 ? "FP16" : "FP32", conv.first);
+                ok = false;
+                break;
+            }
+            const uint64_t perFilter = layer->kernelCount() / layer->filters;
+            for (const bool bias : {false, true})
+            {
+                const uint64_t values = bias ? layer->filters : layer->kernelCount();
+                const void* tensor = bias ? layer->bias : layer->kernel;
+                for (uint64_t k = 0; k < values; ++k)
+                {
+                    const double value = fp16
+                        ? halfToFloat(static_cast<const uint16_t*>(tensor)[k])
+                        : static_cast<const float*>(tensor)[k];
+                    const double expected = foldedReference(
+                        block, weights.data() + offset, layer->filters, perFilter, bias, k);
+                    if (!near(value, expected, tolerance))
+                    {
+                        printf("FAIL %s block %u %s %llu is %g, expected %g\n",
+                               fp16 ? "FP16" : "FP32", conv.first, bias ? "bias" : "kernel",
+                               (unsigned long long)k, value, expected);
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+            offset += convWeightCount(block, conv.second);
+        }
+        if (container.layer(0) || container.layer(2))
+        {
+            printf("FAIL layers found for blocks without convolutions\n");
+            ok = false;
+        }
+    }
+    const std::vector<char> fp32 = readFile(fp32Path), fp16 = readFile(fp16Path);
+    if (fp16.size() >= fp32.size() * 3 / 4)
+    {
+        printf("FAIL FP16 container is %zu bytes, FP32 %zu\n", fp16.size(), fp32.size());
+        ok = false;
+    }
+
+    auto refused = [&](const char* what, const std::string& path, const uint64_t hash,
+                       const char* reason) {
+        YoloWeightsFile container;
+        if (container.load(path, hash, error) || container.isOpen()
+            || error.find(reason) == std::string::npos)
+        {
+            printf("FAIL %s container: \"%s\", expected \"%s\"\n", what, error.c_str(), reason);
+            ok = false;
+        }
+        error.clear();
+    };
+    YoloWeightsFile container;
+    if (!container.load(fp32Path, 0, error))
+    {
+        printf("FAIL container without a cfg check: %s\n", error.c_str());
+        ok = false;
+    }
+    refused("other cfg", fp32Path, cfgHash + 1, "another network cfg");
+    // Darknet weights, cut to the container alignment so only the magic tells
+    std::vector<char> broken(darknet.begin(),
+                             darknet.begin() + darknet.size() / YOLO_WEIGHTS_ALIGNMENT
+                                 * YOLO_WEIGHTS_ALIGNMENT);
+    writeFile(brokenPath, broken.data(), broken.size());
+    refused("Darknet", brokenPath, 0, "not a Hermes weights file");
+    if (isYoloWeightsFile(darknetPath) || !isYoloWeightsFile(fp32Path))
+    {
+        printf("FAIL container magic\n");
+        ok = false;
+    }
+    refused("missing", dir + "/missing.hwts", 0, "Cannot open");
+
+    // one flipped bit in the first kernel
+    YoloWeightsLayer first;
+    memcpy(&first, fp32.data() + sizeof(YoloWeightsHeader), sizeof(first));
+    broken = fp32;
+    broken[first.kernelOffset] ^= 0x10;
+    writeFile(brokenPath, broken.data(), broken.size());
+    refused("flipped", brokenPath, cfgHash, "checksum mismatch");
+
+    writeFile(brokenPath, fp32.data(), fp32.size() - YOLO_WEIGHTS_ALIGNMENT);
+    refused("cut short", brokenPath, cfgHash, "truncated");
+
+    broken = fp32;
+    const uint32_t version = YOLO_WEIGHTS_VERSION + 1;
+    memcpy(broken.data() + offsetof(YoloWeightsHeader, version), &version, sizeof(version));
+    writeFile(brokenPath, broken.data(), broken.size());
+    refused("next version", brokenPath, cfgHash, "has version");
+
+    for (const std::string& path : {cfgPath, cfgPath + ".edited", darknetPath, fp32Path,
+                                    fp16Path, brokenPath})
+    {
+        unlink(path.c_str());
+    }
+    rmdir(dir.c_str());
+    return ok;
+}
+
+bool report(const char* name, const bool ok)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int seed = 1;
+    std::string cfgPath = "../../models/YOLOv3WildFires/yolov3-fire.cfg";
+    std::string weightsPath = "../../models/YOLOv3WildFires/yolov3-fire.weights";
+    const struct option options[] = {{"seed", required_argument, NULL, 's'},
+                                     {"cfg", required_argument, NULL, 'c'},
+                                     {"weights", required_argument, NULL, 'w'},
+                                     {NULL, 0, NULL, 0}};
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 's': seed = atoi(optarg); break;
+        case 'c': cfgPath = optarg; break;
+        case 'w': weightsPath = optarg; break;
+        default:
+            fprintf(stderr, "Usage: %s [--seed 1] [--cfg yolov3-fire.cfg] "
+                            "[--weights yolov3-fire.weights]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    bool ok = report("upsample references", testUpsample(rng));
+    ok &= report("activation references", testActivations(rng));
+    ok &= report("route groups", testRouteGroup(rng));
+    ok &= report("weight counts", testWeightCounts());
+    ok &= report("shipped weights", testShippedWeights(cfgPath, weightsPath));
+    ok &= report("plugin params", testPluginParams());
+    ok &= report("yolo output dims", testOutputDims());
+    ok &= report("calibration tables", testCalibrationTable());
+    ok &= report("timing caches", testTimingCache());
+    ok &= report("half conversion", testHalfConversion());
+    ok &= report("weights container", testWeightsContainer(rng));
+    return ok ? 0 : 1;
+}
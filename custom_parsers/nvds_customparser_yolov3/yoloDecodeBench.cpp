@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Checks the host yolo decoders against the scalar reference and times them
+ * over batch sizes 1 to 32, then the per-frame parse on 1 to N pool threads,
+ * see yoloDecodeCpu.h:
+ *
+ *   yolo-decode-bench [--iterations 20] [--threads N] [--cpus 2-5] [--seed 1]
+ *
+ * Random raw head tensors are decoded by decodeYoloV3RawScalar, which is
+ * built strict IEEE, and by decodeYoloV3RawVectorized and
+ * decodeYoloV3RawBatch, built with -ffast-math. The same tensors activated
+ * as the YoloLayerV3 plugin would are decoded by decodeYoloV3Pooled, the
+ * path NvDsInferParseCustomYoloV3 takes. Boxes have to come out in the same
+ * order and agree within a tolerance; exits 1 when they do not. */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "yoloDecodeCpu.h"
+#include "yoloParsePool.h"
+
+namespace {
+
+// Coordinates are in network pixels, scores in [0, 1]
+const float kCoordTolerance = 1e-3f;
+const float kScoreTolerance = 1e-5f;
+
+const uint kNetSize = 416;
+
+const std::vector<float> kAnchors = {10.0, 13.0, 16.0,  30.0,  33.0, 23.0,  30.0,  61.0,  62.0,
+                                     45.0, 59.0, 119.0, 116.0, 90.0, 156.0, 198.0, 373.0, 326.0};
+
+YoloHeadInfo makeHead(const uint gridSize, const uint numClasses, const float scaleXY,
+                      const std::vector<int>& mask)
+{
+    YoloHeadInfo head;
+    head.gridSizeW = gridSize;
+    head.gridSizeH = gridSize;
+    head.stride = kNetSize / gridSize;
+    head.numBBoxes = 3;
+    head.numClasses = numClasses;
+    head.scaleXY = scaleXY;
+    head.mask = mask;
+    head.anchors = kAnchors;
+    return head;
+}
+
+// The three heads of a 416x416 yolov3
+std::vector<YoloHeadInfo> makeNetwork(const uint numClasses, const float scaleXY)
+{
+    return {makeHead(13, numClasses, scaleXY, {6, 7, 8}),
+            makeHead(26, numClasses, scaleXY, {3, 4, 5}),
+            makeHead(52, numClasses, scaleXY, {0, 1, 2})};
+}
+
+// Raw conv outputs, spread so that w/h stay within the clamps most of the time
+std::vector<float> randomTensor(const uint64_t size, std::mt19937& rng)
+{
+    std::normal_distribution<float> dist(0.0f, 2.0f);
+    std::vector<float> tensor(size);
+    for (float& value : tensor) value = dist(rng);
+    return tensor;
+}
+
+bool near(const float a, const float b, const float tolerance)
+{
+    return std::fabs(a - b) <= tolerance * std::max(1.0f, std::fabs(b));
+}
+
+/* Compares boxes against the reference, prints the first difference */
+bool sameBoxes(const std::vector<YoloBox>& boxes, const std::vector<YoloBox>& reference,
+               const std::string& what)
+{
+    if (boxes.size() != reference.size())
+    {
+        printf("FAIL %s: %zu boxes, reference has %zu\n", what.c_str(), boxes.size(),
+               reference.size());
+        return false;
+    }
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        const YoloBox& b = boxes[i];
+        const YoloBox& r = reference[i];
+        if (b.classId != r.classId || !near(b.left, r.left, kCoordTolerance)
+            || !near(b.top, r.top, kCoordTolerance) || !near(b.width, r.width, kCoordTolerance)
+            || !near(b.height, r.height, kCoordTolerance)
+            || !near(b.confidence, r.confidence, kScoreTolerance))
+        {
+            printf("FAIL %s: box %zu is class %d (%.4f %.4f %.4f %.4f) %.6f, reference class %d "
+                   "(%.4f %.4f %.4f %.4f) %.6f\n",
+                   what.c_str(), i, b.classId, b.left, b.top, b.width, b.height, b.confidence,
+                   r.classId, r.left, r.top, r.width, r.height, r.confidence);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* One frame per network variant, scalar against vectorized */
+bool checkFrames(std::mt19937& rng)
+{
+    bool ok = true;
+    for (const uint numClasses : {1u, 80u})
+    {
+        for (const float scaleXY : {1.0f, 1.05f, 1.2f})
+        {
+            for (const YoloHeadInfo& head : makeNetwork(numClasses, scaleXY))
+            {
+                const std::vector<float> input = randomTensor(head.volume(), rng);
+                std::vector<YoloBox> reference, boxes;
+                decodeYoloV3RawScalar(input.data(), head, kNetSize, kNetSize, reference);
+                decodeYoloV3RawVectorized(input.data(), head, kNetSize, kNetSize, boxes);
+
+                char what[128];
+                snprintf(what, sizeof(what), "vectorized grid %u classes %u scale_x_y %.2f",
+                         head.gridSizeW, numClasses, scaleXY);
+                ok &= sameBoxes(boxes, reference, what);
+            }
+        }
+    }
+    return ok;
+}
+
+/* Batched decode on several threads against the reference frame by frame */
+bool checkBatch(std::mt19937& rng, const uint numThreads)
+{
+    const std::vector<YoloHeadInfo> heads = makeNetwork(1, 1.0f);
+    const uint batchSize = 7;
+
+    std::vector<std::vector<float>> tensors;
+    std::vector<const float*> buffers;
+    for (const YoloHeadInfo& head : heads)
+    {
+        tensors.push_back(randomTensor(head.volume() * batchSize, rng));
+        buffers.push_back(tensors.back().data());
+    }
+
+    std::vector<std::vector<YoloBox>> frameBoxes;
+    decodeYoloV3RawBatch(buffers, heads, batchSize, kNetSize, kNetSize, numThreads, frameBoxes);
+    if (frameBoxes.size() != batchSize)
+    {
+        printf("FAIL batch: %zu frames, expected %u\n", frameBoxes.size(), batchSize);
+        return false;
+    }
+
+    bool ok = true;
+    for (uint frame = 0; frame < batchSize; ++frame)
+    {
+        std::vector<YoloBox> reference;
+        for (uint h = 0; h < heads.size(); ++h)
+        {
+            decodeYoloV3RawScalar(buffers[h] + frame * heads[h].volume(), heads[h], kNetSize,
+                                  kNetSize, reference);
+        }
+        ok &= sameBoxes(frameBoxes[frame], reference,
+                        "batch frame " + std::to_string(frame) + " on "
+                            + std::to_string(numThreads) + " threads");
+    }
+    return ok;
+}
+
+// What the YoloLayerV3 plugin hands the parser for a raw tensor
+std::vector<float> activate(const std::vector<float>& raw, const YoloHeadInfo& head)
+{
+    std::vector<float> activated(raw.size());
+    yoloActivateCpu(raw.data(), activated.data(), head);
+    return activated;
+}
+
+/* Per-frame parse on pools of several sizes against the scalar reference */
+bool checkPooled(std::mt19937& rng, const uint numThreads)
+{
+    bool ok = true;
+    for (const uint numClasses : {1u, 80u})
+    {
+        const std::vector<YoloHeadInfo> heads = makeNetwork(numClasses, 1.0f);
+        std::vector<std::vector<float>> tensors;
+        std::vector<const float*> buffers;
+        std::vector<YoloBox> reference;
+        for (const YoloHeadInfo& head : heads)
+        {
+            const std::vector<float> raw = randomTensor(head.volume(), rng);
+            decodeYoloV3RawScalar(raw.data(), head, kNetSize, kNetSize, reference);
+            tensors.push_back(activate(raw, head));
+            buffers.push_back(tensors.back().data());
+        }
+
+        for (const uint poolSize : {1u, 2u, 3u, numThreads})
+        {
+            YoloParsePool pool(poolSize, {});
+            std::vector<YoloBox> boxes;
+            decodeYoloV3Pooled(pool, buffers, heads, kNetSize, kNetSize, boxes);
+            ok &= sameBoxes(boxes, reference,
+                            "pooled classes " + std::to_string(numClasses) + " on "
+                                + std::to_string(poolSize) + " threads");
+        }
+    }
+    return ok;
+}
+
+template <typename F>
+double timeMs(const uint iterations, F fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint i = 0; i < iterations; ++i) fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+               .count()
+        / iterations;
+}
+
+void benchmark(std::mt19937& rng, const uint iterations, const uint numThreads)
+{
+    const std::vector<YoloHeadInfo> heads = makeNetwork(1, 1.0f);
+    const uint maxBatch = 32;
+
+    std::vector<std::vector<float>> tensors;
+    std::vector<const float*> buffers;
+    for (const YoloHeadInfo& head : heads)
+    {
+        tensors.push_back(randomTensor(head.volume() * maxBatch, rng));
+        buffers.push_back(tensors.back().data());
+    }
+
+    printf("\nyolov3 %ux%u, 1 class, ms per batch over %u iterations\n", kNetSize, kNetSize,
+           iterations);
+    printf("%6s %10s %12s %12s %9s\n", "batch", "scalar", "vectorized",
+           (std::to_string(numThreads) + " threads").c_str(), "speedup");
+
+    for (uint batchSize = 1; batchSize <= maxBatch; batchSize *= 2)
+    {
+        std::vector<YoloBox> boxes;
+        const double scalarMs = timeMs(iterations, [&] {
+            for (uint frame = 0; frame < batchSize; ++frame)
+            {
+                boxes.clear();
+                for (uint h = 0; h < heads.size(); ++h)
+                {
+                    decodeYoloV3RawScalar(buffers[h] + frame * heads[h].volume(), heads[h],
+                                          kNetSize, kNetSize, boxes);
+                }
+            }
+        });
+
+        std::vector<std::vector<YoloBox>> frameBoxes;
+        const double vectorizedMs = timeMs(iterations, [&] {
+            decodeYoloV3RawBatch(buffers, heads, batchSize, kNetSize, kNetSize, 1, frameBoxes);
+        });
+        const double threadedMs = timeMs(iterations, [&] {
+            decodeYoloV3RawBatch(buffers, heads, batchSize, kNetSize, kNetSize, numThreads,
+                                 frameBoxes);
+        });
+
+        printf("%6u %10.3f %12.3f %12.3f %8.1fx\n", batchSize, scalarMs, vectorizedMs,
+               threadedMs, scalarMs / threadedMs);
+    }
+}
+
+void benchmarkPool(std::mt19937& rng, const uint iterations, const uint numThreads,
+                   const std::vector<int>& cpus)
+{
+    printf("\nyolov3 %ux%u, one frame on YoloParsePool, ms per frame over %u iterations\n",
+           kNetSize, kNetSize, iterations);
+    printf("%8s %8s %10s %9s\n", "classes", "threads", "ms", "speedup");
+
+    for (const uint numClasses : {1u, 80u})
+    {
+        const std::vector<YoloHeadInfo> heads = makeNetwork(numClasses, 1.0f);
+        std::vector<std::vector<float>> tensors;
+        std::vector<const float*> buffers;
+        for (const YoloHeadInfo& head : heads)
+        {
+            tensors.push_back(activate(randomTensor(head.volume(), rng), head));
+            buffers.push_back(tensors.back().data());
+        }
+
+        double singleMs = 0;
+        for (uint poolSize = 1; poolSize <= numThreads; ++poolSize)
+        {
+            YoloParsePool pool(poolSize, cpus);
+            std::vector<YoloBox> boxes;
+            const double ms = timeMs(iterations, [&] {
+                boxes.clear();
+                decodeYoloV3Pooled(pool, buffers, heads, kNetSize, kNetSize, boxes);
+            });
+            if (poolSize == 1) singleMs = ms;
+            printf("%8u %8u %10.3f %8.1fx\n", numClasses, poolSize, ms, singleMs / ms);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint iterations = 20;
+    uint numThreads = std::max(1u, std::thread::hardware_concurrency());
+    uint seed = 1;
+    std::vector<int> cpus;
+
+    const struct option options[] = {
+        {"iterations", required_argument, NULL, 'i'},
+        {"threads", required_argument, NULL, 't'},
+        {"cpus", required_argument, NULL, 'c'},
+        {"seed", required_argument, NULL, 's'},
+        {NULL, 0, NULL, 0}};
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'i': iterations = std::max(1, atoi(optarg)); break;
+        case 't': numThreads = std::max(1, atoi(optarg)); break;
+        case 'c': cpus = YoloParsePool::parseCpuList(optarg); break;
+        case 's': seed = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [--iterations 20] [--threads N] [--cpus LIST] [--seed 1]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    bool ok = checkFrames(rng);
+    ok &= checkBatch(rng, 1);
+    ok &= checkBatch(rng, numThreads);
+    ok &= checkPooled(rng, numThreads);
+    printf("%s: vectorized, batched and pooled decodes %s the scalar reference\n",
+           ok ? "PASS" : "FAIL", ok ? "match" : "differ from");
+    if (!ok) return 1;
+
+    benchmark(rng, iterations, numThreads);
+    benchmarkPool(rng, iterations, numThreads, cpus);
+    return 0;
+}
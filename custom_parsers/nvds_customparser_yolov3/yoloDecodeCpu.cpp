@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "yoloDecodeCpu.h"
+#include "yoloDecodeCpuInl.h"
+#include "yoloParsePool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+void yoloActivateCpu(const float* input, float* output, const YoloHeadInfo& head)
+{
+    const uint numGridCells = head.gridSizeW * head.gridSizeH;
+    const uint numAttrs = 5 + head.numClasses;
+
+    for (uint b = 0; b < head.numBBoxes; ++b)
+    {
+        for (uint a = 0; a < numAttrs; ++a)
+        {
+            const float* in = input + numGridCells * (b * numAttrs + a);
+            float* out = output + numGridCells * (b * numAttrs + a);
+            if (a == 0 || a == 1)
+            {
+                for (uint c = 0; c < numGridCells; ++c) out[c] = scaledSigmoidCpu(in[c], head.scaleXY);
+            }
+            else if (a == 2 || a == 3)
+            {
+                for (uint c = 0; c < numGridCells; ++c) out[c] = std::exp(in[c]);
+            }
+            else
+            {
+                for (uint c = 0; c < numGridCells; ++c) out[c] = sigmoidCpu(in[c]);
+            }
+        }
+    }
+}
+
+namespace {
+
+/* Raw conv outputs, activated here as gpuYoloLayerV3 does */
+struct RawCell
+{
+    float scaleXY;
+    float xy(const float v) const { return scaledSigmoidCpu(v, scaleXY); }
+    float wh(const float v) const { return std::exp(v); }
+    float score(const float v) const { return sigmoidCpu(v); }
+};
+
+/* Outputs of the YoloLayerV3 plugin, already activated */
+struct ActivatedCell
+{
+    float xy(const float v) const { return v; }
+    float wh(const float v) const { return v; }
+    float score(const float v) const { return v; }
+};
+
+/* The one cell by cell decode of rows [rowBegin, rowEnd), the cell type only
+ * decides what is still to be activated */
+template <typename Cell>
+void decodeCells(const float* input, const YoloHeadInfo& head, const Cell& activate,
+                 const uint rowBegin, const uint rowEnd, const uint netW, const uint netH,
+                 std::vector<YoloBox>& boxes)
+{
+    assert(head.mask.size() >= head.numBBoxes);
+    const uint numGridCells = head.gridSizeW * head.gridSizeH;
+    const uint numAttrs = 5 + head.numClasses;
+
+    for (uint y = rowBegin; y < std::min(rowEnd, head.gridSizeH); ++y) {
+        for (uint x = 0; x < head.gridSizeW; ++x) {
+            for (uint b = 0; b < head.numBBoxes; ++b)
+            {
+                const float pw = head.anchors[head.mask[b] * 2];
+                const float ph = head.anchors[head.mask[b] * 2 + 1];
+
+                const uint bbindex = y * head.gridSizeW + x;
+                const float* cell = input + bbindex + numGridCells * (b * numAttrs);
+
+                const float bx = x + activate.xy(cell[numGridCells * 0]);
+                const float by = y + activate.xy(cell[numGridCells * 1]);
+                const float bw = pw * activate.wh(cell[numGridCells * 2]);
+                const float bh = ph * activate.wh(cell[numGridCells * 3]);
+                const float objectness = activate.score(cell[numGridCells * 4]);
+
+                float maxProb = 0.0f;
+                int maxIndex = -1;
+
+                for (uint i = 0; i < head.numClasses; ++i)
+                {
+                    const float prob = activate.score(cell[numGridCells * (5 + i)]);
+                    if (prob > maxProb)
+                    {
+                        maxProb = prob;
+                        maxIndex = i;
+                    }
+                }
+                maxProb = objectness * maxProb;
+
+                addBox(bx, by, bw, bh, head.stride, netW, netH, maxIndex, maxProb, boxes);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void decodeYoloV3RawScalar(const float* input, const YoloHeadInfo& head,
+                           const uint netW, const uint netH,
+                           std::vector<YoloBox>& boxes)
+{
+    decodeCells(input, head, RawCell{head.scaleXY}, 0, head.gridSizeH, netW, netH, boxes);
+}
+
+void decodeYoloV3Rows(const float* input, const YoloHeadInfo& head,
+                      const uint rowBegin, const uint rowEnd,
+                      const uint netW, const uint netH,
+                      std::vector<YoloBox>& boxes)
+{
+    decodeCells(input, head, ActivatedCell(), rowBegin, rowEnd, netW, netH, boxes);
+}
+
+void decodeYoloV3Pooled(YoloParsePool& pool, const std::vector<const float*>& headBuffers,
+                        const std::vector<YoloHeadInfo>& heads,
+                        const uint netW, const uint netH,
+                        std::vector<YoloBox>& boxes)
+{
+    assert(headBuffers.size() == heads.size());
+
+    // (head, first row) of every band, in output order
+    std::vector<std::pair<uint, uint>> bands;
+    std::vector<uint> bandRows(heads.size());
+    for (uint h = 0; h < heads.size(); ++h)
+    {
+        const uint numBands = std::max(1u, std::min(pool.size(), heads[h].gridSizeH));
+        bandRows[h] = (heads[h].gridSizeH + numBands - 1) / numBands;
+        for (uint row = 0; row < heads[h].gridSizeH; row += bandRows[h])
+        {
+            bands.emplace_back(h, row);
+        }
+    }
+
+    std::vector<std::vector<YoloBox>> partial(bands.size());
+    pool.parallelFor(bands.size(), [&](uint task) {
+        const uint h = bands[task].first;
+        const uint row = bands[task].second;
+        decodeYoloV3Rows(headBuffers[h], heads[h], row, row + bandRows[h], netW, netH,
+                         partial[task]);
+    });
+
+    for (const std::vector<YoloBox>& part : partial)
+    {
+        boxes.insert(boxes.end(), part.begin(), part.end());
+    }
+}
+
+void decodeYoloV3RawBatch(const std::vector<const float*>& headBuffers,
+                          const std::vector<YoloHeadInfo>& heads,
+                          const uint batchSize, const uint netW, const uint netH,
+                          const uint numThreads,
+                          std::vector<std::vector<YoloBox>>& frameBoxes)
+{
+    assert(headBuffers.size() == heads.size());
+    frameBoxes.assign(batchSize, std::vector<YoloBox>());
+
+    auto decodeFrames = [&](const uint first, const uint step) {
+        for (uint frame = first; frame < batchSize; frame += step)
+        {
+            for (uint h = 0; h < heads.size(); ++h)
+            {
+                decodeYoloV3RawVectorized(headBuffers[h] + frame * heads[h].volume(),
+                                          heads[h], netW, netH, frameBoxes[frame]);
+            }
+        }
+    };
+
+    const uint workers = std::max(1u, std::min(numThreads, batchSize));
+    if (workers == 1)
+    {
+        decodeFrames(0, 1);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (uint t = 1; t < workers; ++t)
+    {
+        threads.emplace_back(decodeFrames, t, workers);
+    }
+    decodeFrames(0, workers);
+    for (auto& t : threads) t.join();
+}
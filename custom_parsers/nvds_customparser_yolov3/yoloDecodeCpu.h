@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __YOLO_DECODE_CPU_H__
+#define __YOLO_DECODE_CPU_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+class YoloParsePool;
+
+/**
+ * Describes one yolo output head (one scale) of the network.
+ * Tensor layout is the one produced by the conv layer feeding the yolo
+ * layer: numBBoxes * (5 + numClasses) planes of gridSizeH x gridSizeW.
+ */
+struct YoloHeadInfo
+{
+    uint gridSizeW{0};
+    uint gridSizeH{0};
+    uint stride{0};
+    uint numBBoxes{0};
+    uint numClasses{0};
+    float scaleXY{1.0f};
+    std::vector<int> mask;
+    std::vector<float> anchors;
+
+    uint64_t volume() const
+    {
+        return static_cast<uint64_t>(gridSizeW) * gridSizeH * numBBoxes * (5 + numClasses);
+    }
+};
+
+/**
+ * Host side equivalent of NvDsInferParseObjectInfo, kept free of any
+ * TensorRT/DeepStream headers so the decoder builds without CUDA.
+ */
+struct YoloBox
+{
+    float left{0};
+    float top{0};
+    float width{0};
+    float height{0};
+    float confidence{0};
+    int classId{-1};
+};
+
+/* Applies the activations of gpuYoloLayerV3 (scale_x_y stretched sigmoid on
+ * x, y, sigmoid on objectness and class scores, exp on w, h) to one frame of
+ * a head. */
+void yoloActivateCpu(const float* input, float* output, const YoloHeadInfo& head);
+
+/* Golden reference: activates and decodes one frame of one head cell by cell,
+ * in the same order and with the same arithmetic as decodeYoloV3Tensor. */
+void decodeYoloV3RawScalar(const float* input, const YoloHeadInfo& head,
+                           const uint netW, const uint netH,
+                           std::vector<YoloBox>& boxes);
+
+/* Same result as decodeYoloV3RawScalar, but every activation and box
+ * transform runs over whole planes so the compiler can vectorize it. */
+void decodeYoloV3RawVectorized(const float* input, const YoloHeadInfo& head,
+                               const uint netW, const uint netH,
+                               std::vector<YoloBox>& boxes);
+
+/* Decodes a whole batch. headBuffers[i] points at the batched output of
+ * heads[i] (frames laid out back to back, volume() floats each). Frames are
+ * spread over numThreads threads; frameBoxes is resized to batchSize. */
+void decodeYoloV3RawBatch(const std::vector<const float*>& headBuffers,
+                          const std::vector<YoloHeadInfo>& heads,
+                          const uint batchSize, const uint netW, const uint netH,
+                          const uint numThreads,
+                          std::vector<std::vector<YoloBox>>& frameBoxes);
+
+/* Decodes rows [rowBegin, rowEnd) of one frame of a head the YoloLayerV3
+ * plugin has already activated, cell by cell like decodeYoloV3RawScalar. */
+void decodeYoloV3Rows(const float* input, const YoloHeadInfo& head,
+                      const uint rowBegin, const uint rowEnd,
+                      const uint netW, const uint netH,
+                      std::vector<YoloBox>& boxes);
+
+/* Decodes one frame of activated heads on pool. Every head is cut into row
+ * bands, one per pool thread, and the bands are appended in head and row
+ * order, so boxes come out as if the heads were decoded one after another. */
+void decodeYoloV3Pooled(YoloParsePool& pool, const std::vector<const float*>& headBuffers,
+                        const std::vector<YoloHeadInfo>& heads,
+                        const uint netW, const uint netH,
+                        std::vector<YoloBox>& boxes);
+
+#endif // __YOLO_DECODE_CPU_H__
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __YOLO_DECODE_CPU_INL_H__
+#define __YOLO_DECODE_CPU_INL_H__
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "yoloDecodeCpu.h"
+
+/* Helpers shared by yoloDecodeCpu.cpp and yoloDecodeVectorized.cpp. They are
+ * static so each file keeps its own copy: the vectorized file is built with
+ * -ffast-math and must not lend its versions to the strict scalar reference. */
+
+static inline float sigmoidCpu(const float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+static inline float scaledSigmoidCpu(const float x, const float scaleXY)
+{
+    return sigmoidCpu(x) * scaleXY - 0.5f * (scaleXY - 1.0f);
+}
+
+static inline float clampCpu(const float val, const float minVal, const float maxVal)
+{
+    return std::min(maxVal, std::max(minVal, val));
+}
+
+// Mirrors convertBBox + addBBoxProposal in nvdsparsebbox_Yolo.cpp
+static inline void addBox(const float bx, const float by, const float bw, const float bh,
+                   const uint stride, const uint netW, const uint netH,
+                   const int maxIndex, const float maxProb, std::vector<YoloBox>& boxes)
+{
+    const float xCenter = bx * stride;
+    const float yCenter = by * stride;
+    float x0 = xCenter - bw / 2;
+    float y0 = yCenter - bh / 2;
+    float x1 = x0 + bw;
+    float y1 = y0 + bh;
+
+    x0 = clampCpu(x0, 0, netW);
+    y0 = clampCpu(y0, 0, netH);
+    x1 = clampCpu(x1, 0, netW);
+    y1 = clampCpu(y1, 0, netH);
+
+    YoloBox b;
+    b.left = x0;
+    b.width = clampCpu(x1 - x0, 0, netW);
+    b.top = y0;
+    b.height = clampCpu(y1 - y0, 0, netH);
+    if (b.width < 1 || b.height < 1) return;
+
+    b.confidence = maxProb;
+    b.classId = maxIndex;
+    boxes.push_back(b);
+}
+
+
+#endif // __YOLO_DECODE_CPU_INL_H__
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Built with -O3 -ffast-math so the plane-wise loops below use vectorized
+ * exp(). decodeYoloV3RawScalar in yoloDecodeCpu.cpp stays strict IEEE and is
+ * what this is checked against, see yoloDecodeBench.cpp. */
+
+#include "yoloDecodeCpu.h"
+#include "yoloDecodeCpuInl.h"
+
+#include <cassert>
+
+void decodeYoloV3RawVectorized(const float* input, const YoloHeadInfo& head,
+                               const uint netW, const uint netH,
+                               std::vector<YoloBox>& boxes)
+{
+    assert(head.mask.size() >= head.numBBoxes);
+    const uint numGridCells = head.gridSizeW * head.gridSizeH;
+    const uint numAttrs = 5 + head.numClasses;
+
+    // Per anchor planes: bx, by, bw, bh, best score, best class
+    std::vector<float> planes(numGridCells * head.numBBoxes * 5);
+    std::vector<int> classes(numGridCells * head.numBBoxes);
+
+    for (uint b = 0; b < head.numBBoxes; ++b)
+    {
+        const float pw = head.anchors[head.mask[b] * 2];
+        const float ph = head.anchors[head.mask[b] * 2 + 1];
+        const float* in = input + numGridCells * (b * numAttrs);
+
+        float* __restrict__ bx = planes.data() + numGridCells * (b * 5 + 0);
+        float* __restrict__ by = planes.data() + numGridCells * (b * 5 + 1);
+        float* __restrict__ bw = planes.data() + numGridCells * (b * 5 + 2);
+        float* __restrict__ bh = planes.data() + numGridCells * (b * 5 + 3);
+        float* __restrict__ score = planes.data() + numGridCells * (b * 5 + 4);
+        int* __restrict__ cls = classes.data() + numGridCells * b;
+
+        const float* __restrict__ tx = in + numGridCells * 0;
+        const float* __restrict__ ty = in + numGridCells * 1;
+        const float* __restrict__ tw = in + numGridCells * 2;
+        const float* __restrict__ th = in + numGridCells * 3;
+        const float* __restrict__ to = in + numGridCells * 4;
+
+        for (uint c = 0; c < numGridCells; ++c)
+        {
+            bx[c] = static_cast<float>(c % head.gridSizeW) + scaledSigmoidCpu(tx[c], head.scaleXY);
+            by[c] = static_cast<float>(c / head.gridSizeW) + scaledSigmoidCpu(ty[c], head.scaleXY);
+            bw[c] = pw * std::exp(tw[c]);
+            bh[c] = ph * std::exp(th[c]);
+            score[c] = 0.0f;
+            cls[c] = -1;
+        }
+
+        for (uint i = 0; i < head.numClasses; ++i)
+        {
+            const float* __restrict__ tc = in + numGridCells * (5 + i);
+            for (uint c = 0; c < numGridCells; ++c)
+            {
+                const float prob = sigmoidCpu(tc[c]);
+                const bool better = prob > score[c];
+                score[c] = better ? prob : score[c];
+                cls[c] = better ? static_cast<int>(i) : cls[c];
+            }
+        }
+
+        for (uint c = 0; c < numGridCells; ++c)
+        {
+            score[c] *= sigmoidCpu(to[c]);
+        }
+    }
+
+    // Emit in the same cell-major order as the scalar reference
+    for (uint c = 0; c < numGridCells; ++c)
+    {
+        for (uint b = 0; b < head.numBBoxes; ++b)
+        {
+            const float* p = planes.data() + numGridCells * (b * 5);
+            addBox(p[c], p[numGridCells + c], p[numGridCells * 2 + c], p[numGridCells * 3 + c],
+                   head.stride, netW, netH, classes[numGridCells * b + c],
+                   p[numGridCells * 4 + c], boxes);
+        }
+    }
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Runs the layers trt_utils.cpp builds on a GPU and compares them with the
+ * host references in yoloLayersCpu.h:
+ *
+ *   yolo-layers-check [--seed 1]
+ *
+ * Every case is a network of a single netAddUpsample or netAddActivation on
+ * a random FP32 tensor, built and run with the TensorRT the library links.
+ * Upsampling has to match exactly, activations within kTolerance. Exits 1
+ * when any case differs or fails to build. */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cuda_runtime_api.h"
+#include "trt_utils.h"
+#include "yoloLayersCpu.h"
+
+#if NV_TENSORRT_MAJOR >= 8
+#define TRT_NOEXCEPT noexcept
+#else
+#define TRT_NOEXCEPT
+#endif
+
+namespace {
+
+// softplus and tanh are approximated by TensorRT
+const float kTolerance = 1e-4f;
+
+class Logger : public nvinfer1::ILogger
+{
+    void log(Severity severity, const char* msg) TRT_NOEXCEPT override
+    {
+        if (severity <= Severity::kWARNING) fprintf(stderr, "TensorRT: %s\n", msg);
+    }
+};
+
+Logger gLogger;
+
+std::vector<float> randomTensor(const size_t size, const float spread, std::mt19937& rng)
+{
+    std::normal_distribution<float> dist(0.0f, spread);
+    std::vector<float> tensor(size);
+    for (float& value : tensor) value = dist(rng);
+    return tensor;
+}
+
+/* Builds the layer addLayer puts on a 1 x c x h x w input, runs it on input
+ * and returns its output, empty when anything failed */
+template <typename AddLayer>
+std::vector<float> runLayer(const uint c, const uint h, const uint w,
+                            const std::vector<float>& input, AddLayer addLayer)
+{
+    std::vector<float> output;
+    nvinfer1::IBuilder* builder = nvinfer1::createInferBuilder(gLogger);
+    nvinfer1::INetworkDefinition* network = builder->createNetworkV2(
+        1U << static_cast<uint32_t>(nvinfer1::NetworkDefinitionCreationFlag::kEXPLICIT_BATCH));
+    nvinfer1::IBuilderConfig* config = builder->createBuilderConfig();
+    nvinfer1::ICudaEngine* engine = nullptr;
+    nvinfer1::IExecutionContext* context = nullptr;
+    std::vector<nvinfer1::Weights> trtWeights;
+    void* buffers[2] = {nullptr, nullptr};
+
+    nvinfer1::ITensor* data = network->addInput("data", nvinfer1::DataType::kFLOAT,
+                                                nvinfer1::Dims4{1, (int)c, (int)h, (int)w});
+    nvinfer1::ILayer* layer = addLayer(data, network, trtWeights);
+    if (layer)
+    {
+        nvinfer1::ITensor* out = layer->getOutput(0);
+        out->setName("out");
+        network->markOutput(*out);
+        config->setMaxWorkspaceSize(1 << 24);
+        engine = builder->buildEngineWithConfig(*network, *config);
+    }
+    if (engine) context = engine->createExecutionContext();
+    if (context)
+    {
+        const int inIndex = engine->getBindingIndex("data");
+        const int outIndex = engine->getBindingIndex("out");
+        const nvinfer1::Dims outDims = engine->getBindingDimensions(outIndex);
+        size_t outSize = 1;
+        for (int d = 0; d < outDims.nbDims; ++d) outSize *= outDims.d[d];
+
+        output.resize(outSize);
+        if (cudaMalloc(&buffers[inIndex], input.size() * sizeof(float)) != cudaSuccess
+            || cudaMalloc(&buffers[outIndex], outSize * sizeof(float)) != cudaSuccess
+            || cudaMemcpy(buffers[inIndex], input.data(), input.size() * sizeof(float),
+                          cudaMemcpyHostToDevice) != cudaSuccess
+            || !context->executeV2(buffers)
+            || cudaMemcpy(output.data(), buffers[outIndex], outSize * sizeof(float),
+                          cudaMemcpyDeviceToHost) != cudaSuccess)
+        {
+            output.clear();
+        }
+    }
+
+    for (void* buffer : buffers) cudaFree(buffer);
+    for (nvinfer1::Weights& weights : trtWeights) delete[] (const float*)weights.values;
+    if (context) context->destroy();
+    if (engine) engine->destroy();
+    config->destroy();
+    network->destroy();
+    builder->destroy();
+    return output;
+}
+
+bool checkUpsample(std::mt19937& rng)
+{
+    bool ok = true;
+    const uint shapes[][3] = {{3, 13, 13}, {8, 26, 26}, {2, 5, 9}};
+    for (const auto& shape : shapes)
+    {
+        for (const uint stride : {2u, 3u})
+        {
+            const uint c = shape[0], h = shape[1], w = shape[2];
+            const std::vector<float> input = randomTensor(c * h * w, 4.0f, rng);
+            std::map<std::string, std::string> block
+                = {{"type", "upsample"}, {"stride", std::to_string(stride)}};
+            std::vector<float> weights;
+            int inputChannels = c;
+            const std::vector<float> output = runLayer(
+                c, h, w, input,
+                [&](nvinfer1::ITensor* data, nvinfer1::INetworkDefinition* network,
+                    std::vector<nvinfer1::Weights>& trtWeights) {
+                    return netAddUpsample(0, block, weights, trtWeights, inputChannels, data,
+                                          network);
+                });
+
+            std::vector<float> reference(c * h * w * stride * stride);
+            upsampleNearestCpu(input.data(), reference.data(), c, h, w, stride);
+            char what[64];
+            snprintf(what, sizeof(what), "upsample %ux%ux%u stride %u", c, h, w, stride);
+            if (output != reference)
+            {
+                printf("FAIL %s: %s\n", what,
+                       output.empty() ? "did not run" : "differs from upsampleNearestCpu");
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+bool checkActivations(std::mt19937& rng)
+{
+    bool ok = true;
+    const uint c = 4, h = 16, w = 16;
+    std::vector<float> input = randomTensor(c * h * w, 6.0f, rng);
+    // the tails where exp() overflows or vanishes
+    const float edges[] = {0.0f, 20.0f, -20.0f, 88.0f, 89.0f, -89.0f, 1000.0f, -1000.0f};
+    std::copy(std::begin(edges), std::end(edges), input.begin());
+
+    for (const std::string activation : {"leaky", "logistic", "swish", "mish"})
+    {
+        const std::vector<float> output = runLayer(
+            c, h, w, input,
+            [&](nvinfer1::ITensor* data, nvinfer1::INetworkDefinition* network,
+                std::vector<nvinfer1::Weights>&) {
+                return netAddActivation(0, activation, data, network);
+            });
+        std::vector<float> reference = input;
+        activationCpu(activation, reference.data(), reference.size());
+        if (output.size() != reference.size())
+        {
+            printf("FAIL %s: did not run\n", activation.c_str());
+            ok = false;
+            continue;
+        }
+        for (size_t i = 0; i < output.size(); ++i)
+        {
+            if (!(std::fabs(output[i] - reference[i])
+                  <= kTolerance * std::max(1.0f, std::fabs(reference[i]))))
+            {
+                printf("FAIL %s(%g) is %g, activationCpu gives %g\n", activation.c_str(),
+                       input[i], output[i], reference[i]);
+                ok = false;
+                break;
+            }
+        }
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int seed = 1;
+    const struct option options[] = {{"seed", required_argument, NULL, 's'}, {NULL, 0, NULL, 0}};
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 's': seed = atoi(optarg); break;
+        default: fprintf(stderr, "Usage: %s [--seed 1]\n", argv[0]); return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    bool ok = checkUpsample(rng);
+    ok &= checkActivations(rng);
+    printf("%s: TensorRT upsample and activation layers %s the host references\n",
+           ok ? "PASS" : "FAIL", ok ? "match" : "differ from");
+    return ok ? 0 : 1;
+}
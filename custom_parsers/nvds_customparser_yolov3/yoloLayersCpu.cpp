@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "yoloLayersCpu.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+void upsampleNearestCpu(const float* input, float* output, const uint c, const uint h,
+                        const uint w, const uint stride)
+{
+    const uint outW = w * stride;
+    for (uint ch = 0; ch < c; ++ch)
+    {
+        const float* in = input + ch * h * w;
+        float* out = output + ch * h * w * stride * stride;
+        for (uint y = 0; y < h * stride; ++y)
+        {
+            const float* inRow = in + (y / stride) * w;
+            float* outRow = out + y * outW;
+            for (uint x = 0; x < outW; ++x) outRow[x] = inRow[x / stride];
+        }
+    }
+}
+
+void upsampleMatMulCpu(const float* input, float* output, const uint c, const uint h,
+                       const uint w, const uint stride)
+{
+    // netAddUpsample only supported square inputs
+    assert(h == w);
+
+    std::vector<float> preWt(stride * h * w);
+    for (uint i = 0, idx = 0; i < h; ++i)
+    {
+        for (uint s = 0; s < stride; ++s)
+        {
+            for (uint j = 0; j < w; ++j, ++idx)
+            {
+                preWt[idx] = (i == j) ? 1.0 : 0.0;
+            }
+        }
+    }
+    std::vector<float> postWt(stride * h * w);
+    for (uint i = 0, idx = 0; i < h; ++i)
+    {
+        for (uint j = 0; j < stride * w; ++j, ++idx)
+        {
+            postWt[idx] = (j / stride == i) ? 1.0 : 0.0;
+        }
+    }
+
+    std::vector<float> mm1(stride * h * w);
+    for (uint ch = 0; ch < c; ++ch)
+    {
+        const float* in = input + ch * h * w;
+        float* out = output + ch * h * w * stride * stride;
+
+        // (stride*h x h) * (h x w)
+        for (uint r = 0; r < stride * h; ++r)
+        {
+            for (uint col = 0; col < w; ++col)
+            {
+                float acc = 0;
+                for (uint k = 0; k < h; ++k) acc += preWt[r * w + k] * in[k * w + col];
+                mm1[r * w + col] = acc;
+            }
+        }
+        // (stride*h x w) * (h x stride*w)
+        for (uint r = 0; r < stride * h; ++r)
+        {
+            for (uint col = 0; col < stride * w; ++col)
+            {
+                float acc = 0;
+                for (uint k = 0; k < w; ++k) acc += mm1[r * w + k] * postWt[k * stride * w + col];
+                out[r * stride * w + col] = acc;
+            }
+        }
+    }
+}
+
+bool activationCpu(const std::string& activation, float* data, const size_t count)
+{
+    if (activation == "linear") return true;
+
+    if (activation == "leaky")
+    {
+        for (size_t i = 0; i < count; ++i) data[i] = data[i] > 0 ? data[i] : 0.1f * data[i];
+    }
+    else if (activation == "logistic")
+    {
+        for (size_t i = 0; i < count; ++i) data[i] = 1.0f / (1.0f + std::exp(-data[i]));
+    }
+    else if (activation == "swish")
+    {
+        for (size_t i = 0; i < count; ++i) data[i] = data[i] / (1.0f + std::exp(-data[i]));
+    }
+    else if (activation == "mish")
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            data[i] = data[i] * std::tanh(std::log1p(std::exp(data[i])));
+        }
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void routeGroupCpu(const float* input, float* output, const uint c, const uint h, const uint w,
+                   const uint groups, const uint groupId)
+{
+    assert(groups > 0 && c % groups == 0);
+    assert(groupId < groups);
+    const uint groupChannels = c / groups;
+    std::memcpy(output, input + static_cast<size_t>(groupId) * groupChannels * h * w,
+                sizeof(float) * groupChannels * h * w);
+}
+
+uint64_t convWeightCount(const std::map<std::string, std::string>& block, const int inputChannels)
+{
+    assert(block.at("type") == "convolutional");
+    const uint64_t filters = std::stoul(block.at("filters"));
+    const uint64_t kernelSize = std::stoul(block.at("size"));
+    const auto bn = block.find("batch_normalize");
+    const bool batchNormalize = (bn != block.end()) && (bn->second == "1");
+
+    // batch norm: biases, scales, running mean, running variance
+    const uint64_t perFilter = batchNormalize ? 4 : 1;
+    return filters * perFilter + filters * inputChannels * kernelSize * kernelSize;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __YOLO_LAYERS_CPU_H__
+#define __YOLO_LAYERS_CPU_H__
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/* Host reference implementations of the layers built in trt_utils.cpp.
+ * Tensors are single CHW frames. */
+
+/* Nearest neighbour upsampling, as built by netAddUpsample. */
+void upsampleNearestCpu(const float* input, float* output, const uint c, const uint h,
+                        const uint w, const uint stride);
+
+/* The pre/post matrix formulation previously used by netAddUpsample:
+ * out[c] = preMul (stride*h x h) * in[c] (h x w) * postMul (w x stride*w).
+ * The matrices are built exactly as the TensorRT constants were. */
+void upsampleMatMulCpu(const float* input, float* output, const uint c, const uint h,
+                       const uint w, const uint stride);
+
+/* In-place activation as built by netAddActivation: linear, leaky (0.1),
+ * logistic, swish (x * sigmoid(x)) and mish (x * tanh(softplus(x))).
+ * Returns false for an unsupported activation. */
+bool activationCpu(const std::string& activation, float* data, const size_t count);
+
+/* Channel slice of a route layer with groups/group_id, as built by
+ * netAddRouteGroup. Writes c / groups channels. */
+void routeGroupCpu(const float* input, float* output, const uint c, const uint h, const uint w,
+                   const uint groups, const uint groupId);
+
+/* Number of Darknet weights a convolutional block consumes for the given
+ * number of input channels: bias or 4 batch norm vectors, plus kernels. */
+uint64_t convWeightCount(const std::map<std::string, std::string>& block, const int inputChannels);
+
+#endif // __YOLO_LAYERS_CPU_H__
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "yoloParsePool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+
+YoloParsePool::YoloParsePool(const uint numThreads, const std::vector<int>& cpus)
+{
+    const uint workers = std::max(1u, numThreads) - 1;
+    for (uint i = 0; i < workers; ++i)
+    {
+        m_Workers.emplace_back(&YoloParsePool::workerLoop, this);
+        if (!cpus.empty())
+        {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(cpus[i % cpus.size()], &cpuset);
+            if (pthread_setaffinity_np(m_Workers.back().native_handle(),
+                                       sizeof(cpu_set_t), &cpuset) != 0)
+            {
+                std::cerr << "WARNING: Failed to pin yolo parse worker " << i
+                          << " to cpu " << cpus[i % cpus.size()] << std::endl;
+            }
+        }
+    }
+}
+
+YoloParsePool::~YoloParsePool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WorkCv.notify_all();
+    for (auto& worker : m_Workers) worker.join();
+}
+
+YoloParsePool& YoloParsePool::instance()
+{
+    static YoloParsePool pool(
+        [] {
+            const char* env = std::getenv(YOLO_PARSE_THREADS_ENV);
+            const int threads = env ? std::atoi(env) : 1;
+            return static_cast<uint>(std::max(1, threads));
+        }(),
+        [] {
+            const char* env = std::getenv(YOLO_PARSE_CPUS_ENV);
+            return env ? parseCpuList(env) : std::vector<int>();
+        }());
+    return pool;
+}
+
+std::vector<int> YoloParsePool::parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        const size_t dash = item.find('-');
+        char* end = nullptr;
+        const long first = std::strtol(item.c_str(), &end, 10);
+        if (end == item.c_str() || first < 0) continue;
+        long last = first;
+        if (dash != std::string::npos)
+        {
+            const char* lastStr = item.c_str() + dash + 1;
+            last = std::strtol(lastStr, &end, 10);
+            if (end == lastStr || last < first) continue;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+        {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+void YoloParsePool::parallelFor(const uint count, const std::function<void(uint)>& fn)
+{
+    if (count == 0) return;
+    if (m_Workers.empty() || count == 1)
+    {
+        for (uint i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(m_SubmitMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Task = &fn;
+        m_TaskCount = count;
+        m_NextTask = 0;
+        m_Pending = m_Workers.size();
+        ++m_Generation;
+    }
+    m_WorkCv.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCv.wait(lock, [this] { return m_Pending == 0; });
+    m_Task = nullptr;
+}
+
+void YoloParsePool::runTasks()
+{
+    for (uint i = m_NextTask.fetch_add(1); i < m_TaskCount; i = m_NextTask.fetch_add(1))
+    {
+        (*m_Task)(i);
+    }
+}
+
+void YoloParsePool::workerLoop()
+{
+    uint64_t seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkCv.wait(lock, [&] { return m_Stop || m_Generation != seenGeneration; });
+            if (m_Stop) return;
+            seenGeneration = m_Generation;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (--m_Pending == 0) m_DoneCv.notify_one();
+        }
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __YOLO_PARSE_POOL_H__
+#define __YOLO_PARSE_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+/* Environment variables read by YoloParsePool::instance() */
+#define YOLO_PARSE_THREADS_ENV "HERMES_PARSE_THREADS"
+#define YOLO_PARSE_CPUS_ENV "HERMES_PARSE_CPUS"
+
+/**
+ * Persistent worker pool the yolov3 parser decodes row bands on.
+ * The calling thread takes part in every parallelFor, so a pool of size N
+ * owns N - 1 threads. Workers are optionally pinned round-robin to a list
+ * of CPU cores.
+ */
+class YoloParsePool
+{
+public:
+    YoloParsePool(const uint numThreads, const std::vector<int>& cpus);
+    ~YoloParsePool();
+
+    YoloParsePool(const YoloParsePool&) = delete;
+    YoloParsePool& operator=(const YoloParsePool&) = delete;
+
+    /* Process wide pool, sized from HERMES_PARSE_THREADS and pinned to
+     * HERMES_PARSE_CPUS, e.g. "2,3,4-5". A single thread unless configured:
+     * the parser runs on nvinfer's output thread for every frame, and waking
+     * workers there competes with the stage threads for the cores. */
+    static YoloParsePool& instance();
+
+    /* Runs fn(0) .. fn(count - 1) across the pool and blocks until all
+     * calls have returned. */
+    void parallelFor(const uint count, const std::function<void(uint)>& fn);
+
+    uint size() const { return m_Workers.size() + 1; }
+
+    /* Parses a cpu list such as "0,2-3". Invalid entries are skipped. */
+    static std::vector<int> parseCpuList(const std::string& list);
+
+private:
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> m_Workers;
+    std::mutex m_SubmitMutex;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkCv;
+    std::condition_variable m_DoneCv;
+    const std::function<void(uint)>* m_Task {nullptr};
+    uint m_TaskCount {0};
+    std::atomic<uint> m_NextTask {0};
+    uint m_Pending {0};
+    uint64_t m_Generation {0};
+    bool m_Stop {false};
+};
+
+#endif // __YOLO_PARSE_POOL_H__
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "yoloPluginParams.h"
+
+#include <cstring>
+
+namespace {
+template <typename T>
+void write(char*& buffer, const T& val)
+{
+    std::memcpy(buffer, &val, sizeof(T));
+    buffer += sizeof(T);
+}
+
+template <typename T>
+void read(const char*& buffer, T& val)
+{
+    std::memcpy(&val, buffer, sizeof(T));
+    buffer += sizeof(T);
+}
+} // namespace
+
+size_t YoloLayerParams::getSerializationSize() const
+{
+    return sizeof(uint32_t) + sizeof(numBoxes) + sizeof(numClasses) + sizeof(gridSize)
+        + sizeof(scaleXY) + sizeof(dataType);
+}
+
+void YoloLayerParams::serialize(void* buffer) const
+{
+    char* d = static_cast<char*>(buffer);
+    write(d, static_cast<uint32_t>(YOLO_PLUGIN_PARAMS_VERSION));
+    write(d, numBoxes);
+    write(d, numClasses);
+    write(d, gridSize);
+    write(d, scaleXY);
+    write(d, dataType);
+}
+
+bool YoloLayerParams::deserialize(const void* data, const size_t length,
+                                  YoloLayerParams& params)
+{
+    YoloLayerParams p;
+    if (data == nullptr || length != p.getSerializationSize()) return false;
+
+    const char* d = static_cast<const char*>(data);
+    uint32_t version = 0;
+    read(d, version);
+    if (version != YOLO_PLUGIN_PARAMS_VERSION) return false;
+    read(d, p.numBoxes);
+    read(d, p.numClasses);
+    read(d, p.gridSize);
+    read(d, p.scaleXY);
+    read(d, p.dataType);
+    if (p.numBoxes == 0 || p.numClasses == 0 || p.gridSize == 0) return false;
+
+    params = p;
+    return true;
+}
+
+bool yoloLayerOutputDims(const YoloLayerParams& params, const int* inputDims, const int nbDims,
+                         int* outputDims)
+{
+    if (nbDims != 3 && nbDims != 4) return false;
+    const int* chw = inputDims + (nbDims - 3);
+    if (chw[0] != static_cast<int>(params.numBoxes * (5 + params.numClasses))
+        || chw[1] != static_cast<int>(params.gridSize)
+        || chw[2] != static_cast<int>(params.gridSize))
+    {
+        return false;
+    }
+    if (nbDims == 4 && inputDims[0] == 0) return false;
+
+    for (int i = 0; i < nbDims; ++i) outputDims[i] = inputDims[i];
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __YOLO_PLUGIN_PARAMS_H__
+#define __YOLO_PLUGIN_PARAMS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Bumped whenever the serialized layout of YoloLayerParams changes */
+#define YOLO_PLUGIN_PARAMS_VERSION 1
+
+/**
+ * State of the dynamic shape yolo plugin, kept free of TensorRT headers so
+ * serialization and shape inference build and run on the host alone.
+ * dataType holds the nvinfer1::DataType value the plugin was configured with.
+ */
+struct YoloLayerParams
+{
+    uint numBoxes{0};
+    uint numClasses{0};
+    uint gridSize{0};
+    float scaleXY{1.0f};
+    int32_t dataType{0};
+
+    /* Elements of one frame, the layer is applied in place per frame */
+    uint64_t outputSize() const
+    {
+        return static_cast<uint64_t>(gridSize) * gridSize * numBoxes * (5 + numClasses);
+    }
+
+    size_t getSerializationSize() const;
+    void serialize(void* buffer) const;
+
+    /* Returns false if data is truncated, of another layout version or
+     * describes an empty layer. */
+    static bool deserialize(const void* data, const size_t length, YoloLayerParams& params);
+};
+
+/* Output shape of the yolo layer for an NCHW (explicit batch) or CHW input.
+ * The layer keeps the input shape; returns false if the channel and spatial
+ * dimensions do not match the params. A batch dimension of -1 is allowed. */
+bool yoloLayerOutputDims(const YoloLayerParams& params, const int* inputDims, const int nbDims,
+                         int* outputDims);
+
+#endif // __YOLO_PLUGIN_PARAMS_H__
@@ -46,22 +46,37 @@ void read(const char*& buffer, T& val)
 cudaError_t cudaYoloLayerV3 (
     const void* input, void* output, const uint& batchSize,
     const uint& gridSize, const uint& numOutputClasses,
-    const uint& numBBoxes, uint64_t outputSize, cudaStream_t stream);
+    const uint& numBBoxes, const float& scaleXY, uint64_t outputSize, cudaStream_t stream);
+
+cudaError_t cudaYoloLayerV3Half (
+    const void* input, void* output, const uint& batchSize,
+    const uint& gridSize, const uint& numOutputClasses,
+    const uint& numBBoxes, const float& scaleXY, uint64_t outputSize, cudaStream_t stream);
 
 YoloLayerV3::YoloLayerV3 (const void* data, size_t length)
 {
     const char *d = static_cast<const char*>(data);
+    const char *end = d + length;
     read(d, m_NumBoxes);
     read(d, m_NumClasses);
     read(d, m_GridSize);
     read(d, m_OutputSize);
+    // engines serialized before the half precision path carry no data type
+    if (d + sizeof(m_DataType) <= end) {
+        read(d, m_DataType);
+    }
+    if (d + sizeof(m_ScaleXY) <= end) {
+        read(d, m_ScaleXY);
+    }
 };
 
 YoloLayerV3::YoloLayerV3 (
-    const uint& numBoxes, const uint& numClasses, const uint& gridSize) :
+    const uint& numBoxes, const uint& numClasses, const uint& gridSize,
+    const float& scaleXY) :
     m_NumBoxes(numBoxes),
     m_NumClasses(numClasses),
-    m_GridSize(gridSize)
+    m_GridSize(gridSize),
+    m_ScaleXY(scaleXY)
 {
     assert(m_NumBoxes > 0);
     assert(m_NumClasses > 0);
@@ -80,7 +95,7 @@ YoloLayerV3::getOutputDimensions(
 
 bool YoloLayerV3::supportsFormat (
     nvinfer1::DataType type, nvinfer1::PluginFormat format) const {
-    return (type == nvinfer1::DataType::kFLOAT &&
+    return ((type == nvinfer1::DataType::kFLOAT || type == nvinfer1::DataType::kHALF) &&
             format == nvinfer1::PluginFormat::kNCHW);
 }
 
@@ -93,21 +108,29 @@ YoloLayerV3::configureWithFormat (
     assert(nbInputs == 1);
     assert (format == nvinfer1::PluginFormat::kNCHW);
     assert(inputDims != nullptr);
+    m_DataType = type;
 }
 
 int YoloLayerV3::enqueue(
     int batchSize, const void* const* inputs, void** outputs, void* workspace,
     cudaStream_t stream)
 {
-    CHECK(cudaYoloLayerV3(
-              inputs[0], outputs[0], batchSize, m_GridSize, m_NumClasses, m_NumBoxes,
-              m_OutputSize, stream));
+    if (m_DataType == nvinfer1::DataType::kHALF) {
+        CHECK(cudaYoloLayerV3Half(
+                  inputs[0], outputs[0], batchSize, m_GridSize, m_NumClasses, m_NumBoxes,
+                  m_ScaleXY, m_OutputSize, stream));
+    } else {
+        CHECK(cudaYoloLayerV3(
+                  inputs[0], outputs[0], batchSize, m_GridSize, m_NumClasses, m_NumBoxes,
+                  m_ScaleXY, m_OutputSize, stream));
+    }
     return 0;
 }
 
 size_t YoloLayerV3::getSerializationSize() const
 {
-    return sizeof(m_NumBoxes) + sizeof(m_NumClasses) + sizeof(m_GridSize) + sizeof(m_OutputSize);
+    return sizeof(m_NumBoxes) + sizeof(m_NumClasses) + sizeof(m_GridSize) + sizeof(m_OutputSize)
+        + sizeof(m_DataType) + sizeof(m_ScaleXY);
 }
 
 void YoloLayerV3::serialize(void* buffer) const
@@ -117,11 +140,101 @@ void YoloLayerV3::serialize(void* buffer) const
     write(d, m_NumClasses);
     write(d, m_GridSize);
     write(d, m_OutputSize);
+    write(d, m_DataType);
+    write(d, m_ScaleXY);
 }
 
 nvinfer1::IPluginV2* YoloLayerV3::clone() const
 {
-    return new YoloLayerV3 (m_NumBoxes, m_NumClasses, m_GridSize);
+    YoloLayerV3* plugin = new YoloLayerV3 (m_NumBoxes, m_NumClasses, m_GridSize, m_ScaleXY);
+    plugin->m_DataType = m_DataType;
+    return plugin;
+}
+
+YoloLayerV3Dynamic::YoloLayerV3Dynamic (const YoloLayerParams& params) :
+    m_Params(params)
+{
+    assert(m_Params.numBoxes > 0);
+    assert(m_Params.numClasses > 0);
+    assert(m_Params.gridSize > 0);
+}
+
+nvinfer1::DimsExprs
+YoloLayerV3Dynamic::getOutputDimensions(
+    int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs,
+    nvinfer1::IExprBuilder& exprBuilder)
+{
+    assert(outputIndex == 0);
+    assert(nbInputs == 1);
+    assert(inputs[0].nbDims == 4);
+    // only the batch dimension is dynamic, check the rest against the params
+    int inDims[4] = {-1, -1, -1, -1};
+    for (int i = 1; i < 4; ++i) {
+        if (inputs[0].d[i]->isConstant()) inDims[i] = inputs[0].d[i]->getConstantValue();
+    }
+    int outDims[4];
+    if (!yoloLayerOutputDims(m_Params, inDims, 4, outDims)) {
+        std::cerr << "yoloLayerV3Dynamic input does not match " << m_Params.numBoxes
+                  << " boxes, " << m_Params.numClasses << " classes on a "
+                  << m_Params.gridSize << "x" << m_Params.gridSize << " grid" << std::endl;
+        assert(0);
+    }
+    return inputs[0];
+}
+
+bool YoloLayerV3Dynamic::supportsFormatCombination (
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    assert(nbInputs == 1 && nbOutputs == 1 && pos < 2);
+    const nvinfer1::PluginTensorDesc& desc = inOut[pos];
+    if (desc.format != nvinfer1::PluginFormat::kNCHW) return false;
+    if (pos == 0) {
+        return desc.type == nvinfer1::DataType::kFLOAT || desc.type == nvinfer1::DataType::kHALF;
+    }
+    // output follows the input
+    return desc.type == inOut[0].type;
+}
+
+void
+YoloLayerV3Dynamic::configurePlugin (
+    const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+    const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    assert(nbInputs == 1);
+    assert(in != nullptr);
+    m_Params.dataType = static_cast<int32_t>(in[0].desc.type);
+}
+
+nvinfer1::DataType YoloLayerV3Dynamic::getOutputDataType (
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    assert(index == 0 && nbInputs == 1);
+    return inputTypes[0];
+}
+
+int YoloLayerV3Dynamic::enqueue(
+    const nvinfer1::PluginTensorDesc* inputDesc, const nvinfer1::PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    const uint batchSize = inputDesc[0].dims.d[0];
+    if (inputDesc[0].type == nvinfer1::DataType::kHALF) {
+        CHECK(cudaYoloLayerV3Half(
+                  inputs[0], outputs[0], batchSize, m_Params.gridSize, m_Params.numClasses,
+                  m_Params.numBoxes, m_Params.scaleXY, m_Params.outputSize(), stream));
+    } else {
+        CHECK(cudaYoloLayerV3(
+                  inputs[0], outputs[0], batchSize, m_Params.gridSize, m_Params.numClasses,
+                  m_Params.numBoxes, m_Params.scaleXY, m_Params.outputSize(), stream));
+    }
+    return 0;
+}
+
+nvinfer1::IPluginV2DynamicExt* YoloLayerV3Dynamic::clone() const
+{
+    YoloLayerV3Dynamic* plugin = new YoloLayerV3Dynamic(m_Params);
+    plugin->setPluginNamespace(m_Namespace.c_str());
+    return plugin;
 }
 
 REGISTER_TENSORRT_PLUGIN(YoloLayerV3PluginCreator);
+REGISTER_TENSORRT_PLUGIN(YoloLayerV3DynamicPluginCreator);
@@ -30,6 +30,7 @@
 #include <memory>
 
 #include "NvInferPlugin.h"
+#include "yoloPluginParams.h"
 
 #define CHECK(status)                                                                              \
     {                                                                                              \
@@ -45,13 +46,16 @@ namespace
 {
 const char* YOLOV3LAYER_PLUGIN_VERSION {"1"};
 const char* YOLOV3LAYER_PLUGIN_NAME {"YoloLayerV3_TRT"};
+const char* YOLOV3LAYER_DYNAMIC_PLUGIN_VERSION {"1"};
+const char* YOLOV3LAYER_DYNAMIC_PLUGIN_NAME {"YoloLayerV3Dynamic_TRT"};
 } // namespace
 
 class YoloLayerV3 : public nvinfer1::IPluginV2
 {
 public:
     YoloLayerV3 (const void* data, size_t length);
-    YoloLayerV3 (const uint& numBoxes, const uint& numClasses, const uint& gridSize);
+    YoloLayerV3 (const uint& numBoxes, const uint& numClasses, const uint& gridSize,
+                 const float& scaleXY = 1.0f);
     const char* getPluginType () const override { return YOLOV3LAYER_PLUGIN_NAME; }
     const char* getPluginVersion () const override { return YOLOV3LAYER_PLUGIN_VERSION; }
     int getNbOutputs () const override { return 1; }
@@ -91,6 +95,8 @@ private:
     uint m_NumClasses {0};
     uint m_GridSize {0};
     uint64_t m_OutputSize {0};
+    nvinfer1::DataType m_DataType {nvinfer1::DataType::kFLOAT};
+    float m_ScaleXY {1.0f};
     std::string m_Namespace {""};
 };
 
@@ -133,4 +139,101 @@ private:
     std::string m_Namespace {""};
 };
 
+/**
+ * Explicit batch variant of YoloLayerV3. The batch dimension is part of the
+ * tensor shape, so a single engine built with an optimization profile serves
+ * every batch size between the profile min and max.
+ */
+class YoloLayerV3Dynamic : public nvinfer1::IPluginV2DynamicExt
+{
+public:
+    YoloLayerV3Dynamic (const YoloLayerParams& params);
+    const char* getPluginType () const override { return YOLOV3LAYER_DYNAMIC_PLUGIN_NAME; }
+    const char* getPluginVersion () const override { return YOLOV3LAYER_DYNAMIC_PLUGIN_VERSION; }
+    int getNbOutputs () const override { return 1; }
+
+    nvinfer1::DimsExprs getOutputDimensions (
+        int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs,
+        nvinfer1::IExprBuilder& exprBuilder) override;
+
+    bool supportsFormatCombination (
+        int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    void configurePlugin (
+        const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+        const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) override;
+
+    nvinfer1::DataType getOutputDataType (
+        int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    int initialize () override { return 0; }
+    void terminate () override {}
+    size_t getWorkspaceSize (
+        const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+        const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const override { return 0; }
+    int enqueue (
+        const nvinfer1::PluginTensorDesc* inputDesc, const nvinfer1::PluginTensorDesc* outputDesc,
+        const void* const* inputs, void* const* outputs, void* workspace,
+        cudaStream_t stream) override;
+    size_t getSerializationSize() const override { return m_Params.getSerializationSize(); }
+    void serialize (void* buffer) const override { m_Params.serialize(buffer); }
+    void destroy () override { delete this; }
+    nvinfer1::IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace (const char* pluginNamespace)override {
+        m_Namespace = pluginNamespace;
+    }
+    virtual const char* getPluginNamespace () const override {
+        return m_Namespace.c_str();
+    }
+
+private:
+    YoloLayerParams m_Params;
+    std::string m_Namespace {""};
+};
+
+class YoloLayerV3DynamicPluginCreator : public nvinfer1::IPluginCreator
+{
+public:
+    YoloLayerV3DynamicPluginCreator () {}
+    ~YoloLayerV3DynamicPluginCreator () {}
+
+    const char* getPluginName () const override { return YOLOV3LAYER_DYNAMIC_PLUGIN_NAME; }
+    const char* getPluginVersion () const override { return YOLOV3LAYER_DYNAMIC_PLUGIN_VERSION; }
+
+    const nvinfer1::PluginFieldCollection* getFieldNames() override {
+        std::cerr<< "YoloLayerV3DynamicPluginCreator::getFieldNames is not implemented" << std::endl;
+        return nullptr;
+    }
+
+    nvinfer1::IPluginV2* createPlugin (
+        const char* name, const nvinfer1::PluginFieldCollection* fc) override
+    {
+        std::cerr<< "YoloLayerV3DynamicPluginCreator::createPlugin is not implemented.\n";
+        return nullptr;
+    }
+
+    nvinfer1::IPluginV2* deserializePlugin (
+        const char* name, const void* serialData, size_t serialLength) override
+    {
+        std::cout << "Deserialize yoloLayerV3Dynamic plugin: " << name << std::endl;
+        YoloLayerParams params;
+        if (!YoloLayerParams::deserialize(serialData, serialLength, params)) {
+            std::cerr << "Invalid yoloLayerV3Dynamic plugin data, rebuild the engine" << std::endl;
+            return nullptr;
+        }
+        return new YoloLayerV3Dynamic(params);
+    }
+
+    void setPluginNamespace(const char* libNamespace) override {
+        m_Namespace = libNamespace;
+    }
+    const char* getPluginNamespace() const override {
+        return m_Namespace.c_str();
+    }
+
+private:
+    std::string m_Namespace {""};
+};
+
 #endif // __YOLO_PLUGINS__
\ No newline at end of file
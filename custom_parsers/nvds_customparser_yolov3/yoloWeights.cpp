@@ -0,0 +1,544 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "yoloWeights.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "yoloLayersCpu.h"
+
+namespace {
+
+const uint64_t kFnvOffset = 14695981039346656037ull;
+const uint64_t kFnvPrime = 1099511628211ull;
+// added to the running variance before the square root, as Darknet does
+const float kBatchNormEpsilon = 1.0e-5f;
+
+std::string trimmed(const std::string& s)
+{
+    const size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    return s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+uint64_t alignUp(const uint64_t offset)
+{
+    return (offset + YOLO_WEIGHTS_ALIGNMENT - 1) / YOLO_WEIGHTS_ALIGNMENT * YOLO_WEIGHTS_ALIGNMENT;
+}
+
+/* FNV-1a over 64-bit words in four interleaved lanes, so the multiplies of
+ * neighbouring words overlap. size is a multiple of 32. */
+uint64_t checksum(const uint8_t* data, const uint64_t size)
+{
+    uint64_t lanes[4] = {kFnvOffset, kFnvOffset ^ 1, kFnvOffset ^ 2, kFnvOffset ^ 3};
+    for (uint64_t i = 0; i < size; i += 32)
+    {
+        for (uint l = 0; l < 4; ++l)
+        {
+            uint64_t word;
+            memcpy(&word, data + i + 8 * l, sizeof(word));
+            lanes[l] = (lanes[l] ^ word) * kFnvPrime;
+        }
+    }
+    uint64_t hash = kFnvOffset;
+    for (uint l = 0; l < 4; ++l) hash = (hash ^ lanes[l]) * kFnvPrime;
+    return hash;
+}
+
+std::vector<int> routeLayers(const std::string& layers)
+{
+    std::vector<int> indexes;
+    size_t lastPos = 0, pos = 0;
+    while ((pos = layers.find(',', lastPos)) != std::string::npos)
+    {
+        indexes.push_back(std::stoi(trimmed(layers.substr(lastPos, pos - lastPos))));
+        lastPos = pos + 1;
+    }
+    if (lastPos < layers.length() && !trimmed(layers.substr(lastPos)).empty())
+    {
+        indexes.push_back(std::stoi(trimmed(layers.substr(lastPos))));
+    }
+    return indexes;
+}
+
+} // namespace
+
+std::vector<std::map<std::string, std::string>> parseDarknetConfig(const std::string& cfgFilePath)
+{
+    std::ifstream file(cfgFilePath);
+    std::string line;
+    std::vector<std::map<std::string, std::string>> blocks;
+    std::map<std::string, std::string> block;
+
+    while (getline(file, line))
+    {
+        if (line.size() == 0) continue;
+        if (line.front() == '#') continue;
+        line = trimmed(line);
+        if (line.empty()) continue;
+        if (line.front() == '[')
+        {
+            if (block.size() > 0)
+            {
+                blocks.push_back(block);
+                block.clear();
+            }
+            block.insert({"type", trimmed(line.substr(1, line.size() - 2))});
+        }
+        else
+        {
+            size_t cpos = line.find('=');
+            block.insert({trimmed(line.substr(0, cpos)), trimmed(line.substr(cpos + 1))});
+        }
+    }
+    blocks.push_back(block);
+    return blocks;
+}
+
+uint64_t hashConfigFile(const std::string& cfgFilePath)
+{
+    std::ifstream file(cfgFilePath, std::ios_base::binary);
+    uint64_t hash = kFnvOffset;
+    char buffer[4096];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+    {
+        for (std::streamsize i = 0; i < file.gcount(); ++i)
+        {
+            hash = (hash ^ (uint8_t)buffer[i]) * kFnvPrime;
+        }
+    }
+    return hash;
+}
+
+bool readDarknetWeights(const std::string& weightsFilePath, const std::string& networkType,
+                        std::vector<float>& weights, std::string& error)
+{
+    // major, minor, revision and the images seen, 32 bit before Darknet 0.2
+    uint headerSize;
+    if (networkType == "yolov2")
+    {
+        headerSize = 4 * 4;
+    }
+    else if ((networkType == "yolov3") || (networkType == "yolov3-tiny")
+             || (networkType == "yolov4") || (networkType == "yolov4-tiny")
+             || (networkType == "yolov2-tiny"))
+    {
+        headerSize = 4 * 5;
+    }
+    else
+    {
+        error = "Invalid network type " + networkType;
+        return false;
+    }
+
+    std::ifstream file(weightsFilePath, std::ios_base::binary | std::ios_base::ate);
+    if (!file.good())
+    {
+        error = "Cannot open " + weightsFilePath;
+        return false;
+    }
+    const uint64_t size = file.tellg();
+    if (size < headerSize || (size - headerSize) % sizeof(float))
+    {
+        error = weightsFilePath + " is truncated";
+        return false;
+    }
+    // One read, no per value work: the file is most of a model update
+    weights.resize((size - headerSize) / sizeof(float));
+    file.seekg(headerSize);
+    file.read(reinterpret_cast<char*>(weights.data()), size - headerSize);
+    if ((uint64_t)file.gcount() != size - headerSize)
+    {
+        error = "Failed to read " + weightsFilePath;
+        return false;
+    }
+    return true;
+}
+
+bool convInputChannels(const std::vector<std::map<std::string, std::string>>& blocks,
+                       std::map<uint, uint>& channels, std::string& error)
+{
+    // output channels of every block after [net], as tensorOutputs in the builder
+    std::vector<uint> outputs;
+    uint current = 0;
+    channels.clear();
+    for (uint i = 0; i < blocks.size(); ++i)
+    {
+        const std::map<std::string, std::string>& block = blocks[i];
+        const std::string& type = block.at("type");
+        if (type == "net")
+        {
+            current = block.count("channels") ? std::stoi(block.at("channels")) : 0;
+            continue;
+        }
+        if (type == "convolutional")
+        {
+            channels[i] = current;
+            current = std::stoi(block.at("filters"));
+        }
+        else if (type == "reorg")
+        {
+            // the reorg plugin is built with stride 2
+            current *= 4;
+        }
+        else if (type == "route")
+        {
+            std::vector<int> layers = routeLayers(block.at("layers"));
+            uint sum = 0;
+            for (int layer : layers)
+            {
+                if (layer < 0) layer += outputs.size();
+                if (layer < 0 || layer >= (int)outputs.size())
+                {
+                    error = "Route of block " + std::to_string(i) + " is out of range";
+                    return false;
+                }
+                sum += outputs[layer];
+            }
+            if (block.count("groups"))
+            {
+                sum /= std::stoi(block.at("groups"));
+            }
+            current = sum;
+        }
+        else if (type != "shortcut" && type != "upsample" && type != "maxpool"
+                 && type != "yolo" && type != "region")
+        {
+            error = "Unsupported layer type " + type;
+            return false;
+        }
+        outputs.push_back(current);
+    }
+    return true;
+}
+
+bool writeYoloWeights(const std::string& outPath,
+                      const std::vector<std::map<std::string, std::string>>& blocks,
+                      const std::vector<float>& darknetWeights, const uint64_t cfgHash,
+                      const bool fp16, std::string& error)
+{
+    std::map<uint, uint> inputChannels;
+    if (!convInputChannels(blocks, inputChannels, error)) return false;
+
+    // Layout first: header, index, then every tensor on its own alignment
+    const uint elementSize = fp16 ? sizeof(uint16_t) : sizeof(float);
+    std::vector<YoloWeightsLayer> index;
+    uint64_t offset = alignUp(sizeof(YoloWeightsHeader)
+                              + inputChannels.size() * sizeof(YoloWeightsLayer));
+    for (const auto& conv : inputChannels)
+    {
+        const std::map<std::string, std::string>& block = blocks[conv.first];
+        YoloWeightsLayer layer {};
+        layer.blockIndex = conv.first;
+        layer.filters = std::stoi(block.at("filters"));
+        layer.inputChannels = conv.second;
+        layer.kernelSize = std::stoi(block.at("size"));
+        layer.kernelOffset = offset;
+        offset = alignUp(offset + (uint64_t)layer.filters * layer.inputChannels
+                                      * layer.kernelSize * layer.kernelSize * elementSize);
+        layer.biasOffset = offset;
+        offset = alignUp(offset + (uint64_t)layer.filters * elementSize);
+        index.push_back(layer);
+    }
+
+    std::vector<uint8_t> buffer(offset, 0);
+    std::vector<float> kernel, bias;
+    uint64_t weightPtr = 0;
+    for (const YoloWeightsLayer& layer : index)
+    {
+        const std::map<std::string, std::string>& block = blocks[layer.blockIndex];
+        const uint64_t count = convWeightCount(block, layer.inputChannels);
+        if (weightPtr + count > darknetWeights.size())
+        {
+            error = "Weights end at block " + std::to_string(layer.blockIndex)
+                + ", they do not belong to this cfg";
+            return false;
+        }
+        const float* src = darknetWeights.data() + weightPtr;
+        const uint filters = layer.filters;
+        const uint64_t perFilter = (uint64_t)layer.inputChannels * layer.kernelSize
+            * layer.kernelSize;
+
+        bias.assign(filters, 0.0f);
+        kernel.resize(filters * perFilter);
+        if (block.count("batch_normalize") && block.at("batch_normalize") == "1")
+        {
+            // biases, scales, running mean and variance, then the kernels
+            const float* beta = src;
+            const float* gamma = src + filters;
+            const float* mean = src + 2 * filters;
+            const float* var = src + 3 * filters;
+            const float* weights = src + 4 * filters;
+            for (uint f = 0; f < filters; ++f)
+            {
+                const float scale = gamma[f] / sqrtf(var[f] + kBatchNormEpsilon);
+                bias[f] = beta[f] - mean[f] * scale;
+                for (uint64_t k = 0; k < perFilter; ++k)
+                {
+                    kernel[f * perFilter + k] = weights[f * perFilter + k] * scale;
+                }
+            }
+        }
+        else
+        {
+            std::copy(src, src + filters, bias.begin());
+            std::copy(src + filters, src + filters + filters * perFilter, kernel.begin());
+        }
+        weightPtr += count;
+
+        uint8_t* kernelOut = buffer.data() + layer.kernelOffset;
+        uint8_t* biasOut = buffer.data() + layer.biasOffset;
+        if (fp16)
+        {
+            for (uint64_t k = 0; k < kernel.size(); ++k)
+            {
+                const uint16_t half = floatToHalf(kernel[k]);
+                memcpy(kernelOut + k * sizeof(half), &half, sizeof(half));
+            }
+            for (uint f = 0; f < filters; ++f)
+            {
+                const uint16_t half = floatToHalf(bias[f]);
+                memcpy(biasOut + f * sizeof(half), &half, sizeof(half));
+            }
+        }
+        else
+        {
+            memcpy(kernelOut, kernel.data(), kernel.size() * sizeof(float));
+            memcpy(biasOut, bias.data(), bias.size() * sizeof(float));
+        }
+    }
+    if (weightPtr != darknetWeights.size())
+    {
+        error = std::to_string(darknetWeights.size() - weightPtr)
+            + " weights left over, they do not belong to this cfg";
+        return false;
+    }
+
+    memcpy(buffer.data() + sizeof(YoloWeightsHeader), index.data(),
+           index.size() * sizeof(YoloWeightsLayer));
+    YoloWeightsHeader header {};
+    memcpy(header.magic, YOLO_WEIGHTS_MAGIC, sizeof(YOLO_WEIGHTS_MAGIC));
+    header.version = YOLO_WEIGHTS_VERSION;
+    header.flags = fp16 ? YOLO_WEIGHTS_FP16 : 0;
+    header.cfgHash = cfgHash;
+    header.fileSize = buffer.size();
+    header.layerCount = index.size();
+    header.checksum = checksum(buffer.data() + sizeof(header), buffer.size() - sizeof(header));
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    std::ofstream file(outPath, std::ios_base::binary | std::ios_base::trunc);
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    if (!file.good())
+    {
+        error = "Failed to write " + outPath;
+        return false;
+    }
+    return true;
+}
+
+bool isYoloWeightsFile(const std::string& path)
+{
+    char magic[sizeof(YOLO_WEIGHTS_MAGIC)] = {};
+    std::ifstream file(path, std::ios_base::binary);
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && !memcmp(magic, YOLO_WEIGHTS_MAGIC, sizeof(magic));
+}
+
+uint16_t floatToHalf(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    const uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff)
+    {
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+    const int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 0x1f)
+    {
+        return sign | 0x7c00;
+    }
+    if (halfExponent <= 0)
+    {
+        // subnormal or zero, round to nearest even on the shifted mantissa
+        if (halfExponent < -10) return sign;
+        mantissa |= 0x800000;
+        const uint shift = 14 - halfExponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return sign | half;
+    }
+    uint32_t half = (halfExponent << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fff;
+    // a carry out of the mantissa correctly bumps the exponent
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return sign | half;
+}
+
+float halfToFloat(const uint16_t value)
+{
+    const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // subnormal, normalize it
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+bool YoloWeightsFile::load(const std::string& path, const uint64_t expectedCfgHash,
+                           std::string& error)
+{
+    close();
+    error.clear();
+    std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+    if (!file.good())
+    {
+        error = "Cannot open " + path;
+        return false;
+    }
+    const uint64_t size = file.tellg();
+    if (size < sizeof(YoloWeightsHeader) || size % YOLO_WEIGHTS_ALIGNMENT)
+    {
+        error = path + " is truncated";
+        return false;
+    }
+
+    void* data = nullptr;
+    if (posix_memalign(&data, YOLO_WEIGHTS_ALIGNMENT, size))
+    {
+        error = "Out of memory for " + path;
+        return false;
+    }
+    m_Data.reset(data);
+    file.seekg(0);
+    file.read(static_cast<char*>(data), size);
+    if ((uint64_t)file.gcount() != size)
+    {
+        error = "Failed to read " + path;
+        close();
+        return false;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    memcpy(&m_Header, bytes, sizeof(m_Header));
+    if (memcmp(m_Header.magic, YOLO_WEIGHTS_MAGIC, sizeof(YOLO_WEIGHTS_MAGIC)))
+    {
+        error = path + " is not a Hermes weights file";
+    }
+    else if (m_Header.version != YOLO_WEIGHTS_VERSION)
+    {
+        error = path + " has version " + std::to_string(m_Header.version) + ", expected "
+            + std::to_string(YOLO_WEIGHTS_VERSION);
+    }
+    else if (m_Header.fileSize != size)
+    {
+        error = path + " is truncated";
+    }
+    else if (expectedCfgHash && m_Header.cfgHash != expectedCfgHash)
+    {
+        error = path + " was made for another network cfg";
+    }
+    else if (checksum(bytes + sizeof(m_Header), size - sizeof(m_Header)) != m_Header.checksum)
+    {
+        error = path + " is corrupt, checksum mismatch";
+    }
+    else if (sizeof(m_Header) + (uint64_t)m_Header.layerCount * sizeof(YoloWeightsLayer) > size)
+    {
+        error = path + " has a truncated index";
+    }
+    if (!error.empty())
+    {
+        close();
+        return false;
+    }
+
+    const uint elementSize = fp16() ? sizeof(uint16_t) : sizeof(float);
+    for (uint i = 0; i < m_Header.layerCount; ++i)
+    {
+        YoloWeightsLayer entry;
+        memcpy(&entry, bytes + sizeof(m_Header) + i * sizeof(entry), sizeof(entry));
+        FoldedConv conv {entry.blockIndex, entry.filters, entry.inputChannels,
+                         entry.kernelSize, fp16(), bytes + entry.kernelOffset,
+                         bytes + entry.biasOffset};
+        if (entry.kernelOffset % YOLO_WEIGHTS_ALIGNMENT || entry.biasOffset % YOLO_WEIGHTS_ALIGNMENT
+            || entry.kernelOffset + conv.kernelCount() * elementSize > size
+            || entry.biasOffset + (uint64_t)entry.filters * elementSize > size
+            || (!m_Layers.empty() && entry.blockIndex <= m_Layers.back().blockIndex))
+        {
+            error = path + " has a bad index entry " + std::to_string(i);
+            close();
+            return false;
+        }
+        m_Layers.push_back(conv);
+    }
+    return true;
+}
+
+void YoloWeightsFile::close()
+{
+    m_Data.reset();
+    m_Layers.clear();
+    m_Header = YoloWeightsHeader {};
+}
+
+const FoldedConv* YoloWeightsFile::layer(const uint blockIndex) const
+{
+    auto it = std::lower_bound(
+        m_Layers.begin(), m_Layers.end(), blockIndex,
+        [](const FoldedConv& conv, const uint index) { return conv.blockIndex < index; });
+    return (it != m_Layers.end() && it->blockIndex == blockIndex) ? &*it : nullptr;
+}
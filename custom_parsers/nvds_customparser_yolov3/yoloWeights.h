@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __YOLO_WEIGHTS_H__
+#define __YOLO_WEIGHTS_H__
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * Hermes weight container (.hwts): the convolutions of a Darknet network with
+ * batch norm already folded in, so the builder adds each as one convolution
+ * with bias and does no arithmetic on the weights.
+ *
+ *   header    64 bytes, YoloWeightsHeader
+ *   index     one YoloWeightsLayer per convolutional block, in cfg order
+ *   tensors   kernels (GKCRS) and biases, each 64 byte aligned
+ *
+ * Tensors are FP32, or FP16 with YOLO_WEIGHTS_FP16. The header carries a
+ * hash of the cfg the weights belong to and a checksum of everything after
+ * it. Little endian, as Darknet weights are.
+ */
+
+#define YOLO_WEIGHTS_MAGIC "HRMSWTS"
+#define YOLO_WEIGHTS_VERSION 1
+#define YOLO_WEIGHTS_EXTENSION ".hwts"
+#define YOLO_WEIGHTS_ALIGNMENT 64
+
+enum YoloWeightsFlags
+{
+    YOLO_WEIGHTS_FP16 = 1
+};
+
+struct YoloWeightsHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t cfgHash;
+    uint64_t checksum;      // of the bytes after the header
+    uint64_t fileSize;
+    uint32_t layerCount;
+    uint32_t reserved[5];
+};
+
+struct YoloWeightsLayer
+{
+    uint32_t blockIndex;    // of the convolutional block in the cfg
+    uint32_t filters;
+    uint32_t inputChannels;
+    uint32_t kernelSize;
+    uint64_t kernelOffset;  // from the start of the file
+    uint64_t biasOffset;
+};
+
+/* One convolution, pointing into the loaded container */
+struct FoldedConv
+{
+    uint blockIndex;
+    uint filters;
+    uint inputChannels;
+    uint kernelSize;
+    bool fp16;
+    const void* kernel;     // filters * inputChannels * kernelSize^2 values
+    const void* bias;       // filters values
+    uint64_t kernelCount() const
+    {
+        return (uint64_t)filters * inputChannels * kernelSize * kernelSize;
+    }
+};
+
+/* Blocks of a Darknet cfg, "type" holds the section name */
+std::vector<std::map<std::string, std::string>> parseDarknetConfig(const std::string& cfgFilePath);
+
+/* FNV-1a of the cfg file, ties a container to the network it was made for */
+uint64_t hashConfigFile(const std::string& cfgFilePath);
+
+/* Float values of a Darknet weights file after its 16 or 20 byte header */
+bool readDarknetWeights(const std::string& weightsFilePath, const std::string& networkType,
+                        std::vector<float>& weights, std::string& error);
+
+/* Input channels of every convolutional block, by block index, as the
+ * builder will see them */
+bool convInputChannels(const std::vector<std::map<std::string, std::string>>& blocks,
+                       std::map<uint, uint>& channels, std::string& error);
+
+/* Folds batch norm into the kernels and biases of every convolution of
+ * blocks and writes the container. */
+bool writeYoloWeights(const std::string& outPath,
+                      const std::vector<std::map<std::string, std::string>>& blocks,
+                      const std::vector<float>& darknetWeights, const uint64_t cfgHash,
+                      const bool fp16, std::string& error);
+
+/* True if the file starts with the container magic */
+bool isYoloWeightsFile(const std::string& path);
+
+uint16_t floatToHalf(const float value);
+float halfToFloat(const uint16_t value);
+
+/* A loaded container. One read into aligned memory, then the header, the
+ * checksum and the index are checked; layers point into that memory. */
+class YoloWeightsFile
+{
+public:
+    /* expectedCfgHash 0 skips the cfg check */
+    bool load(const std::string& path, const uint64_t expectedCfgHash, std::string& error);
+    void close();
+
+    bool isOpen() const { return m_Data != nullptr; }
+    bool fp16() const { return m_Header.flags & YOLO_WEIGHTS_FP16; }
+    uint64_t size() const { return m_Header.fileSize; }
+    const std::vector<FoldedConv>& layers() const { return m_Layers; }
+
+    /* The convolution of cfg block blockIndex, nullptr if there is none */
+    const FoldedConv* layer(const uint blockIndex) const;
+
+private:
+    struct FreeDeleter
+    {
+        void operator()(void* p) const { free(p); }
+    };
+
+    YoloWeightsHeader m_Header {};
+    std::unique_ptr<void, FreeDeleter> m_Data;
+    std::vector<FoldedConv> m_Layers;
+};
+
+#endif // __YOLO_WEIGHTS_H__
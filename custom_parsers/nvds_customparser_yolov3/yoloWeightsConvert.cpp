@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Converts Darknet weights to the Hermes weight container read by the engine
+ * builder, see yoloWeights.h:
+ *
+ *   yolo-weights-convert --cfg yolov3-fire.cfg --weights yolov3-fire.weights
+ *                        [--out yolov3-fire.hwts] [--fp16] [--network-type yolov3]
+ *
+ * The network type is taken from the cfg name as nvdsinfer_yolo_engine.cpp
+ * does. The written file is loaded back and checked before this returns. */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "yoloWeights.h"
+
+namespace {
+
+std::string networkTypeFromCfg(std::string cfg)
+{
+    std::transform(cfg.begin(), cfg.end(), cfg.begin(), [](uint8_t c) { return std::tolower(c); });
+    for (const char* type : {"yolov2-tiny", "yolov2", "yolov3-tiny", "yolov3", "yolov4-tiny", "yolov4"})
+    {
+        if (cfg.find(type) != std::string::npos) return type;
+    }
+    return "";
+}
+
+double elapsedMs(const std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string cfgPath, weightsPath, outPath, networkType;
+    bool fp16 = false;
+
+    const struct option options[] = {
+        {"cfg", required_argument, NULL, 'c'},
+        {"weights", required_argument, NULL, 'w'},
+        {"out", required_argument, NULL, 'o'},
+        {"fp16", no_argument, NULL, 'h'},
+        {"network-type", required_argument, NULL, 't'},
+        {NULL, 0, NULL, 0}};
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'c': cfgPath = optarg; break;
+        case 'w': weightsPath = optarg; break;
+        case 'o': outPath = optarg; break;
+        case 'h': fp16 = true; break;
+        case 't': networkType = optarg; break;
+        default: cfgPath.clear(); optind = argc; break;
+        }
+    }
+    if (cfgPath.empty() || weightsPath.empty())
+    {
+        fprintf(stderr, "Usage: %s --cfg FILE --weights FILE [--out FILE] [--fp16] "
+                        "[--network-type yolov3]\n", argv[0]);
+        return 1;
+    }
+    if (outPath.empty())
+    {
+        outPath = weightsPath.substr(0, weightsPath.rfind('.')) + YOLO_WEIGHTS_EXTENSION;
+    }
+    if (networkType.empty()) networkType = networkTypeFromCfg(cfgPath);
+
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::map<std::string, std::string>> blocks = parseDarknetConfig(cfgPath);
+    std::vector<float> weights;
+    if (!readDarknetWeights(weightsPath, networkType, weights, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const double readMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    if (!writeYoloWeights(outPath, blocks, weights, hashConfigFile(cfgPath), fp16, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const double writeMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    YoloWeightsFile container;
+    if (!container.load(outPath, hashConfigFile(cfgPath), error))
+    {
+        fprintf(stderr, "Written file does not load: %s\n", error.c_str());
+        return 1;
+    }
+    const double loadMs = elapsedMs(start);
+
+    printf("%s: %zu weights, %.1f MB, read in %.1f ms\n", weightsPath.c_str(), weights.size(),
+           weights.size() * sizeof(float) / 1e6, readMs);
+    printf("%s: %zu convolutions folded, %s, %.1f MB, written in %.1f ms, loaded and checked "
+           "in %.1f ms\n",
+           outPath.c_str(), container.layers().size(), fp16 ? "FP16" : "FP32",
+           container.size() / 1e6, writeMs, loadMs);
+    return 0;
+}
@@ -0,0 +1,512 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "iouTracker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <tuple>
+
+namespace {
+
+std::string trimCopy(const std::string& s)
+{
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+bool parseBool(const std::string& value, bool& out)
+{
+    std::string v = value;
+    std::transform(v.begin(), v.end(), v.begin(), ::tolower);
+    if (v == "1" || v == "true") out = true;
+    else if (v == "0" || v == "false") out = false;
+    else return false;
+    return true;
+}
+
+// Keeps the entries of v whose keep flag is set, in order
+template <typename T>
+void compact(std::vector<T>& v, const std::vector<bool>& keep)
+{
+    uint out = 0;
+    for (uint i = 0; i < v.size(); ++i)
+    {
+        if (keep[i]) v[out++] = v[i];
+    }
+    v.resize(out);
+}
+
+// Min-cost assignment of every row (rows <= cols), potentials formulation of
+// the Hungarian algorithm. cost is rows x cols, row-major.
+void hungarian(const std::vector<double>& cost, const uint rows, const uint cols,
+               std::vector<int>& rowToCol)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> u(rows + 1, 0.0), v(cols + 1, 0.0), minv(cols + 1);
+    std::vector<int> p(cols + 1, 0), way(cols + 1, 0);
+    std::vector<bool> used(cols + 1);
+
+    for (uint i = 1; i <= rows; ++i)
+    {
+        p[0] = i;
+        uint j0 = 0;
+        std::fill(minv.begin(), minv.end(), inf);
+        std::fill(used.begin(), used.end(), false);
+        do
+        {
+            used[j0] = true;
+            const uint i0 = p[j0];
+            double delta = inf;
+            uint j1 = 0;
+            for (uint j = 1; j <= cols; ++j)
+            {
+                if (used[j]) continue;
+                const double cur = cost[(i0 - 1) * cols + (j - 1)] - u[i0] - v[j];
+                if (cur < minv[j])
+                {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta)
+                {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (uint j = 0; j <= cols; ++j)
+            {
+                if (used[j])
+                {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                }
+                else
+                {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+        do
+        {
+            const uint j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    rowToCol.assign(rows, -1);
+    for (uint j = 1; j <= cols; ++j)
+    {
+        if (p[j]) rowToCol[p[j] - 1] = j - 1;
+    }
+}
+
+} // namespace
+
+bool readTrackerParams(const std::string& configPath, TrackerParams& params)
+{
+    std::ifstream file(configPath);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open tracker config file : " << configPath << std::endl;
+        return false;
+    }
+
+    bool inSection = false;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = line.substr(0, line.find('#'));
+        if (trimCopy(line).empty() || trimCopy(line) == "%YAML:1.0") continue;
+
+        // Unindented lines open a section
+        if (!std::isspace(static_cast<unsigned char>(line[0])))
+        {
+            inSection = trimCopy(line) == "IOUTracker:";
+            continue;
+        }
+        if (!inSection) continue;
+
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        const std::string key = trimCopy(line.substr(0, colon));
+        const std::string value = trimCopy(line.substr(colon + 1));
+
+        try
+        {
+            if (key == "iouThreshold") params.iouThreshold = std::stof(value);
+            else if (key == "minConfidence") params.minConfidence = std::stof(value);
+            else if (key == "maxAge") params.maxAge = std::stoul(value);
+            else if (key == "probationAge") params.probationAge = std::stoul(value);
+            else if (key == "maxTargetsPerStream") params.maxTargetsPerStream = std::stoul(value);
+            else if (key == "processNoise") params.processNoise = std::stof(value);
+            else if (key == "measurementNoise") params.measurementNoise = std::stof(value);
+            else if (key == "reportPredicted")
+            {
+                if (!parseBool(value, params.reportPredicted)) throw std::invalid_argument(value);
+            }
+            else if (key == "assignment")
+            {
+                if (value == "greedy") params.assignment = TrackerAssignment::Greedy;
+                else if (value == "hungarian") params.assignment = TrackerAssignment::Hungarian;
+                else throw std::invalid_argument(value);
+            }
+            else
+            {
+                std::cerr << "Unknown tracker config key : " << key << std::endl;
+            }
+        }
+        catch (const std::exception&)
+        {
+            std::cerr << "Invalid value for tracker config key " << key << " : " << value
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void iouMatrix(const float* rx0, const float* ry0, const float* rx1, const float* ry1,
+               const uint16_t* rowClasses, const uint rows,
+               const float* cx0, const float* cy0, const float* cx1, const float* cy1,
+               const uint16_t* colClasses, const uint cols, float* iou)
+{
+    for (uint r = 0; r < rows; ++r)
+    {
+        const float x0 = rx0[r], y0 = ry0[r], x1 = rx1[r], y1 = ry1[r];
+        const float rowArea = (x1 - x0) * (y1 - y0);
+        const uint16_t rowClass = rowClasses[r];
+        float* __restrict__ out = iou + r * cols;
+
+        // Only selects between values already computed, anything else is a
+        // branch under -ftrapping-math and the loop stays scalar
+        for (uint c = 0; c < cols; ++c)
+        {
+            const float left = x0 > cx0[c] ? x0 : cx0[c];
+            const float right = x1 < cx1[c] ? x1 : cx1[c];
+            const float top = y0 > cy0[c] ? y0 : cy0[c];
+            const float bottom = y1 < cy1[c] ? y1 : cy1[c];
+            const float dw = right - left;
+            const float dh = bottom - top;
+            const float w = dw > 0.0f ? dw : 0.0f;
+            const float h = dh > 0.0f ? dh : 0.0f;
+            const float inter = w * h;
+            const float colArea = (cx1[c] - cx0[c]) * (cy1[c] - cy0[c]);
+            const float uni = rowArea + colArea - inter;
+            out[c] = inter / (uni > 1e-6f ? uni : 1e-6f);
+        }
+        for (uint c = 0; c < cols; ++c)
+        {
+            out[c] = colClasses[c] == rowClass ? out[c] : 0.0f;
+        }
+    }
+}
+
+void assignTracks(const float* iou, const uint rows, const uint cols, const float threshold,
+                  const TrackerAssignment method, std::vector<int>& rowToCol)
+{
+    rowToCol.assign(rows, -1);
+    if (rows == 0 || cols == 0) return;
+
+    if (method == TrackerAssignment::Greedy)
+    {
+        std::vector<std::tuple<float, uint, uint>> pairs;
+        for (uint r = 0; r < rows; ++r)
+        {
+            for (uint c = 0; c < cols; ++c)
+            {
+                if (iou[r * cols + c] >= threshold) pairs.emplace_back(iou[r * cols + c], r, c);
+            }
+        }
+        // Highest IoU first, ties in index order so results are reproducible
+        std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+            if (std::get<0>(a) != std::get<0>(b)) return std::get<0>(a) > std::get<0>(b);
+            return std::make_pair(std::get<1>(a), std::get<2>(a)) <
+                   std::make_pair(std::get<1>(b), std::get<2>(b));
+        });
+        std::vector<bool> colUsed(cols, false);
+        for (const auto& pair : pairs)
+        {
+            const uint r = std::get<1>(pair), c = std::get<2>(pair);
+            if (rowToCol[r] >= 0 || colUsed[c]) continue;
+            rowToCol[r] = c;
+            colUsed[c] = true;
+        }
+        return;
+    }
+
+    // Every row gets a column, so pairs below the threshold cost more than
+    // any set of valid pairs can save; they are dropped afterwards
+    const bool transpose = rows > cols;
+    const uint n = transpose ? cols : rows;
+    const uint m = transpose ? rows : cols;
+    const double invalid = n + 1.0;
+    std::vector<double> cost(n * m);
+    for (uint i = 0; i < n; ++i)
+    {
+        for (uint j = 0; j < m; ++j)
+        {
+            const float value = transpose ? iou[j * cols + i] : iou[i * cols + j];
+            cost[i * m + j] = value >= threshold ? 1.0 - value : invalid;
+        }
+    }
+
+    std::vector<int> assigned;
+    hungarian(cost, n, m, assigned);
+    for (uint i = 0; i < n; ++i)
+    {
+        const int j = assigned[i];
+        if (j < 0) continue;
+        const uint r = transpose ? j : i;
+        const uint c = transpose ? i : j;
+        if (iou[r * cols + c] >= threshold) rowToCol[r] = c;
+    }
+}
+
+void TrackSet::reset()
+{
+    for (uint a = 0; a < AXES; ++a)
+    {
+        m_Pos[a].clear();
+        m_Vel[a].clear();
+        m_P00[a].clear();
+        m_P01[a].clear();
+        m_P11[a].clear();
+    }
+    m_Ids.clear();
+    m_Classes.clear();
+    m_Confidence.clear();
+    m_Age.clear();
+    m_Hits.clear();
+    m_Misses.clear();
+    m_Started = false;
+}
+
+TrackerBox TrackSet::box(const uint track) const
+{
+    const float w = std::max(m_Pos[W][track], 1.0f);
+    const float h = std::max(m_Pos[H][track], 1.0f);
+    return {m_Pos[CX][track] - w / 2, m_Pos[CY][track] - h / 2, w, h};
+}
+
+void TrackSet::predict(const float frames)
+{
+    const uint n = m_Ids.size();
+    m_Scale.resize(n);
+    for (uint i = 0; i < n; ++i) m_Scale[i] = std::max(m_Pos[H][i], 1.0f);
+
+    const float posNoise = m_Params.processNoise;
+    const float velNoise = m_Params.processNoise / 8;
+    for (uint a = 0; a < AXES; ++a)
+    {
+        float* __restrict__ pos = m_Pos[a].data();
+        float* __restrict__ vel = m_Vel[a].data();
+        float* __restrict__ p00 = m_P00[a].data();
+        float* __restrict__ p01 = m_P01[a].data();
+        float* __restrict__ p11 = m_P11[a].data();
+        const float* __restrict__ scale = m_Scale.data();
+        for (uint i = 0; i < n; ++i)
+        {
+            const float qp = posNoise * scale[i];
+            const float qv = velNoise * scale[i];
+            pos[i] += vel[i] * frames;
+            p00[i] += frames * (2 * p01[i] + frames * p11[i]) + frames * qp * qp;
+            p01[i] += frames * p11[i];
+            p11[i] += frames * qv * qv;
+        }
+    }
+}
+
+void TrackSet::update(const uint track, const TrackerBox& box)
+{
+    const float z[AXES] = {box.left + box.width / 2, box.top + box.height / 2, box.width,
+                           box.height};
+    const float r = m_Params.measurementNoise * std::max(m_Pos[H][track], 1.0f);
+    for (uint a = 0; a < AXES; ++a)
+    {
+        const float p00 = m_P00[a][track], p01 = m_P01[a][track];
+        const float s = p00 + r * r;
+        const float k0 = p00 / s, k1 = p01 / s;
+        const float y = z[a] - m_Pos[a][track];
+        m_Pos[a][track] += k0 * y;
+        m_Vel[a][track] += k1 * y;
+        m_P00[a][track] = (1 - k0) * p00;
+        m_P01[a][track] = (1 - k0) * p01;
+        m_P11[a][track] -= k1 * p01;
+    }
+}
+
+void TrackSet::add(const TrackerDetection& detection, uint64_t& nextId)
+{
+    const TrackerBox& b = detection.bbox;
+    const float z[AXES] = {b.left + b.width / 2, b.top + b.height / 2, b.width, b.height};
+    const float h = std::max(b.height, 1.0f);
+    const float posStd = 2 * m_Params.measurementNoise * h;
+    const float velStd = 10 * m_Params.processNoise / 8 * h;
+    for (uint a = 0; a < AXES; ++a)
+    {
+        m_Pos[a].push_back(z[a]);
+        m_Vel[a].push_back(0.0f);
+        m_P00[a].push_back(posStd * posStd);
+        m_P01[a].push_back(0.0f);
+        m_P11[a].push_back(velStd * velStd);
+    }
+    m_Ids.push_back(nextId++);
+    m_Classes.push_back(detection.classId);
+    m_Confidence.push_back(detection.confidence);
+    m_Age.push_back(0);
+    m_Hits.push_back(1);
+    m_Misses.push_back(0);
+}
+
+void TrackSet::process(const uint32_t frameNum, const bool detectionDone,
+                       const std::vector<TrackerDetection>& detections, uint64_t& nextId,
+                       std::vector<TrackerOutput>& outputs)
+{
+    // Frames skipped by the detector interval or dropped upstream still move
+    // the prediction; a stream restarting its count moves it by one
+    uint32_t frames = 0;
+    if (m_Started) frames = frameNum > m_FrameNum ? frameNum - m_FrameNum : 1;
+    frames = std::min(frames, m_Params.maxAge + 1);
+    m_Started = true;
+    m_FrameNum = frameNum;
+
+    if (frames > 0 && !m_Ids.empty())
+    {
+        predict(frames);
+        for (uint i = 0; i < m_Ids.size(); ++i)
+        {
+            m_Age[i] += frames;
+            m_Misses[i] += frames;
+        }
+    }
+
+    uint numTracks = m_Ids.size();
+    m_Assignment.assign(numTracks, -1);
+
+    if (detectionDone)
+    {
+        const uint numDets = detections.size();
+        for (uint k = 0; k < 4; ++k)
+        {
+            m_TrackCorners[k].resize(numTracks);
+            m_DetCorners[k].resize(numDets);
+        }
+        for (uint i = 0; i < numTracks; ++i)
+        {
+            const TrackerBox b = box(i);
+            m_TrackCorners[0][i] = b.left;
+            m_TrackCorners[1][i] = b.top;
+            m_TrackCorners[2][i] = b.left + b.width;
+            m_TrackCorners[3][i] = b.top + b.height;
+        }
+        m_DetClasses.resize(numDets);
+        for (uint j = 0; j < numDets; ++j)
+        {
+            const TrackerBox& b = detections[j].bbox;
+            m_DetCorners[0][j] = b.left;
+            m_DetCorners[1][j] = b.top;
+            m_DetCorners[2][j] = b.left + b.width;
+            m_DetCorners[3][j] = b.top + b.height;
+            m_DetClasses[j] = detections[j].classId;
+        }
+        m_Iou.resize(numTracks * numDets);
+        iouMatrix(m_TrackCorners[0].data(), m_TrackCorners[1].data(), m_TrackCorners[2].data(),
+                  m_TrackCorners[3].data(), m_Classes.data(), numTracks,
+                  m_DetCorners[0].data(), m_DetCorners[1].data(), m_DetCorners[2].data(),
+                  m_DetCorners[3].data(), m_DetClasses.data(), numDets, m_Iou.data());
+        assignTracks(m_Iou.data(), numTracks, numDets, m_Params.iouThreshold,
+                     m_Params.assignment, m_Assignment);
+
+        m_DetUsed.assign(numDets, false);
+        m_Keep.assign(numTracks, true);
+        for (uint i = 0; i < numTracks; ++i)
+        {
+            const int j = m_Assignment[i];
+            if (j >= 0)
+            {
+                update(i, detections[j].bbox);
+                m_Confidence[i] = detections[j].confidence;
+                m_Hits[i]++;
+                m_Misses[i] = 0;
+                m_DetUsed[j] = true;
+            }
+            // Tentative tracks have to be seen on every detection frame
+            else if (m_Hits[i] <= m_Params.probationAge || m_Misses[i] > m_Params.maxAge)
+            {
+                m_Keep[i] = false;
+            }
+        }
+
+        if (std::find(m_Keep.begin(), m_Keep.end(), false) != m_Keep.end())
+        {
+            for (uint a = 0; a < AXES; ++a)
+            {
+                compact(m_Pos[a], m_Keep);
+                compact(m_Vel[a], m_Keep);
+                compact(m_P00[a], m_Keep);
+                compact(m_P01[a], m_Keep);
+                compact(m_P11[a], m_Keep);
+            }
+            compact(m_Ids, m_Keep);
+            compact(m_Classes, m_Keep);
+            compact(m_Confidence, m_Keep);
+            compact(m_Age, m_Keep);
+            compact(m_Hits, m_Keep);
+            compact(m_Misses, m_Keep);
+            compact(m_Assignment, m_Keep);
+            numTracks = m_Ids.size();
+        }
+
+        for (uint j = 0; j < numDets; ++j)
+        {
+            if (m_DetUsed[j] || detections[j].confidence < m_Params.minConfidence) continue;
+            if (m_Ids.size() >= m_Params.maxTargetsPerStream) break;
+            add(detections[j], nextId);
+            m_Assignment.push_back(j);
+        }
+        numTracks = m_Ids.size();
+    }
+
+    for (uint i = 0; i < numTracks; ++i)
+    {
+        if (m_Hits[i] <= m_Params.probationAge) continue;
+        const int j = m_Assignment[i];
+        if (j < 0 && (!m_Params.reportPredicted || m_Misses[i] > m_Params.maxAge)) continue;
+
+        TrackerOutput out;
+        out.trackingId = m_Ids[i];
+        out.classId = m_Classes[i];
+        out.bbox = j >= 0 ? detections[j].bbox : box(i);
+        out.confidence = m_Confidence[i];
+        out.age = m_Age[i];
+        out.detectionIndex = j;
+        outputs.push_back(out);
+    }
+}
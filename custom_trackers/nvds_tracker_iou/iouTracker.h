@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __IOU_TRACKER_H__
+#define __IOU_TRACKER_H__
+
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * Host-only multi-object tracker for nvtracker: detections are associated
+ * to tracks by IoU against the positions predicted by a constant velocity
+ * Kalman filter. No pixels are looked at, the cost per frame depends only
+ * on the number of targets.
+ *
+ * With diagonal process and measurement noise the covariance of the usual
+ * 8-d (cx, cy, w, h + velocities) filter stays block diagonal, so it is
+ * kept as four independent 2-d filters, one per coordinate. Tracks are
+ * stored as a struct of arrays so prediction and the IoU matrix run as
+ * plain loops over contiguous floats.
+ */
+
+enum class TrackerAssignment
+{
+    Greedy,
+    Hungarian
+};
+
+struct TrackerParams
+{
+    float iouThreshold {0.3f};       // minimum IoU for a detection to continue a track
+    float minConfidence {0.0f};      // detections below start no tracks
+    uint maxAge {30};                // frames a track survives without detections
+    uint probationAge {0};           // matches needed before a track is reported
+    uint maxTargetsPerStream {128};
+    float processNoise {0.05f};      // std of the motion model, fraction of box height
+    float measurementNoise {0.05f};  // std of detector boxes, fraction of box height
+    bool reportPredicted {true};     // report tracks coasting on predictions
+    TrackerAssignment assignment {TrackerAssignment::Greedy};
+};
+
+struct TrackerBox
+{
+    float left;
+    float top;
+    float width;
+    float height;
+};
+
+struct TrackerDetection
+{
+    TrackerBox bbox;
+    float confidence;
+    uint16_t classId;
+};
+
+struct TrackerOutput
+{
+    uint64_t trackingId;
+    uint16_t classId;
+    TrackerBox bbox;
+    float confidence;
+    uint32_t age;            // frames since the track started
+    int detectionIndex;      // detection continued this frame, -1 if predicted
+};
+
+/* Reads the IOUTracker section of an ll-config-file, keys as in TrackerParams */
+bool readTrackerParams(const std::string& configPath, TrackerParams& params);
+
+/* rows x cols IoU of boxes given as separate x0, y0, x1, y1 arrays. Pairs
+ * with different classes get 0 so they never associate. */
+void iouMatrix(const float* rx0, const float* ry0, const float* rx1, const float* ry1,
+               const uint16_t* rowClasses, const uint rows,
+               const float* cx0, const float* cy0, const float* cx1, const float* cy1,
+               const uint16_t* colClasses, const uint cols, float* iou);
+
+/* Pairs (row, col) with iou >= threshold, each row and column used once.
+ * Greedy takes the highest IoU first, Hungarian maximizes the total IoU of
+ * the accepted pairs. Unassigned entries are -1. */
+void assignTracks(const float* iou, const uint rows, const uint cols, const float threshold,
+                  const TrackerAssignment method, std::vector<int>& rowToCol);
+
+/* Tracks of one stream */
+class TrackSet
+{
+public:
+    explicit TrackSet(const TrackerParams& params) : m_Params(params) {}
+
+    /* Advances to frameNum and, if detectionDone, associates detections.
+     * Reported tracks are appended to outputs. nextId hands out tracking ids. */
+    void process(const uint32_t frameNum, const bool detectionDone,
+                 const std::vector<TrackerDetection>& detections, uint64_t& nextId,
+                 std::vector<TrackerOutput>& outputs);
+
+    void reset();
+    uint size() const { return m_Ids.size(); }
+
+private:
+    enum { CX, CY, W, H, AXES };
+
+    void predict(const float frames);
+    void update(const uint track, const TrackerBox& box);
+    void add(const TrackerDetection& detection, uint64_t& nextId);
+    TrackerBox box(const uint track) const;
+
+    TrackerParams m_Params;
+    bool m_Started {false};
+    uint32_t m_FrameNum {0};
+
+    // Per axis filter state: position, velocity and the 2x2 covariance
+    std::vector<float> m_Pos[AXES];
+    std::vector<float> m_Vel[AXES];
+    std::vector<float> m_P00[AXES];
+    std::vector<float> m_P01[AXES];
+    std::vector<float> m_P11[AXES];
+
+    std::vector<uint64_t> m_Ids;
+    std::vector<uint16_t> m_Classes;
+    std::vector<float> m_Confidence;
+    std::vector<uint32_t> m_Age;
+    std::vector<uint32_t> m_Hits;
+    std::vector<uint32_t> m_Misses;
+
+    // Scratch reused across frames
+    std::vector<float> m_TrackCorners[4];
+    std::vector<float> m_DetCorners[4];
+    std::vector<uint16_t> m_DetClasses;
+    std::vector<float> m_Iou;
+    std::vector<float> m_Scale;
+    std::vector<int> m_Assignment;
+    std::vector<bool> m_DetUsed;
+    std::vector<bool> m_Keep;
+};
+
+#endif // __IOU_TRACKER_H__
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Runs the IoU tracker on synthetic detection sequences and reports the cost
+ * per frame against the number of targets, with how well identities held:
+ *
+ *   iou-tracker-bench [--targets 8,32,128,512] [--frames N] [--streams N]
+ *                     [--interval N] [--assignment greedy|hungarian|both] [--seed N]
+ *
+ * Targets move at constant velocity with random jitter across a 1920x1080
+ * frame. Detections are noisy, some are missed and some are false alarms;
+ * every frame a target continues under a different tracking id than before
+ * counts as an id switch. */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "iouTracker.h"
+
+namespace {
+
+const float kFrameWidth = 1920.0f;
+const float kFrameHeight = 1080.0f;
+const float kMissRate = 0.1f;
+const float kFalseAlarmRate = 0.02f;  // per target and frame
+const float kBoxNoise = 2.0f;         // px
+
+struct Target
+{
+    uint64_t id;
+    float x, y, w, h, vx, vy;
+};
+
+struct BenchResult
+{
+    double meanUs;
+    double p99Us;
+    uint64_t idSwitches;
+    uint64_t continued;
+};
+
+class Scene
+{
+public:
+    Scene(const uint numTargets, const uint seed) : m_Rng(seed)
+    {
+        for (uint i = 0; i < numTargets; ++i) m_Targets.push_back(spawn());
+    }
+
+    void step()
+    {
+        std::normal_distribution<float> jitter(0.0f, 0.3f);
+        for (Target& t : m_Targets)
+        {
+            t.vx += jitter(m_Rng);
+            t.vy += jitter(m_Rng);
+            t.x += t.vx;
+            t.y += t.vy;
+            if (t.x < -t.w || t.y < -t.h || t.x > kFrameWidth || t.y > kFrameHeight) t = spawn();
+        }
+    }
+
+    // Detections with the target each came from, -1 for false alarms
+    void detect(std::vector<TrackerDetection>& detections, std::vector<int64_t>& sources)
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::normal_distribution<float> noise(0.0f, kBoxNoise);
+        detections.clear();
+        sources.clear();
+        for (const Target& t : m_Targets)
+        {
+            if (unit(m_Rng) < kMissRate) continue;
+            detections.push_back({{t.x + noise(m_Rng), t.y + noise(m_Rng), t.w + noise(m_Rng),
+                                   t.h + noise(m_Rng)}, 0.5f + 0.5f * unit(m_Rng), 0});
+            sources.push_back(t.id);
+        }
+        std::poisson_distribution<uint> falseAlarms(kFalseAlarmRate * m_Targets.size());
+        for (uint i = falseAlarms(m_Rng); i > 0; --i)
+        {
+            detections.push_back({{unit(m_Rng) * kFrameWidth, unit(m_Rng) * kFrameHeight, 40, 40},
+                                  0.3f, 0});
+            sources.push_back(-1);
+        }
+    }
+
+private:
+    Target spawn()
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        Target t;
+        t.id = m_NextId++;
+        t.w = 20 + 100 * unit(m_Rng);
+        t.h = 20 + 100 * unit(m_Rng);
+        t.x = unit(m_Rng) * (kFrameWidth - t.w);
+        t.y = unit(m_Rng) * (kFrameHeight - t.h);
+        t.vx = 8 * unit(m_Rng) - 4;
+        t.vy = 8 * unit(m_Rng) - 4;
+        return t;
+    }
+
+    std::mt19937 m_Rng;
+    std::vector<Target> m_Targets;
+    uint64_t m_NextId {0};
+};
+
+BenchResult runBench(const TrackerParams& params, const uint numTargets, const uint numStreams,
+                     const uint numFrames, const uint interval, const uint seed)
+{
+    std::vector<Scene> scenes;
+    std::vector<TrackSet> tracks;
+    for (uint s = 0; s < numStreams; ++s)
+    {
+        scenes.emplace_back(numTargets, seed + s);
+        tracks.emplace_back(params);
+    }
+
+    std::vector<std::vector<TrackerDetection>> detections(numStreams);
+    std::vector<std::vector<int64_t>> sources(numStreams);
+    std::vector<std::vector<TrackerOutput>> outputs(numStreams);
+    std::vector<std::map<int64_t, uint64_t>> lastTrack(numStreams);
+    std::vector<double> samples;
+    samples.reserve(numFrames);
+    uint64_t nextId = 0;
+    BenchResult result {0, 0, 0, 0};
+
+    for (uint frame = 0; frame < numFrames; ++frame)
+    {
+        const bool detectionDone = frame % (interval + 1) == 0;
+        for (uint s = 0; s < numStreams; ++s)
+        {
+            scenes[s].step();
+            if (detectionDone) scenes[s].detect(detections[s], sources[s]);
+            else detections[s].clear();
+        }
+
+        // One batch: every stream's frame, as nvtracker hands them over
+        const auto start = std::chrono::steady_clock::now();
+        for (uint s = 0; s < numStreams; ++s)
+        {
+            outputs[s].clear();
+            tracks[s].process(frame, detectionDone, detections[s], nextId, outputs[s]);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+        for (uint s = 0; s < numStreams; ++s)
+        {
+            for (const TrackerOutput& out : outputs[s])
+            {
+                if (out.detectionIndex < 0) continue;
+                const int64_t source = sources[s][out.detectionIndex];
+                if (source < 0) continue;
+                auto seen = lastTrack[s].find(source);
+                if (seen != lastTrack[s].end())
+                {
+                    result.continued++;
+                    if (seen->second != out.trackingId) result.idSwitches++;
+                }
+                lastTrack[s][source] = out.trackingId;
+            }
+        }
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double s : samples) sum += s;
+    result.meanUs = sum / samples.size();
+    result.p99Us = samples[std::min<size_t>(samples.size() - 1, samples.size() * 99 / 100)];
+    return result;
+}
+
+std::vector<uint> parseList(const std::string& list)
+{
+    std::vector<uint> values;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty()) values.push_back(std::stoul(item));
+    }
+    return values;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::vector<uint> targets = {8, 32, 128, 512};
+    uint frames = 1000, streams = 1, interval = 0, seed = 1;
+    std::string assignment = "both";
+
+    const struct option options[] = {
+        {"targets", required_argument, NULL, 't'},
+        {"frames", required_argument, NULL, 'f'},
+        {"streams", required_argument, NULL, 's'},
+        {"interval", required_argument, NULL, 'i'},
+        {"assignment", required_argument, NULL, 'a'},
+        {"seed", required_argument, NULL, 'r'},
+        {NULL, 0, NULL, 0}};
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 't': targets = parseList(optarg); break;
+        case 'f': frames = std::max(1ul, strtoul(optarg, NULL, 10)); break;
+        case 's': streams = std::max(1ul, strtoul(optarg, NULL, 10)); break;
+        case 'i': interval = strtoul(optarg, NULL, 10); break;
+        case 'a': assignment = optarg; break;
+        case 'r': seed = strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Usage: %s [--targets 8,32,128,512] [--frames N] [--streams N] "
+                            "[--interval N] [--assignment greedy|hungarian|both] [--seed N]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::pair<std::string, TrackerAssignment>> methods;
+    if (assignment == "greedy" || assignment == "both")
+        methods.emplace_back("greedy", TrackerAssignment::Greedy);
+    if (assignment == "hungarian" || assignment == "both")
+        methods.emplace_back("hungarian", TrackerAssignment::Hungarian);
+    if (methods.empty())
+    {
+        fprintf(stderr, "Unknown assignment %s\n", assignment.c_str());
+        return 1;
+    }
+
+    // Targets sometimes go undetected, keep them through a few misses
+    TrackerParams params;
+    params.maxAge = 5 * (interval + 1);
+    params.maxTargetsPerStream = 0;
+    for (uint n : targets) params.maxTargetsPerStream = std::max(params.maxTargetsPerStream, 2 * n);
+
+    printf("%u frames, %u stream(s), detector interval %u\n", frames, streams, interval);
+    printf("%-10s %8s %12s %12s %12s\n", "assignment", "targets", "mean us", "p99 us", "id switches");
+    for (const auto& method : methods)
+    {
+        params.assignment = method.second;
+        for (uint n : targets)
+        {
+            const BenchResult r = runBench(params, n, streams, frames, interval, seed);
+            printf("%-10s %8u %12.1f %12.1f %11.3f%%\n", method.first.c_str(), n, r.meanUs, r.p99Us,
+                   r.continued ? 100.0 * r.idSwitches / r.continued : 0.0);
+        }
+    }
+    return 0;
+}
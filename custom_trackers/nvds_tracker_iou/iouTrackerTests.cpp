@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Host tests of the IoU tracker and of its nvtracker interface:
+ *
+ *   iou-tracker-tests [--seed 1]
+ *
+ * Hungarian assignment is checked against every assignment of small random
+ * IoU matrices, and greedy against hand made cases where taking the highest
+ * IoU first loses a pair. TrackSet runs scripted scenes for maxAge,
+ * probationAge, coasting and reset. NvMOT_Process runs batches of several
+ * streams to check that outputs land in the list of their stream and point
+ * at the input object they continue. Needs the DeepStream headers for
+ * nvdstracker.h, no DeepStream libraries. Every failed comparison is
+ * printed; exits 1 when any test fails. */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "iouTracker.h"
+#include "nvdstracker.h"
+
+namespace {
+
+/* Pairs at or above the threshold and their total IoU */
+std::pair<uint, double> score(const std::vector<float>& iou, const uint cols,
+                              const float threshold, const std::vector<int>& rowToCol)
+{
+    uint pairs = 0;
+    double total = 0;
+    for (uint r = 0; r < rowToCol.size(); ++r)
+    {
+        if (rowToCol[r] < 0) continue;
+        const float value = iou[r * cols + rowToCol[r]];
+        if (value < threshold) return {0, -1};
+        pairs++;
+        total += value;
+    }
+    return {pairs, total};
+}
+
+/* Best over every assignment: the most pairs, then the highest total IoU,
+ * which is what the Hungarian costs in assignTracks rank by */
+std::pair<uint, double> bruteForce(const std::vector<float>& iou, const uint rows,
+                                   const uint cols, const float threshold)
+{
+    std::vector<int> rowToCol(rows, -1);
+    std::vector<bool> colUsed(cols, false);
+    std::pair<uint, double> best {0, 0};
+    // rows in turn, each left unassigned or given a free column
+    std::vector<int> choice(rows, -2);
+    int r = 0;
+    while (r >= 0)
+    {
+        if (r == (int)rows)
+        {
+            const auto s = score(iou, cols, threshold, rowToCol);
+            if (s.first > best.first || (s.first == best.first && s.second > best.second + 1e-9))
+                best = s;
+            r--;
+            continue;
+        }
+        if (rowToCol[r] >= 0) colUsed[rowToCol[r]] = false;
+        rowToCol[r] = -1;
+        int next = choice[r] + 1;
+        while (next >= 0 && next < (int)cols &&
+               (colUsed[next] || iou[r * cols + next] < threshold))
+            next++;
+        if (next >= (int)cols)
+        {
+            choice[r] = -2;
+            r--;
+            continue;
+        }
+        choice[r] = next;
+        if (next >= 0)
+        {
+            rowToCol[r] = next;
+            colUsed[next] = true;
+        }
+        r++;
+    }
+    return best;
+}
+
+bool testAssignment(std::mt19937& rng)
+{
+    bool ok = true;
+    std::vector<int> rowToCol;
+
+    // Greedy takes 0.9 and leaves track 1 without a detection, the optimum
+    // pairs both
+    const std::vector<float> crossed = {0.9f, 0.8f,
+                                        0.7f, 0.0f};
+    assignTracks(crossed.data(), 2, 2, 0.3f, TrackerAssignment::Greedy, rowToCol);
+    if (rowToCol != std::vector<int>{0, -1})
+    {
+        printf("FAIL greedy on the crossed case gives %d %d\n", rowToCol[0], rowToCol[1]);
+        ok = false;
+    }
+    assignTracks(crossed.data(), 2, 2, 0.3f, TrackerAssignment::Hungarian, rowToCol);
+    if (rowToCol != std::vector<int>{1, 0})
+    {
+        printf("FAIL hungarian on the crossed case gives %d %d\n", rowToCol[0], rowToCol[1]);
+        ok = false;
+    }
+    // More tracks than detections goes through the transposed problem; the
+    // best pairs are 0.8 + 0.85, not the 0.9 + 0.7 greedy finds
+    const std::vector<float> tall = {0.9f, 0.8f,
+                                     0.0f, 0.7f,
+                                     0.85f, 0.2f};
+    assignTracks(tall.data(), 3, 2, 0.3f, TrackerAssignment::Hungarian, rowToCol);
+    if (rowToCol != std::vector<int>{1, -1, 0})
+    {
+        printf("FAIL hungarian on 3x2 gives %d %d %d\n", rowToCol[0], rowToCol[1], rowToCol[2]);
+        ok = false;
+    }
+    // Nothing above the threshold, nothing assigned
+    const std::vector<float> weak = {0.2f, 0.1f};
+    for (const TrackerAssignment method : {TrackerAssignment::Greedy, TrackerAssignment::Hungarian})
+    {
+        assignTracks(weak.data(), 1, 2, 0.3f, method, rowToCol);
+        if (rowToCol != std::vector<int>{-1})
+        {
+            printf("FAIL pair below the threshold assigned\n");
+            ok = false;
+        }
+    }
+
+    std::uniform_int_distribution<uint> size(1, 5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (uint trial = 0; trial < 2000 && ok; ++trial)
+    {
+        const uint rows = size(rng), cols = size(rng);
+        std::vector<float> iou(rows * cols);
+        // half the entries overlap at all, as with tracks spread over a frame
+        for (float& value : iou) value = unit(rng) < 0.5f ? unit(rng) : 0.0f;
+        const auto best = bruteForce(iou, rows, cols, 0.3f);
+
+        assignTracks(iou.data(), rows, cols, 0.3f, TrackerAssignment::Hungarian, rowToCol);
+        const auto hungarian = score(iou, cols, 0.3f, rowToCol);
+        assignTracks(iou.data(), rows, cols, 0.3f, TrackerAssignment::Greedy, rowToCol);
+        const auto greedy = score(iou, cols, 0.3f, rowToCol);
+        if (hungarian.first != best.first || std::fabs(hungarian.second - best.second) > 1e-5)
+        {
+            printf("FAIL hungarian on %ux%u: %u pairs, %.4f total, best %u pairs, %.4f total\n",
+                   rows, cols, hungarian.first, hungarian.second, best.first, best.second);
+            ok = false;
+        }
+        if (greedy.first > best.first || greedy.second < 0 ||
+            (greedy.first == best.first && greedy.second > best.second + 1e-5))
+        {
+            printf("FAIL greedy on %ux%u beats the optimum\n", rows, cols);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+TrackerDetection detection(const float left, const float top, const uint16_t classId = 0)
+{
+    return {{left, top, 50, 50}, 0.9f, classId};
+}
+
+/* Runs one frame with detections, or none when the detector skipped it */
+std::vector<TrackerOutput> step(TrackSet& tracks, const uint32_t frame, const bool detectionDone,
+                                const std::vector<TrackerDetection>& detections, uint64_t& nextId)
+{
+    std::vector<TrackerOutput> outputs;
+    tracks.process(frame, detectionDone, detections, nextId, outputs);
+    return outputs;
+}
+
+bool expectOutputs(const char* what, const std::vector<TrackerOutput>& outputs,
+                   const std::vector<std::pair<uint64_t, int>>& expected)
+{
+    bool ok = outputs.size() == expected.size();
+    for (uint i = 0; ok && i < outputs.size(); ++i)
+    {
+        ok = outputs[i].trackingId == expected[i].first &&
+            outputs[i].detectionIndex == expected[i].second;
+    }
+    if (!ok)
+    {
+        printf("FAIL %s:", what);
+        for (const TrackerOutput& out : outputs)
+            printf(" id %lu det %d", (unsigned long)out.trackingId, out.detectionIndex);
+        printf("\n");
+    }
+    return ok;
+}
+
+bool testTrackLifetime()
+{
+    bool ok = true;
+    TrackerParams params;
+    params.maxAge = 2;
+    uint64_t nextId = 0;
+
+    // A fire the detector loses: coasted and reported for maxAge frames, then dropped
+    TrackSet tracks(params);
+    const std::vector<TrackerDetection> fire = {detection(100, 100)};
+    ok &= expectOutputs("new track", step(tracks, 0, true, fire, nextId), {{0, 0}});
+    ok &= expectOutputs("first miss", step(tracks, 1, true, {}, nextId), {{0, -1}});
+    ok &= expectOutputs("second miss", step(tracks, 2, true, {}, nextId), {{0, -1}});
+    ok &= expectOutputs("past maxAge", step(tracks, 3, true, {}, nextId), {});
+    ok &= tracks.size() == 0;
+    ok &= expectOutputs("back after maxAge", step(tracks, 4, true, fire, nextId), {{1, 0}});
+
+    // Found again within maxAge it keeps its id; skipped detector frames are
+    // no misses to remove a track for
+    params.reportPredicted = false;
+    TrackSet coasting(params);
+    ok &= expectOutputs("coasting start", step(coasting, 0, true, fire, nextId), {{2, 0}});
+    ok &= expectOutputs("coasting unreported", step(coasting, 1, true, {}, nextId), {});
+    ok &= expectOutputs("interval frame", step(coasting, 2, false, {}, nextId), {});
+    ok &= expectOutputs("found within maxAge", step(coasting, 2, true, fire, nextId), {{2, 0}});
+
+    // Reported after probationAge matches, a tentative track missed once is gone
+    params.probationAge = 2;
+    params.reportPredicted = true;
+    TrackSet probation(params);
+    ok &= expectOutputs("probation 1", step(probation, 0, true, fire, nextId), {});
+    ok &= expectOutputs("probation 2", step(probation, 1, true, fire, nextId), {});
+    ok &= expectOutputs("confirmed", step(probation, 2, true, fire, nextId), {{3, 0}});
+    TrackSet tentative(params);
+    step(tentative, 0, true, fire, nextId);
+    step(tentative, 1, true, fire, nextId);
+    ok &= expectOutputs("tentative missed", step(tentative, 2, true, {}, nextId), {});
+    ok &= tentative.size() == 0;
+    ok &= expectOutputs("tentative again", step(tentative, 3, true, fire, nextId), {});
+    ok &= tentative.size() == 1;
+
+    // Classes never associate, each keeps its own track
+    params.probationAge = 0;
+    TrackSet classes(params);
+    step(classes, 0, true, {detection(100, 100, 0), detection(100, 100, 1)}, nextId);
+    const auto swapped = step(classes, 1, true, {detection(100, 100, 1), detection(100, 100, 0)},
+                              nextId);
+    ok &= expectOutputs("classes kept apart", swapped, {{nextId - 2, 1}, {nextId - 1, 0}});
+
+    if (!ok) printf("FAIL track lifetime\n");
+    return ok;
+}
+
+bool testReset()
+{
+    bool ok = true;
+    TrackerParams params;
+    uint64_t nextId = 0;
+    TrackSet tracks(params);
+    const std::vector<TrackerDetection> fire = {detection(300, 200)};
+    ok &= expectOutputs("before reset", step(tracks, 10, true, fire, nextId), {{0, 0}});
+    step(tracks, 11, true, fire, nextId);
+    tracks.reset();
+    ok &= tracks.size() == 0;
+    // a restarted stream counts from 0 again and gets new ids
+    ok &= expectOutputs("after reset", step(tracks, 0, true, fire, nextId), {{1, 0}});
+    ok &= expectOutputs("continued after reset", step(tracks, 1, true, fire, nextId), {{1, 0}});
+    if (!ok) printf("FAIL reset\n");
+    return ok;
+}
+
+/* One frame of a stream as nvtracker hands it over */
+struct StreamFrame
+{
+    NvMOTStreamId stream;
+    std::vector<NvMOTObjToTrack> objects;
+    bool doTracking {true};
+    bool reset {false};
+};
+
+NvMOTObjToTrack object(const float x, const float y, const uint16_t classId = 0,
+                       const bool doTracking = true)
+{
+    NvMOTObjToTrack obj {};
+    obj.classId = classId;
+    obj.bbox.x = x;
+    obj.bbox.y = y;
+    obj.bbox.width = 50;
+    obj.bbox.height = 50;
+    obj.confidence = 0.9f;
+    obj.doTracking = doTracking;
+    return obj;
+}
+
+/* Output lists for listStreams in that order, allocated objects each */
+struct Batch
+{
+    std::vector<NvMOTFrame> frames;
+    std::vector<NvMOTTrackedObjList> lists;
+    std::vector<std::vector<NvMOTTrackedObj>> objects;
+
+    Batch(std::vector<StreamFrame>& streamFrames, const uint32_t frameNum,
+          const std::vector<NvMOTStreamId>& listStreams, const uint allocated = 8)
+    {
+        for (StreamFrame& f : streamFrames)
+        {
+            NvMOTFrame frame {};
+            frame.streamID = f.stream;
+            frame.frameNum = frameNum;
+            frame.doTracking = f.doTracking;
+            frame.reset = f.reset;
+            frame.objectsIn.detectionDone = true;
+            frame.objectsIn.list = f.objects.data();
+            frame.objectsIn.numAllocated = f.objects.size();
+            frame.objectsIn.numFilled = f.objects.size();
+            frames.push_back(frame);
+        }
+        objects.resize(listStreams.size(), std::vector<NvMOTTrackedObj>(allocated));
+        for (uint l = 0; l < listStreams.size(); ++l)
+        {
+            NvMOTTrackedObjList list {};
+            list.streamID = listStreams[l];
+            list.list = objects[l].data();
+            list.numAllocated = allocated;
+            lists.push_back(list);
+        }
+    }
+
+    NvMOTStatus process(NvMOTContextHandle context)
+    {
+        NvMOTProcessParams params {};
+        params.numFrames = frames.size();
+        params.frameList = frames.data();
+        NvMOTTrackedObjBatch batch {};
+        batch.list = lists.data();
+        batch.numAllocated = lists.size();
+        batch.numFilled = lists.size();
+        return NvMOT_Process(context, &params, &batch);
+    }
+};
+
+bool testProcessMapping()
+{
+    bool ok = true;
+    NvMOTConfig config {};
+    NvMOTConfigResponse response {};
+    NvMOTContextHandle context = nullptr;
+    if (NvMOT_Init(&config, &context, &response) != NvMOTStatus_OK || !context)
+    {
+        printf("FAIL NvMOT_Init without a config file\n");
+        return false;
+    }
+
+    // Stream 7 has an object nvtracker is not to track ahead of the two it
+    // is; the output lists come in another order than the frames
+    std::vector<StreamFrame> streams = {
+        {7, {object(0, 0, 0, false), object(100, 100), object(400, 100, 1)}},
+        {3, {object(600, 300)}}};
+    Batch first(streams, 0, {3, 7});
+    ok &= first.process(context) == NvMOTStatus_OK;
+    const NvMOTTrackedObjList& list3 = first.lists[0];
+    const NvMOTTrackedObjList& list7 = first.lists[1];
+    if (list7.numFilled != 2 || list3.numFilled != 1 || !list7.valid || !list3.valid)
+    {
+        printf("FAIL outputs per stream: %u for 7, %u for 3\n", list7.numFilled, list3.numFilled);
+        ok = false;
+    }
+    else
+    {
+        const NvMOTTrackedObj& a = list7.list[0];
+        const NvMOTTrackedObj& b = list7.list[1];
+        const NvMOTTrackedObj& c = list3.list[0];
+        ok &= a.associatedObjectIn == &streams[0].objects[1] && a.bbox.x == 100 && a.classId == 0;
+        ok &= b.associatedObjectIn == &streams[0].objects[2] && b.bbox.x == 400 && b.classId == 1;
+        ok &= c.associatedObjectIn == &streams[1].objects[0] && c.bbox.x == 600;
+        ok &= std::set<uint64_t>{a.trackingId, b.trackingId, c.trackingId}.size() == 3;
+        if (!ok) printf("FAIL output objects point at the wrong input or share ids\n");
+    }
+    const uint64_t id7 = list7.list[0].trackingId;
+    const uint64_t id3 = list3.list[0].trackingId;
+
+    // Next frame, same ids; stream 3 not tracked this time
+    streams[1].doTracking = false;
+    Batch second(streams, 1, {7, 3});
+    ok &= second.process(context) == NvMOTStatus_OK;
+    if (second.lists[0].numFilled != 2 || second.lists[0].list[0].trackingId != id7 ||
+        second.lists[0].frameNum != 1 || second.lists[1].valid || second.lists[1].numFilled != 0)
+    {
+        printf("FAIL second batch: tracks not continued or untracked frame filled\n");
+        ok = false;
+    }
+
+    // More tracks than the list holds are cut at numAllocated
+    Batch small(streams, 2, {7, 3}, 1);
+    ok &= small.process(context) == NvMOTStatus_OK;
+    if (small.lists[0].numFilled != 1 || small.lists[0].list[0].trackingId != id7)
+    {
+        printf("FAIL outputs beyond numAllocated\n");
+        ok = false;
+    }
+
+    // reset starts the stream over, the other stream keeps its tracks
+    streams[0].reset = true;
+    streams[1].doTracking = true;
+    Batch restarted(streams, 0, {7, 3});
+    ok &= restarted.process(context) == NvMOTStatus_OK;
+    if (restarted.lists[0].numFilled != 2 || restarted.lists[0].list[0].trackingId == id7 ||
+        restarted.lists[1].numFilled != 1 || restarted.lists[1].list[0].trackingId != id3)
+    {
+        printf("FAIL reset of one stream\n");
+        ok = false;
+    }
+
+    // A removed stream comes back with new tracks
+    NvMOT_RemoveStreams(context, 3);
+    streams[0].reset = false;
+    Batch removed(streams, 1, {7, 3});
+    ok &= removed.process(context) == NvMOTStatus_OK;
+    if (removed.lists[1].numFilled != 1 || removed.lists[1].list[0].trackingId == id3)
+    {
+        printf("FAIL removed stream kept its tracks\n");
+        ok = false;
+    }
+
+    // A frame without an output list is an error
+    Batch missing(streams, 2, {7});
+    if (missing.process(context) != NvMOTStatus_Error)
+    {
+        printf("FAIL frame without an output list accepted\n");
+        ok = false;
+    }
+
+    NvMOT_DeInit(context);
+    return ok;
+}
+
+bool report(const char* name, const bool ok)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int seed = 1;
+    const struct option options[] = {
+        {"seed", required_argument, NULL, 's'},
+        {NULL, 0, NULL, 0}};
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 's': seed = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [--seed 1]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    bool ok = report("assignment", testAssignment(rng));
+    ok &= report("track lifetime", testTrackLifetime());
+    ok &= report("reset", testReset());
+    ok &= report("NvMOT_Process mapping", testProcessMapping());
+    return ok ? 0 : 1;
+}
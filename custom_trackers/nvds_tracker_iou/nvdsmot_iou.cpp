@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "iouTracker.h"
+#include "nvdstracker.h"
+
+/* Low-level tracker interface for nvtracker (ll-lib-file). Streams of a
+ * batch are processed in one call; buffers are never requested. */
+struct NvMOTContext
+{
+    TrackerParams params;
+    std::unordered_map<NvMOTStreamId, TrackSet> streams;
+    uint64_t nextId {0};
+
+    // Scratch reused across frames
+    std::vector<TrackerDetection> detections;
+    std::vector<uint32_t> detectionObjects;
+    std::vector<TrackerOutput> outputs;
+};
+
+extern "C" NvMOTStatus NvMOT_Query(uint16_t customConfigFilePathSize,
+                                   char* pCustomConfigFilePath, NvMOTQuery* pQuery)
+{
+    pQuery->computeConfig = NvMOTCompute_CPU;
+    pQuery->numTransforms = 0;
+    pQuery->memType = NVBUF_MEM_DEFAULT;
+    pQuery->supportBatchProcessing = true;
+    pQuery->supportPastFrame = false;
+    return NvMOTStatus_OK;
+}
+
+extern "C" NvMOTStatus NvMOT_Init(NvMOTConfig* pConfigIn, NvMOTContextHandle* pContextHandle,
+                                  NvMOTConfigResponse* pConfigResponse)
+{
+    NvMOTContext* context = new NvMOTContext();
+
+    pConfigResponse->summaryStatus = NvMOTConfigStatus_OK;
+    pConfigResponse->computeStatus = NvMOTConfigStatus_OK;
+    pConfigResponse->transformBatchStatus = NvMOTConfigStatus_OK;
+    pConfigResponse->miscConfigStatus = NvMOTConfigStatus_OK;
+    pConfigResponse->customConfigStatus = NvMOTConfigStatus_OK;
+
+    if (pConfigIn->customConfigFilePathSize > 0 && pConfigIn->customConfigFilePath)
+    {
+        if (!readTrackerParams(pConfigIn->customConfigFilePath, context->params))
+        {
+            pConfigResponse->summaryStatus = NvMOTConfigStatus_Error;
+            pConfigResponse->customConfigStatus = NvMOTConfigStatus_Error;
+            delete context;
+            return NvMOTStatus_Error;
+        }
+    }
+    if (pConfigIn->miscConfig.maxObjPerStream > 0)
+    {
+        context->params.maxTargetsPerStream = std::min(context->params.maxTargetsPerStream,
+                                                       pConfigIn->miscConfig.maxObjPerStream);
+    }
+
+    *pContextHandle = context;
+    return NvMOTStatus_OK;
+}
+
+extern "C" void NvMOT_DeInit(NvMOTContextHandle contextHandle)
+{
+    delete contextHandle;
+}
+
+extern "C" NvMOTStatus NvMOT_Process(NvMOTContextHandle contextHandle,
+                                     NvMOTProcessParams* pParams,
+                                     NvMOTTrackedObjBatch* pTrackedObjectsBatch)
+{
+    NvMOTContext& context = *contextHandle;
+
+    for (uint f = 0; f < pParams->numFrames; ++f)
+    {
+        NvMOTFrame& frame = pParams->frameList[f];
+
+        // nvtracker allocates one output list per stream of the batch
+        NvMOTTrackedObjList* out = nullptr;
+        for (uint l = 0; l < pTrackedObjectsBatch->numAllocated; ++l)
+        {
+            if (pTrackedObjectsBatch->list[l].streamID == frame.streamID)
+            {
+                out = &pTrackedObjectsBatch->list[l];
+                break;
+            }
+        }
+        if (!out)
+        {
+            std::cerr << "No output list for stream " << frame.streamID << std::endl;
+            return NvMOTStatus_Error;
+        }
+        out->frameNum = frame.frameNum;
+        out->numFilled = 0;
+        out->valid = frame.doTracking;
+        if (!frame.doTracking) continue;
+
+        TrackSet& tracks =
+            context.streams.emplace(frame.streamID, TrackSet(context.params)).first->second;
+        if (frame.reset) tracks.reset();
+
+        context.detections.clear();
+        context.detectionObjects.clear();
+        const NvMOTObjToTrackList& objectsIn = frame.objectsIn;
+        for (uint i = 0; i < objectsIn.numFilled; ++i)
+        {
+            const NvMOTObjToTrack& object = objectsIn.list[i];
+            if (!object.doTracking) continue;
+            TrackerDetection detection;
+            detection.bbox = {object.bbox.x, object.bbox.y, object.bbox.width, object.bbox.height};
+            detection.confidence = object.confidence;
+            detection.classId = object.classId;
+            context.detections.push_back(detection);
+            context.detectionObjects.push_back(i);
+        }
+
+        context.outputs.clear();
+        tracks.process(frame.frameNum, objectsIn.detectionDone, context.detections,
+                       context.nextId, context.outputs);
+
+        const uint count = std::min<uint>(context.outputs.size(), out->numAllocated);
+        for (uint i = 0; i < count; ++i)
+        {
+            const TrackerOutput& track = context.outputs[i];
+            NvMOTTrackedObj& tracked = out->list[i];
+            tracked.classId = track.classId;
+            tracked.trackingId = track.trackingId;
+            tracked.bbox = {track.bbox.left, track.bbox.top, track.bbox.width, track.bbox.height};
+            tracked.confidence = track.confidence;
+            tracked.age = track.age;
+            tracked.associatedObjectIn = track.detectionIndex >= 0
+                ? &objectsIn.list[context.detectionObjects[track.detectionIndex]]
+                : nullptr;
+        }
+        out->numFilled = count;
+    }
+    return NvMOTStatus_OK;
+}
+
+/* Past frame data is not kept, see supportPastFrame in NvMOT_Query */
+extern "C" NvMOTStatus NvMOT_ProcessPast(NvMOTContextHandle contextHandle,
+                                         NvMOTProcessParams* pParams,
+                                         NvDsPastFrameObjBatch* pPastFrameObjBatch)
+{
+    return NvMOTStatus_OK;
+}
+
+extern "C" void NvMOT_RemoveStreams(NvMOTContextHandle contextHandle,
+                                    NvMOTStreamId streamIdMask)
+{
+    contextHandle->streams.erase(streamIdMask);
+}
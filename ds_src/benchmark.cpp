@@ -0,0 +1,163 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace WildFireDetection {
+
+  namespace {
+    double
+    nearest_rank(const std::vector<int64_t> &sorted, double percentile) {
+      size_t rank = (size_t)std::ceil(percentile / 100.0 * sorted.size());
+      return sorted[std::max<size_t>(rank, 1) - 1] / 1000.0;
+    }
+
+    std::string
+    number(double value) {
+      char text[32];
+      snprintf(text, sizeof(text), "%.3f", value);
+      return text;
+    }
+
+    std::string
+    json_string(const std::string &value) {
+      std::string quoted = "\"";
+      for (char c : value) {
+        if (c == '"' || c == '\\') {
+          quoted += '\\';
+        }
+        quoted += c;
+      }
+      return quoted + "\"";
+    }
+  }
+
+  double
+  BenchmarkStep::throughput_fps() const {
+    return duration_s > 0 ? frames / duration_s : 0;
+  }
+
+  double
+  BenchmarkStep::efficiency() const {
+    return expected_frames ? (double)frames / expected_frames : 0;
+  }
+
+  uint64_t
+  BenchmarkStep::dropped_frames() const {
+    return expected_frames > frames ? expected_frames - frames : 0;
+  }
+
+  LatencyPercentiles
+  latency_percentiles(std::vector<int64_t> samples_us) {
+    LatencyPercentiles percentiles;
+    percentiles.samples = samples_us.size();
+    if (samples_us.empty()) {
+      return percentiles;
+    }
+    std::sort(samples_us.begin(), samples_us.end());
+    percentiles.p50_ms = nearest_rank(samples_us, 50);
+    percentiles.p90_ms = nearest_rank(samples_us, 90);
+    percentiles.p99_ms = nearest_rank(samples_us, 99);
+    return percentiles;
+  }
+
+  bool
+  sweep_past_knee(const std::vector<BenchmarkStep> &steps, double min_efficiency) {
+    if (steps.empty()) {
+      return false;
+    }
+    const BenchmarkStep &last = steps.back();
+    if (last.efficiency() < min_efficiency) {
+      return true;
+    }
+    return steps.size() > 1 && last.throughput_fps() <= steps[steps.size() - 2].throughput_fps();
+  }
+
+  unsigned int
+  knee_sources(const std::vector<BenchmarkStep> &steps, double min_efficiency) {
+    unsigned int sources = 0;
+    for (const BenchmarkStep &step : steps) {
+      if (step.efficiency() >= min_efficiency) {
+        sources = std::max(sources, step.sources);
+      }
+    }
+    return sources;
+  }
+
+  std::string
+  benchmark_csv(const BenchmarkSettings &settings, const std::vector<BenchmarkStep> &steps) {
+    std::ostringstream csv;
+    csv << "sources,width,height,fps,codec,stand_in,duration_s,frames,expected_frames,"
+           "dropped_frames,throughput_fps,per_source_fps,efficiency,cpu_percent";
+    if (!steps.empty()) {
+      for (const StageLatency &stage : steps.front().stages) {
+        csv << "," << stage.name << "_p50_ms," << stage.name << "_p90_ms,"
+            << stage.name << "_p99_ms";
+      }
+    }
+    csv << "\n";
+
+    for (const BenchmarkStep &step : steps) {
+      csv << step.sources << "," << settings.width << "," << settings.height << ","
+          << settings.fps << "," << settings.codec << "," << (settings.stand_in ? 1 : 0) << ","
+          << number(step.duration_s) << "," << step.frames << "," << step.expected_frames << ","
+          << step.dropped_frames() << "," << number(step.throughput_fps()) << ","
+          << number(step.sources ? step.throughput_fps() / step.sources : 0) << ","
+          << number(step.efficiency()) << "," << number(step.cpu_percent);
+      for (const StageLatency &stage : step.stages) {
+        csv << "," << number(stage.latency.p50_ms) << "," << number(stage.latency.p90_ms)
+            << "," << number(stage.latency.p99_ms);
+      }
+      csv << "\n";
+    }
+    return csv.str();
+  }
+
+  std::string
+  benchmark_json(const BenchmarkSettings &settings, const std::vector<BenchmarkStep> &steps) {
+    std::ostringstream json;
+    json << "{\n  \"settings\": {\"width\": " << settings.width
+         << ", \"height\": " << settings.height << ", \"fps\": " << settings.fps
+         << ", \"codec\": " << json_string(settings.codec)
+         << ", \"stand_in\": " << (settings.stand_in ? "true" : "false")
+         << ", \"warmup_s\": " << settings.warmup_s
+         << ", \"duration_s\": " << settings.duration_s
+         << ", \"min_efficiency\": " << number(settings.min_efficiency) << "},\n"
+         << "  \"knee_sources\": " << knee_sources(steps, settings.min_efficiency) << ",\n"
+         << "  \"steps\": [";
+
+    for (size_t i = 0; i < steps.size(); i++) {
+      const BenchmarkStep &step = steps[i];
+      json << (i ? ",\n" : "\n") << "    {\"sources\": " << step.sources
+           << ", \"duration_s\": " << number(step.duration_s)
+           << ", \"frames\": " << step.frames
+           << ", \"expected_frames\": " << step.expected_frames
+           << ", \"dropped_frames\": " << step.dropped_frames()
+           << ", \"throughput_fps\": " << number(step.throughput_fps())
+           << ", \"efficiency\": " << number(step.efficiency())
+           << ", \"cpu_percent\": " << number(step.cpu_percent)
+           << ", \"latency\": [";
+      for (size_t s = 0; s < step.stages.size(); s++) {
+        const StageLatency &stage = step.stages[s];
+        json << (s ? ", " : "") << "{\"stage\": " << json_string(stage.name)
+             << ", \"samples\": " << stage.latency.samples
+             << ", \"p50_ms\": " << number(stage.latency.p50_ms)
+             << ", \"p90_ms\": " << number(stage.latency.p90_ms)
+             << ", \"p99_ms\": " << number(stage.latency.p99_ms) << "}";
+      }
+      json << "]}";
+    }
+    json << (steps.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    return json.str();
+  }
+
+  bool
+  write_benchmark_file(const std::string &path, const std::string &contents) {
+    std::ofstream file(path, std::ios::trunc);
+    file << contents;
+    return file.good();
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef __HERMES_BENCHMARK_H__
+#define __HERMES_BENCHMARK_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Bookkeeping of --benchmark: statistics, the stopping rule of the source
+ * sweep and the CSV/JSON reports. Kept free of GStreamer and DeepStream
+ * types so it builds and runs on the host alone. */
+namespace WildFireDetection {
+
+  struct BenchmarkSettings {
+    // synthetic source format
+    unsigned int width = 1920;
+    unsigned int height = 1080;
+    unsigned int fps = 30;
+    // raw, h264 or h265
+    std::string codec = "h264";
+    // sweep over the number of sources
+    unsigned int start_sources = 1;
+    unsigned int max_sources = 16;
+    unsigned int source_step = 1;
+    // per step, the warmup is not measured
+    unsigned int warmup_s = 5;
+    unsigned int duration_s = 20;
+    // the knee: fewer frames than this fraction of what the sources produce
+    double min_efficiency = 0.95;
+    // identity elements instead of nvinfer and nvtracker, no NVIDIA plugins
+    bool stand_in = false;
+    // time an identity stand-in spends on each buffer
+    unsigned int stand_in_work_us = 0;
+    std::string csv_path = "benchmark.csv";
+    std::string json_path = "benchmark.json";
+  };
+
+  struct LatencyPercentiles {
+    uint64_t samples = 0;
+    double p50_ms = 0;
+    double p90_ms = 0;
+    double p99_ms = 0;
+  };
+
+  struct StageLatency {
+    std::string name;
+    LatencyPercentiles latency;
+  };
+
+  /* Result of running a number of sources for one measurement window. */
+  struct BenchmarkStep {
+    unsigned int sources = 0;
+    double duration_s = 0;
+    // frames that reached the end of the analytics branch
+    uint64_t frames = 0;
+    // frames the sources produced at their nominal rate
+    uint64_t expected_frames = 0;
+    // process CPU time over wall time, 100 per busy core
+    double cpu_percent = 0;
+    // per stage, followed by the whole pipeline
+    std::vector<StageLatency> stages;
+
+    double throughput_fps() const;
+    double efficiency() const;
+    uint64_t dropped_frames() const;
+  };
+
+  /* Nearest rank percentiles of latencies given in microseconds. */
+  LatencyPercentiles
+  latency_percentiles(std::vector<int64_t> samples_us);
+
+  /* True once the last step is past the knee: it fell below min_efficiency
+   * or delivered no more frames per second than the step before. */
+  bool
+  sweep_past_knee(const std::vector<BenchmarkStep> &steps, double min_efficiency);
+
+  /* Most sources handled at min_efficiency or better, 0 if none was. */
+  unsigned int
+  knee_sources(const std::vector<BenchmarkStep> &steps, double min_efficiency);
+
+  /* One row per step, stage latency columns are taken from the first step. */
+  std::string
+  benchmark_csv(const BenchmarkSettings &settings, const std::vector<BenchmarkStep> &steps);
+
+  std::string
+  benchmark_json(const BenchmarkSettings &settings, const std::vector<BenchmarkStep> &steps);
+
+  bool
+  write_benchmark_file(const std::string &path, const std::string &contents);
+}
+
+#endif // __HERMES_BENCHMARK_H__
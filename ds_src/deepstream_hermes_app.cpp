@@ -12,6 +12,9 @@ namespace WildFireDetection {
     if (timer > PERF_INTERVAL) {
       fps[id].display_fps = fps[id].rolling_fps;
       fps[id].display_timer = system_clock::now();
+      if (!display_meta_enabled) {
+        g_print("Source: %d | FPS: %d\n", id, fps[id].display_fps);
+      }
     }
     fps[id].fps_timer = system_clock::now();
   }
@@ -37,6 +40,10 @@ namespace WildFireDetection {
           g_printerr("Failed to create source bin. Exiting.\n");
           return -1;
         }
+        // Live sources only stream in PLAYING, they can connect early
+        if (g_str_has_prefix(source.c_str(), "rtsp://")) {
+          live_source_bins.push_back(source_bin);
+        }
 
         gst_bin_add(GST_BIN(pipeline), source_bin);
 
@@ -107,8 +114,7 @@ namespace WildFireDetection {
     //   g_free (txt_params->display_text);
     txt_params->display_text = (char *)g_malloc0(MAX_DISPLAY_LEN);
 
-    update_fps(frame_meta->source_id);
-
+    // fps is measured by the analytics branch, at full inference rate
     offset = snprintf(txt_params->display_text, MAX_DISPLAY_LEN, "Source: %d | FPS: %d | ",
                       frame_meta->source_id, fps[frame_meta->source_id].display_fps);
 
@@ -135,9 +141,10 @@ namespace WildFireDetection {
   }
 
   GstPadProbeReturn
-  Hermes::tiler_src_pad_buffer_probe(GstPad *pad, GstPadProbeInfo *info,
+  Hermes::metadata_buffer_probe(GstPad *pad, GstPadProbeInfo *info,
                             gpointer u_data) {
     GstBuffer *buf = (GstBuffer *)info->data;
+    BranchMetrics *metrics = (BranchMetrics *)u_data;
 
     // To access the entire batch data
     NvDsBatchMeta *batch_meta = NULL;
@@ -145,30 +152,74 @@ namespace WildFireDetection {
     NvDsObjectMeta *obj_meta = NULL;
     NvDsFrameMeta *frame_meta = NULL;
 
-    // To access the frame
-    NvBufSurface *surface = NULL;
-    // TO generate message meta
-    NvDsEventMsgMeta *msg_meta = NULL;
-
     NvDsMetaList *l_frame = NULL;
     NvDsMetaList *l_obj = NULL;
 
-    // Get original raw data
-    GstMapInfo in_map_info;
-    char *src_data = NULL;
+    batch_meta = gst_buffer_get_nvds_batch_meta(buf);
 
-    if (!gst_buffer_map(buf, &in_map_info, GST_MAP_READ)) {
-      g_print("Error: Failed to map gst buffer\n");
-      gst_buffer_unmap(buf, &in_map_info);
+    if (!batch_meta) {
       return GST_PAD_PROBE_OK;
     }
 
-    batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    metrics->batches++;
+    metrics->frames += batch_meta->num_frames_in_batch;
 
-    if (!batch_meta) {
+    if (!metrics->display_meta) {
+      // Analytics, nothing is drawn. Only the copy is made under the lock,
+      // the display branch waits on it.
+      std::vector<FrameRecord> frames;
+      nvds_acquire_meta_lock(batch_meta);
+      for (l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+          l_frame = l_frame->next) {
+        frame_meta = (NvDsFrameMeta *)(l_frame->data);
+        if (frame_meta == NULL) {
+          continue;
+        }
+        frames.emplace_back();
+        FrameRecord &frame = frames.back();
+        frame.source_id = frame_meta->source_id;
+        frame.buf_pts = frame_meta->buf_pts;
+        frame.source_frame_width = frame_meta->source_frame_width;
+        frame.source_frame_height = frame_meta->source_frame_height;
+        for (l_obj = frame_meta->obj_meta_list; l_obj != NULL; l_obj = l_obj->next) {
+          obj_meta = (NvDsObjectMeta *)(l_obj->data);
+          if (obj_meta == NULL) {
+            continue;
+          }
+          ObjectRecord object;
+          object.object_id = obj_meta->object_id;
+          object.class_id = obj_meta->class_id;
+          object.confidence = obj_meta->confidence;
+          object.tracker_confidence = obj_meta->tracker_confidence;
+          object.left = obj_meta->rect_params.left;
+          object.top = obj_meta->rect_params.top;
+          object.width = obj_meta->rect_params.width;
+          object.height = obj_meta->rect_params.height;
+          frame.objects.push_back(object);
+        }
+      }
+      nvds_release_meta_lock(batch_meta);
+
+      for (const FrameRecord &frame : frames) {
+        update_fps(frame.source_id);
+        if (fire_map_enabled) {
+          map_fire_detections(frame);
+        }
+        if (heatmap_enabled) {
+          accumulate_heatmap(frame);
+        }
+        if (events_enabled) {
+          note_fire_event(frame);
+        }
+        if (survey_pipeline) {
+          log_survey_frame(frame);
+        }
+      }
       return GST_PAD_PROBE_OK;
     }
 
+    // Branches share the batch meta, the display branch writes to it
+    nvds_acquire_meta_lock(batch_meta);
     for (l_frame = batch_meta->frame_meta_list; l_frame != NULL;
         l_frame = l_frame->next) {
       frame_meta = (NvDsFrameMeta *)(l_frame->data);
@@ -178,8 +229,6 @@ namespace WildFireDetection {
         continue;
       }
 
-      guint person_count = 0;
-
       for (l_obj = frame_meta->obj_meta_list; l_obj != NULL;
           l_obj = l_obj->next) {
 
@@ -199,27 +248,330 @@ namespace WildFireDetection {
       }
       // Add Information to every stream
       addDisplayMeta(batch_meta, frame_meta);
+      if (heatmap_enabled && heatmap_overlay) {
+        add_heatmap_display_meta(batch_meta, frame_meta);
+      }
+    }
+    nvds_release_meta_lock(batch_meta);
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstPadProbeReturn
+  Hermes::rate_limit_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    BranchMetrics *metrics = (BranchMetrics *)u_data;
+    gint64 now = g_get_monotonic_time();
+
+    if (metrics->last_admitted_us &&
+        now - metrics->last_admitted_us < metrics->min_interval_us) {
+      metrics->rate_dropped++;
+      return GST_PAD_PROBE_DROP;
     }
-    gst_buffer_unmap(buf, &in_map_info);
+    metrics->last_admitted_us = now;
     return GST_PAD_PROBE_OK;
   }
 
+  void
+  Hermes::queue_overrun(GstElement *queue, gpointer u_data) {
+    // a full leaky queue drops its oldest buffer
+    ((BranchMetrics *)u_data)->queue_dropped++;
+  }
+
+  gboolean
+  Hermes::report_branch_metrics(gpointer data) {
+    for (BranchMetrics &metrics : branch_metrics) {
+      guint64 frames = metrics.frames;
+      g_print("Branch: %s | FPS: %.1f | rate dropped: %lu | queue dropped: %lu\n",
+              metrics.name.c_str(), (frames - metrics.reported_frames) / (gdouble)PERF_INTERVAL,
+              (gulong)metrics.rate_dropped, (gulong)metrics.queue_dropped);
+      metrics.reported_frames = frames;
+    }
+    g_print("Muxer: %ux%u%s | resolution mismatches: %lu\n", muxer_geometry.width,
+            muxer_geometry.height, muxer_geometry.padding ? " padded" : "",
+            (gulong)muxer_mismatches);
+    if (governor_enabled) {
+      std::lock_guard<std::mutex> guard(governor_lock);
+      const GovernorDecision &decision = governor.decision();
+      g_print("Governor: level %u/%lu | %.1f C | %.1f W | interval: %u | display: %u fps | "
+              "fallback model: %s | throttled: %.0f s\n", decision.level,
+              (gulong)governor.steps().size() - 1, governor.temp_c(), governor.power_w(),
+              decision.interval, decision.display_fps, governor_fallback_active ? "yes" : "no",
+              governor.stats().throttled_us / 1e6);
+    }
+    if (classifier_enabled) {
+      std::lock_guard<std::mutex> guard(classifier_lock);
+      const TrackGateStats &stats = track_gate.stats();
+      g_print("Classifier: crops: %lu | cached: %lu | deferred: %lu | confirmed: %lu | "
+              "rejected: %lu | tracks: %lu\n", (gulong)stats.classified, (gulong)stats.cached,
+              (gulong)stats.deferred, (gulong)stats.confirmed, (gulong)stats.rejected,
+              (gulong)track_gate.size());
+    }
+    return G_SOURCE_CONTINUE;
+  }
+
+  TopologySpec
+  Hermes::get_topology(gboolean headless, guint display_fps) {
+    TopologySpec topology;
+    topology.stages = {
+      {"nvinfer", PGIE_ELEMENT_NAME},
+      {"nvtracker", TRACKER_ELEMENT_NAME},
+    };
+    if (classifier_enabled) {
+      // Runs on the crops of tracked detections, so it sees track ids
+      topology.stages.push_back({"nvinfer", SGIE_ELEMENT_NAME});
+    }
+
+    // Analytics never drops a frame and never waits on a display
+    BranchSpec analytics = {ANALYTICS_BRANCH, {{"fakesink", ANALYTICS_SINK_ELEMENT_NAME}}, FALSE, FALSE, 0};
+
+    if (headless) {
+      // No compositing, conversion or drawing for frames nobody watches
+      topology.name = "headless";
+      topology.branches = {analytics};
+    }
+    else {
+      topology.name = "analytics + display";
+      BranchSpec display = {DISPLAY_BRANCH, {
+        // Compose all the sources into one 2D tiled window
+        {"nvmultistreamtiler", TILER_ELEMENT_NAME},
+        // Convert from NV12 to RGBA as required by nvosd
+        {"nvvideoconvert", "nvvideo-converter"},
+        {"nvdsosd", "nv-onscreendisplay"},
+      #ifdef PLATFORM_TEGRA
+        {"nvegltransform", "nvegl-transform"},
+      #endif
+        {"nveglglessink", SINK_ELEMENT_NAME},
+      }, TRUE, TRUE, display_fps};
+      topology.branches = {analytics, display};
+    }
+    return topology;
+  }
+
+  gboolean
+  Hermes::build_topology(GstElement *pipeline, GstElement *upstream, const TopologySpec &topology,
+                         std::map<std::string, GstElement *> &elements) {
+    stage_threads.clear();
+
+    // boundary names the element the thread starts at, see load_threading_config
+    auto start_thread = [&](const std::string &owner, const std::string &boundary) -> ThreadSpec & {
+      StageThread thread;
+      thread.owner = owner;
+      thread.spec = thread_defaults;
+      auto it = thread_boundaries.find(boundary);
+      if (threading_enabled && it != thread_boundaries.end()) {
+        thread.spec = it->second;
+        thread.configured = TRUE;
+      }
+      stage_threads.push_back(thread);
+      return stage_threads.back().spec;
+    };
+
+    auto link_element = [&](GstElement *previous, GstElement *element, const gchar *factory,
+                            const gchar *name) -> GstElement * {
+      if (!element) {
+        g_printerr("%s (%s) could not be created. Exiting.\n", name, factory);
+        return NULL;
+      }
+      gst_bin_add(GST_BIN(pipeline), element);
+      if (!gst_element_link(previous, element)) {
+        g_printerr("Elements could not be linked: %s -> %s. Exiting.\n",
+                   GST_ELEMENT_NAME(previous), name);
+        return NULL;
+      }
+      elements[name] = element;
+      return element;
+    };
+
+    // A configured boundary before a stage puts a queue, and a new thread, in front of it
+    auto add_chain = [&](GstElement *previous, const std::vector<StageSpec> &stages,
+                         gboolean boundary_at_first) -> GstElement * {
+      for (const StageSpec &stage : stages) {
+        if ((boundary_at_first || &stage != &stages.front()) &&
+            threading_enabled && thread_boundaries.count(stage.name)) {
+          std::string queue_name = std::string(stage.name) + "-queue";
+          ThreadSpec &spec = start_thread(queue_name, stage.name);
+          // the trunk never drops a batch
+          spec.leaky = 0;
+          previous = link_element(previous, make_stage_queue(queue_name.c_str(), spec),
+                                  "queue", queue_name.c_str());
+          if (!previous) {
+            return NULL;
+          }
+        }
+        previous = link_element(previous, gst_element_factory_make(stage.factory, stage.name),
+                                stage.factory, stage.name);
+        if (!previous) {
+          return NULL;
+        }
+        stage_threads.back().stages.push_back(stage.name);
+      }
+      return previous;
+    };
+
+    // The trunk starts on the src pad task of the streammux
+    start_thread(GST_ELEMENT_NAME(upstream), GST_ELEMENT_NAME(upstream));
+    GstElement *trunk = add_chain(upstream, topology.stages, TRUE);
+    if (!trunk) {
+      return FALSE;
+    }
+
+    gboolean need_tee = topology.branches.size() > 1;
+    for (const BranchSpec &branch : topology.branches) {
+      need_tee |= branch.leaky || branch.max_fps > 0;
+    }
+
+    GstElement *tee = NULL;
+    if (need_tee) {
+      tee = add_chain(trunk, {{"tee", TEE_ELEMENT_NAME}}, FALSE);
+      if (!tee) {
+        return FALSE;
+      }
+    }
+
+    branch_metrics.clear();
+    display_meta_enabled = FALSE;
+
+    for (const BranchSpec &branch : topology.branches) {
+      branch_metrics.emplace_back();
+      BranchMetrics &metrics = branch_metrics.back();
+      metrics.name = branch.name;
+      metrics.display_meta = branch.display_meta;
+      metrics.max_fps = branch.max_fps;
+      display_meta_enabled |= branch.display_meta;
+
+      GstElement *head = trunk;
+      if (tee) {
+        // Every branch runs on the thread of its queue, a [thread-*] group
+        // naming its first stage configures that queue
+        std::string queue_name = std::string(branch.name) + "-queue";
+        ThreadSpec &spec = start_thread(queue_name, branch.stages.front().name);
+        if (branch.leaky) {
+          // hold a single batch unless told otherwise, older ones give way to
+          // the newest unless the group asks to drop the newest instead
+          spec.queue_depth = stage_threads.back().configured ? spec.queue_depth : 1;
+          spec.leaky = spec.leaky ? spec.leaky : 2;
+        }
+        else {
+          spec.leaky = 0;
+        }
+        head = link_element(tee, make_stage_queue(queue_name.c_str(), spec),
+                            "queue", queue_name.c_str());
+        if (!head) {
+          return FALSE;
+        }
+        if (branch.leaky) {
+          g_signal_connect(head, "overrun", G_CALLBACK(queue_overrun), &metrics);
+        }
+        // The governor lowers the display rate through the same probe
+        if (branch.max_fps > 0 || (governor_enabled && branch.display_meta)) {
+          metrics.min_interval_us = branch.max_fps ? G_USEC_PER_SEC / branch.max_fps : 0;
+          GstPad *queue_sink_pad = gst_element_get_static_pad(head, "sink");
+          gst_pad_add_probe(queue_sink_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                            rate_limit_probe, &metrics, NULL);
+          gst_object_unref(queue_sink_pad);
+        }
+      }
+
+      if (!add_chain(head, branch.stages, !tee)) {
+        return FALSE;
+      }
+
+      /* Lets add probe to get informed of the meta data generated, on the
+       * first element of the branch, which sees every frame let into it. */
+      GstPad *entry_pad = gst_element_get_static_pad(elements[branch.stages.front().name], "sink");
+      if (!entry_pad) {
+        g_print("Unable to get sink pad\n");
+      }
+      else {
+        gst_pad_add_probe(entry_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                          metadata_buffer_probe, &metrics, NULL);
+        gst_object_unref(entry_pad);
+      }
+      g_print("Branch %s: %s%s, %u fps max\n", branch.name,
+              branch.display_meta ? "display meta" : "metrics only",
+              branch.leaky ? ", leaky" : "", branch.max_fps);
+    }
+    return TRUE;
+  }
+
+  GstElement *
+  Hermes::make_stage_queue(const gchar *name, const ThreadSpec &spec) {
+    GstElement *queue = gst_element_factory_make("queue", name);
+    if (queue) {
+      // Bounded in batches only, a batch is a few NVMM surface descriptors
+      g_object_set(G_OBJECT(queue), "max-size-buffers", spec.queue_depth,
+                   "max-size-bytes", 0, "max-size-time", (guint64)0,
+                   "leaky", spec.leaky, NULL);
+    }
+    return queue;
+  }
+
+  void
+  Hermes::report_stage_threads() {
+    g_print("Stage threads:\n");
+    for (const StageThread &thread : stage_threads) {
+      std::string stages;
+      for (const std::string &stage : thread.stages) {
+        stages += (stages.empty() ? "" : ", ") + stage;
+      }
+      std::string queue = thread.owner == stage_threads.front().owner ? "" :
+          str(boost::format(", depth %u%s") % thread.spec.queue_depth %
+              (thread.spec.leaky ? ", leaky" : ""));
+      std::string priority = thread.spec.set_priority ?
+          str(boost::format(", nice %d") % thread.spec.priority) : "";
+      g_print("  %s [cpus %s%s%s]: %s\n", thread.owner.c_str(),
+              format_cpu_list(thread.spec.cpu_cores).c_str(), priority.c_str(),
+              queue.c_str(), stages.c_str());
+    }
+  }
+
+  GstBusSyncReply
+  Hermes::stream_status_handler(GstBus *bus, GstMessage *msg, gpointer data) {
+    GstStreamStatusType type;
+    GstElement *owner = NULL;
+
+    if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_STREAM_STATUS) {
+      return GST_BUS_PASS;
+    }
+
+    // Posted synchronously from the streaming thread that is starting
+    gst_message_parse_stream_status(msg, &type, &owner);
+    if (type != GST_STREAM_STATUS_TYPE_ENTER || !owner) {
+      return GST_BUS_PASS;
+    }
+
+    for (const StageThread &thread : stage_threads) {
+      if (thread.owner != GST_ELEMENT_NAME(owner)) {
+        continue;
+      }
+      std::string error;
+      if (thread.configured && !apply_thread_spec(thread.spec, error)) {
+        HERMES_LOG(LOG_LEVEL_WARNING, "Stage thread setting failed",
+                   log_field("stage", thread.owner), log_field("error", error));
+      }
+      HERMES_LOG(LOG_LEVEL_INFO, "Stage thread running",
+                 log_field("stage", thread.owner), log_field("tid", current_thread_id()));
+      break;
+    }
+    return GST_BUS_PASS;
+  }
+
   gboolean
   Hermes::bus_call(GstBus *bus, GstMessage *msg, gpointer data) {
     GMainLoop *loop = (GMainLoop *)data;
     switch (GST_MESSAGE_TYPE(msg)) {
     case GST_MESSAGE_EOS:
-      g_print("End of stream\n");
+      HERMES_LOG(LOG_LEVEL_INFO, "End of stream");
       g_main_loop_quit(loop);
       break;
     case GST_MESSAGE_WARNING: {
       gchar *debug;
       GError *error;
       gst_message_parse_warning(msg, &error, &debug);
-      g_printerr("WARNING from element %s: %s\n",
-                GST_OBJECT_NAME(msg->src), error->message);
+      HERMES_LOG(LOG_LEVEL_WARNING, "Element warning",
+                 log_field("element", GST_OBJECT_NAME(msg->src)),
+                 log_field("error", error->message));
       g_free(debug);
-      g_printerr("Warning: %s\n", error->message);
       g_error_free(error);
       break;
     }
@@ -227,10 +579,10 @@ namespace WildFireDetection {
       gchar *debug;
       GError *error;
       gst_message_parse_error(msg, &error, &debug);
-      g_printerr("ERROR from element %s: %s\n",
-                GST_OBJECT_NAME(msg->src), error->message);
-      if (debug)
-        g_printerr("Error details: %s\n", debug);
+      HERMES_LOG(LOG_LEVEL_ERROR, "Element error",
+                 log_field("element", GST_OBJECT_NAME(msg->src)),
+                 log_field("error", error->message),
+                 log_field("details", debug ? debug : ""));
       g_free(debug);
       g_error_free(error);
       g_main_loop_quit(loop);
@@ -241,7 +593,7 @@ namespace WildFireDetection {
         if (gst_nvmessage_is_stream_eos(msg)) {
           guint stream_id;
           if (gst_nvmessage_parse_stream_eos(msg, &stream_id)) {
-            g_print("Got EOS from stream %d\n", stream_id);
+            HERMES_LOG(LOG_LEVEL_INFO, "Stream EOS", log_field("stream", stream_id));
           }
         }
         break;
@@ -255,7 +607,8 @@ namespace WildFireDetection {
 
   void
   Hermes::cb_newpad(GstElement *decodebin, GstPad *decoder_src_pad, gpointer data) {
-    g_print("In cb_newpad\n");
+    HERMES_LOG(LOG_LEVEL_DEBUG, "Decoder pad added",
+               log_field("pad", GST_PAD_NAME(decoder_src_pad)));
     GstCaps *caps = gst_pad_get_current_caps(decoder_src_pad);
     const GstStructure *str = gst_caps_get_structure(caps, 0);
     const gchar *name = gst_structure_get_name(str);
@@ -269,31 +622,412 @@ namespace WildFireDetection {
       * decoder plugin nvdec_*. We do this by checking if the pad caps contain
       * NVMM memory features. */
       if (gst_caps_features_contains(features, GST_CAPS_FEATURES_NVMM)) {
+        startup.mark(std::string(GST_ELEMENT_NAME(source_bin)) + " decoding");
+        // Again on every reconnect, the size may have changed
+        guint index;
+        gint width, height;
+        if (sscanf(GST_ELEMENT_NAME(source_bin), "source-bin-%u", &index) == 1 &&
+            gst_structure_get_int(str, "width", &width) &&
+            gst_structure_get_int(str, "height", &height)) {
+          note_source_geometry(index, width, height);
+        }
         /* Get the source bin ghost pad */
         GstPad *bin_ghost_pad = gst_element_get_static_pad(source_bin, "src");
         if (!gst_ghost_pad_set_target(GST_GHOST_PAD(bin_ghost_pad),
                                       decoder_src_pad)) {
-          g_printerr("Failed to link decoder src pad to source bin ghost pad\n");
+          HERMES_LOG(LOG_LEVEL_ERROR, "Failed to link decoder src pad to source bin ghost pad",
+                     log_field("source", GST_ELEMENT_NAME(source_bin)));
         }
         gst_object_unref(bin_ghost_pad);
       }
       else {
-        g_printerr("Error: Decodebin did not pick nvidia decoder plugin.\n");
+        HERMES_LOG(LOG_LEVEL_ERROR, "Decodebin did not pick nvidia decoder plugin",
+                   log_field("source", GST_ELEMENT_NAME(source_bin)));
+      }
+    }
+  }
+
+  void
+  Hermes::source_setup(GstElement *uri_decode_bin, GstElement *source, gpointer data) {
+    // rtspsrc tells when the camera answered DESCRIBE
+    if (g_signal_lookup("on-sdp", G_OBJECT_TYPE(source))) {
+      g_signal_connect(G_OBJECT(source), "on-sdp", G_CALLBACK(source_described), data);
+    }
+  }
+
+  void
+  Hermes::source_described(GstElement *source, gpointer sdp, gpointer data) {
+    startup.mark(std::string(GST_ELEMENT_NAME((GstElement *)data)) + " connected");
+  }
+
+  GstPadProbeReturn
+  Hermes::startup_mark_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    startup.mark((const gchar *)u_data);
+    return GST_PAD_PROBE_REMOVE;
+  }
+
+  GstPadProbeReturn
+  Hermes::first_detection_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+
+    if (!batch_meta) {
+      return GST_PAD_PROBE_OK;
+    }
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+        l_frame = l_frame->next) {
+      NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+      for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+          l_obj = l_obj->next) {
+        if (((NvDsObjectMeta *)l_obj->data)->unique_component_id == FIRE_DETECTOR) {
+          startup.mark("first detection");
+          report_startup();
+          return GST_PAD_PROBE_REMOVE;
+        }
+      }
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  void
+  Hermes::report_startup() {
+    if (startup_reported) {
+      return;
+    }
+    startup_reported = TRUE;
+    g_print("%s", startup.report().c_str());
+  }
+
+  gboolean
+  Hermes::validate_model_file(const gchar *path, std::string &error) {
+    struct stat info;
+    if (!path || stat(path, &info) || !S_ISREG(info.st_mode)) {
+      error = std::string(path ? path : "(none)") + " does not exist";
+      return FALSE;
+    }
+    if (info.st_size == 0) {
+      error = std::string(path) + " is empty";
+      return FALSE;
+    }
+    // Darknet weights are a 16 or 20 byte header followed by float32 values
+    if (g_str_has_suffix(path, ".weights") && info.st_size % sizeof(float)) {
+      error = std::string(path) + " is truncated";
+      return FALSE;
+    }
+    // .hwts containers are padded to 64 bytes, the builder checks the rest
+    if (g_str_has_suffix(path, ".hwts") && info.st_size % 64) {
+      error = std::string(path) + " is truncated";
+      return FALSE;
+    }
+    return TRUE;
+  }
+
+  std::string
+  Hermes::write_model_config(guint version, const gchar *engine_file, const gchar *weights_file) {
+    GError *error = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    std::string config_path;
+
+    if (!g_key_file_load_from_file(key_file, PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH,
+                                  G_KEY_FILE_KEEP_COMMENTS, &error)) {
+      g_printerr("Failed to load config file: %s\n", error->message);
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return config_path;
+    }
+
+    // Same batch as the running engine, nvinfer refuses to change it in place
+    g_key_file_set_integer(key_file, CONFIG_GROUP_PROPERTY, CONFIG_BATCH_SIZE, pgie_batch_size);
+    if (weights_file) {
+      g_key_file_set_string(key_file, CONFIG_GROUP_PROPERTY, CONFIG_MODEL_FILE, weights_file);
+    }
+    if (engine_file) {
+      g_key_file_set_string(key_file, CONFIG_GROUP_PROPERTY, CONFIG_MODEL_ENGINE_FILE, engine_file);
+    }
+    else {
+      // built from the weights by NvDsInferYoloCudaEngineGet in the update thread
+      g_key_file_remove_key(key_file, CONFIG_GROUP_PROPERTY, CONFIG_MODEL_ENGINE_FILE, NULL);
+    }
+
+    // Next to the original so its relative paths still resolve
+    boost::filesystem::path original(PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH);
+    config_path = (original.parent_path() /
+                   str(boost::format("%s_v%u.txt") % original.stem().string() % version)).string();
+    if (!g_key_file_save_to_file(key_file, config_path.c_str(), &error)) {
+      g_printerr("Failed to write %s: %s\n", config_path.c_str(), error->message);
+      g_error_free(error);
+      config_path.clear();
+    }
+    g_key_file_free(key_file);
+    return config_path;
+  }
+
+  gboolean
+  Hermes::check_model_update(gpointer data) {
+    Hermes *hermes = (Hermes *)data;
+    GError *error = NULL;
+    GKeyFile *key_file = NULL;
+    gchar *engine_file = NULL;
+    gchar *weights_file = NULL;
+    ModelVersion candidate;
+    ModelHealthPolicy policy;
+    std::string reason;
+    struct stat info;
+
+    if (stat(MODEL_UPDATE_FILE, &info) || info.st_mtime == model_update_mtime) {
+      return G_SOURCE_CONTINUE;
+    }
+    model_update_mtime = info.st_mtime;
+
+    key_file = g_key_file_new();
+    if (!g_key_file_load_from_file(key_file, MODEL_UPDATE_FILE, G_KEY_FILE_NONE, &error)) {
+      g_printerr("Invalid %s: %s\n", MODEL_UPDATE_FILE, error->message);
+      goto done;
+    }
+    candidate.version = g_key_file_get_integer(key_file, CONFIG_GROUP_MODEL_UPDATE,
+                                               CONFIG_MODEL_UPDATE_VERSION, &error);
+    CHECK_ERROR(error);
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_MODEL_UPDATE, CONFIG_MODEL_ENGINE_FILE, NULL)) {
+      engine_file = get_absolute_file_path((gchar *)MODEL_UPDATE_FILE,
+          g_key_file_get_string(key_file, CONFIG_GROUP_MODEL_UPDATE, CONFIG_MODEL_ENGINE_FILE, &error));
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_MODEL_UPDATE, CONFIG_MODEL_FILE, NULL)) {
+      weights_file = get_absolute_file_path((gchar *)MODEL_UPDATE_FILE,
+          g_key_file_get_string(key_file, CONFIG_GROUP_MODEL_UPDATE, CONFIG_MODEL_FILE, &error));
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_MODEL_UPDATE, CONFIG_MODEL_UPDATE_PROBATION, NULL)) {
+      policy.probation_batches = g_key_file_get_integer(key_file, CONFIG_GROUP_MODEL_UPDATE,
+                                                        CONFIG_MODEL_UPDATE_PROBATION, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_MODEL_UPDATE, CONFIG_MODEL_UPDATE_MAX_UNHEALTHY, NULL)) {
+      policy.max_unhealthy = g_key_file_get_integer(key_file, CONFIG_GROUP_MODEL_UPDATE,
+                                                    CONFIG_MODEL_UPDATE_MAX_UNHEALTHY, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_MODEL_UPDATE, CONFIG_MODEL_UPDATE_MAX_OBJECTS, NULL)) {
+      max_objects_per_frame = g_key_file_get_integer(key_file, CONFIG_GROUP_MODEL_UPDATE,
+                                                     CONFIG_MODEL_UPDATE_MAX_OBJECTS, &error);
+      CHECK_ERROR(error);
+    }
+
+    if (!engine_file && !weights_file) {
+      reason = "neither " CONFIG_MODEL_ENGINE_FILE " nor " CONFIG_MODEL_FILE " given";
+    }
+    else if ((!engine_file || validate_model_file(engine_file, reason)) &&
+             (!weights_file || validate_model_file(weights_file, reason))) {
+      std::lock_guard<std::mutex> guard(model_update_lock);
+      if (model_updater.active().config_path.empty() &&
+          model_updater.state() == ModelUpdateState::IDLE) {
+        // The running model gets a config of its own to roll back to
+        std::string engine_path =
+            boost::filesystem::absolute(hermes->PGIE_YOLO_ENGINE_PATH).string();
+        ModelVersion initial;
+        initial.config_path = hermes->write_model_config(0, engine_path.c_str(), NULL);
+        model_updater = ModelUpdater(initial);
+      }
+      candidate.config_path = hermes->write_model_config(candidate.version, engine_file,
+                                                         weights_file);
+      if (candidate.config_path.empty()) {
+        reason = "could not write its nvinfer config";
+      }
+      else if (model_updater.begin(candidate, policy, reason)) {
+        g_print("Model update: loading version %u from %s\n", candidate.version,
+                candidate.config_path.c_str());
+        // nvinfer loads it on a thread of its own and swaps at a batch boundary
+        g_object_set(G_OBJECT(model_update_target), "config-file-path",
+                     candidate.config_path.c_str(), NULL);
+      }
+    }
+    if (!reason.empty()) {
+      g_printerr("Model update to version %u refused: %s\n", candidate.version, reason.c_str());
+    }
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      g_free(engine_file);
+      g_free(weights_file);
+      g_key_file_free(key_file);
+    return G_SOURCE_CONTINUE;
+  }
+
+  void
+  Hermes::model_updated(GstElement *pgie_yolo_detector, gint error, const gchar *config_file,
+                        gpointer data) {
+    std::lock_guard<std::mutex> guard(model_update_lock);
+    ModelUpdateState state = model_updater.state();
+
+    if (state == ModelUpdateState::IDLE) {
+      // Not an update, the governor swapped models
+      std::lock_guard<std::mutex> governor_guard(governor_lock);
+      governor_swap_pending = FALSE;
+      if (error) {
+        // not tried again, the model that was serving still does
+        governor_fallback_failed = TRUE;
+        g_printerr("Governor: %s failed to load (%d)\n", config_file, error);
+      }
+      else {
+        governor_fallback_active = !governor_fallback_active;
+        g_print("Governor: %s model serving\n", governor_fallback_active ? "fallback" : "main");
+      }
+      return;
+    }
+    model_updater.loaded(error == 0);
+
+    if (state == ModelUpdateState::ROLLING_BACK) {
+      g_print("Model update: %s version %u\n", error ? "failed to roll back to" : "rolled back to",
+              model_updater.active().version);
+    }
+    else if (error) {
+      g_printerr("Model update: version %u failed to load (%d), version %u keeps running\n",
+                 model_updater.candidate().version, error, model_updater.active().version);
+    }
+    else {
+      g_print("Model update: version %u swapped in, on probation\n",
+              model_updater.candidate().version);
+    }
+  }
+
+  GstPadProbeReturn
+  Hermes::model_health_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    gboolean inferred = FALSE;
+    gboolean healthy = TRUE;
+
+    std::lock_guard<std::mutex> guard(model_update_lock);
+    if (!batch_meta || model_updater.state() != ModelUpdateState::PROBATION) {
+      return GST_PAD_PROBE_OK;
+    }
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+        l_frame = l_frame->next) {
+      NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+      guint objects = 0;
+      inferred |= frame_meta->bInferDone;
+
+      for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+          l_obj = l_obj->next) {
+        NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)(l_obj->data);
+        if (obj_meta->unique_component_id != FIRE_DETECTOR) {
+          continue;
+        }
+        const NvOSD_RectParams &rect = obj_meta->rect_params;
+        objects++;
+        // NaN or off-frame boxes come from broken weights, not from fires
+        healthy &= std::isfinite(obj_meta->confidence) && obj_meta->confidence <= 1.0 &&
+                   std::isfinite(rect.left) && std::isfinite(rect.top) &&
+                   std::isfinite(rect.width) && std::isfinite(rect.height) &&
+                   rect.width > 0 && rect.height > 0 && rect.left >= -1 && rect.top >= -1 &&
+                   rect.left + rect.width <= muxer_geometry.width + 1 &&
+                   rect.top + rect.height <= muxer_geometry.height + 1;
       }
+      healthy &= objects <= max_objects_per_frame;
+    }
+
+    // Batches skipped by interval say nothing about the model
+    if (!inferred) {
+      return GST_PAD_PROBE_OK;
+    }
+
+    switch (model_updater.batch(healthy)) {
+    case ProbationVerdict::COMMIT:
+      HERMES_LOG(LOG_LEVEL_INFO, "Model update committed",
+                 log_field("version", model_updater.active().version));
+      break;
+    case ProbationVerdict::ROLLBACK:
+      HERMES_LOG(LOG_LEVEL_WARNING, "Model update unhealthy, rolling back",
+                 log_field("version", model_updater.candidate().version),
+                 log_field("previous", model_updater.active().version));
+      g_idle_add(rollback_model, NULL);
+      break;
+    default:
+      break;
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  gboolean
+  Hermes::rollback_model(gpointer data) {
+    std::string config_path;
+    {
+      std::lock_guard<std::mutex> guard(model_update_lock);
+      config_path = model_updater.active().config_path;
+    }
+    g_object_set(G_OBJECT(model_update_target), "config-file-path", config_path.c_str(), NULL);
+    return G_SOURCE_REMOVE;
+  }
+
+  gboolean
+  Hermes::start_pipeline(GstElement *pipeline, GstElement *pgie_yolo_detector, GstElement *nvtracker) {
+    /* Engine deserialization (nvinfer) and low level tracker init (nvtracker)
+     * happen on the way to PAUSED. Each gets a thread and is locked out of
+     * the pipeline state changes until it is done. */
+    auto prepare = [](GstElement *element, const gchar *phase) {
+      gst_element_set_locked_state(element, TRUE);
+      return std::async(std::launch::async, [element, phase]() {
+        startup.begin(phase);
+        GstStateChangeReturn ret = gst_element_set_state(element, GST_STATE_PAUSED);
+        startup.end(phase);
+        return ret;
+      });
+    };
+    auto engine = prepare(pgie_yolo_detector, "engine load");
+    auto tracker = prepare(nvtracker, "tracker init");
+
+    /* Meanwhile live sources connect: PAUSED gets rtspsrc through DESCRIBE and
+     * SETUP, data only flows once PLAYING. */
+    startup.begin("source pre-connect");
+    for (GstElement *source_bin : live_source_bins) {
+      gst_element_set_locked_state(source_bin, TRUE);
+      gst_element_set_state(source_bin, GST_STATE_PAUSED);
+    }
+    startup.end("source pre-connect");
+
+    startup.begin("pipeline to READY");
+    gst_element_set_state(pipeline, GST_STATE_READY);
+    startup.end("pipeline to READY");
+
+    gboolean ready = engine.get() != GST_STATE_CHANGE_FAILURE &&
+                     tracker.get() != GST_STATE_CHANGE_FAILURE;
+    gst_element_set_locked_state(pgie_yolo_detector, FALSE);
+    gst_element_set_locked_state(nvtracker, FALSE);
+    for (GstElement *source_bin : live_source_bins) {
+      gst_element_set_locked_state(source_bin, FALSE);
+    }
+    if (!ready) {
+      g_printerr("Failed to start the inference engine or the tracker. Exiting.\n");
+      return FALSE;
     }
+
+    startup.mark("pipeline to PLAYING");
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    return TRUE;
   }
 
   void
   Hermes::decodebin_child_added(GstChildProxy *child_proxy, GObject *object, gchar *name, gpointer user_data) {
-    g_print("Decodebin child added: %s\n", name);
+    HERMES_LOG(LOG_LEVEL_DEBUG, "Decodebin child added", log_field("child", name));
     if (g_strrstr(name, "decodebin") == name) {
       g_signal_connect(G_OBJECT(object), "child-added",
                       G_CALLBACK(decodebin_child_added), user_data);
     }
     if (g_strstr_len(name, -1, "nvv4l2decoder") == name) {
-      g_print("Seting bufapi_version\n");
+      HERMES_LOG(LOG_LEVEL_DEBUG, "Setting bufapi-version", log_field("decoder", name));
       g_object_set(object, "bufapi-version", TRUE, NULL);
     }
+    if (events_enabled &&
+        (g_str_has_prefix(name, "h264parse") || g_str_has_prefix(name, "h265parse"))) {
+      attach_event_ring(GST_ELEMENT(object), (GstElement *)user_data);
+    }
   }
 
   GstElement *
@@ -301,6 +1035,10 @@ namespace WildFireDetection {
     GstElement *bin = NULL, *uri_decode_bin = NULL;
     gchar bin_name[16] = {};
 
+    if (g_str_has_prefix(uri, SHM_SOURCE_PREFIX)) {
+      return create_shm_source_bin(index, uri + strlen(SHM_SOURCE_PREFIX));
+    }
+
     g_snprintf(bin_name, 15, "source-bin-%02d", index);
     /* Create a source GstBin to abstract this bin's content from the rest of the
     * pipeline */
@@ -325,6 +1063,8 @@ namespace WildFireDetection {
                     G_CALLBACK(cb_newpad), bin);
     g_signal_connect(G_OBJECT(uri_decode_bin), "child-added",
                     G_CALLBACK(decodebin_child_added), bin);
+    g_signal_connect(G_OBJECT(uri_decode_bin), "source-setup",
+                    G_CALLBACK(source_setup), bin);
 
     gst_bin_add(GST_BIN(bin), uri_decode_bin);
 
@@ -341,103 +1081,3017 @@ namespace WildFireDetection {
     return bin;
   }
 
-  gchar *
-  Hermes::get_absolute_file_path(gchar *cfg_file_path, gchar *file_path) {
-    gchar abs_cfg_path[PATH_MAX + 1];
-    gchar *abs_file_path;
-    gchar *delim;
+  GstElement *
+  Hermes::create_shm_source_bin(guint index, const gchar *name) {
+    GstElement *bin = NULL, *appsrc = NULL, *converter = NULL, *capsfilter = NULL;
+    GstCaps *caps = NULL;
+    GstPad *srcpad = NULL;
+    gchar bin_name[16] = {};
 
-    if (file_path && file_path[0] == '/') {
-      return file_path;
+    if (!*name || strchr(name, '/')) {
+      g_printerr("Invalid shared memory source %s%s\n", SHM_SOURCE_PREFIX, name);
+      return NULL;
     }
 
-    if (!realpath(cfg_file_path, abs_cfg_path)) {
+    /* The capture process writes raw frames, the only conversion left is the
+     * upload to NVMM for the streammux */
+    g_snprintf(bin_name, 15, "source-bin-%02d", index);
+    bin = gst_bin_new(bin_name);
+    appsrc = gst_element_factory_make("appsrc", "shm-source");
+    converter = gst_element_factory_make("nvvideoconvert", "shm-converter");
+    capsfilter = gst_element_factory_make("capsfilter", "shm-caps");
+
+    if (!bin || !appsrc || !converter || !capsfilter) {
+      g_printerr("One element in source bin could not be created.\n");
+      return NULL;
+    }
+
+    // Caps are set by the reader thread once it knows the ring
+    g_object_set(G_OBJECT(appsrc), "is-live", TRUE, "format", GST_FORMAT_TIME,
+                 "do-timestamp", TRUE, NULL);
+    caps = gst_caps_from_string("video/x-raw(" GST_CAPS_FEATURES_NVMM "), format=NV12");
+    g_object_set(G_OBJECT(capsfilter), "caps", caps, NULL);
+    gst_caps_unref(caps);
+
+    gst_bin_add_many(GST_BIN(bin), appsrc, converter, capsfilter, NULL);
+    if (!gst_element_link_many(appsrc, converter, capsfilter, NULL)) {
+      g_printerr("Failed to link shared memory source %s\n", name);
+      return NULL;
+    }
+
+    srcpad = gst_element_get_static_pad(capsfilter, "src");
+    if (!gst_element_add_pad(bin, gst_ghost_pad_new("src", srcpad))) {
+      g_printerr("Failed to add ghost pad in source bin\n");
+      gst_object_unref(srcpad);
+      return NULL;
+    }
+    gst_object_unref(srcpad);
+
+    shm_sources.emplace_back();
+    ShmSource &source = shm_sources.back();
+    source.name = name;
+    source.index = index;
+    source.appsrc = appsrc;
+    source.thread = std::thread(shm_source_loop, &source);
+    return bin;
+  }
+
+  void
+  Hermes::shm_source_loop(ShmSource *source) {
+    std::string error;
+    gboolean waiting_reported = FALSE;
+    guint idle_ms = 0;
+    GstBuffer *buffer = NULL;
+
+    while (source->running) {
+      if (!source->reader.is_open()) {
+        if (!source->reader.open(source->name, error)) {
+          if (!waiting_reported) {
+            g_printerr("%s, waiting for the writer\n", error.c_str());
+            waiting_reported = TRUE;
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(SHM_SOURCE_WAIT_MS));
+          continue;
+        }
+        waiting_reported = FALSE;
+        idle_ms = 0;
+        // a restarted writer may have changed the frame size
+        if (buffer) {
+          gst_buffer_unref(buffer);
+          buffer = NULL;
+        }
+
+        ShmRingReader &reader = source->reader;
+        GstCaps *caps = gst_caps_new_simple("video/x-raw",
+            "format", G_TYPE_STRING, shm_format_name(reader.format()),
+            "width", G_TYPE_INT, (gint)reader.width(), "height", G_TYPE_INT, (gint)reader.height(),
+            "framerate", GST_TYPE_FRACTION, (gint)reader.fps(), 1, NULL);
+        g_object_set(G_OBJECT(source->appsrc), "caps", caps, NULL);
+        gst_caps_unref(caps);
+        g_print("Source %s%s: %ux%u %s\n", SHM_SOURCE_PREFIX, source->name.c_str(),
+                reader.width(), reader.height(), shm_format_name(reader.format()));
+        note_source_geometry(source->index, reader.width(), reader.height());
+      }
+
+      // Kept until a frame lands in it
+      if (!buffer) {
+        buffer = gst_buffer_new_allocate(NULL, source->reader.frame_size(), NULL);
+      }
+      GstMapInfo map;
+      uint64_t timestamp_ns;
+      gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+      gboolean got_frame = source->reader.read_latest(map.data, SHM_SOURCE_WAIT_MS, timestamp_ns);
+      gst_buffer_unmap(buffer, &map);
+
+      if (!got_frame) {
+        idle_ms += SHM_SOURCE_WAIT_MS;
+        if (idle_ms >= SHM_SOURCE_REOPEN_MS) {
+          idle_ms = 0;
+          if (source->reader.replaced()) {
+            source->reader.close();
+          }
+        }
+        continue;
+      }
+      idle_ms = 0;
+
+      // Newest frame only, nothing queues up behind a slow pipeline
+      guint64 queued = 0;
+      g_object_get(G_OBJECT(source->appsrc), "current-level-bytes", &queued, NULL);
+      if (queued) {
+        source->dropped++;
+        continue;
+      }
+
+      GstFlowReturn ret = GST_FLOW_OK;
+      g_signal_emit_by_name(source->appsrc, "push-buffer", buffer, &ret);
+      gst_buffer_unref(buffer);
+      buffer = NULL;
+      if (ret != GST_FLOW_OK && ret != GST_FLOW_FLUSHING) {
+        g_printerr("Source %s%s stopped: %s\n", SHM_SOURCE_PREFIX, source->name.c_str(),
+                   gst_flow_get_name(ret));
+        break;
+      }
+    }
+
+    if (buffer) {
+      gst_buffer_unref(buffer);
+    }
+  }
+
+  void
+  Hermes::stop_shm_sources() {
+    for (ShmSource &source : shm_sources) {
+      source.running = FALSE;
+      if (source.thread.joinable()) {
+        source.thread.join();
+      }
+      if (source.reader.is_open()) {
+        g_print("Source %s%s: %lu frames read, %lu skipped by the reader, %lu dropped\n",
+                SHM_SOURCE_PREFIX, source.name.c_str(), (gulong)source.reader.frames_read,
+                (gulong)source.reader.frames_skipped, (gulong)source.dropped);
+      }
+    }
+  }
+
+  gchar *
+  Hermes::get_absolute_file_path(gchar *cfg_file_path, gchar *file_path) {
+    gchar abs_cfg_path[PATH_MAX + 1];
+    gchar *abs_file_path;
+    gchar *delim;
+
+    if (file_path && file_path[0] == '/') {
+      return file_path;
+    }
+
+    if (!realpath(cfg_file_path, abs_cfg_path)) {
       g_free(file_path);
       return NULL;
     }
-
-    // Return absolute path of config file if file_path is NULL.
-    if (!file_path) {
-      abs_file_path = g_strdup(abs_cfg_path);
-      return abs_file_path;
+
+    // Return absolute path of config file if file_path is NULL.
+    if (!file_path) {
+      abs_file_path = g_strdup(abs_cfg_path);
+      return abs_file_path;
+    }
+
+    delim = g_strrstr(abs_cfg_path, "/");
+    *(delim + 1) = '\0';
+
+    abs_file_path = g_strconcat(abs_cfg_path, file_path, NULL);
+    g_free(file_path);
+
+    return abs_file_path;
+  }
+
+  gboolean
+  Hermes::set_tracker_properties(GstElement *nvtracker) {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar **keys = NULL;
+    gchar **key = NULL;
+    GKeyFile *key_file = g_key_file_new();
+
+    if (!g_key_file_load_from_file(key_file, TRACKER_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      g_printerr("Failed to load config file: %s\n", error->message);
+      return FALSE;
+    }
+
+    keys = g_key_file_get_keys(key_file, CONFIG_GROUP_TRACKER, NULL, &error);
+    CHECK_ERROR(error);
+
+    for (key = keys; *key; key++) {
+      if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_WIDTH)) {
+        gint width =
+            g_key_file_get_integer(key_file, CONFIG_GROUP_TRACKER,
+                                  CONFIG_GROUP_TRACKER_WIDTH, &error);
+        CHECK_ERROR(error);
+        g_object_set(G_OBJECT(nvtracker), "tracker-width", width, NULL);
+      }
+      else if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_HEIGHT)) {
+        gint height =
+            g_key_file_get_integer(key_file, CONFIG_GROUP_TRACKER,
+                                  CONFIG_GROUP_TRACKER_HEIGHT, &error);
+        CHECK_ERROR(error);
+        g_object_set(G_OBJECT(nvtracker), "tracker-height", height, NULL);
+      }
+      else if (!g_strcmp0(*key, CONFIG_GPU_ID)) {
+        guint gpu_id =
+            g_key_file_get_integer(key_file, CONFIG_GROUP_TRACKER,
+                                  CONFIG_GPU_ID, &error);
+        CHECK_ERROR(error);
+        g_object_set(G_OBJECT(nvtracker), "gpu_id", gpu_id, NULL);
+      }
+      else if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_LL_CONFIG_FILE)) {
+        char *ll_config_file = get_absolute_file_path(TRACKER_CONFIG_FILE,
+                                                      g_key_file_get_string(key_file,
+                                                                            CONFIG_GROUP_TRACKER,
+                                                                            CONFIG_GROUP_TRACKER_LL_CONFIG_FILE, &error));
+        CHECK_ERROR(error);
+        g_object_set(G_OBJECT(nvtracker), "ll-config-file", ll_config_file, NULL);
+      }
+      else if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_LL_LIB_FILE)) {
+        char *ll_lib_file = get_absolute_file_path(TRACKER_CONFIG_FILE,
+                                                  g_key_file_get_string(key_file,
+                                                                        CONFIG_GROUP_TRACKER,
+                                                                        CONFIG_GROUP_TRACKER_LL_LIB_FILE, &error));
+        CHECK_ERROR(error);
+        g_object_set(G_OBJECT(nvtracker), "ll-lib-file", ll_lib_file, NULL);
+      }
+      else if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS)) {
+        gboolean enable_batch_process =
+            g_key_file_get_integer(key_file, CONFIG_GROUP_TRACKER,
+                                  CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS, &error);
+        CHECK_ERROR(error);
+        g_object_set(G_OBJECT(nvtracker), "enable_batch_process",
+                    enable_batch_process, NULL);
+      }
+      else {
+        g_printerr("Unknown key '%s' for group [%s]", *key,
+                  CONFIG_GROUP_TRACKER);
+      }
+    }
+
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      if (keys) {
+        g_strfreev(keys);
+      }
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+      }
+    return ret;
+  }
+
+  gboolean
+  Hermes::read_slice_grid(GKeyFile *key_file, const gchar *group, SliceGrid &grid) {
+    GError *error = NULL;
+    gint rows = grid.rows;
+    gint columns = grid.columns;
+
+    if (g_key_file_has_key(key_file, group, CONFIG_SLICING_ROWS, NULL)) {
+      rows = g_key_file_get_integer(key_file, group, CONFIG_SLICING_ROWS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_SLICING_COLUMNS, NULL)) {
+      columns = g_key_file_get_integer(key_file, group, CONFIG_SLICING_COLUMNS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_SLICING_OVERLAP, NULL)) {
+      grid.overlap = g_key_file_get_double(key_file, group, CONFIG_SLICING_OVERLAP, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_SLICING_FULL_FRAME, NULL)) {
+      grid.full_frame = g_key_file_get_integer(key_file, group, CONFIG_SLICING_FULL_FRAME, &error);
+      CHECK_ERROR(error);
+    }
+    // one engine batch bounds how many slices a frame can usefully have
+    if (rows < 1 || columns < 1 || rows * columns > PGIE_MAX_BATCH_SIZE ||
+        grid.overlap < 0 || grid.overlap >= 1) {
+      g_printerr("Invalid slice grid in [%s]\n", group);
+      return FALSE;
+    }
+    grid.rows = rows;
+    grid.columns = columns;
+    return TRUE;
+
+    done:
+      g_error_free(error);
+      return FALSE;
+  }
+
+  gboolean
+  Hermes::load_slicing_config() {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar **groups = NULL;
+    GKeyFile *key_file = g_key_file_new();
+
+    slicing_enabled = FALSE;
+    source_slice_grids.clear();
+
+    if (!g_key_file_load_from_file(key_file, SLICING_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      // Tiled inference is optional
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_SLICING, CONFIG_SLICING_ENABLE, NULL)) {
+      slicing_enabled = g_key_file_get_integer(key_file, CONFIG_GROUP_SLICING,
+                                               CONFIG_SLICING_ENABLE, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_SLICING, CONFIG_SLICING_MERGE_IOU, NULL)) {
+      slice_merge_params.iou_threshold = g_key_file_get_double(key_file, CONFIG_GROUP_SLICING,
+                                                               CONFIG_SLICING_MERGE_IOU, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_SLICING, CONFIG_SLICING_MERGE_IOS, NULL)) {
+      slice_merge_params.ios_threshold = g_key_file_get_double(key_file, CONFIG_GROUP_SLICING,
+                                                               CONFIG_SLICING_MERGE_IOS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_group(key_file, CONFIG_GROUP_SLICING) &&
+        !read_slice_grid(key_file, CONFIG_GROUP_SLICING, slice_grid)) {
+      goto done;
+    }
+
+    // [source-N] groups override the grid of the N-th source in inputsources.txt
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (gchar **group = groups; *group; group++) {
+      guint source_id;
+      if (sscanf(*group, CONFIG_GROUP_SLICING_SOURCE, &source_id) != 1) {
+        continue;
+      }
+      SliceGrid grid = slice_grid;
+      if (!read_slice_grid(key_file, *group, grid)) {
+        goto done;
+      }
+      source_slice_grids[source_id] = grid;
+    }
+
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      if (groups) {
+        g_strfreev(groups);
+      }
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+        slicing_enabled = FALSE;
+      }
+    return ret;
+  }
+
+  gboolean
+  Hermes::read_network_size(guint &width, guint &height) {
+    GError *error = NULL;
+    gchar *network_config = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    gboolean in_net = FALSE;
+    guint found = 0;
+
+    if (!g_key_file_load_from_file(key_file, PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH,
+                                  G_KEY_FILE_NONE, &error)) {
+      g_printerr("Failed to load %s: %s\n", PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH, error->message);
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return FALSE;
+    }
+    network_config = g_key_file_get_string(key_file, CONFIG_GROUP_PROPERTY,
+                                           CONFIG_CUSTOM_NETWORK_CONFIG, NULL);
+    g_key_file_free(key_file);
+    if (!network_config) {
+      return FALSE;
+    }
+
+    // Darknet cfg, not a key file: repeated groups and # comments mid line
+    std::ifstream cfg(network_config);
+    std::string line;
+    while (found != 3 && getline(cfg, line)) {
+      boost::algorithm::erase_all(line, " ");
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      if (line[0] == '[') {
+        if (in_net) {
+          break;
+        }
+        in_net = line == DARKNET_GROUP_NET;
+      }
+      else if (in_net && sscanf(line.c_str(), "width=%u", &width) == 1) {
+        found |= 1;
+      }
+      else if (in_net && sscanf(line.c_str(), "height=%u", &height) == 1) {
+        found |= 2;
+      }
+    }
+    if (found != 3) {
+      g_printerr("No network input size in %s\n", network_config);
+    }
+    g_free(network_config);
+    return found == 3;
+  }
+
+  gboolean
+  Hermes::load_muxer_config() {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar *policy = NULL;
+    GKeyFile *key_file = g_key_file_new();
+
+    muxer_settings = MuxerPolicySettings();
+    muxer_settings.fixed_width = MUXER_OUTPUT_WIDTH;
+    muxer_settings.fixed_height = MUXER_OUTPUT_HEIGHT;
+
+    if (!g_key_file_load_from_file(key_file, MUXER_CONFIG_FILE, G_KEY_FILE_NONE, &error)) {
+      // Without it the muxer runs at MUXER_OUTPUT_WIDTH x MUXER_OUTPUT_HEIGHT
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_MUXER, CONFIG_MUXER_POLICY, NULL)) {
+      policy = g_key_file_get_string(key_file, CONFIG_GROUP_MUXER, CONFIG_MUXER_POLICY, &error);
+      CHECK_ERROR(error);
+      if (!parse_muxer_policy(policy, muxer_settings.policy)) {
+        g_printerr("Unknown %s %s, expected fixed, native-max or network-aligned\n",
+                   CONFIG_MUXER_POLICY, policy);
+        goto done;
+      }
+    }
+
+    {
+      std::pair<const gchar *, guint *> sizes[] = {
+        {CONFIG_MUXER_WIDTH, &muxer_settings.fixed_width},
+        {CONFIG_MUXER_HEIGHT, &muxer_settings.fixed_height},
+        {CONFIG_MUXER_MAX_WIDTH, &muxer_settings.max_width},
+        {CONFIG_MUXER_MAX_HEIGHT, &muxer_settings.max_height},
+        {CONFIG_MUXER_ALIGNMENT, &muxer_settings.alignment},
+        {CONFIG_MUXER_PROBE_TIMEOUT, &muxer_probe_timeout}
+      };
+      for (auto &size : sizes) {
+        if (!g_key_file_has_key(key_file, CONFIG_GROUP_MUXER, size.first, NULL)) {
+          continue;
+        }
+        gint value = g_key_file_get_integer(key_file, CONFIG_GROUP_MUXER, size.first, &error);
+        CHECK_ERROR(error);
+        if (value <= 0) {
+          g_printerr("%s has to be positive\n", size.first);
+          goto done;
+        }
+        *size.second = value;
+      }
+    }
+
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_MUXER, CONFIG_MUXER_PADDING, NULL)) {
+      muxer_settings.padding = g_key_file_get_boolean(key_file, CONFIG_GROUP_MUXER,
+                                                      CONFIG_MUXER_PADDING, &error);
+      CHECK_ERROR(error);
+    }
+
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      g_free(policy);
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+      }
+    return ret;
+  }
+
+  SourceGeometry
+  Hermes::probe_source_geometry(const std::string &uri) {
+    SourceGeometry geometry;
+    GError *error = NULL;
+
+    // The writer's ring header has the size, nothing to decode
+    if (g_str_has_prefix(uri.c_str(), SHM_SOURCE_PREFIX)) {
+      ShmRingReader reader;
+      std::string reason;
+      if (reader.open(uri.substr(strlen(SHM_SOURCE_PREFIX)), reason)) {
+        geometry.width = reader.width();
+        geometry.height = reader.height();
+      }
+      return geometry;
+    }
+
+    GstDiscoverer *discoverer = gst_discoverer_new(muxer_probe_timeout * GST_SECOND, &error);
+    if (!discoverer) {
+      g_printerr("Could not probe %s: %s\n", uri.c_str(), error->message);
+      g_error_free(error);
+      return geometry;
+    }
+    GstDiscovererInfo *info = gst_discoverer_discover_uri(discoverer, uri.c_str(), &error);
+    if (info && gst_discoverer_info_get_result(info) == GST_DISCOVERER_OK) {
+      GList *streams = gst_discoverer_info_get_video_streams(info);
+      if (streams) {
+        GstDiscovererVideoInfo *video = GST_DISCOVERER_VIDEO_INFO(streams->data);
+        geometry.width = gst_discoverer_video_info_get_width(video);
+        geometry.height = gst_discoverer_video_info_get_height(video);
+      }
+      gst_discoverer_stream_info_list_free(streams);
+    }
+    else {
+      g_printerr("Could not probe %s: %s\n", uri.c_str(), error ? error->message : "timed out");
+    }
+    if (error) {
+      g_error_free(error);
+    }
+    if (info) {
+      gst_discoverer_info_unref(info);
+    }
+    gst_object_unref(discoverer);
+    return geometry;
+  }
+
+  gboolean
+  Hermes::choose_muxer_resolution() {
+    std::vector<std::string> uris;
+    std::string source;
+
+    if (!load_muxer_config()) {
+      return FALSE;
+    }
+
+    std::ifstream infile(SOURCE_PATH);
+    while (getline(infile, source)) {
+      uris.push_back(source);
+    }
+
+    std::lock_guard<std::mutex> lock(muxer_lock);
+    muxer_sources.assign(uris.size(), SourceGeometry());
+
+    if (muxer_settings.policy != MuxerPolicy::FIXED) {
+      guint width = muxer_settings.network_width, height = muxer_settings.network_height;
+      if (read_network_size(width, height)) {
+        muxer_settings.network_width = width;
+        muxer_settings.network_height = height;
+      }
+
+      // Under tiled inference the detector sees slices, the frame has to hold the grid
+      if (slicing_enabled) {
+        std::vector<SliceGrid> grids = {slice_grid};
+        for (auto &grid : source_slice_grids) {
+          grids.push_back(grid.second);
+        }
+        gdouble columns = 1, rows = 1;
+        for (const SliceGrid &grid : grids) {
+          gdouble overlap = MIN(MAX(grid.overlap, 0.0f), 0.9f);
+          columns = MAX(columns, grid.columns - (grid.columns - 1) * overlap);
+          rows = MAX(rows, grid.rows - (grid.rows - 1) * overlap);
+        }
+        muxer_settings.network_width = width * columns;
+        muxer_settings.network_height = height * rows;
+      }
+
+      // Sources answer in parallel, startup waits for the slowest one only
+      std::vector<std::future<SourceGeometry>> probes;
+      for (const std::string &uri : uris) {
+        probes.push_back(std::async(std::launch::async, probe_source_geometry, uri));
+      }
+      for (guint i = 0; i < probes.size(); i++) {
+        muxer_sources[i] = probes[i].get();
+      }
+      startup.mark("sources probed");
+    }
+
+    muxer_geometry = choose_muxer_geometry(muxer_sources, muxer_settings);
+    g_print("Muxer: %ux%u, %s policy (%s)%s\n", muxer_geometry.width, muxer_geometry.height,
+            muxer_policy_name(muxer_settings.policy), muxer_geometry.reason.c_str(),
+            muxer_geometry.padding ? ", padded" : "");
+    for (guint i = 0; i < muxer_sources.size(); i++) {
+      if (muxer_sources[i].width) {
+        g_print("Source %u: %ux%u%s\n", i, muxer_sources[i].width, muxer_sources[i].height,
+                muxer_sources[i].width < muxer_geometry.width &&
+                muxer_sources[i].height < muxer_geometry.height ? ", upscaled" : "");
+      }
+    }
+    return TRUE;
+  }
+
+  void
+  Hermes::note_source_geometry(guint index, guint width, guint height) {
+    std::lock_guard<std::mutex> lock(muxer_lock);
+    if (index >= muxer_sources.size() ||
+        (muxer_sources[index].width == width && muxer_sources[index].height == height)) {
+      return;
+    }
+    muxer_sources[index].width = width;
+    muxer_sources[index].height = height;
+
+    // A reconnected camera may come back at another size
+    MuxerGeometry wanted = choose_muxer_geometry(muxer_sources, muxer_settings);
+    if (muxer_geometry_differs(wanted, muxer_geometry)) {
+      muxer_mismatches++;
+      HERMES_LOG(LOG_LEVEL_WARNING, "Sources call for another muxer resolution, restart to apply",
+                 log_field("source", index), log_field("width", width),
+                 log_field("height", height), log_field("muxer_width", muxer_geometry.width),
+                 log_field("muxer_height", muxer_geometry.height),
+                 log_field("wanted_width", wanted.width), log_field("wanted_height", wanted.height));
+    }
+  }
+
+  gboolean
+  Hermes::read_thread_spec(GKeyFile *key_file, const gchar *group, ThreadSpec &spec) {
+    GError *error = NULL;
+    gchar *cpu_cores = NULL;
+    gint queue_depth = spec.queue_depth;
+    gint leaky = spec.leaky;
+    gint priority = spec.priority;
+
+    if (g_key_file_has_key(key_file, group, CONFIG_THREAD_QUEUE_DEPTH, NULL)) {
+      queue_depth = g_key_file_get_integer(key_file, group, CONFIG_THREAD_QUEUE_DEPTH, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_THREAD_LEAKY, NULL)) {
+      leaky = g_key_file_get_integer(key_file, group, CONFIG_THREAD_LEAKY, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_THREAD_PRIORITY, NULL)) {
+      priority = g_key_file_get_integer(key_file, group, CONFIG_THREAD_PRIORITY, &error);
+      CHECK_ERROR(error);
+      spec.set_priority = true;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_THREAD_CPU_CORES, NULL)) {
+      cpu_cores = g_key_file_get_string(key_file, group, CONFIG_THREAD_CPU_CORES, &error);
+      CHECK_ERROR(error);
+      gboolean valid = parse_cpu_list(cpu_cores, spec.cpu_cores);
+      g_free(cpu_cores);
+      if (!valid) {
+        g_printerr("Invalid %s in [%s]\n", CONFIG_THREAD_CPU_CORES, group);
+        return FALSE;
+      }
+    }
+    if (queue_depth < 1 || leaky < 0 || leaky > 2 || priority < -20 || priority > 19) {
+      g_printerr("Invalid thread settings in [%s]\n", group);
+      return FALSE;
+    }
+    // Only the display branch may drop, every other queue blocks when full
+    if (leaky && g_strcmp0(group, CONFIG_GROUP_THREAD_PREFIX TILER_ELEMENT_NAME) != 0) {
+      g_printerr("%s is only allowed in [%s%s], not in [%s]\n", CONFIG_THREAD_LEAKY,
+                 CONFIG_GROUP_THREAD_PREFIX, TILER_ELEMENT_NAME, group);
+      return FALSE;
+    }
+    spec.queue_depth = queue_depth;
+    spec.leaky = leaky;
+    spec.priority = priority;
+    return TRUE;
+
+    done:
+      g_error_free(error);
+      return FALSE;
+  }
+
+  gboolean
+  Hermes::load_threading_config() {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar **groups = NULL;
+    GKeyFile *key_file = g_key_file_new();
+
+    threading_enabled = FALSE;
+    thread_defaults = ThreadSpec();
+    thread_boundaries.clear();
+
+    if (!g_key_file_load_from_file(key_file, THREADING_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      // Without it every stage runs on the streammux thread
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_THREADING, CONFIG_THREADING_ENABLE, NULL)) {
+      threading_enabled = g_key_file_get_integer(key_file, CONFIG_GROUP_THREADING,
+                                                 CONFIG_THREADING_ENABLE, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_group(key_file, CONFIG_GROUP_THREADING) &&
+        !read_thread_spec(key_file, CONFIG_GROUP_THREADING, thread_defaults)) {
+      goto done;
+    }
+
+    // [thread-<element>] starts a thread at the named element of the topology
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (gchar **group = groups; *group; group++) {
+      if (!g_str_has_prefix(*group, CONFIG_GROUP_THREAD_PREFIX)) {
+        continue;
+      }
+      ThreadSpec spec = thread_defaults;
+      if (!read_thread_spec(key_file, *group, spec)) {
+        goto done;
+      }
+      thread_boundaries[*group + strlen(CONFIG_GROUP_THREAD_PREFIX)] = spec;
+    }
+
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      if (groups) {
+        g_strfreev(groups);
+      }
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+        threading_enabled = FALSE;
+      }
+    return ret;
+  }
+
+  gboolean
+  Hermes::load_classifier_config() {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    GKeyFile *infer_key_file = NULL;
+    const gchar *group = CONFIG_GROUP_CLASSIFIER;
+
+    classifier_enabled = FALSE;
+
+    if (!g_key_file_load_from_file(key_file, CLASSIFIER_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      // The secondary classifier is optional
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_ENABLE, NULL)) {
+      classifier_enabled = g_key_file_get_integer(key_file, group, CONFIG_CLASSIFIER_ENABLE, &error);
+      CHECK_ERROR(error);
+    }
+    if (!classifier_enabled) {
+      ret = TRUE;
+      goto done;
+    }
+
+    if (!g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_INFER_CONFIG, NULL)) {
+      g_printerr("%s: %s is required\n", CLASSIFIER_CONFIG_FILE, CONFIG_CLASSIFIER_INFER_CONFIG);
+      goto done;
+    }
+    g_free(classifier_infer_config);
+    classifier_infer_config = g_key_file_get_string(key_file, group,
+                                                    CONFIG_CLASSIFIER_INFER_CONFIG, &error);
+    CHECK_ERROR(error);
+
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_FIRE_CLASS, NULL)) {
+      classifier_fire_class = g_key_file_get_integer(key_file, group,
+                                                     CONFIG_CLASSIFIER_FIRE_CLASS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_CONFIRM_THRESHOLD, NULL)) {
+      track_gate_params.confirm_threshold =
+          g_key_file_get_double(key_file, group, CONFIG_CLASSIFIER_CONFIRM_THRESHOLD, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_MAX_ATTEMPTS, NULL)) {
+      track_gate_params.max_attempts = g_key_file_get_integer(key_file, group,
+                                                              CONFIG_CLASSIFIER_MAX_ATTEMPTS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_RETRY_INTERVAL, NULL)) {
+      track_gate_params.retry_interval =
+          g_key_file_get_integer(key_file, group, CONFIG_CLASSIFIER_RETRY_INTERVAL, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_RECHECK_INTERVAL, NULL)) {
+      track_gate_params.recheck_interval =
+          g_key_file_get_integer(key_file, group, CONFIG_CLASSIFIER_RECHECK_INTERVAL, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_MAX_AGE, NULL)) {
+      track_gate_params.max_age = g_key_file_get_integer(key_file, group,
+                                                         CONFIG_CLASSIFIER_MAX_AGE, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_REQUIRE_CONFIRMATION, NULL)) {
+      require_confirmation = g_key_file_get_integer(key_file, group,
+                                                    CONFIG_CLASSIFIER_REQUIRE_CONFIRMATION, &error);
+      CHECK_ERROR(error);
+    }
+
+    if (g_key_file_has_key(key_file, group, CONFIG_CLASSIFIER_MAX_CROPS, NULL)) {
+      track_gate_params.max_crops_per_batch =
+          g_key_file_get_integer(key_file, group, CONFIG_CLASSIFIER_MAX_CROPS, &error);
+      CHECK_ERROR(error);
+    }
+    else {
+      // One inference per batch: as many crops as the classifier takes at once
+      infer_key_file = g_key_file_new();
+      if (!g_key_file_load_from_file(infer_key_file, classifier_infer_config, G_KEY_FILE_NONE,
+                                    &error)) {
+        CHECK_ERROR(error);
+      }
+      if (g_key_file_has_key(infer_key_file, CONFIG_GROUP_PROPERTY, CONFIG_BATCH_SIZE, NULL)) {
+        track_gate_params.max_crops_per_batch =
+            g_key_file_get_integer(infer_key_file, CONFIG_GROUP_PROPERTY, CONFIG_BATCH_SIZE, &error);
+        CHECK_ERROR(error);
+      }
+    }
+
+    track_gate = TrackGate(track_gate_params);
+    g_print("Fire classifier: %u crops per batch, %u attempts %u frames apart%s\n",
+            track_gate_params.max_crops_per_batch, track_gate_params.max_attempts,
+            track_gate_params.retry_interval,
+            require_confirmation ? ", unconfirmed tracks hidden" : "");
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      if (infer_key_file) {
+        g_key_file_free(infer_key_file);
+      }
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+        classifier_enabled = FALSE;
+      }
+    return ret;
+  }
+
+  gboolean
+  Hermes::configure_classifier(GstElement *sgie_fire_classifier) {
+    if (!sgie_fire_classifier) {
+      return FALSE;
+    }
+    /* Secondary mode on the detections the gate probe tags, whatever the
+     * infer config says, so nvinfer does not pick its own objects */
+    g_object_set(G_OBJECT(sgie_fire_classifier), "config-file-path", classifier_infer_config,
+                 "unique-id", FIRE_CLASSIFIER, "process-mode", 2,
+                 "infer-on-gie-id", CLASSIFIER_GATE, NULL);
+
+    GstPad *sgie_sink_pad = gst_element_get_static_pad(sgie_fire_classifier, "sink");
+    GstPad *sgie_src_pad = gst_element_get_static_pad(sgie_fire_classifier, "src");
+    gst_pad_add_probe(sgie_sink_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                      sgie_sink_pad_gate_probe, NULL, NULL);
+    gst_pad_add_probe(sgie_src_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                      sgie_src_pad_verdict_probe, NULL, NULL);
+    gst_object_unref(sgie_sink_pad);
+    gst_object_unref(sgie_src_pad);
+    return TRUE;
+  }
+
+  gboolean
+  Hermes::classifier_fire_score(NvDsObjectMeta *obj_meta, gfloat &score) {
+    for (NvDsMetaList *l_class = obj_meta->classifier_meta_list; l_class != NULL;
+        l_class = l_class->next) {
+      NvDsClassifierMeta *class_meta = (NvDsClassifierMeta *)(l_class->data);
+      if (class_meta->unique_component_id != FIRE_CLASSIFIER) {
+        continue;
+      }
+      // The most likely class, any other than fire means not a fire
+      score = 0;
+      for (NvDsMetaList *l_label = class_meta->label_info_list; l_label != NULL;
+          l_label = l_label->next) {
+        NvDsLabelInfo *label = (NvDsLabelInfo *)(l_label->data);
+        if (label->result_class_id == classifier_fire_class) {
+          score = label->result_prob;
+        }
+      }
+      return TRUE;
+    }
+    // Skipped by nvinfer, e.g. a crop under input-object-min-width
+    return FALSE;
+  }
+
+  GstPadProbeReturn
+  Hermes::sgie_sink_pad_gate_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+
+    if (!batch_meta) {
+      return GST_PAD_PROBE_OK;
+    }
+
+    // Detections of all sources are gated together, the crops go in one batch
+    std::vector<NvDsObjectMeta *> objects;
+    std::vector<TrackObservation> observations;
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+        l_frame = l_frame->next) {
+      NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+
+      if (frame_meta == NULL) {
+        continue;
+      }
+
+      for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+          l_obj = l_obj->next) {
+        NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)(l_obj->data);
+        if (obj_meta == NULL) {
+          continue;
+        }
+        TrackObservation observation;
+        observation.source_id = frame_meta->source_id;
+        observation.object_id = obj_meta->object_id;
+        observation.frame = frame_meta->frame_num;
+        observations.push_back(observation);
+        objects.push_back(obj_meta);
+      }
+    }
+
+    std::vector<bool> chosen;
+    {
+      std::lock_guard<std::mutex> guard(classifier_lock);
+      chosen = track_gate.select(observations);
+    }
+
+    // Retagged for the classifier, the verdict probe puts the detector's id back
+    for (guint i = 0; i < objects.size(); i++) {
+      if (chosen[i]) {
+        objects[i]->misc_obj_info[CLASSIFIER_GATE_SLOT] = objects[i]->unique_component_id;
+        objects[i]->unique_component_id = CLASSIFIER_GATE;
+      }
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstPadProbeReturn
+  Hermes::sgie_src_pad_verdict_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+
+    if (!batch_meta) {
+      return GST_PAD_PROBE_OK;
+    }
+
+    std::lock_guard<std::mutex> guard(classifier_lock);
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+        l_frame = l_frame->next) {
+      NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+
+      if (frame_meta == NULL) {
+        continue;
+      }
+
+      std::vector<NvDsObjectMeta *> hidden;
+      for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+          l_obj = l_obj->next) {
+        NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)(l_obj->data);
+        if (obj_meta == NULL) {
+          continue;
+        }
+
+        TrackVerdict verdict = track_gate.verdict(frame_meta->source_id, obj_meta->object_id);
+        if (obj_meta->unique_component_id == CLASSIFIER_GATE) {
+          obj_meta->unique_component_id = (gint)obj_meta->misc_obj_info[CLASSIFIER_GATE_SLOT];
+          gfloat score;
+          if (classifier_fire_score(obj_meta, score)) {
+            verdict = track_gate.record(frame_meta->source_id, obj_meta->object_id, score);
+          }
+        }
+
+        // Turned down tracks never reach the OSD, the fire map or the survey logs
+        if (verdict == TrackVerdict::REJECTED ||
+            (require_confirmation && verdict != TrackVerdict::CONFIRMED)) {
+          hidden.push_back(obj_meta);
+        }
+      }
+      for (NvDsObjectMeta *obj_meta : hidden) {
+        nvds_remove_obj_meta_from_frame(frame_meta, obj_meta);
+      }
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  void
+  Hermes::attach_slicing_probes(GstElement *pgie_yolo_detector) {
+    if (!slicing_enabled) {
+      return;
+    }
+    GstPad *pgie_sink_pad = gst_element_get_static_pad(pgie_yolo_detector, "sink");
+    GstPad *pgie_src_pad = gst_element_get_static_pad(pgie_yolo_detector, "src");
+    gst_pad_add_probe(pgie_sink_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                      pgie_sink_pad_slice_probe, NULL, NULL);
+    gst_pad_add_probe(pgie_src_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                      pgie_src_pad_merge_probe, NULL, NULL);
+    gst_object_unref(pgie_sink_pad);
+    gst_object_unref(pgie_src_pad);
+  }
+
+  GstPadProbeReturn
+  Hermes::pgie_sink_pad_slice_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+
+    if (!batch_meta) {
+      return GST_PAD_PROBE_OK;
+    }
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+        l_frame = l_frame->next) {
+      NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+
+      if (frame_meta == NULL) {
+        continue;
+      }
+
+      auto it = source_slice_grids.find(frame_meta->source_id);
+      const SliceGrid &grid = (it != source_slice_grids.end()) ? it->second : slice_grid;
+
+      // Slice objects are what pgie_yolo_detector infers on in secondary mode
+      for (const SliceRect &slice : compute_slices(muxer_geometry.width, muxer_geometry.height, grid)) {
+        NvDsObjectMeta *obj_meta = nvds_acquire_obj_meta_from_pool(batch_meta);
+        obj_meta->unique_component_id = SLICER;
+        obj_meta->class_id = 0;
+        obj_meta->confidence = 1.0;
+        obj_meta->object_id = UNTRACKED_OBJECT_ID;
+        obj_meta->rect_params.left = slice.left;
+        obj_meta->rect_params.top = slice.top;
+        obj_meta->rect_params.width = slice.width;
+        obj_meta->rect_params.height = slice.height;
+        obj_meta->rect_params.border_width = 0;
+        obj_meta->rect_params.has_bg_color = 0;
+        obj_meta->text_params.display_text = NULL;
+        nvds_add_obj_meta_to_frame(frame_meta, obj_meta, NULL);
+      }
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstPadProbeReturn
+  Hermes::pgie_src_pad_merge_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+
+    if (!batch_meta) {
+      return GST_PAD_PROBE_OK;
+    }
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+        l_frame = l_frame->next) {
+      NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+
+      if (frame_meta == NULL) {
+        continue;
+      }
+
+      std::vector<NvDsObjectMeta *> slice_metas;
+      std::vector<NvDsObjectMeta *> detection_metas;
+      std::vector<SliceDetection> detections;
+
+      for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+          l_obj = l_obj->next) {
+        NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)(l_obj->data);
+        if (obj_meta == NULL) {
+          continue;
+        }
+        if (obj_meta->unique_component_id == SLICER) {
+          slice_metas.push_back(obj_meta);
+        }
+        else {
+          detection_metas.push_back(obj_meta);
+        }
+      }
+
+      // Detections come back in frame coordinates, parented to their slice
+      for (NvDsObjectMeta *obj_meta : detection_metas) {
+        SliceDetection det;
+        det.box = {obj_meta->rect_params.left, obj_meta->rect_params.top,
+                   obj_meta->rect_params.width, obj_meta->rect_params.height};
+        det.confidence = obj_meta->confidence;
+        det.class_id = obj_meta->class_id;
+        auto parent = std::find(slice_metas.begin(), slice_metas.end(), obj_meta->parent);
+        det.slice_index = (parent != slice_metas.end()) ? (gint)(parent - slice_metas.begin()) : -1;
+        detections.push_back(det);
+      }
+
+      std::vector<MergedDetection> merged = merge_slice_detections(detections, slice_merge_params);
+      std::vector<gboolean> keep(detection_metas.size(), FALSE);
+      for (const MergedDetection &m : merged) {
+        NvDsObjectMeta *obj_meta = detection_metas[m.leader];
+        obj_meta->rect_params.left = m.detection.box.left;
+        obj_meta->rect_params.top = m.detection.box.top;
+        obj_meta->rect_params.width = m.detection.box.width;
+        obj_meta->rect_params.height = m.detection.box.height;
+        keep[m.leader] = TRUE;
+      }
+
+      for (guint i = 0; i < detection_metas.size(); i++) {
+        detection_metas[i]->parent = NULL;
+        if (!keep[i]) {
+          nvds_remove_obj_meta_from_frame(frame_meta, detection_metas[i]);
+        }
+      }
+      for (NvDsObjectMeta *obj_meta : slice_metas) {
+        nvds_remove_obj_meta_from_frame(frame_meta, obj_meta);
+      }
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  std::string
+  Hermes::get_compute_mode(const gchar *infer_config_file) {
+    // 0=FP32, 1=INT8, 2=FP16 mode, same as nvinfer
+    static const gchar *modes[] = {"fp32", "int8", "fp16"};
+    GError *error = NULL;
+    gint network_mode = 0;
+    GKeyFile *key_file = g_key_file_new();
+
+    if (!g_key_file_load_from_file(key_file, infer_config_file, G_KEY_FILE_NONE,
+                                  &error)) {
+      g_printerr("Failed to load config file: %s\n", error->message);
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return modes[0];
+    }
+
+    if (g_key_file_has_key(key_file, CONFIG_GROUP_PROPERTY, CONFIG_NETWORK_MODE, NULL)) {
+      network_mode = g_key_file_get_integer(key_file, CONFIG_GROUP_PROPERTY,
+                                            CONFIG_NETWORK_MODE, &error);
+      if (error) {
+        g_printerr("Invalid %s: %s\n", CONFIG_NETWORK_MODE, error->message);
+        g_error_free(error);
+        network_mode = 0;
+      }
+    }
+    g_key_file_free(key_file);
+
+    if (network_mode < 0 || network_mode > 2) {
+      g_printerr("Unsupported %s %d, assuming FP32\n", CONFIG_NETWORK_MODE, network_mode);
+      network_mode = 0;
+    }
+    return modes[network_mode];
+  }
+
+  int
+  Hermes::configure_element_properties(int num_sources, GstElement *streammux, GstElement *pgie_yolo_detector,
+                               GstElement *nvtracker, GstElement *sink, GstElement *tiler) {
+
+    guint tiler_rows, tiler_columns;
+
+    g_object_set(G_OBJECT(streammux), "width", muxer_geometry.width,
+               "height", muxer_geometry.height, "enable-padding", muxer_geometry.padding,
+               "batch-size", num_sources,
+               "batched-push-timeout", MUXER_BATCH_TIMEOUT_USEC,
+               "live-source", live_sources, NULL);
+
+    // Set all important properties of pgie_yolo_detector
+    g_object_set(G_OBJECT(pgie_yolo_detector),
+                "config-file-path", PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH, NULL);
+
+    // Override batch-size of pgie_yolo_detector, partial batches run on the same engine
+    g_object_set(G_OBJECT(pgie_yolo_detector), "batch-size", pgie_batch_size, NULL);
+
+    // Tiled inference: the detector runs on the slice objects, batched across sources
+    if (slicing_enabled) {
+      g_object_set(G_OBJECT(pgie_yolo_detector), "process-mode", 2,
+                  "infer-on-gie-id", SLICER, NULL);
+      g_print("Tiled inference: %ux%u slices, %.0f%% overlap%s\n", slice_grid.rows,
+              slice_grid.columns, slice_grid.overlap * 100,
+              slice_grid.full_frame ? " plus full frame" : "");
+    }
+
+    // Check if Engine Exists
+    if (boost::filesystem::exists(boost::filesystem::path(
+        WildFireDetection::Hermes::PGIE_YOLO_ENGINE_PATH))) {
+
+      g_object_set(G_OBJECT(pgie_yolo_detector),
+                  "model-engine-file", WildFireDetection::Hermes::PGIE_YOLO_ENGINE_PATH.c_str(), NULL);
+    }
+    else {
+      cout << str(boost::format("YOLO Engine for batch-size: %d and compute-mode: %s not found.")
+              % pgie_batch_size % compute_mode) << endl;
+      return EXIT_FAILURE;
+    }
+
+    // Set necessary properties of the tracker element
+    if (!WildFireDetection::Hermes::set_tracker_properties(nvtracker)) {
+      g_printerr("Failed to set tracker properties. Exiting.\n");
+      return -1;
+    }
+
+    if (sink) {
+      g_object_set(G_OBJECT(sink),
+                  "sync", FALSE, NULL);
+    }
+
+    if (tiler) {
+      tiler_rows = (guint)sqrt(num_sources);
+      tiler_columns = (guint)ceil(1.0 * num_sources / tiler_rows);
+      // Tiler Properties
+      g_object_set(G_OBJECT(tiler), "rows", tiler_rows, "columns", tiler_columns,
+                  "width", TILED_OUTPUT_WIDTH, "height", TILED_OUTPUT_HEIGHT, NULL);
+    }
+
+    return EXIT_SUCCESS;
+  }
+
+  void Hermes::setPaths(guint num_sources) {
+
+    // FPS counters, indexed by source_id
+    fps.assign(num_sources, fps_calculator{system_clock::now(), system_clock::now(), 0, 0});
+
+    // Config Paths
+    PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH =
+    strdup("models/YOLOv3WildFires/config_infer_primary_yolov3.txt");
+    g_setenv(INFER_CONFIG_ENV, PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH, FALSE);
+
+    TRACKER_CONFIG_FILE =
+    g_strdup_printf(TRACKER_CONFIG_PATTERN, tracker ? tracker : DEFAULT_TRACKER);
+
+    SLICING_CONFIG_FILE =
+    strdup("models/YOLOv3WildFires/config_slicing.txt");
+
+    THREADING_CONFIG_FILE =
+    strdup("models/config_threading.txt");
+
+    // Engine Paths
+    compute_mode = get_compute_mode(PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH);
+    pgie_batch_size = MAX((guint)PGIE_MAX_BATCH_SIZE, num_sources);
+    PGIE_YOLO_ENGINE_PATH =
+    str(boost::format("model_b%d_gpu0_%s.engine") % pgie_batch_size % compute_mode);
+
+    // Fall back to an engine built for exactly this many sources
+    std::string source_engine_path =
+    str(boost::format("model_b%d_gpu0_%s.engine") % num_sources % compute_mode);
+    if (!boost::filesystem::exists(boost::filesystem::path(PGIE_YOLO_ENGINE_PATH)) &&
+        boost::filesystem::exists(boost::filesystem::path(source_engine_path))) {
+      pgie_batch_size = num_sources;
+      PGIE_YOLO_ENGINE_PATH = source_engine_path;
+    }
+  }
+
+  gboolean
+  Hermes::read_benchmark_settings(BenchmarkSettings &settings) {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar *text = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    const gchar *group = CONFIG_GROUP_BENCHMARK;
+
+    // Without a stand-in setting, stand in whenever nvinfer is missing
+    GstElementFactory *nvinfer = gst_element_factory_find("nvinfer");
+    settings.stand_in = !nvinfer;
+    if (nvinfer) {
+      gst_object_unref(nvinfer);
+    }
+
+    if (!g_key_file_load_from_file(key_file, BENCHMARK_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      // Defaults are a 1080p30 H.264 sweep
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    auto read_uint = [&](const gchar *key, unsigned int &value) -> gboolean {
+      if (g_key_file_has_key(key_file, group, key, NULL)) {
+        gint number = g_key_file_get_integer(key_file, group, key, &error);
+        if (error || number < 0) {
+          g_printerr("Invalid %s in [%s]\n", key, group);
+          return FALSE;
+        }
+        value = number;
+      }
+      return TRUE;
+    };
+
+    if (!read_uint(CONFIG_BENCHMARK_WIDTH, settings.width) ||
+        !read_uint(CONFIG_BENCHMARK_HEIGHT, settings.height) ||
+        !read_uint(CONFIG_BENCHMARK_FPS, settings.fps) ||
+        !read_uint(CONFIG_BENCHMARK_START_SOURCES, settings.start_sources) ||
+        !read_uint(CONFIG_BENCHMARK_MAX_SOURCES, settings.max_sources) ||
+        !read_uint(CONFIG_BENCHMARK_SOURCE_STEP, settings.source_step) ||
+        !read_uint(CONFIG_BENCHMARK_WARMUP, settings.warmup_s) ||
+        !read_uint(CONFIG_BENCHMARK_DURATION, settings.duration_s) ||
+        !read_uint(CONFIG_BENCHMARK_STAND_IN_WORK, settings.stand_in_work_us)) {
+      goto done;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_BENCHMARK_MIN_EFFICIENCY, NULL)) {
+      settings.min_efficiency = g_key_file_get_double(key_file, group,
+                                                      CONFIG_BENCHMARK_MIN_EFFICIENCY, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_BENCHMARK_STAND_IN, NULL)) {
+      settings.stand_in = g_key_file_get_boolean(key_file, group, CONFIG_BENCHMARK_STAND_IN, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_BENCHMARK_CODEC, NULL)) {
+      text = g_key_file_get_string(key_file, group, CONFIG_BENCHMARK_CODEC, &error);
+      CHECK_ERROR(error);
+      settings.codec = text;
+      g_free(text);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_BENCHMARK_CSV_FILE, NULL)) {
+      text = g_key_file_get_string(key_file, group, CONFIG_BENCHMARK_CSV_FILE, &error);
+      CHECK_ERROR(error);
+      settings.csv_path = text;
+      g_free(text);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_BENCHMARK_JSON_FILE, NULL)) {
+      text = g_key_file_get_string(key_file, group, CONFIG_BENCHMARK_JSON_FILE, &error);
+      CHECK_ERROR(error);
+      settings.json_path = text;
+      g_free(text);
+    }
+
+    if (!settings.width || !settings.height || !settings.fps || !settings.duration_s ||
+        !settings.start_sources || !settings.source_step ||
+        settings.max_sources < settings.start_sources ||
+        (settings.codec != "raw" && settings.codec != "h264" && settings.codec != "h265")) {
+      g_printerr("Invalid benchmark settings in %s\n", BENCHMARK_CONFIG_FILE);
+      goto done;
+    }
+
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+      }
+    return ret;
+  }
+
+  gboolean
+  Hermes::create_synthetic_sources(GstElement *pipeline, GstElement *mux, guint count,
+                                   const BenchmarkSettings &settings) {
+    // encoder, parser and decoder per codec, hardware or software (stand-in)
+    struct CodecElements {
+      const gchar *codec;
+      const gchar *encoder;
+      const gchar *stand_in_encoder;
+      const gchar *parser;
+      const gchar *decoder;
+      const gchar *stand_in_decoder;
+    };
+    static const CodecElements codecs[] = {
+      {"h264", "nvv4l2h264enc", "x264enc", "h264parse", "nvv4l2decoder", "avdec_h264"},
+      {"h265", "nvv4l2h265enc", "x265enc", "h265parse", "nvv4l2decoder", "avdec_h265"},
+    };
+    const CodecElements *codec = NULL;
+    for (const CodecElements &entry : codecs) {
+      if (settings.codec == entry.codec) {
+        codec = &entry;
+      }
+    }
+
+    auto add = [&](const gchar *factory, const gchar *name) -> GstElement * {
+      GstElement *element = gst_element_factory_make(factory, name);
+      if (!element) {
+        g_printerr("%s (%s) could not be created. Exiting.\n", name, factory);
+        return NULL;
+      }
+      gst_bin_add(GST_BIN(pipeline), element);
+      return element;
+    };
+
+    /* One live, moving test pattern is encoded once and decoded once per
+     * source: every source costs what a drone feed costs, a decode, and the
+     * encode is paid a single time. */
+    GstElement *source = add("videotestsrc", "synthetic-source");
+    GstElement *raw_caps = add("capsfilter", "synthetic-caps");
+    if (!source || !raw_caps) {
+      return FALSE;
+    }
+    g_object_set(G_OBJECT(source), "is-live", TRUE, "pattern", 18, NULL);
+    GstCaps *caps = gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "I420",
+                                        "width", G_TYPE_INT, settings.width,
+                                        "height", G_TYPE_INT, settings.height,
+                                        "framerate", GST_TYPE_FRACTION, settings.fps, 1, NULL);
+    g_object_set(G_OBJECT(raw_caps), "caps", caps, NULL);
+    gst_caps_unref(caps);
+    std::vector<GstElement *> chain = {source, raw_caps};
+
+    if (codec && !settings.stand_in) {
+      // the hardware encoder takes NVMM input
+      GstElement *convert = add("nvvideoconvert", "synthetic-convert");
+      GstElement *nvmm_caps = add("capsfilter", "synthetic-nvmm-caps");
+      if (!convert || !nvmm_caps) {
+        return FALSE;
+      }
+      caps = gst_caps_from_string("video/x-raw(" GST_CAPS_FEATURES_NVMM "), format=I420");
+      g_object_set(G_OBJECT(nvmm_caps), "caps", caps, NULL);
+      gst_caps_unref(caps);
+      chain.push_back(convert);
+      chain.push_back(nvmm_caps);
+    }
+    if (codec) {
+      GstElement *encoder = add(settings.stand_in ? codec->stand_in_encoder : codec->encoder,
+                                "synthetic-encoder");
+      GstElement *parser = add(codec->parser, "synthetic-parser");
+      if (!encoder || !parser) {
+        return FALSE;
+      }
+      if (settings.stand_in) {
+        gst_util_set_object_arg(G_OBJECT(encoder), "tune", "zerolatency");
+        gst_util_set_object_arg(G_OBJECT(encoder), "speed-preset", "ultrafast");
+      }
+      // parameter sets with every keyframe, for decoders joining the tee
+      g_object_set(G_OBJECT(parser), "config-interval", -1, NULL);
+      chain.push_back(encoder);
+      chain.push_back(parser);
+    }
+
+    GstElement *tee = add("tee", "synthetic-tee");
+    if (!tee) {
+      return FALSE;
+    }
+    chain.push_back(tee);
+    for (size_t i = 1; i < chain.size(); i++) {
+      if (!gst_element_link(chain[i - 1], chain[i])) {
+        g_printerr("Elements could not be linked: %s -> %s. Exiting.\n",
+                   GST_ELEMENT_NAME(chain[i - 1]), GST_ELEMENT_NAME(chain[i]));
+        return FALSE;
+      }
+    }
+
+    for (guint index = 0; index < count; index++) {
+      gchar name[32] = {};
+      gchar pad_name[16] = {};
+
+      g_snprintf(name, sizeof(name), "synthetic-queue-%02u", index);
+      chain = {tee, add("queue", name)};
+      if (codec) {
+        g_snprintf(name, sizeof(name), "synthetic-decoder-%02u", index);
+        chain.push_back(add(settings.stand_in ? codec->stand_in_decoder : codec->decoder, name));
+      }
+      else if (!settings.stand_in) {
+        // raw frames are uploaded to NVMM for the muxer
+        g_snprintf(name, sizeof(name), "synthetic-convert-%02u", index);
+        chain.push_back(add("nvvideoconvert", name));
+      }
+      for (size_t i = 1; i < chain.size(); i++) {
+        if (!chain[i] || !gst_element_link(chain[i - 1], chain[i])) {
+          g_printerr("Failed to link synthetic source %u\n", index);
+          return FALSE;
+        }
+      }
+
+      g_snprintf(pad_name, 15, "sink_%u", index);
+      GstPad *sinkpad = gst_element_get_request_pad(mux, pad_name);
+      GstPad *srcpad = gst_element_get_static_pad(chain.back(), "src");
+      if (!sinkpad || !srcpad || gst_pad_link(srcpad, sinkpad) != GST_PAD_LINK_OK) {
+        g_printerr("Failed to link synthetic source %u to the muxer\n", index);
+        return FALSE;
+      }
+      gst_object_unref(srcpad);
+      gst_object_unref(sinkpad);
+    }
+    return TRUE;
+  }
+
+  GstPadProbeReturn
+  Hermes::benchmark_stage_entry_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    StageProbe *stage = (StageProbe *)u_data;
+    std::lock_guard<std::mutex> guard(stage->lock);
+    stage->entries.push_back(g_get_monotonic_time());
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstPadProbeReturn
+  Hermes::benchmark_stage_exit_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    StageProbe *stage = (StageProbe *)u_data;
+    gint64 now = g_get_monotonic_time();
+    std::lock_guard<std::mutex> guard(stage->lock);
+    if (stage->entries.empty()) {
+      // a buffer made by the stage itself
+      return GST_PAD_PROBE_OK;
+    }
+    if (benchmark_measuring) {
+      stage->samples_us.push_back(now - stage->entries.front());
+    }
+    stage->entries.pop_front();
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstPadProbeReturn
+  Hermes::benchmark_sink_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    GstBuffer *buf = (GstBuffer *)info->data;
+    StageProbe *pipeline_latency = (StageProbe *)u_data;
+
+    if (!benchmark_measuring) {
+      return GST_PAD_PROBE_OK;
+    }
+
+    // Live sources stamp frames with the running time they were captured at
+    GstClock *clock = gst_element_get_clock(benchmark_pipeline);
+    if (!clock) {
+      return GST_PAD_PROBE_OK;
+    }
+    GstClockTime now = gst_clock_get_time(clock) - gst_element_get_base_time(benchmark_pipeline);
+    gst_object_unref(clock);
+
+    std::vector<GstClockTime> capture_times;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    if (batch_meta) {
+      for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+          l_frame = l_frame->next) {
+        capture_times.push_back(((NvDsFrameMeta *)l_frame->data)->buf_pts);
+      }
+    }
+    else {
+      // stand-in pipelines carry one frame per buffer
+      capture_times.push_back(GST_BUFFER_PTS(buf));
+    }
+
+    benchmark_frames += capture_times.size();
+    std::lock_guard<std::mutex> guard(pipeline_latency->lock);
+    for (GstClockTime capture_time : capture_times) {
+      if (GST_CLOCK_TIME_IS_VALID(capture_time) && now > capture_time) {
+        pipeline_latency->samples_us.push_back(GST_TIME_AS_USECONDS(now - capture_time));
+      }
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  gboolean
+  Hermes::benchmark_start_measuring(gpointer data) {
+    BenchmarkWindow *window = (BenchmarkWindow *)data;
+    for (StageProbe &stage : benchmark_stages) {
+      std::lock_guard<std::mutex> guard(stage.lock);
+      stage.samples_us.clear();
+    }
+    benchmark_frames = 0;
+    getrusage(RUSAGE_SELF, &window->start_usage);
+    window->start_us = g_get_monotonic_time();
+    benchmark_measuring = TRUE;
+    return G_SOURCE_REMOVE;
+  }
+
+  gboolean
+  Hermes::benchmark_stop(gpointer data) {
+    BenchmarkWindow *window = (BenchmarkWindow *)data;
+    benchmark_measuring = FALSE;
+    window->end_us = g_get_monotonic_time();
+    getrusage(RUSAGE_SELF, &window->end_usage);
+    window->finished = TRUE;
+    g_main_loop_quit(window->loop);
+    return G_SOURCE_REMOVE;
+  }
+
+  gboolean
+  Hermes::run_benchmark_step(guint count, const BenchmarkSettings &settings, BenchmarkStep &step) {
+    gboolean ret = FALSE;
+    BenchmarkWindow window;
+    std::map<std::string, GstElement *> elements;
+    guint warmup_id, stop_id, bus_watch_id;
+    GstBus *bus = NULL;
+
+    GstElement *pipeline = gst_pipeline_new("hermes-benchmark-pipeline");
+    // A funnel stands in for the batching of nvstreammux
+    GstElement *mux = gst_element_factory_make(settings.stand_in ? "funnel" : "nvstreammux",
+                                               "stream-muxer");
+    if (!pipeline || !mux) {
+      g_printerr("One element could not be created. Exiting.\n");
+      return FALSE;
+    }
+    gst_bin_add(GST_BIN(pipeline), mux);
+
+    num_sources = count;
+    setPaths(count);
+    if (!load_threading_config() ||
+        !create_synthetic_sources(pipeline, mux, count, settings)) {
+      gst_object_unref(pipeline);
+      return FALSE;
+    }
+
+    // Headless: drawing is not part of what a box can sustain
+    TopologySpec topology = get_topology(TRUE, 0);
+    if (settings.stand_in) {
+      for (StageSpec &stage : topology.stages) {
+        stage.factory = "identity";
+      }
+    }
+    if (!build_topology(pipeline, mux, topology, elements)) {
+      gst_object_unref(pipeline);
+      return FALSE;
+    }
+
+    if (settings.stand_in) {
+      g_object_set(G_OBJECT(elements[PGIE_ELEMENT_NAME]), "sleep-time",
+                   settings.stand_in_work_us, NULL);
+    }
+    else if (configure_element_properties(count, mux, elements[PGIE_ELEMENT_NAME],
+                                          elements[TRACKER_ELEMENT_NAME], NULL, NULL) == -1) {
+      gst_object_unref(pipeline);
+      return FALSE;
+    }
+    else {
+      attach_slicing_probes(elements[PGIE_ELEMENT_NAME]);
+    }
+    if (count == settings.start_sources) {
+      report_stage_threads();
+    }
+
+    // Stage latencies, then the whole pipeline at the analytics sink
+    benchmark_stages.clear();
+    for (const StageSpec &stage : topology.stages) {
+      benchmark_stages.emplace_back();
+      benchmark_stages.back().name = stage.name;
+      GstPad *sink_pad = gst_element_get_static_pad(elements[stage.name], "sink");
+      GstPad *src_pad = gst_element_get_static_pad(elements[stage.name], "src");
+      gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                        benchmark_stage_entry_probe, &benchmark_stages.back(), NULL);
+      gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                        benchmark_stage_exit_probe, &benchmark_stages.back(), NULL);
+      gst_object_unref(sink_pad);
+      gst_object_unref(src_pad);
+    }
+    benchmark_stages.emplace_back();
+    benchmark_stages.back().name = "pipeline";
+    const BranchSpec &analytics = topology.branches.front();
+    GstPad *analytics_pad = gst_element_get_static_pad(elements[analytics.stages.back().name], "sink");
+    gst_pad_add_probe(analytics_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                      benchmark_sink_probe, &benchmark_stages.back(), NULL);
+    gst_object_unref(analytics_pad);
+
+    benchmark_pipeline = pipeline;
+    benchmark_measuring = FALSE;
+    window.loop = g_main_loop_new(NULL, FALSE);
+
+    bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+    bus_watch_id = gst_bus_add_watch(bus, bus_call, window.loop);
+    gst_bus_set_sync_handler(bus, stream_status_handler, NULL, NULL);
+    gst_object_unref(bus);
+
+    warmup_id = g_timeout_add_seconds(settings.warmup_s, benchmark_start_measuring, &window);
+    stop_id = g_timeout_add_seconds(settings.warmup_s + settings.duration_s, benchmark_stop, &window);
+
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    g_main_loop_run(window.loop);
+    benchmark_measuring = FALSE;
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+
+    // an error or EOS ends the loop before the window does
+    if (!window.finished) {
+      g_source_remove(stop_id);
+      if (window.start_us == 0) {
+        g_source_remove(warmup_id);
+      }
+      g_printerr("Benchmark with %u sources stopped early\n", count);
+    }
+    else {
+      step.sources = count;
+      step.duration_s = (window.end_us - window.start_us) / (gdouble)G_USEC_PER_SEC;
+      step.frames = benchmark_frames;
+      step.expected_frames = (guint64)(step.duration_s * settings.fps * count);
+      gdouble cpu_us =
+          (window.end_usage.ru_utime.tv_sec - window.start_usage.ru_utime.tv_sec +
+           window.end_usage.ru_stime.tv_sec - window.start_usage.ru_stime.tv_sec) * 1e6 +
+          (window.end_usage.ru_utime.tv_usec - window.start_usage.ru_utime.tv_usec +
+           window.end_usage.ru_stime.tv_usec - window.start_usage.ru_stime.tv_usec);
+      step.cpu_percent = 100.0 * cpu_us / (window.end_us - window.start_us);
+      step.stages.clear();
+      for (StageProbe &stage : benchmark_stages) {
+        step.stages.push_back({stage.name, latency_percentiles(stage.samples_us)});
+      }
+      ret = TRUE;
+    }
+
+    g_source_remove(bus_watch_id);
+    g_main_loop_unref(window.loop);
+    gst_object_unref(GST_OBJECT(pipeline));
+    benchmark_pipeline = NULL;
+    benchmark_stages.clear();
+    return ret;
+  }
+
+  int
+  Hermes::run_benchmark() {
+    BenchmarkSettings settings;
+    std::vector<BenchmarkStep> steps;
+
+    if (!read_benchmark_settings(settings) || !load_slicing_config()) {
+      return -1;
+    }
+    g_print("Benchmark: %ux%u@%u %s sources, %u to %u, %us per step%s\n", settings.width,
+            settings.height, settings.fps, settings.codec.c_str(), settings.start_sources,
+            settings.max_sources, settings.duration_s,
+            settings.stand_in ? ", stand-in elements" : "");
+
+    for (guint count = settings.start_sources; count <= settings.max_sources;
+         count += settings.source_step) {
+      BenchmarkStep step;
+      if (!run_benchmark_step(count, settings, step)) {
+        break;
+      }
+      steps.push_back(step);
+      g_print("Sources: %u | FPS: %.1f (%.0f%% of nominal) | dropped: %lu | "
+              "latency p99: %.1f ms | CPU: %.0f%%\n", count, step.throughput_fps(),
+              step.efficiency() * 100, (gulong)step.dropped_frames(),
+              step.stages.back().latency.p99_ms, step.cpu_percent);
+
+      // Rewritten every step, an interrupted sweep still leaves its results
+      if (!write_benchmark_file(settings.csv_path, benchmark_csv(settings, steps)) ||
+          !write_benchmark_file(settings.json_path, benchmark_json(settings, steps))) {
+        g_printerr("Could not write %s or %s\n", settings.csv_path.c_str(),
+                   settings.json_path.c_str());
+        return -1;
+      }
+      if (sweep_past_knee(steps, settings.min_efficiency)) {
+        break;
+      }
+    }
+
+    if (steps.empty()) {
+      g_printerr("Benchmark did not complete a single step\n");
+      return -1;
+    }
+    g_print("Sustained sources: %u, results in %s and %s\n",
+            knee_sources(steps, settings.min_efficiency), settings.csv_path.c_str(),
+            settings.json_path.c_str());
+    return 0;
+  }
+
+  gboolean
+  Hermes::read_pose(GKeyFile *key_file, const gchar *group, DronePose &pose) {
+    GError *error = NULL;
+
+    // Only the keys present change the pose
+    auto read_double = [&](const gchar *key, double &value) -> gboolean {
+      if (g_key_file_has_key(key_file, group, key, NULL)) {
+        gdouble number = g_key_file_get_double(key_file, group, key, &error);
+        if (error) {
+          g_printerr("Invalid %s in [%s]\n", key, group);
+          g_error_free(error);
+          return FALSE;
+        }
+        value = number;
+      }
+      return TRUE;
+    };
+
+    return read_double(CONFIG_POSE_LATITUDE, pose.position.latitude) &&
+           read_double(CONFIG_POSE_LONGITUDE, pose.position.longitude) &&
+           read_double(CONFIG_POSE_ALTITUDE, pose.height_m) &&
+           read_double(CONFIG_POSE_YAW, pose.yaw_deg) &&
+           read_double(CONFIG_POSE_PITCH, pose.pitch_deg);
+  }
+
+  gboolean
+  Hermes::read_camera(GKeyFile *key_file, const gchar *group, SourcePose &source) {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gdouble hfov = 0;
+
+    if (g_key_file_has_key(key_file, group, CONFIG_FIRE_MAP_WIDTH, NULL)) {
+      source.width = g_key_file_get_integer(key_file, group, CONFIG_FIRE_MAP_WIDTH, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_FIRE_MAP_HEIGHT, NULL)) {
+      source.height = g_key_file_get_integer(key_file, group, CONFIG_FIRE_MAP_HEIGHT, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_FIRE_MAP_HFOV, NULL)) {
+      hfov = g_key_file_get_double(key_file, group, CONFIG_FIRE_MAP_HFOV, &error);
+      CHECK_ERROR(error);
+      if (hfov <= 0 || hfov >= 180) {
+        g_printerr("Invalid %s in [%s]\n", CONFIG_FIRE_MAP_HFOV, group);
+        goto done;
+      }
+    }
+    if (!source.width || !source.height) {
+      g_printerr("No camera %s and %s in [%s]\n", CONFIG_FIRE_MAP_WIDTH, CONFIG_FIRE_MAP_HEIGHT,
+                 group);
+      goto done;
+    }
+    if (hfov > 0) {
+      source.camera = intrinsics_from_fov(source.width, source.height, hfov);
+    }
+
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+    return ret;
+  }
+
+  gboolean
+  Hermes::load_fire_map_config() {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar **groups = NULL;
+    gchar *pose_file = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    const gchar *group = CONFIG_GROUP_FIRE_MAP;
+    SourcePose defaults;
+    // Tello camera, most sources are one
+    defaults.width = 960;
+    defaults.height = 720;
+    defaults.camera = intrinsics_from_fov(defaults.width, defaults.height, 82.6);
+
+    fire_map_enabled = FALSE;
+    source_poses.clear();
+
+    if (!g_key_file_load_from_file(key_file, FIRE_MAP_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      // The fire map is optional
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    if (g_key_file_has_key(key_file, group, CONFIG_FIRE_MAP_ENABLE, NULL)) {
+      fire_map_enabled = g_key_file_get_integer(key_file, group, CONFIG_FIRE_MAP_ENABLE, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_FIRE_MAP_MERGE_RADIUS, NULL)) {
+      fire_map_params.merge_radius_m = g_key_file_get_double(key_file, group,
+                                                             CONFIG_FIRE_MAP_MERGE_RADIUS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_FIRE_MAP_DECAY, NULL)) {
+      fire_map_params.decay_s = g_key_file_get_double(key_file, group, CONFIG_FIRE_MAP_DECAY,
+                                                      &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_FIRE_MAP_MIN_WEIGHT, NULL)) {
+      fire_map_params.min_weight = g_key_file_get_double(key_file, group,
+                                                         CONFIG_FIRE_MAP_MIN_WEIGHT, &error);
+      CHECK_ERROR(error);
+    }
+    if (fire_map_params.merge_radius_m <= 0 || fire_map_params.decay_s <= 0 ||
+        fire_map_params.min_weight <= 0) {
+      g_printerr("Invalid fire map settings in %s\n", FIRE_MAP_CONFIG_FILE);
+      goto done;
+    }
+    if (g_key_file_has_group(key_file, group) && !read_camera(key_file, group, defaults)) {
+      goto done;
+    }
+
+    // [source-N] groups place the N-th source in inputsources.txt
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (gchar **source_group = groups; *source_group; source_group++) {
+      guint source_id;
+      if (sscanf(*source_group, CONFIG_GROUP_FIRE_MAP_SOURCE, &source_id) != 1) {
+        continue;
+      }
+      SourcePose source = defaults;
+      if (!read_camera(key_file, *source_group, source) ||
+          !read_pose(key_file, *source_group, source.pose)) {
+        goto done;
+      }
+      if (g_key_file_has_key(key_file, *source_group, CONFIG_FIRE_MAP_POSE_FILE, NULL)) {
+        pose_file = g_key_file_get_string(key_file, *source_group, CONFIG_FIRE_MAP_POSE_FILE,
+                                          &error);
+        CHECK_ERROR(error);
+        source.pose_file = pose_file;
+        g_free(pose_file);
+        pose_file = NULL;
+      }
+      source_poses[source_id] = source;
+    }
+
+    fire_map = FireMap(fire_map_params);
+    if (fire_map_enabled) {
+      g_print("Fire map: %zu sources placed, merge radius %.0f m, decay %.0f s\n",
+              source_poses.size(), fire_map_params.merge_radius_m, fire_map_params.decay_s);
+    }
+
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      if (groups) {
+        g_strfreev(groups);
+      }
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+        fire_map_enabled = FALSE;
+      }
+    return ret;
+  }
+
+  gboolean
+  Hermes::refresh_poses(gpointer data) {
+    for (auto &entry : source_poses) {
+      SourcePose &source = entry.second;
+      struct stat status;
+      if (source.pose_file.empty() || stat(source.pose_file.c_str(), &status) != 0) {
+        continue;
+      }
+      gint64 mtime = (gint64)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+      if (mtime == source.pose_mtime) {
+        continue;
+      }
+
+      GKeyFile *key_file = g_key_file_new();
+      DronePose pose = source.pose;
+      // a half written file is read again on the next poll
+      if (g_key_file_load_from_file(key_file, source.pose_file.c_str(), G_KEY_FILE_NONE, NULL) &&
+          read_pose(key_file, CONFIG_GROUP_POSE, pose)) {
+        std::lock_guard<std::mutex> guard(fire_map_lock);
+        source.pose = pose;
+        source.pose_mtime = mtime;
+      }
+      g_key_file_free(key_file);
+    }
+    return G_SOURCE_CONTINUE;
+  }
+
+  void
+  Hermes::map_fire_detections(const FrameRecord &frame) {
+    auto entry = source_poses.find(frame.source_id);
+    if (entry == source_poses.end() || frame.objects.empty()) {
+      return;
+    }
+    gint64 now = g_get_monotonic_time();
+
+    std::lock_guard<std::mutex> guard(fire_map_lock);
+    const SourcePose &source = entry->second;
+    double scale_x, scale_y;
+    muxer_to_source_scale(muxer_geometry, source.width, source.height, scale_x, scale_y);
+    for (const ObjectRecord &box : frame.objects) {
+      if (box.class_id != FIRE) {
+        continue;
+      }
+      // Boxes are in muxer resolution, the fire touches the ground at the bottom centre
+      double u = (box.left + box.width / 2) * scale_x;
+      double v = (box.top + box.height) * scale_y;
+      GeoPoint ground;
+      if (!project_to_ground(source.camera, source.pose, u, v, ground)) {
+        continue;
+      }
+      FireObservation observation = fire_map.insert(ground, frame.source_id, now);
+      if (observation.new_cluster) {
+        HERMES_LOG(LOG_LEVEL_INFO, "New fire",
+                   log_field("fire", observation.cluster_id),
+                   log_field("latitude", ground.latitude), log_field("longitude", ground.longitude),
+                   log_field("source", frame.source_id));
+      }
+    }
+  }
+
+  gboolean
+  Hermes::report_fire_map(gpointer data) {
+    std::vector<FireCluster> clusters;
+    {
+      std::lock_guard<std::mutex> guard(fire_map_lock);
+      fire_map.expire(g_get_monotonic_time());
+      clusters = fire_map.clusters(g_get_monotonic_time());
+    }
+    for (const FireCluster &cluster : clusters) {
+      g_print("Fire %lu | %.6f, %.6f | weight: %.1f | observations: %lu | sources: %d\n",
+              (gulong)cluster.id, cluster.position.latitude, cluster.position.longitude,
+              cluster.weight, (gulong)cluster.observations, __builtin_popcountll(cluster.sources));
+    }
+    return G_SOURCE_CONTINUE;
+  }
+
+  gboolean
+  Hermes::load_heatmap_config() {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar *export_dir = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    const gchar *group = CONFIG_GROUP_HEATMAP;
+
+    heatmap_enabled = FALSE;
+
+    if (!g_key_file_load_from_file(key_file, HEATMAP_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      // Heatmaps are optional
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    if (g_key_file_has_key(key_file, group, CONFIG_HEATMAP_ENABLE, NULL)) {
+      heatmap_enabled = g_key_file_get_integer(key_file, group, CONFIG_HEATMAP_ENABLE, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_HEATMAP_WIDTH, NULL)) {
+      heatmap_params.width = g_key_file_get_integer(key_file, group, CONFIG_HEATMAP_WIDTH, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_HEATMAP_HEIGHT, NULL)) {
+      heatmap_params.height = g_key_file_get_integer(key_file, group, CONFIG_HEATMAP_HEIGHT,
+                                                     &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_HEATMAP_DECAY, NULL)) {
+      heatmap_params.decay_s = g_key_file_get_double(key_file, group, CONFIG_HEATMAP_DECAY, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_HEATMAP_OVERLAY, NULL)) {
+      heatmap_overlay = g_key_file_get_integer(key_file, group, CONFIG_HEATMAP_OVERLAY, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_HEATMAP_THRESHOLD, NULL)) {
+      heatmap_threshold = g_key_file_get_double(key_file, group, CONFIG_HEATMAP_THRESHOLD, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_HEATMAP_EXPORT_DIR, NULL)) {
+      export_dir = g_key_file_get_string(key_file, group, CONFIG_HEATMAP_EXPORT_DIR, &error);
+      CHECK_ERROR(error);
+      heatmap_export_dir = export_dir;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_HEATMAP_REPORT_INTERVAL, NULL)) {
+      heatmap_report_interval = g_key_file_get_integer(key_file, group,
+                                                       CONFIG_HEATMAP_REPORT_INTERVAL, &error);
+      CHECK_ERROR(error);
+    }
+    if (heatmap_params.width < 1 || heatmap_params.height < 1 || heatmap_params.decay_s <= 0 ||
+        heatmap_threshold <= 0 || heatmap_report_interval < 1) {
+      g_printerr("Invalid heatmap settings in %s\n", HEATMAP_CONFIG_FILE);
+      goto done;
+    }
+
+    if (heatmap_enabled && !heatmap_export_dir.empty()) {
+      boost::system::error_code mkdir_error;
+      boost::filesystem::create_directories(heatmap_export_dir, mkdir_error);
+      if (mkdir_error) {
+        g_printerr("Could not create %s: %s\n", heatmap_export_dir.c_str(),
+                   mkdir_error.message().c_str());
+        goto done;
+      }
+    }
+
+    heatmaps.clear();
+    if (heatmap_enabled) {
+      g_print("Heatmap: %ux%u cells per source, decay %.0f s%s\n", heatmap_params.width,
+              heatmap_params.height, heatmap_params.decay_s, heatmap_overlay ? ", drawn" : "");
+    }
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      g_free(export_dir);
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+        heatmap_enabled = FALSE;
+      }
+    return ret;
+  }
+
+  void
+  Hermes::accumulate_heatmap(const FrameRecord &frame) {
+    gint64 now = g_get_monotonic_time();
+    gfloat scale_x = 1.0f / muxer_geometry.width;
+    gfloat scale_y = 1.0f / muxer_geometry.height;
+
+    std::lock_guard<std::mutex> guard(heatmap_lock);
+    auto entry = heatmaps.find(frame.source_id);
+    if (entry == heatmaps.end()) {
+      entry = heatmaps.emplace(frame.source_id, Heatmap(heatmap_params)).first;
+    }
+    Heatmap &heatmap = entry->second;
+    // Every frame decays the map, with or without fire
+    heatmap.begin_frame(now);
+    for (const ObjectRecord &box : frame.objects) {
+      if (box.class_id != FIRE) {
+        continue;
+      }
+      // Frames the detector skips (interval) only carry the tracker's confidence
+      gfloat confidence = box.confidence > 0 ? box.confidence : box.tracker_confidence;
+      heatmap.add(box.left * scale_x, box.top * scale_y, box.width * scale_x,
+                  box.height * scale_y, confidence);
+    }
+  }
+
+  void
+  Hermes::add_heatmap_display_meta(gpointer batch_meta_data, gpointer frame_meta_data) {
+    NvDsBatchMeta *batch_meta = (NvDsBatchMeta *)batch_meta_data;
+    NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)frame_meta_data;
+    std::vector<HeatmapRun> runs;
+    {
+      std::lock_guard<std::mutex> guard(heatmap_lock);
+      auto entry = heatmaps.find(frame_meta->source_id);
+      if (entry == heatmaps.end()) {
+        return;
+      }
+      // A cell at full scale saw fire at confidence 1 for a while
+      runs = heatmap_runs(entry->second, heatmap_threshold, 1.0, HEATMAP_OVERLAY_LEVELS,
+                          HEATMAP_MAX_OVERLAY_RECTS);
+    }
+
+    // Drawn in muxer resolution, the tiler scales them with the boxes
+    gfloat cell_width = (gfloat)muxer_geometry.width / heatmap_params.width;
+    gfloat cell_height = (gfloat)muxer_geometry.height / heatmap_params.height;
+    NvDsDisplayMeta *display_meta = NULL;
+    for (const HeatmapRun &run : runs) {
+      if (!display_meta || display_meta->num_rects == MAX_ELEMENTS_IN_DISPLAY_META) {
+        display_meta = nvds_acquire_display_meta_from_pool(batch_meta);
+        nvds_add_display_meta_to_frame(frame_meta, display_meta);
+      }
+      NvOSD_RectParams &rect = display_meta->rect_params[display_meta->num_rects++];
+      rect.left = run.first * cell_width;
+      rect.top = run.row * cell_height;
+      rect.width = (run.last - run.first) * cell_width;
+      rect.height = cell_height;
+
+      // yellow to red as the cells get hotter
+      gdouble heat = (gdouble)run.level / HEATMAP_OVERLAY_LEVELS;
+      NvOSD_ColorParams color = {1.0, 1.0 - heat, 0.0, 0.15 + 0.25 * heat};
+    #ifndef PLATFORM_TEGRA
+      rect.border_width = 0;
+      rect.has_bg_color = 1;
+      rect.bg_color = color;
+    #else
+      rect.border_width = 1;
+      rect.border_color = color;
+    #endif
+    }
+  }
+
+  gboolean
+  Hermes::report_heatmaps(gpointer data) {
+    std::vector<std::pair<guint, std::string>> exports;
+    {
+      std::lock_guard<std::mutex> guard(heatmap_lock);
+      for (const auto &entry : heatmaps) {
+        guint x, y;
+        gfloat peak = entry.second.peak(x, y);
+        g_print("Heatmap: source %u | peak: %.2f at %u,%u | hot cells: %lu\n", entry.first,
+                peak, x, y, (gulong)entry.second.count_above(heatmap_threshold));
+        if (!heatmap_export_dir.empty()) {
+          exports.emplace_back(entry.first, heatmap_pgm(entry.second, 1.0));
+        }
+      }
+    }
+
+    // Replaced whole, a dashboard never reads half a map
+    for (const auto &map : exports) {
+      gchar *name = g_strdup_printf(HEATMAP_FILE_PATTERN, map.first);
+      std::string path = (boost::filesystem::path(heatmap_export_dir) / name).string();
+      GError *error = NULL;
+      if (!g_file_set_contents(path.c_str(), map.second.data(), map.second.size(), &error)) {
+        HERMES_LOG(LOG_LEVEL_WARNING, "Could not export heatmap", log_field("path", path.c_str()),
+                   log_field("error", error->message));
+        g_error_free(error);
+      }
+      g_free(name);
+    }
+    return G_SOURCE_CONTINUE;
+  }
+
+  gboolean
+  Hermes::load_event_config() {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar *text = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    const gchar *group = CONFIG_GROUP_EVENTS;
+    gdouble seconds;
+
+    events_enabled = FALSE;
+
+    if (!g_key_file_load_from_file(key_file, EVENT_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      // Event clips are optional
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    if (g_key_file_has_key(key_file, group, CONFIG_EVENTS_ENABLE, NULL)) {
+      events_enabled = g_key_file_get_integer(key_file, group, CONFIG_EVENTS_ENABLE, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_EVENTS_PRE_EVENT, NULL)) {
+      seconds = g_key_file_get_double(key_file, group, CONFIG_EVENTS_PRE_EVENT, &error);
+      CHECK_ERROR(error);
+      event_ring_params.pre_event_us = (gint64)(seconds * G_USEC_PER_SEC);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_EVENTS_POST_EVENT, NULL)) {
+      seconds = g_key_file_get_double(key_file, group, CONFIG_EVENTS_POST_EVENT, &error);
+      CHECK_ERROR(error);
+      event_post_us = (gint64)(seconds * G_USEC_PER_SEC);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_EVENTS_MAX_CLIP, NULL)) {
+      seconds = g_key_file_get_double(key_file, group, CONFIG_EVENTS_MAX_CLIP, &error);
+      CHECK_ERROR(error);
+      event_max_clip_us = (gint64)(seconds * G_USEC_PER_SEC);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_EVENTS_RING_SIZE, NULL)) {
+      // megabytes
+      event_ring_params.max_bytes =
+          (size_t)(g_key_file_get_double(key_file, group, CONFIG_EVENTS_RING_SIZE, &error) *
+                   (1 << 20));
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_EVENTS_CONTAINER, NULL)) {
+      text = g_key_file_get_string(key_file, group, CONFIG_EVENTS_CONTAINER, &error);
+      CHECK_ERROR(error);
+      event_container = text;
+      g_free(text);
+      text = NULL;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_EVENTS_OUTPUT_DIR, NULL)) {
+      text = g_key_file_get_string(key_file, group, CONFIG_EVENTS_OUTPUT_DIR, &error);
+      CHECK_ERROR(error);
+      event_output_dir = text;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_EVENTS_TRIGGER_CONFIDENCE, NULL)) {
+      event_trigger_confidence = g_key_file_get_double(key_file, group,
+                                                       CONFIG_EVENTS_TRIGGER_CONFIDENCE, &error);
+      CHECK_ERROR(error);
+    }
+    if (event_ring_params.pre_event_us < 0 || event_post_us < 0 ||
+        event_max_clip_us <= event_ring_params.pre_event_us ||
+        event_ring_params.max_bytes < (1 << 20) ||
+        (event_container != "mp4" && event_container != "mkv")) {
+      g_printerr("Invalid event settings in %s\n", EVENT_CONFIG_FILE);
+      goto done;
+    }
+
+    if (events_enabled) {
+      boost::system::error_code mkdir_error;
+      boost::filesystem::create_directories(event_output_dir, mkdir_error);
+      if (mkdir_error) {
+        g_printerr("Could not create %s: %s\n", event_output_dir.c_str(),
+                   mkdir_error.message().c_str());
+        goto done;
+      }
+      g_print("Event clips: %.0f s before and %.0f s after a fire, %s in %s, "
+              "%.0f MB of ring per source\n",
+              event_ring_params.pre_event_us / 1e6, event_post_us / 1e6, event_container.c_str(),
+              event_output_dir.c_str(), event_ring_params.max_bytes / (double)(1 << 20));
+    }
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      g_free(text);
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+        events_enabled = FALSE;
+      }
+    return ret;
+  }
+
+  void
+  Hermes::attach_event_ring(GstElement *parser, GstElement *source_bin) {
+    guint index;
+    if (sscanf(GST_ELEMENT_NAME(source_bin), "source-bin-%u", &index) != 1) {
+      return;
+    }
+
+    EventSource *source = NULL;
+    {
+      std::lock_guard<std::mutex> guard(events_lock);
+      auto entry = event_sources.find(index);
+      if (entry == event_sources.end()) {
+        entry = event_sources.try_emplace(index).first;
+        entry->second.index = index;
+        entry->second.ring = EventRing(event_ring_params);
+      }
+      source = &entry->second;
+    }
+    {
+      // Again on every reconnect, with a new parser
+      std::lock_guard<std::mutex> guard(source->lock);
+      source->parser = GST_OBJECT_NAME(gst_element_get_factory(parser));
+    }
+
+    // Parameter sets before every keyframe, a clip can start at any of them
+    g_object_set(G_OBJECT(parser), "config-interval", -1, NULL);
+    GstPad *parser_src_pad = gst_element_get_static_pad(parser, "src");
+    gst_pad_add_probe(parser_src_pad,
+                      (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER |
+                                        GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                      event_packet_probe, source, NULL);
+    gst_object_unref(parser_src_pad);
+    HERMES_LOG(LOG_LEVEL_DEBUG, "Event ring attached", log_field("source", index),
+               log_field("parser", GST_ELEMENT_NAME(parser)));
+  }
+
+  GstPadProbeReturn
+  Hermes::event_packet_probe(GstPad *pad, GstPadProbeInfo *info,
+                            gpointer u_data) {
+    EventSource *source = (EventSource *)u_data;
+
+    if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+      GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
+      if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+        GstCaps *caps = NULL;
+        gst_event_parse_caps(event, &caps);
+        std::lock_guard<std::mutex> guard(source->lock);
+        // Packets of other parameters do not go in the same clip
+        if (source->caps && !gst_caps_is_equal(source->caps, caps)) {
+          source->ring.clear();
+          source->record_until_us = 0;
+          source->wake.notify_one();
+        }
+        gst_caps_replace(&source->caps, caps);
+      }
+      return GST_PAD_PROBE_OK;
+    }
+
+    // A reference, the bytes stay where the parser put them
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    EventPacket packet;
+    packet.data = std::shared_ptr<const void>(gst_buffer_ref(buffer), [](const void *data) {
+      gst_buffer_unref((GstBuffer *)data);
+    });
+    packet.size = gst_buffer_get_size(buffer);
+    packet.keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    packet.arrival_us = g_get_monotonic_time();
+
+    std::lock_guard<std::mutex> guard(source->lock);
+    source->ring.push(packet);
+    if (source->record_until_us) {
+      if (packet.arrival_us > source->record_until_us) {
+        source->record_until_us = 0;
+      }
+      else if (source->pending_bytes + packet.size > event_ring_params.max_bytes) {
+        // Cut short rather than hold more than a ring
+        source->record_until_us = 0;
+        source->truncated++;
+      }
+      else {
+        source->pending.push_back(packet);
+        source->pending_bytes += packet.size;
+      }
+      source->wake.notify_one();
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  void
+  Hermes::note_fire_event(const FrameRecord &frame) {
+    // Rejected tracks were removed by the classifier, what is left is fire
+    for (const ObjectRecord &object : frame.objects) {
+      if (object.class_id != FIRE) {
+        continue;
+      }
+      gfloat confidence = object.confidence > 0 ? object.confidence : object.tracker_confidence;
+      if (confidence >= event_trigger_confidence) {
+        trigger_event(frame.source_id, "fire");
+        return;
+      }
+    }
+  }
+
+  void
+  Hermes::trigger_event(guint source_id, const gchar *reason) {
+    EventSource *source = NULL;
+    {
+      std::lock_guard<std::mutex> guard(events_lock);
+      auto entry = event_sources.find(source_id);
+      if (entry == event_sources.end()) {
+        // shm:// or a source not parsed yet, nothing compressed to cut from
+        return;
+      }
+      source = &entry->second;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    std::lock_guard<std::mutex> guard(source->lock);
+    if (source->record_until_us) {
+      // Fire still seen, the clip goes on
+      source->record_until_us = MIN(now + event_post_us, source->record_limit_us);
+      return;
+    }
+    if (source->recording || !source->caps || !source->ring.packets()) {
+      // the previous clip is being finished, or no keyframe yet
+      return;
+    }
+    // the previous recorder is done
+    if (source->recorder.joinable()) {
+      source->recorder.join();
+    }
+
+    std::vector<EventPacket> packets = source->ring.snapshot();
+    source->pending.assign(packets.begin(), packets.end());
+    source->pending_bytes = source->ring.bytes();
+    source->record_limit_us = packets.front().arrival_us + event_max_clip_us;
+    source->record_until_us = MIN(now + event_post_us, source->record_limit_us);
+
+    GDateTime *time = g_date_time_new_now_local();
+    gchar *stamp = g_date_time_format(time, "%Y%m%d-%H%M%S");
+    gchar *name = g_strdup_printf("source%02u_%s.%s", source_id, stamp, event_container.c_str());
+    source->clip_path = (boost::filesystem::path(event_output_dir) / name).string();
+    g_free(name);
+    g_free(stamp);
+    g_date_time_unref(time);
+
+    source->recording = TRUE;
+    source->recorder = std::thread(record_event_clip, source);
+    HERMES_LOG(LOG_LEVEL_INFO, "Recording event clip", log_field("source", source_id),
+               log_field("reason", reason), log_field("path", source->clip_path.c_str()),
+               log_field("pre_event_s", (now - packets.front().arrival_us) / 1e6));
+  }
+
+  gboolean
+  Hermes::manual_event(gpointer data) {
+    // kill -USR1, to try the clips with a file or a test RTSP server
+    std::vector<guint> indices;
+    {
+      std::lock_guard<std::mutex> guard(events_lock);
+      for (const auto &entry : event_sources) {
+        indices.push_back(entry.first);
+      }
+    }
+    for (guint index : indices) {
+      trigger_event(index, "manual");
+    }
+    return G_SOURCE_CONTINUE;
+  }
+
+  void
+  Hermes::record_event_clip(EventSource *source) {
+    GstElement *pipeline = NULL, *appsrc = NULL, *parser = NULL, *muxer = NULL, *filesink = NULL;
+    GstClockTime base = GST_CLOCK_TIME_NONE;
+    guint64 written = 0;
+    gboolean ok = FALSE;
+    gboolean added = FALSE;
+    GstCaps *caps = NULL;
+    std::string path, parser_name;
+    std::string error_text;
+
+    // The source's streaming thread takes the lock for every packet, it is
+    // only held here to move packets, never while the pipeline changes state
+    std::unique_lock<std::mutex> lock(source->lock);
+    path = source->clip_path;
+    parser_name = source->parser;
+    caps = source->caps ? gst_caps_ref(source->caps) : NULL;
+    lock.unlock();
+
+    pipeline = gst_pipeline_new("event-clip");
+    appsrc = gst_element_factory_make("appsrc", "event-packets");
+    parser = gst_element_factory_make(parser_name.c_str(), "event-parser");
+    muxer = gst_element_factory_make(event_container == "mkv" ? "matroskamux" : "mp4mux",
+                                     "event-muxer");
+    filesink = gst_element_factory_make("filesink", "event-file");
+    if (!pipeline || !appsrc || !parser || !muxer || !filesink) {
+      error_text = "an element could not be created";
+      goto stop;
+    }
+
+    // Blocks this thread, never the source, when the file falls behind
+    g_object_set(G_OBJECT(appsrc), "caps", caps, "format", GST_FORMAT_TIME,
+                 "block", TRUE, NULL);
+    g_object_set(G_OBJECT(filesink), "location", path.c_str(), NULL);
+    gst_bin_add_many(GST_BIN(pipeline), appsrc, parser, muxer, filesink, NULL);
+    added = TRUE;
+    if (!gst_element_link_many(appsrc, parser, muxer, filesink, NULL)) {
+      error_text = "the clip pipeline could not be linked";
+      goto stop;
+    }
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+      error_text = "the clip pipeline did not start";
+      goto stop;
+    }
+
+    lock.lock();
+    while (true) {
+      source->wake.wait(lock, [source] {
+        return !source->pending.empty() || !source->record_until_us;
+      });
+      if (source->pending.empty()) {
+        break;
+      }
+      EventPacket packet = std::move(source->pending.front());
+      source->pending.pop_front();
+      source->pending_bytes -= packet.size;
+      lock.unlock();
+
+      // Timestamps from 0, the metadata is copied and the memory shared
+      GstBuffer *buffer = gst_buffer_copy((GstBuffer *)packet.data.get());
+      GstClockTime pts = GST_BUFFER_PTS(buffer);
+      GstClockTime dts = GST_BUFFER_DTS(buffer);
+      GstClockTime stamp = GST_CLOCK_TIME_IS_VALID(dts) ? dts : pts;
+      if (!GST_CLOCK_TIME_IS_VALID(base)) {
+        base = stamp;
+      }
+      // Undecodable without the group before, or stamped before a source restart
+      if (!GST_CLOCK_TIME_IS_VALID(stamp) || stamp < base ||
+          (GST_CLOCK_TIME_IS_VALID(pts) && pts < base)) {
+        gst_buffer_unref(buffer);
+        lock.lock();
+        continue;
+      }
+      if (GST_CLOCK_TIME_IS_VALID(pts)) {
+        GST_BUFFER_PTS(buffer) = pts - base;
+      }
+      if (GST_CLOCK_TIME_IS_VALID(dts)) {
+        GST_BUFFER_DTS(buffer) = dts - base;
+      }
+
+      GstFlowReturn flow = GST_FLOW_OK;
+      g_signal_emit_by_name(appsrc, "push-buffer", buffer, &flow);
+      gst_buffer_unref(buffer);
+      lock.lock();
+      if (flow != GST_FLOW_OK) {
+        error_text = std::string("clip pipeline ") + gst_flow_get_name(flow);
+        source->record_until_us = 0;
+        source->pending.clear();
+        source->pending_bytes = 0;
+        break;
+      }
+      written++;
+    }
+    lock.unlock();
+
+    if (error_text.empty()) {
+      GstFlowReturn flow = GST_FLOW_OK;
+      g_signal_emit_by_name(appsrc, "end-of-stream", &flow);
+      // The index is written at EOS, without it an mp4 does not play
+      GstBus *bus = gst_element_get_bus(pipeline);
+      GstMessage *msg = gst_bus_timed_pop_filtered(
+          bus, EVENT_CLIP_EOS_TIMEOUT * GST_SECOND,
+          (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+      if (!msg) {
+        error_text = "the clip was not finished in time";
+      }
+      else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+        GError *error = NULL;
+        gst_message_parse_error(msg, &error, NULL);
+        error_text = error->message;
+        g_error_free(error);
+      }
+      else {
+        ok = TRUE;
+      }
+      if (msg) {
+        gst_message_unref(msg);
+      }
+      gst_object_unref(bus);
+    }
+
+    stop:
+      if (!added) {
+        // not in the bin, owned by nothing else
+        for (GstElement *element : {appsrc, parser, muxer, filesink}) {
+          if (element) {
+            gst_object_unref(element);
+          }
+        }
+      }
+      if (pipeline) {
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+      }
+      if (caps) {
+        gst_caps_unref(caps);
+      }
+
+      lock.lock();
+      source->record_until_us = 0;
+      source->pending.clear();
+      source->pending_bytes = 0;
+      source->recording = FALSE;
+      if (ok) {
+        source->clips++;
+        HERMES_LOG(LOG_LEVEL_INFO, "Event clip written", log_field("source", source->index),
+                   log_field("path", path.c_str()), log_field("packets", written));
+      }
+      else {
+        source->failed++;
+        HERMES_LOG(LOG_LEVEL_ERROR, "Event clip failed", log_field("source", source->index),
+                   log_field("path", path.c_str()), log_field("error", error_text.c_str()));
+      }
+  }
+
+  gboolean
+  Hermes::report_events(gpointer data) {
+    std::lock_guard<std::mutex> guard(events_lock);
+    size_t held = 0;
+    for (auto &entry : event_sources) {
+      EventSource &source = entry.second;
+      std::lock_guard<std::mutex> source_guard(source.lock);
+      const EventRingStats &stats = source.ring.stats();
+      held += source.ring.bytes() + source.pending_bytes;
+      g_print("Events: source %u | ring: %.1f MB over %.1f s, peak %.1f MB | overflows: %lu | "
+              "clips: %lu%s | failed: %lu | truncated: %lu\n",
+              entry.first, source.ring.bytes() / (double)(1 << 20), source.ring.span_us() / 1e6,
+              stats.peak_bytes / (double)(1 << 20), (gulong)stats.overflows, (gulong)source.clips,
+              source.recording ? " (recording)" : "", (gulong)source.failed,
+              (gulong)source.truncated);
+    }
+    // Ring and pending share packets, twice the ring size per source at most
+    g_print("Events: %.1f MB held, bound %.1f MB\n", held / (double)(1 << 20),
+            2.0 * event_ring_params.max_bytes * event_sources.size() / (1 << 20));
+    return G_SOURCE_CONTINUE;
+  }
+
+  void
+  Hermes::stop_event_recorders() {
+    std::lock_guard<std::mutex> guard(events_lock);
+    for (auto &entry : event_sources) {
+      EventSource &source = entry.second;
+      {
+        // The clip ends with what was queued
+        std::lock_guard<std::mutex> source_guard(source.lock);
+        source.record_until_us = 0;
+        source.wake.notify_one();
+      }
+      if (source.recorder.joinable()) {
+        source.recorder.join();
+      }
+      std::lock_guard<std::mutex> source_guard(source.lock);
+      source.ring.clear();
+      if (source.caps) {
+        gst_caps_unref(source.caps);
+        source.caps = NULL;
+      }
+    }
+  }
+
+  gboolean
+  Hermes::load_governor_config() {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar *text = NULL;
+    gchar **paths = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    const gchar *group = CONFIG_GROUP_GOVERNOR;
+    gdouble period = governor_period_ms / 1000.0;
+
+    governor_enabled = FALSE;
+
+    if (!g_key_file_load_from_file(key_file, GOVERNOR_CONFIG_FILE, G_KEY_FILE_NONE,
+                                  &error)) {
+      // The governor is optional, desktop GPUs have their own
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
+    }
+
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_ENABLE, NULL)) {
+      governor_enabled = g_key_file_get_integer(key_file, group, CONFIG_GOVERNOR_ENABLE, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_PERIOD, NULL)) {
+      period = g_key_file_get_double(key_file, group, CONFIG_GOVERNOR_PERIOD, &error);
+      CHECK_ERROR(error);
+      governor_period_ms = (guint)(period * 1000);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_TEMP_PATHS, NULL)) {
+      paths = g_key_file_get_string_list(key_file, group, CONFIG_GOVERNOR_TEMP_PATHS, NULL,
+                                         &error);
+      CHECK_ERROR(error);
+      governor_temp_paths.assign(paths, paths + g_strv_length(paths));
+      g_strfreev(paths);
+      paths = NULL;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_TEMP_SCALE, NULL)) {
+      governor_temp_scale = g_key_file_get_double(key_file, group, CONFIG_GOVERNOR_TEMP_SCALE,
+                                                  &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_POWER_PATHS, NULL)) {
+      paths = g_key_file_get_string_list(key_file, group, CONFIG_GOVERNOR_POWER_PATHS, NULL,
+                                         &error);
+      CHECK_ERROR(error);
+      governor_power_paths.assign(paths, paths + g_strv_length(paths));
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_POWER_SCALE, NULL)) {
+      governor_power_scale = g_key_file_get_double(key_file, group, CONFIG_GOVERNOR_POWER_SCALE,
+                                                   &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_TEMP_HIGH, NULL)) {
+      governor_params.temp_high_c = g_key_file_get_double(key_file, group,
+                                                          CONFIG_GOVERNOR_TEMP_HIGH, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_TEMP_CRITICAL, NULL)) {
+      governor_params.temp_critical_c = g_key_file_get_double(key_file, group,
+                                                              CONFIG_GOVERNOR_TEMP_CRITICAL, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_TEMP_HYSTERESIS, NULL)) {
+      governor_params.temp_hysteresis_c =
+          g_key_file_get_double(key_file, group, CONFIG_GOVERNOR_TEMP_HYSTERESIS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_POWER_HIGH, NULL)) {
+      governor_params.power_high_w = g_key_file_get_double(key_file, group,
+                                                           CONFIG_GOVERNOR_POWER_HIGH, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_POWER_HYSTERESIS, NULL)) {
+      governor_params.power_hysteresis_w =
+          g_key_file_get_double(key_file, group, CONFIG_GOVERNOR_POWER_HYSTERESIS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_SMOOTHING, NULL)) {
+      governor_params.smoothing_s = g_key_file_get_double(key_file, group,
+                                                          CONFIG_GOVERNOR_SMOOTHING, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_STEP_UP, NULL)) {
+      governor_params.step_up_s = g_key_file_get_double(key_file, group, CONFIG_GOVERNOR_STEP_UP,
+                                                        &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_STEP_DOWN, NULL)) {
+      governor_params.step_down_s = g_key_file_get_double(key_file, group,
+                                                          CONFIG_GOVERNOR_STEP_DOWN, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_SOURCE_FPS, NULL)) {
+      governor_params.source_fps = g_key_file_get_double(key_file, group,
+                                                         CONFIG_GOVERNOR_SOURCE_FPS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_MIN_DETECTION_FPS, NULL)) {
+      governor_params.min_detection_fps =
+          g_key_file_get_double(key_file, group, CONFIG_GOVERNOR_MIN_DETECTION_FPS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_DISPLAY_FPS, NULL)) {
+      governor_params.display_fps = g_key_file_get_integer(key_file, group,
+                                                           CONFIG_GOVERNOR_DISPLAY_FPS, &error);
+      CHECK_ERROR(error);
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_FALLBACK_CONFIG, NULL)) {
+      // Relative to this file, like the paths of nvinfer configs
+      text = get_absolute_file_path((gchar *)GOVERNOR_CONFIG_FILE,
+          g_key_file_get_string(key_file, group, CONFIG_GOVERNOR_FALLBACK_CONFIG, &error));
+      CHECK_ERROR(error);
+      if (!text || !boost::filesystem::exists(text)) {
+        g_printerr("%s: %s not found\n", GOVERNOR_CONFIG_FILE, CONFIG_GOVERNOR_FALLBACK_CONFIG);
+        goto done;
+      }
+      governor_fallback_config = text;
+      governor_params.fallback_model = true;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_GOVERNOR_METRICS_FILE, NULL)) {
+      g_free(text);
+      text = g_key_file_get_string(key_file, group, CONFIG_GOVERNOR_METRICS_FILE, &error);
+      CHECK_ERROR(error);
+      governor_metrics_file = text;
+    }
+
+    if (governor_period_ms < 100 || governor_params.temp_critical_c < governor_params.temp_high_c ||
+        governor_params.temp_hysteresis_c < 0 || governor_params.power_high_w < 0 ||
+        governor_params.power_hysteresis_w < 0 || governor_params.source_fps <= 0 ||
+        governor_params.min_detection_fps < 0) {
+      g_printerr("Invalid governor settings in %s\n", GOVERNOR_CONFIG_FILE);
+      goto done;
+    }
+    if (governor_enabled && governor_temp_paths.empty() && governor_power_paths.empty()) {
+      g_printerr("%s: no %s or %s to read\n", GOVERNOR_CONFIG_FILE, CONFIG_GOVERNOR_TEMP_PATHS,
+                 CONFIG_GOVERNOR_POWER_PATHS);
+      goto done;
+    }
+    ret = TRUE;
+
+    done:
+      if (error) {
+        g_error_free(error);
+      }
+      g_free(text);
+      g_strfreev(paths);
+      g_key_file_free(key_file);
+      if (!ret) {
+        g_printerr("%s failed", __func__);
+        governor_enabled = FALSE;
+      }
+    return ret;
+  }
+
+  gboolean
+  Hermes::start_governor(GstElement *pgie_yolo_detector) {
+    guint interval = 0;
+
+    // The ladder starts from the configured interval and display rate
+    g_object_get(G_OBJECT(pgie_yolo_detector), "interval", &interval, NULL);
+    governor_detector = pgie_yolo_detector;
+    governor_display = NULL;
+    for (BranchMetrics &metrics : branch_metrics) {
+      if (metrics.display_meta) {
+        governor_display = &metrics;
+      }
+    }
+    if (!governor_display) {
+      governor_params.display_fps = 0;
+    }
+
+    std::lock_guard<std::mutex> guard(governor_lock);
+    governor = Governor(governor_params, interval);
+    if (governor.steps().size() == 1) {
+      // Not worth stopping the app for, it runs as it would without a governor
+      g_printerr("Governor: nothing to shed, min-detection-fps leaves no room above interval %u, "
+                 "running without it\n", interval);
+      governor_enabled = FALSE;
+      return TRUE;
+    }
+    g_print("Governor: %.0f C / %.0f W, %lu steps down to one detection every %u frames%s\n",
+            governor_params.temp_high_c, governor_params.power_high_w,
+            (gulong)governor.steps().size() - 1, governor.steps().back().interval + 1,
+            governor_params.fallback_model ? " and the fallback model" : "");
+    governor_running = TRUE;
+    governor_thread = std::thread(governor_loop);
+    return TRUE;
+  }
+
+  void
+  Hermes::governor_loop() {
+    std::unique_lock<std::mutex> lock(governor_lock);
+    while (governor_running) {
+      lock.unlock();
+      // sysfs reads can take milliseconds on some rails, not under the lock
+      GovernorSample sample;
+      sample.time_us = g_get_monotonic_time();
+      sample.temp_c = read_temperature(governor_temp_paths, governor_temp_scale);
+      sample.power_w = read_power(governor_power_paths, governor_power_scale);
+      lock.lock();
+
+      GovernorAction action = governor.update(sample);
+      GovernorDecision decision = governor.decision();
+      if (action == GovernorAction::NO_READING && governor.stats().missing == 1) {
+        HERMES_LOG(LOG_LEVEL_WARNING, "Governor could not read any sensor");
+      }
+      if (action != GovernorAction::HOLD && action != GovernorAction::NO_READING) {
+        // A site per level, critical steps are rare and must not share a burst with the rest
+        if (action == GovernorAction::CRITICAL) {
+          HERMES_LOG(LOG_LEVEL_WARNING, "Governor",
+                     log_field("action", governor_action_name(action)),
+                     log_field("level", decision.level), log_field("temp_c", governor.temp_c()),
+                     log_field("power_w", governor.power_w()),
+                     log_field("interval", decision.interval),
+                     log_field("display_fps", decision.display_fps),
+                     log_field("fallback_model", decision.fallback_model ? "yes" : "no"));
+        }
+        else {
+          HERMES_LOG(LOG_LEVEL_INFO, "Governor",
+                     log_field("action", governor_action_name(action)),
+                     log_field("level", decision.level), log_field("temp_c", governor.temp_c()),
+                     log_field("power_w", governor.power_w()),
+                     log_field("interval", decision.interval),
+                     log_field("display_fps", decision.display_fps),
+                     log_field("fallback_model", decision.fallback_model ? "yes" : "no"));
+        }
+        apply_governor_decision(decision);
+      }
+
+      // Retried every period, a model update may be loading
+      if (governor_params.fallback_model && !governor_fallback_failed && !governor_swap_pending &&
+          decision.fallback_model != governor_fallback_active) {
+        governor_swap_pending = TRUE;
+        g_idle_add(swap_governor_model, NULL);
+      }
+      write_governor_metrics();
+
+      governor_wake.wait_for(lock, std::chrono::milliseconds(governor_period_ms),
+                             [] { return !governor_running; });
+    }
+  }
+
+  void
+  Hermes::apply_governor_decision(const GovernorDecision &decision) {
+    // nvinfer takes a new interval on its next batch
+    g_object_set(G_OBJECT(governor_detector), "interval", decision.interval, NULL);
+
+    if (governor_display) {
+      // Never above the rate the display was started with
+      guint fps = governor_display->max_fps;
+      if (decision.display_fps && (!fps || decision.display_fps < fps)) {
+        fps = decision.display_fps;
+      }
+      governor_display->min_interval_us = fps ? G_USEC_PER_SEC / fps : 0;
+    }
+  }
+
+  gboolean
+  Hermes::swap_governor_model(gpointer data) {
+    std::string config_path;
+    {
+      std::lock_guard<std::mutex> guard(model_update_lock);
+      if (model_updater.state() != ModelUpdateState::IDLE) {
+        // An update is under way, the governor asks again next period
+        std::lock_guard<std::mutex> governor_guard(governor_lock);
+        governor_swap_pending = FALSE;
+        return G_SOURCE_REMOVE;
+      }
+      // Back to whatever an update last committed
+      config_path = model_updater.active().config_path.empty()
+                    ? std::string(PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH)
+                    : model_updater.active().config_path;
+    }
+    {
+      std::lock_guard<std::mutex> guard(governor_lock);
+      if (!governor_fallback_active) {
+        config_path = governor_fallback_config;
+      }
     }
+    g_print("Governor: loading %s\n", config_path.c_str());
+    g_object_set(G_OBJECT(model_update_target), "config-file-path", config_path.c_str(), NULL);
+    return G_SOURCE_REMOVE;
+  }
 
-    delim = g_strrstr(abs_cfg_path, "/");
-    *(delim + 1) = '\0';
+  void
+  Hermes::write_governor_metrics() {
+    if (governor_metrics_file.empty()) {
+      return;
+    }
+    const GovernorDecision &decision = governor.decision();
+    const GovernorStats &stats = governor.stats();
+    std::ostringstream metrics;
+    metrics << "# HELP hermes_governor_level Work shed by the thermal governor, 0 for none\n"
+            << "# TYPE hermes_governor_level gauge\n"
+            << "hermes_governor_level " << decision.level << "\n"
+            << "hermes_governor_interval " << decision.interval << "\n"
+            << "hermes_governor_display_fps " << decision.display_fps << "\n"
+            << "hermes_governor_fallback_model " << (governor_fallback_active ? 1 : 0) << "\n";
+    // NaN until a sensor answers, left out rather than exported
+    if (!std::isnan(governor.temp_c())) {
+      metrics << "hermes_governor_temperature_celsius " << governor.temp_c() << "\n";
+    }
+    if (!std::isnan(governor.power_w())) {
+      metrics << "hermes_governor_power_watts " << governor.power_w() << "\n";
+    }
+    metrics << "hermes_governor_steps_up_total " << stats.steps_up << "\n"
+            << "hermes_governor_steps_down_total " << stats.steps_down << "\n"
+            << "hermes_governor_critical_total " << stats.critical << "\n"
+            << "hermes_governor_missing_readings_total " << stats.missing << "\n"
+            << "hermes_governor_throttled_seconds_total " << stats.throttled_us / 1e6 << "\n";
 
-    abs_file_path = g_strconcat(abs_cfg_path, file_path, NULL);
-    g_free(file_path);
+    // Replaced whole, a collector never reads half of it
+    std::string text = metrics.str();
+    GError *error = NULL;
+    if (!g_file_set_contents(governor_metrics_file.c_str(), text.data(), text.size(), &error)) {
+      HERMES_LOG(LOG_LEVEL_WARNING, "Could not write governor metrics",
+                 log_field("path", governor_metrics_file.c_str()),
+                 log_field("error", error->message));
+      g_error_free(error);
+    }
+  }
 
-    return abs_file_path;
+  void
+  Hermes::stop_governor() {
+    {
+      std::lock_guard<std::mutex> guard(governor_lock);
+      governor_running = FALSE;
+      governor_wake.notify_one();
+    }
+    if (governor_thread.joinable()) {
+      governor_thread.join();
+    }
   }
 
   gboolean
-  Hermes::set_tracker_properties(GstElement *nvtracker) {
+  Hermes::read_survey_settings(SurveySettings &settings) {
     gboolean ret = FALSE;
     GError *error = NULL;
-    gchar **keys = NULL;
-    gchar **key = NULL;
+    gchar *text = NULL;
+    gchar **extensions = NULL;
     GKeyFile *key_file = g_key_file_new();
+    const gchar *group = CONFIG_GROUP_SURVEY;
 
-    if (!g_key_file_load_from_file(key_file, TRACKER_CONFIG_FILE, G_KEY_FILE_NONE,
-                                  &error)) {
-      g_printerr("Failed to load config file: %s\n", error->message);
-      return FALSE;
+    if (!g_key_file_load_from_file(key_file, SURVEY_CONFIG_FILE, G_KEY_FILE_NONE, &error)) {
+      // Defaults are 4 slots logging to survey/
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return TRUE;
     }
 
-    keys = g_key_file_get_keys(key_file, CONFIG_GROUP_TRACKER, NULL, &error);
-    CHECK_ERROR(error);
-
-    for (key = keys; *key; key++) {
-      if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_WIDTH)) {
-        gint width =
-            g_key_file_get_integer(key_file, CONFIG_GROUP_TRACKER,
-                                  CONFIG_GROUP_TRACKER_WIDTH, &error);
-        CHECK_ERROR(error);
-        g_object_set(G_OBJECT(nvtracker), "tracker-width", width, NULL);
-      }
-      else if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_HEIGHT)) {
-        gint height =
-            g_key_file_get_integer(key_file, CONFIG_GROUP_TRACKER,
-                                  CONFIG_GROUP_TRACKER_HEIGHT, &error);
-        CHECK_ERROR(error);
-        g_object_set(G_OBJECT(nvtracker), "tracker-height", height, NULL);
-      }
-      else if (!g_strcmp0(*key, CONFIG_GPU_ID)) {
-        guint gpu_id =
-            g_key_file_get_integer(key_file, CONFIG_GROUP_TRACKER,
-                                  CONFIG_GPU_ID, &error);
-        CHECK_ERROR(error);
-        g_object_set(G_OBJECT(nvtracker), "gpu_id", gpu_id, NULL);
-      }
-      else if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_LL_CONFIG_FILE)) {
-        char *ll_config_file = get_absolute_file_path(TRACKER_CONFIG_FILE,
-                                                      g_key_file_get_string(key_file,
-                                                                            CONFIG_GROUP_TRACKER,
-                                                                            CONFIG_GROUP_TRACKER_LL_CONFIG_FILE, &error));
-        CHECK_ERROR(error);
-        g_object_set(G_OBJECT(nvtracker), "ll-config-file", ll_config_file, NULL);
-      }
-      else if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_LL_LIB_FILE)) {
-        char *ll_lib_file = get_absolute_file_path(TRACKER_CONFIG_FILE,
-                                                  g_key_file_get_string(key_file,
-                                                                        CONFIG_GROUP_TRACKER,
-                                                                        CONFIG_GROUP_TRACKER_LL_LIB_FILE, &error));
-        CHECK_ERROR(error);
-        g_object_set(G_OBJECT(nvtracker), "ll-lib-file", ll_lib_file, NULL);
-      }
-      else if (!g_strcmp0(*key, CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS)) {
-        gboolean enable_batch_process =
-            g_key_file_get_integer(key_file, CONFIG_GROUP_TRACKER,
-                                  CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS, &error);
-        CHECK_ERROR(error);
-        g_object_set(G_OBJECT(nvtracker), "enable_batch_process",
-                    enable_batch_process, NULL);
-      }
-      else {
-        g_printerr("Unknown key '%s' for group [%s]", *key,
-                  CONFIG_GROUP_TRACKER);
+    if (g_key_file_has_key(key_file, group, CONFIG_SURVEY_SLOTS, NULL)) {
+      gint slots = g_key_file_get_integer(key_file, group, CONFIG_SURVEY_SLOTS, &error);
+      CHECK_ERROR(error);
+      if (slots < 1 || slots > PGIE_MAX_BATCH_SIZE) {
+        g_printerr("%s must be 1 to %d\n", CONFIG_SURVEY_SLOTS, PGIE_MAX_BATCH_SIZE);
+        goto done;
       }
+      settings.slots = slots;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_SURVEY_LOG_DIR, NULL)) {
+      text = g_key_file_get_string(key_file, group, CONFIG_SURVEY_LOG_DIR, &error);
+      CHECK_ERROR(error);
+      settings.log_dir = text;
+    }
+    if (g_key_file_has_key(key_file, group, CONFIG_SURVEY_EXTENSIONS, NULL)) {
+      extensions = g_key_file_get_string_list(key_file, group, CONFIG_SURVEY_EXTENSIONS, NULL,
+                                              &error);
+      CHECK_ERROR(error);
+      settings.extensions.assign(extensions, extensions + g_strv_length(extensions));
     }
 
     ret = TRUE;
@@ -446,76 +4100,413 @@ namespace WildFireDetection {
       if (error) {
         g_error_free(error);
       }
-      if (keys) {
-        g_strfreev(keys);
+      g_free(text);
+      if (extensions) {
+        g_strfreev(extensions);
       }
+      g_key_file_free(key_file);
       if (!ret) {
         g_printerr("%s failed", __func__);
       }
     return ret;
   }
 
-  int
-  Hermes::configure_element_properties(int num_sources, GstElement *streammux, GstElement *pgie_yolo_detector,
-                               GstElement *nvtracker, GstElement *sink, GstElement *tiler) {
+  gboolean
+  Hermes::load_survey_queue(const gchar *path) {
+    boost::filesystem::path root(path);
+    std::vector<std::string> files;
 
-    guint tiler_rows, tiler_columns;
+    if (boost::filesystem::is_directory(root)) {
+      // Every video in the directory and below, in name order
+      for (const auto &entry : boost::filesystem::recursive_directory_iterator(root)) {
+        std::string extension = entry.path().extension().string();
+        if (!boost::filesystem::is_regular_file(entry.path()) || extension.empty()) {
+          continue;
+        }
+        extension = boost::algorithm::to_lower_copy(extension.substr(1));
+        if (std::find(survey_settings.extensions.begin(), survey_settings.extensions.end(),
+                      extension) != survey_settings.extensions.end()) {
+          files.push_back(entry.path().string());
+        }
+      }
+      std::sort(files.begin(), files.end());
+    }
+    else {
+      // One file per line, relative to the list
+      std::ifstream list(path);
+      std::string line;
+      if (!list.is_open()) {
+        g_printerr("Could not read survey list %s\n", path);
+        return FALSE;
+      }
+      while (getline(list, line)) {
+        boost::algorithm::trim(line);
+        if (line.empty() || line[0] == '#') {
+          continue;
+        }
+        boost::filesystem::path file(line);
+        files.push_back((file.is_absolute() ? file : root.parent_path() / file).string());
+      }
+    }
 
-    g_object_set(G_OBJECT(streammux), "width", MUXER_OUTPUT_WIDTH,
-               "height", MUXER_OUTPUT_HEIGHT, "batch-size", num_sources,
-               "batched-push-timeout", MUXER_BATCH_TIMEOUT_USEC,
-               "live-source", TRUE, NULL);
+    survey_queue.assign(files.begin(), files.end());
+    survey_files_total = files.size();
+    return TRUE;
+  }
 
-    // Set all important properties of pgie_yolo_detector
-    g_object_set(G_OBJECT(pgie_yolo_detector),
-                "config-file-path", PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH, NULL);
+  gboolean
+  Hermes::start_survey_file(SurveySlot &slot, const std::string &path) {
+    gchar pad_name[16] = {};
+    gchar *uri = NULL;
+    GstPad *sinkpad = NULL, *srcpad = NULL;
+    boost::filesystem::path file_path = boost::filesystem::absolute(path);
+
+    {
+      std::lock_guard<std::mutex> guard(survey_lock);
+      guint number = ++survey_files_started;
+      slot.files.emplace_back();
+      SurveyFile &file = slot.files.back();
+      file.path = path;
+      // numbered, flights of different days tend to share file names
+      std::string log_path = (boost::filesystem::path(survey_settings.log_dir) /
+          str(boost::format("%04u_%s.csv") % number % file_path.filename().string())).string();
+      file.log.open(log_path);
+      if (!file.log.is_open()) {
+        g_printerr("Could not write %s\n", log_path.c_str());
+        return FALSE;
+      }
+      file.log << "frame,pts_s,object_id,class,confidence,left,top,width,height\n";
+    }
 
-    // Override batch-size of pgie_yolo_detector
-    g_object_set(G_OBJECT(pgie_yolo_detector), "batch-size", num_sources, NULL);
+    uri = g_filename_to_uri(file_path.string().c_str(), NULL, NULL);
+    slot.bin = uri ? create_source_bin(slot.index, uri) : NULL;
+    g_free(uri);
+    if (!slot.bin) {
+      g_printerr("Failed to create source bin for %s\n", path.c_str());
+      return FALSE;
+    }
+    gst_bin_add(GST_BIN(survey_pipeline), slot.bin);
 
-    // Check if Engine Exists
-    if (boost::filesystem::exists(boost::filesystem::path(
-        WildFireDetection::Hermes::PGIE_YOLO_ENGINE_PATH))) {
+    // A released pad is requested again, source_id stays the slot index
+    g_snprintf(pad_name, 15, "sink_%u", slot.index);
+    sinkpad = gst_element_get_request_pad(survey_streammux, pad_name);
+    srcpad = gst_element_get_static_pad(slot.bin, "src");
+    if (!sinkpad || !srcpad || gst_pad_link(srcpad, sinkpad) != GST_PAD_LINK_OK) {
+      g_printerr("Failed to link source bin to stream muxer\n");
+      return FALSE;
+    }
+    gst_pad_add_probe(srcpad,
+                      (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER |
+                                        GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                      survey_source_probe, &slot, NULL);
+    gst_object_unref(srcpad);
+    gst_object_unref(sinkpad);
 
-      g_object_set(G_OBJECT(pgie_yolo_detector),
-                  "model-engine-file", WildFireDetection::Hermes::PGIE_YOLO_ENGINE_PATH.c_str(), NULL);
+    slot.swapping = FALSE;
+    gst_element_sync_state_with_parent(slot.bin);
+    g_print("Survey: slot %u decoding %s\n", slot.index, path.c_str());
+    return TRUE;
+  }
+
+  void
+  Hermes::finish_survey_file(SurveySlot &slot) {
+    SurveyFile &file = slot.files.front();
+    gdouble media_s = file.last_pts > file.first_pts ?
+        (file.last_pts - file.first_pts) / (gdouble)GST_SECOND : 0;
+
+    survey_files_done++;
+    survey_files_failed += file.failed;
+    survey_media_s += media_s;
+    file.log.close();
+    survey_summary << std::quoted(file.path) << "," << (file.failed ? "failed" : "done")
+                   << "," << file.frames_logged << "," << file.detections << "," << media_s
+                   << "\n";
+    survey_summary.flush();
+    if (file.failed) {
+      HERMES_LOG(LOG_LEVEL_WARNING, "Survey file failed",
+                 log_field("file", file.path), log_field("done", survey_files_done),
+                 log_field("total", survey_files_total), log_field("frames", file.frames_logged));
     }
     else {
-      cout << str(boost::format("YOLO Engine for batch-size: %d and compute-mode: %s not found.")
-              % num_sources % COMPUTE_MODE) << endl;
-      return EXIT_FAILURE;
+      HERMES_LOG(LOG_LEVEL_INFO, "Survey file done",
+                 log_field("file", file.path), log_field("done", survey_files_done),
+                 log_field("total", survey_files_total), log_field("frames", file.frames_logged),
+                 log_field("detections", file.detections));
     }
+    slot.files.pop_front();
+  }
 
-    // Set necessary properties of the tracker element
-    if (!WildFireDetection::Hermes::set_tracker_properties(nvtracker)) {
-      g_printerr("Failed to set tracker properties. Exiting.\n");
-      return -1;
+  void
+  Hermes::retire_survey_files(SurveySlot &slot) {
+    // Files finish in the order they were decoded, one that ended early waits
+    // for the frames of the one before it
+    while (!slot.files.empty() && slot.files.front().finished &&
+           slot.files.front().frames_logged >= slot.files.front().frames_in) {
+      finish_survey_file(slot);
     }
+  }
 
-    g_object_set(G_OBJECT(sink),
-                "sync", FALSE, NULL);
+  GstPadProbeReturn
+  Hermes::survey_source_probe(GstPad *pad, GstPadProbeInfo *info, gpointer u_data) {
+    SurveySlot *slot = (SurveySlot *)u_data;
+    std::lock_guard<std::mutex> guard(survey_lock);
+    if (slot->files.empty()) {
+      return GST_PAD_PROBE_OK;
+    }
+    SurveyFile &file = slot->files.back();
 
-    tiler_rows = (guint)sqrt(num_sources);
-    tiler_columns = (guint)ceil(1.0 * num_sources / tiler_rows);
-    // Tiler Properties
-    g_object_set(G_OBJECT(tiler), "rows", tiler_rows, "columns", tiler_columns,
-                "width", TILED_OUTPUT_WIDTH, "height", TILED_OUTPUT_HEIGHT, NULL);
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+      GstClockTime pts = GST_BUFFER_PTS((GstBuffer *)info->data);
+      file.frames_in++;
+      if (GST_CLOCK_TIME_IS_VALID(pts)) {
+        if (file.first_pts < 0) {
+          file.first_pts = pts;
+        }
+        file.last_pts = MAX(file.last_pts, (gint64)pts);
+      }
+      return GST_PAD_PROBE_OK;
+    }
+    if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) != GST_EVENT_EOS) {
+      return GST_PAD_PROBE_OK;
+    }
 
-    return EXIT_SUCCESS;
+    file.finished = TRUE;
+    retire_survey_files(*slot);
+    if (survey_queue.empty()) {
+      // Let it through, the streammux ends the run with the last slot
+      return GST_PAD_PROBE_OK;
+    }
+    // The slot lives on with the next file, the streammux must not see EOS
+    slot->next_path = survey_queue.front();
+    survey_queue.pop_front();
+    slot->swapping = TRUE;
+    g_idle_add(survey_next_file, slot);
+    return GST_PAD_PROBE_DROP;
   }
 
-  void Hermes::setPaths(guint num_sources) {
+  void
+  Hermes::remove_survey_source(SurveySlot &slot) {
+    gchar pad_name[16] = {};
 
-    // Config Paths
-    PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH =
-    strdup("models/YOLOv3WildFires/config_infer_primary_yolov3.txt");
+    gst_element_set_state(slot.bin, GST_STATE_NULL);
+    g_snprintf(pad_name, 15, "sink_%u", slot.index);
+    GstPad *sinkpad = gst_element_get_static_pad(survey_streammux, pad_name);
+    if (sinkpad) {
+      gst_pad_send_event(sinkpad, gst_event_new_flush_stop(FALSE));
+      gst_element_release_request_pad(survey_streammux, sinkpad);
+      gst_object_unref(sinkpad);
+    }
+    gst_bin_remove(GST_BIN(survey_pipeline), slot.bin);
+    slot.bin = NULL;
+  }
 
-    TRACKER_CONFIG_FILE =
-    strdup("models/Trackers/DCF/ds_tracker_config.txt");
+  gboolean
+  Hermes::survey_next_file(gpointer data) {
+    SurveySlot *slot = (SurveySlot *)data;
 
-    // Engine Paths
-    PGIE_YOLO_ENGINE_PATH =
-    str(boost::format("model_b%d_gpu0_%s.engine") % num_sources % COMPUTE_MODE);
+    remove_survey_source(*slot);
+    if (!start_survey_file(*slot, slot->next_path)) {
+      gst_element_send_event(survey_pipeline, gst_event_new_eos());
+    }
+    return G_SOURCE_REMOVE;
+  }
+
+  void
+  Hermes::survey_source_failed(SurveySlot &slot, const gchar *reason) {
+    std::string next_path;
+    {
+      std::lock_guard<std::mutex> guard(survey_lock);
+      SurveyFile &file = slot.files.back();
+      g_printerr("Survey: %s failed: %s\n", file.path.c_str(), reason);
+      file.finished = TRUE;
+      file.failed = TRUE;
+      retire_survey_files(slot);
+      if (!survey_queue.empty()) {
+        next_path = survey_queue.front();
+        survey_queue.pop_front();
+      }
+      slot.swapping = TRUE;
+    }
+
+    if (!next_path.empty()) {
+      slot.next_path = next_path;
+      survey_next_file(&slot);
+      return;
+    }
+    // Nothing left for the slot, it ends as if the file had
+    gchar pad_name[16] = {};
+    gst_element_set_state(slot.bin, GST_STATE_NULL);
+    g_snprintf(pad_name, 15, "sink_%u", slot.index);
+    GstPad *sinkpad = gst_element_get_static_pad(survey_streammux, pad_name);
+    if (sinkpad) {
+      gst_pad_send_event(sinkpad, gst_event_new_eos());
+      gst_object_unref(sinkpad);
+    }
+  }
+
+  void
+  Hermes::log_survey_frame(const FrameRecord &frame) {
+    std::lock_guard<std::mutex> guard(survey_lock);
+    auto slot = std::find_if(survey_slots.begin(), survey_slots.end(),
+                             [&](const SurveySlot &s) { return s.index == frame.source_id; });
+    if (slot == survey_slots.end() || slot->files.empty()) {
+      return;
+    }
+
+    // Boxes back in the resolution of the recording
+    SurveyFile &file = slot->files.front();
+    gdouble scale_x, scale_y;
+    muxer_to_source_scale(muxer_geometry, frame.source_frame_width,
+                          frame.source_frame_height, scale_x, scale_y);
+    for (const ObjectRecord &box : frame.objects) {
+      file.log << file.frames_logged << "," << frame.buf_pts / (gdouble)GST_SECOND << ","
+               << box.object_id << "," << box.class_id << "," << box.confidence
+               << "," << box.left * scale_x << "," << box.top * scale_y << ","
+               << box.width * scale_x << "," << box.height * scale_y << "\n";
+      file.detections++;
+    }
+    file.frames_logged++;
+    survey_frames++;
+    retire_survey_files(*slot);
+  }
+
+  gboolean
+  Hermes::survey_bus_call(GstBus *bus, GstMessage *msg, gpointer data) {
+    if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_ERROR) {
+      return bus_call(bus, msg, data);
+    }
+    // Errors still queued from a source that was removed since
+    if (!gst_object_has_as_ancestor(GST_OBJECT(msg->src), GST_OBJECT(survey_pipeline))) {
+      return TRUE;
+    }
+    // A broken recording costs its own file, not the survey
+    for (SurveySlot &slot : survey_slots) {
+      if (slot.bin && !slot.swapping &&
+          gst_object_has_as_ancestor(GST_OBJECT(msg->src), GST_OBJECT(slot.bin))) {
+        GError *error = NULL;
+        gst_message_parse_error(msg, &error, NULL);
+        survey_source_failed(slot, error->message);
+        g_error_free(error);
+        return TRUE;
+      }
+    }
+    return bus_call(bus, msg, data);
+  }
+
+  gboolean
+  Hermes::report_survey(gpointer data) {
+    std::lock_guard<std::mutex> guard(survey_lock);
+    gdouble elapsed_s = (g_get_monotonic_time() - survey_start_us) / 1e6;
+    g_print("Survey: files %u/%u | frames: %lu | FPS: %.1f | %.1fx real time\n",
+            survey_files_done, survey_files_total, (gulong)survey_frames,
+            (survey_frames - survey_reported_frames) / (gdouble)PERF_INTERVAL,
+            elapsed_s > 0 ? survey_media_s / elapsed_s : 0);
+    survey_reported_frames = survey_frames;
+    return G_SOURCE_CONTINUE;
+  }
+
+  int
+  Hermes::run_survey() {
+    std::map<std::string, GstElement *> elements;
+    GMainLoop *loop = NULL;
+    GstBus *bus = NULL;
+    guint bus_watch_id;
+
+    if (!read_survey_settings(survey_settings) || !load_survey_queue(survey) ||
+        !load_slicing_config()) {
+      return -1;
+    }
+    if (survey_queue.empty()) {
+      g_printerr("No recordings to survey in %s\n", survey);
+      return -1;
+    }
+    boost::system::error_code error;
+    boost::filesystem::create_directories(survey_settings.log_dir, error);
+    survey_summary.open((boost::filesystem::path(survey_settings.log_dir) /
+                         SURVEY_SUMMARY_FILE).string());
+    if (!survey_summary.is_open()) {
+      g_printerr("Could not write to %s\n", survey_settings.log_dir.c_str());
+      return -1;
+    }
+    survey_summary << "file,status,frames,detections,media_s\n";
+
+    // Files are read as fast as the pipeline takes them
+    live_sources = FALSE;
+    guint slots = MIN(survey_settings.slots, survey_files_total);
+    g_print("Survey: %u recordings, %u at a time, logs in %s\n", survey_files_total, slots,
+            survey_settings.log_dir.c_str());
+
+    survey_pipeline = gst_pipeline_new("hermes-survey-pipeline");
+    survey_streammux = gst_element_factory_make("nvstreammux", "stream-muxer");
+    if (!survey_pipeline || !survey_streammux) {
+      g_printerr("One element could not be created. Exiting.\n");
+      return -1;
+    }
+    gst_bin_add(GST_BIN(survey_pipeline), survey_streammux);
+
+    num_sources = slots;
+    setPaths(slots);
+    if (!load_threading_config()) {
+      return -1;
+    }
+    for (guint index = 0; index < slots; index++) {
+      survey_slots.emplace_back();
+      survey_slots.back().index = index;
+      std::string path = survey_queue.front();
+      survey_queue.pop_front();
+      if (!start_survey_file(survey_slots.back(), path)) {
+        return -1;
+      }
+    }
+
+    // Headless, nothing is watched while surveying
+    TopologySpec topology = get_topology(TRUE, 0);
+    if (!build_topology(survey_pipeline, survey_streammux, topology, elements) ||
+        configure_element_properties(slots, survey_streammux, elements[PGIE_ELEMENT_NAME],
+                                     elements[TRACKER_ELEMENT_NAME], NULL, NULL) != EXIT_SUCCESS) {
+      return -1;
+    }
+    g_object_set(G_OBJECT(elements[ANALYTICS_SINK_ELEMENT_NAME]), "sync", FALSE, NULL);
+    attach_slicing_probes(elements[PGIE_ELEMENT_NAME]);
+    report_stage_threads();
+
+    loop = g_main_loop_new(NULL, FALSE);
+    bus = gst_pipeline_get_bus(GST_PIPELINE(survey_pipeline));
+    bus_watch_id = gst_bus_add_watch(bus, survey_bus_call, loop);
+    gst_bus_set_sync_handler(bus, stream_status_handler, NULL, NULL);
+    gst_object_unref(bus);
+    g_timeout_add_seconds(PERF_INTERVAL, report_survey, NULL);
+
+    survey_start_us = g_get_monotonic_time();
+    if (gst_element_set_state(survey_pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+      g_printerr("Failed to start the survey pipeline\n");
+      return -1;
+    }
+    g_main_loop_run(loop);
+    log_flush();
+    gdouble elapsed_s = (g_get_monotonic_time() - survey_start_us) / 1e6;
+
+    gst_element_set_state(survey_pipeline, GST_STATE_NULL);
+    {
+      std::lock_guard<std::mutex> guard(survey_lock);
+      // Cut short by an error, whatever did not finish is failed
+      for (SurveySlot &slot : survey_slots) {
+        while (!slot.files.empty()) {
+          slot.files.front().failed = TRUE;
+          finish_survey_file(slot);
+        }
+      }
+      g_print("Survey: %u files, %u failed, %lu frames in %.0f s | FPS: %.1f | "
+              "%.0f s of video, %.1fx real time\n", survey_files_done, survey_files_failed,
+              (gulong)survey_frames, elapsed_s, elapsed_s > 0 ? survey_frames / elapsed_s : 0,
+              survey_media_s, elapsed_s > 0 ? survey_media_s / elapsed_s : 0);
+    }
+    survey_summary.close();
+
+    gst_object_unref(GST_OBJECT(survey_pipeline));
+    g_source_remove(bus_watch_id);
+    g_main_loop_unref(loop);
+    return 0;
   }
 }
 
@@ -524,16 +4515,10 @@ int main(int argc, char *argv[]) {
   WildFireDetection::Hermes hermes;
   GMainLoop *loop = NULL;
   GstElement *pipeline = NULL, *streammux = NULL, *sink = NULL,
-             *pgie_yolo_detector = NULL, *nvtracker = NULL,
-             *nvvidconv = NULL, *nvosd = NULL, *tiler;
-
-  #ifdef PLATFORM_TEGRA
-    GstElement *transform = NULL;
-  #endif
+             *pgie_yolo_detector = NULL, *nvtracker = NULL, *tiler = NULL;
 
   GstBus *bus = NULL;
   guint bus_watch_id = 0;
-  GstPad *tiler_src_pad = NULL;
   guint i;
 
   // Standard GStreamer initialization
@@ -557,6 +4542,14 @@ int main(int argc, char *argv[]) {
     return -1;
   }
   g_option_context_free(ctx);
+  hermes.startup.mark("options parsed");
+
+  if (hermes.benchmark) {
+    return hermes.run_benchmark();
+  }
+  if (hermes.survey) {
+    return hermes.run_survey();
+  }
 
   /* Create gstreamer elements */
   // Create Pipeline element to connect all elements
@@ -578,71 +4571,58 @@ int main(int argc, char *argv[]) {
   else {
     num_sources = sources;
   }
+  hermes.startup.mark("sources created");
 
   hermes.setPaths(num_sources);
 
-  // Primary GPU Inference Engine
-  pgie_yolo_detector = gst_element_factory_make("nvinfer", "primary-yolo-nvinference-engine");
-
-  if (!pgie_yolo_detector) {
-    g_printerr("PGIE YOLO Detector could not be created.\n");
+  // Tiled inference sets what the muxer frame has to hold
+  if (!hermes.load_slicing_config()) {
     return -1;
   }
-
-  // Initialize Tracker
-  nvtracker = gst_element_factory_make("nvtracker", "tracker");
-
-  if (!nvtracker ) {
-    g_printerr("NVTRACKER could not be created.\n");
+  // Before the muxer is configured, it cannot change resolution later
+  if (!hermes.choose_muxer_resolution()) {
     return -1;
   }
 
-  // Compose all the sources into one 2D tiled window
-  tiler = gst_element_factory_make("nvmultistreamtiler", "nvtiler");
-
-  if (!tiler) {
-    g_printerr("SINK could not be created.\n");
+  // Thread boundaries have to be known before the topology is built
+  if (!hermes.load_threading_config()) {
     return -1;
   }
-
-  // Use convertor to convert from NV12 to RGBA as required by nvosd
-  nvvidconv = gst_element_factory_make("nvvideoconvert", "nvvideo-converter");
-
-  if (!nvvidconv) {
-    g_printerr("NVVIDCONV could not be created.\n");
+  if (!hermes.load_fire_map_config()) {
     return -1;
   }
-
-  // Create OSD to draw on the converted RGBA buffer
-  nvosd = gst_element_factory_make("nvdsosd", "nv-onscreendisplay");
-
-  if (!nvosd) {
-    g_printerr("NVOSD could not be created.\n");
+  if (!hermes.load_heatmap_config()) {
     return -1;
   }
-  /* Redner OSD Output */
-  #ifdef PLATFORM_TEGRA
-    transform = gst_element_factory_make("nvegltransform", "nvegl-transform");
-  #endif
-
-  if (hermes.display_off) {
-    sink = gst_element_factory_make("fakesink", "nvvideo-renderer");
+  // Before the sources start, their parsers are probed as decodebin plugs them
+  if (!hermes.load_event_config()) {
+    return -1;
   }
-  else {
-    sink = gst_element_factory_make("nveglglessink", "nvvideo-renderer");
+  // Adds the classifier to the topology
+  if (!hermes.load_classifier_config()) {
+    return -1;
+  }
+  // Adds a rate limit to the display branch
+  if (!hermes.load_governor_config()) {
+    return -1;
   }
 
-  if (!sink) {
-    g_printerr("SINK could not be created.\n");
+  // Everything after the muxer, chosen from a declarative description
+  WildFireDetection::TopologySpec topology =
+      hermes.get_topology(hermes.display_off, MAX(hermes.display_fps, 0));
+  std::map<std::string, GstElement *> elements;
+  if (!hermes.build_topology(pipeline, streammux, topology, elements)) {
     return -1;
   }
+  g_print("Pipeline topology: %s\n", topology.name);
+  hermes.startup.mark("topology built");
+  hermes.report_stage_threads();
 
-  #ifdef PLATFORM_TEGRA
-    if (!transform) {
-      g_printerr("Tegra element TRANSFORM could not be created. Exiting.\n");
-      return -1;
-    }
-  #endif
+  pgie_yolo_detector = elements[PGIE_ELEMENT_NAME];
+  nvtracker = elements[TRACKER_ELEMENT_NAME];
+  // absent from the headless topology
+  sink = elements.count(SINK_ELEMENT_NAME) ? elements[SINK_ELEMENT_NAME] : NULL;
+  tiler = elements.count(TILER_ELEMENT_NAME) ? elements[TILER_ELEMENT_NAME] : NULL;
 
   int fail_safe = hermes.configure_element_properties(num_sources, streammux, pgie_yolo_detector,
                                                       nvtracker, sink, tiler);
@@ -650,56 +4630,64 @@ int main(int argc, char *argv[]) {
   if(fail_safe == -1) {
     return -1;
   }
+  if (hermes.classifier_enabled && !hermes.configure_classifier(elements[SGIE_ELEMENT_NAME])) {
+    g_printerr("Failed to set classifier properties. Exiting.\n");
+    return -1;
+  }
+  // After the detector read its interval from its config
+  if (hermes.governor_enabled && !hermes.start_governor(pgie_yolo_detector)) {
+    return -1;
+  }
+  hermes.startup.mark("elements configured");
   // Message Handler
   bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
   bus_watch_id = gst_bus_add_watch(bus, hermes.bus_call, loop);
+  // Pins each stage thread from within the thread, as it starts
+  gst_bus_set_sync_handler(bus, hermes.stream_status_handler, NULL, NULL);
   gst_object_unref(bus);
 
-  /* Set up the pipeline */
-  #ifdef PLATFORM_TEGRA
-    if (!hermes.display_off) {
-      gst_bin_add_many(GST_BIN(pipeline),
-                      pgie_yolo_detector, nvtracker, tiler, nvvidconv, nvosd, transform, sink, NULL);
-
-      if (!gst_element_link_many(streammux, pgie_yolo_detector, nvtracker,
-                                 tiler, nvvidconv, nvosd, transform, sink, NULL)) {
-        g_printerr("Elements could not be linked. Exiting.\n");
-        return -1;
-      }
-    }
-    else {
-      gst_bin_add_many(GST_BIN(pipeline),
-                      pgie_yolo_detector, nvtracker, tiler, nvvidconv, nvosd, sink, NULL);
+  hermes.attach_slicing_probes(pgie_yolo_detector);
 
-      if (!gst_element_link_many(streammux, pgie_yolo_detector, nvtracker,
-                                 tiler, nvvidconv, nvosd, sink, NULL)) {
-        g_printerr("Elements could not be linked. Exiting.\n");
-        return -1;
-      }
-    }
+  // Time to first frame, first inference and first detection
+  GstPad *startup_pad = gst_element_get_static_pad(streammux, "src");
+  gst_pad_add_probe(startup_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                    hermes.startup_mark_probe, (gpointer)"first batch muxed", NULL);
+  gst_object_unref(startup_pad);
+  startup_pad = gst_element_get_static_pad(pgie_yolo_detector, "src");
+  gst_pad_add_probe(startup_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                    hermes.startup_mark_probe, (gpointer)"first inference", NULL);
+  gst_object_unref(startup_pad);
+  startup_pad = gst_element_get_static_pad(nvtracker, "src");
+  gst_pad_add_probe(startup_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                    hermes.first_detection_probe, NULL, NULL);
+  gst_object_unref(startup_pad);
 
-  #else
-    gst_bin_add_many(GST_BIN(pipeline),
-                    pgie_yolo_detector, nvtracker, tiler, nvvidconv, nvosd, sink, NULL);
+  // New model versions are picked up from MODEL_UPDATE_FILE
+  hermes.model_update_target = pgie_yolo_detector;
+  g_signal_connect(G_OBJECT(pgie_yolo_detector), "model-updated",
+                   G_CALLBACK(hermes.model_updated), NULL);
+  startup_pad = gst_element_get_static_pad(pgie_yolo_detector, "src");
+  gst_pad_add_probe(startup_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                    hermes.model_health_probe, NULL, NULL);
+  gst_object_unref(startup_pad);
+  g_timeout_add_seconds(MODEL_UPDATE_POLL_INTERVAL, hermes.check_model_update, &hermes);
 
-    if (!gst_element_link_many(streammux, pgie_yolo_detector, nvtracker,
-                               tiler, nvvidconv, nvosd, sink, NULL)) {
-      g_printerr("Elements could not be linked. Exiting.\n");
-      return -1;
-    }
-  #endif
+  // Per branch throughput and drops
+  g_timeout_add_seconds(PERF_INTERVAL, hermes.report_branch_metrics, NULL);
 
-  /* Lets add probe to get informed of the meta data generated, we add probe to
-   * the sink pad of the osd element, since by that time, the buffer would have
-   * had got all the metadata. */
-  tiler_src_pad = gst_element_get_static_pad(tiler, "sink");
-  if (!tiler_src_pad) {
-    g_print("Unable to get sink pad\n");
+  // Drone poses and the fires they located
+  if (hermes.fire_map_enabled) {
+    g_timeout_add(FIRE_MAP_POSE_POLL_MS, hermes.refresh_poses, NULL);
+    g_timeout_add_seconds(FIRE_MAP_REPORT_INTERVAL, hermes.report_fire_map, NULL);
   }
-  else {
-    gst_pad_add_probe(tiler_src_pad, GST_PAD_PROBE_TYPE_BUFFER,
-                      hermes.tiler_src_pad_buffer_probe, NULL, NULL);
+  if (hermes.heatmap_enabled) {
+    g_timeout_add_seconds(hermes.heatmap_report_interval, hermes.report_heatmaps, NULL);
   }
+  if (hermes.events_enabled) {
+    g_timeout_add_seconds(EVENT_REPORT_INTERVAL, hermes.report_events, NULL);
+    g_unix_signal_add(SIGUSR1, hermes.manual_event, NULL);
+  }
+
   /* Set the pipeline to "playing" state */
   cout << "Now playing:" << endl;
   std::ifstream infile(SOURCE_PATH);
@@ -711,15 +4699,25 @@ int main(int argc, char *argv[]) {
   }
   infile.close();
 
-  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  if (!hermes.start_pipeline(pipeline, pgie_yolo_detector, nvtracker)) {
+    return -1;
+  }
 
   /* Wait till pipeline encounters an error or EOS */
   g_print("Running...\n");
   g_main_loop_run(loop);
+  // the reason the loop ended is still in the log queue
+  WildFireDetection::log_flush();
 
   /* Out of the main loop, clean up nicely */
+  // nothing was detected, still show where startup went
+  hermes.report_startup();
   g_print("Returned, stopping playback\n");
+  hermes.stop_shm_sources();
+  hermes.stop_governor();
   gst_element_set_state(pipeline, GST_STATE_NULL);
+  // Clips in progress end with the packets already taken
+  hermes.stop_event_recorders();
   g_print("Deleting pipeline\n");
   gst_object_unref(GST_OBJECT(pipeline));
   g_source_remove(bus_watch_id);
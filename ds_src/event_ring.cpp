@@ -0,0 +1,71 @@
+#include "event_ring.h"
+
+#include <algorithm>
+
+namespace WildFireDetection {
+
+  EventRing::EventRing(const EventRingParams &params) : params(params) {}
+
+  bool
+  EventRing::drop_front_group() {
+    auto next = std::find_if(ring.begin() + (ring.empty() ? 0 : 1), ring.end(),
+                             [](const EventPacket &packet) { return packet.keyframe; });
+    if (next == ring.end()) {
+      return false;
+    }
+    for (auto it = ring.begin(); it != next; ++it) {
+      held_bytes -= it->size;
+    }
+    ring.erase(ring.begin(), next);
+    return true;
+  }
+
+  bool
+  EventRing::push(const EventPacket &packet) {
+    if (ring.empty() && !packet.keyframe) {
+      counters.dropped++;
+      return false;
+    }
+    ring.push_back(packet);
+    held_bytes += packet.size;
+    counters.packets++;
+
+    // The group before the newest keyframe old enough is not needed
+    int64_t horizon = packet.arrival_us - params.pre_event_us;
+    while (ring.size() > 1) {
+      auto next = std::find_if(ring.begin() + 1, ring.end(),
+                               [](const EventPacket &p) { return p.keyframe; });
+      if (next == ring.end() || next->arrival_us > horizon) {
+        break;
+      }
+      drop_front_group();
+    }
+
+    while (held_bytes > params.max_bytes) {
+      if (!drop_front_group()) {
+        // a single group larger than the ring: nothing decodable fits
+        clear();
+        counters.overflows++;
+        return false;
+      }
+    }
+    counters.peak_bytes = std::max(counters.peak_bytes, held_bytes);
+    return true;
+  }
+
+  std::vector<EventPacket>
+  EventRing::snapshot() const {
+    return std::vector<EventPacket>(ring.begin(), ring.end());
+  }
+
+  void
+  EventRing::clear() {
+    ring.clear();
+    held_bytes = 0;
+  }
+
+  int64_t
+  EventRing::span_us() const {
+    return ring.empty() ? 0 : ring.back().arrival_us - ring.front().arrival_us;
+  }
+}
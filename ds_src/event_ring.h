@@ -0,0 +1,77 @@
+#ifndef __HERMES_EVENT_RING_H__
+#define __HERMES_EVENT_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+/* Compressed video of one source for the seconds before a fire event, so a
+ * clip of it can be written without re-encoding. Packets are opaque and
+ * shared: a copy of the ring holds references, not bytes. Kept free of
+ * GStreamer and DeepStream types so it builds and runs on the host alone. */
+namespace WildFireDetection {
+
+  /* An encoded frame, data is released with its last reference */
+  struct EventPacket {
+    std::shared_ptr<const void> data;
+    size_t size = 0;
+    // decodable on its own, a clip starts at one
+    bool keyframe = false;
+    // when it reached the ring, clips are cut in this time
+    int64_t arrival_us = 0;
+  };
+
+  struct EventRingParams {
+    // bytes of packets held, never exceeded
+    size_t max_bytes = 16 << 20;
+    // kept before the newest packet, from the keyframe at or before it
+    int64_t pre_event_us = 10000000;
+  };
+
+  struct EventRingStats {
+    uint64_t packets = 0;
+    // delta frames with no keyframe before them in the ring
+    uint64_t dropped = 0;
+    // a group of pictures outgrew max_bytes and the ring was emptied
+    uint64_t overflows = 0;
+    size_t peak_bytes = 0;
+  };
+
+  /* Starts at a keyframe and spans pre_event_us, or less to stay within
+   * max_bytes: whole groups of pictures are dropped from the front. A group
+   * that alone outgrows max_bytes empties the ring, which then waits for
+   * the next keyframe. Not thread safe. */
+  class EventRing {
+    public:
+      EventRing() {}
+      explicit EventRing(const EventRingParams &params);
+
+      // false when the packet was not kept
+      bool push(const EventPacket &packet);
+
+      // The packets held, oldest first, starting at a keyframe
+      std::vector<EventPacket> snapshot() const;
+
+      void clear();
+
+      size_t bytes() const { return held_bytes; }
+      size_t packets() const { return ring.size(); }
+      // arrival of the newest packet less that of the oldest
+      int64_t span_us() const;
+      const EventRingStats &stats() const { return counters; }
+      const EventRingParams &settings() const { return params; }
+
+    private:
+      // Drops the packets before the next keyframe after the first, false without one
+      bool drop_front_group();
+
+      EventRingParams params;
+      std::deque<EventPacket> ring;
+      size_t held_bytes = 0;
+      EventRingStats counters;
+  };
+}
+
+#endif // __HERMES_EVENT_RING_H__
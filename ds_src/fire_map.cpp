@@ -0,0 +1,376 @@
+#include "fire_map.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "benchmark.h"
+
+namespace WildFireDetection {
+
+  namespace {
+    const double EARTH_RADIUS_M = 6371000.0;
+
+    double
+    radians(double degrees) {
+      return degrees * M_PI / 180.0;
+    }
+
+    struct Vector3 {
+      double east;
+      double north;
+      double up;
+    };
+
+    double
+    dot(const Vector3 &a, const Vector3 &b) {
+      return a.east * b.east + a.north * b.north + a.up * b.up;
+    }
+
+    /* Camera axes in east/north/up: x to the right of the image, y down the
+     * image, z along the optical axis. */
+    void
+    camera_axes(const DronePose &pose, Vector3 &x, Vector3 &y, Vector3 &z) {
+      double yaw = radians(pose.yaw_deg);
+      double pitch = radians(pose.pitch_deg);
+      Vector3 forward = {std::sin(yaw), std::cos(yaw), 0};
+      Vector3 up = {0, 0, 1};
+      x = {std::cos(yaw), -std::sin(yaw), 0};
+      y = {-(std::sin(pitch) * forward.east), -(std::sin(pitch) * forward.north),
+           -(std::cos(pitch) * up.up)};
+      z = {std::cos(pitch) * forward.east, std::cos(pitch) * forward.north,
+           -std::sin(pitch) * up.up};
+    }
+  }
+
+  CameraIntrinsics
+  intrinsics_from_fov(unsigned int width, unsigned int height, double horizontal_fov_deg) {
+    CameraIntrinsics camera;
+    camera.fx = camera.fy = (width / 2.0) / std::tan(radians(horizontal_fov_deg) / 2);
+    camera.cx = width / 2.0;
+    camera.cy = height / 2.0;
+    return camera;
+  }
+
+  GeoPoint
+  geo_offset(const GeoPoint &origin, double east_m, double north_m) {
+    GeoPoint point;
+    point.latitude = origin.latitude + north_m / EARTH_RADIUS_M * 180.0 / M_PI;
+    point.longitude = origin.longitude +
+        east_m / (EARTH_RADIUS_M * std::cos(radians(origin.latitude))) * 180.0 / M_PI;
+    return point;
+  }
+
+  double
+  geo_distance_m(const GeoPoint &a, const GeoPoint &b) {
+    double north = radians(b.latitude - a.latitude) * EARTH_RADIUS_M;
+    double east = radians(b.longitude - a.longitude) * EARTH_RADIUS_M *
+                  std::cos(radians((a.latitude + b.latitude) / 2));
+    return std::hypot(east, north);
+  }
+
+  bool
+  project_to_ground(const CameraIntrinsics &camera, const DronePose &pose, double u, double v,
+                    GeoPoint &ground) {
+    if (camera.fx <= 0 || camera.fy <= 0 || pose.height_m <= 0) {
+      return false;
+    }
+    Vector3 x, y, z;
+    camera_axes(pose, x, y, z);
+    double xc = (u - camera.cx) / camera.fx;
+    double yc = (v - camera.cy) / camera.fy;
+    Vector3 ray = {xc * x.east + yc * y.east + z.east, xc * x.north + yc * y.north + z.north,
+                   xc * x.up + yc * y.up + z.up};
+    // at or above the horizon the ray never meets the ground
+    if (ray.up > -1e-6) {
+      return false;
+    }
+    double t = pose.height_m / -ray.up;
+    ground = geo_offset(pose.position, t * ray.east, t * ray.north);
+    return true;
+  }
+
+  bool
+  project_to_image(const CameraIntrinsics &camera, const DronePose &pose, const GeoPoint &ground,
+                   double &u, double &v) {
+    Vector3 x, y, z;
+    camera_axes(pose, x, y, z);
+    Vector3 p = {radians(ground.longitude - pose.position.longitude) * EARTH_RADIUS_M *
+                     std::cos(radians(pose.position.latitude)),
+                 radians(ground.latitude - pose.position.latitude) * EARTH_RADIUS_M,
+                 -pose.height_m};
+    double zc = dot(p, z);
+    if (zc <= 0) {
+      return false;
+    }
+    u = camera.fx * dot(p, x) / zc + camera.cx;
+    v = camera.fy * dot(p, y) / zc + camera.cy;
+    return true;
+  }
+
+  FireMap::FireMap(const FireMapParams &params)
+    : params(params) {
+  }
+
+  FireMap::Local
+  FireMap::to_local(const GeoPoint &point) const {
+    return {radians(point.longitude - origin.longitude) * EARTH_RADIUS_M *
+                std::cos(radians(origin.latitude)),
+            radians(point.latitude - origin.latitude) * EARTH_RADIUS_M};
+  }
+
+  int64_t
+  FireMap::cell_key(const Local &local) const {
+    int64_t column = (int64_t)std::floor(local.x / params.merge_radius_m);
+    int64_t row = (int64_t)std::floor(local.y / params.merge_radius_m);
+    return (row << 32) ^ (column & 0xffffffff);
+  }
+
+  void
+  FireMap::add_to_cell(int64_t key, uint64_t id) {
+    cells[key].push_back(id);
+  }
+
+  void
+  FireMap::remove_from_cell(int64_t key, uint64_t id) {
+    auto cell = cells.find(key);
+    if (cell == cells.end()) {
+      return;
+    }
+    auto &ids = cell->second;
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+    if (ids.empty()) {
+      cells.erase(cell);
+    }
+  }
+
+  double
+  FireMap::decayed(const FireCluster &cluster, int64_t now_us) const {
+    double age_s = std::max<int64_t>(0, now_us - cluster.last_seen_us) / 1e6;
+    return cluster.weight * std::exp(-age_s / params.decay_s);
+  }
+
+  FireObservation
+  FireMap::insert(const GeoPoint &point, unsigned int source_id, int64_t timestamp_us) {
+    FireObservation observation;
+    if (!has_origin) {
+      origin = point;
+      has_origin = true;
+      last_expire_us = timestamp_us;
+    }
+    // a full sweep now and then, amortized over the inserts in between
+    if (timestamp_us - last_expire_us > params.decay_s * 1e6 / 4) {
+      expire(timestamp_us);
+    }
+
+    Local local = to_local(point);
+    int64_t column = (int64_t)std::floor(local.x / params.merge_radius_m);
+    int64_t row = (int64_t)std::floor(local.y / params.merge_radius_m);
+
+    FireCluster *nearest = NULL;
+    double nearest_m = params.merge_radius_m;
+    for (int64_t dr = -1; dr <= 1; dr++) {
+      for (int64_t dc = -1; dc <= 1; dc++) {
+        auto cell = cells.find(((row + dr) << 32) ^ ((column + dc) & 0xffffffff));
+        if (cell == cells.end()) {
+          continue;
+        }
+        for (uint64_t id : cell->second) {
+          FireCluster &cluster = cluster_by_id[id];
+          Local other = to_local(cluster.position);
+          double distance = std::hypot(other.x - local.x, other.y - local.y);
+          if (distance <= nearest_m && decayed(cluster, timestamp_us) >= params.min_weight) {
+            nearest = &cluster;
+            nearest_m = distance;
+          }
+        }
+      }
+    }
+
+    if (!nearest) {
+      FireCluster cluster;
+      cluster.id = next_id++;
+      cluster.position = point;
+      cluster.weight = 1;
+      cluster.first_seen_us = cluster.last_seen_us = timestamp_us;
+      cluster.observations = 1;
+      cluster.sources = 1ull << (source_id % 64);
+      cluster_by_id[cluster.id] = cluster;
+      add_to_cell(cell_key(local), cluster.id);
+      observation.cluster_id = cluster.id;
+      observation.new_cluster = true;
+      return observation;
+    }
+
+    int64_t old_key = cell_key(to_local(nearest->position));
+    double weight = decayed(*nearest, timestamp_us);
+    double share = 1.0 / (weight + 1);
+    nearest->position.latitude += (point.latitude - nearest->position.latitude) * share;
+    nearest->position.longitude += (point.longitude - nearest->position.longitude) * share;
+    nearest->weight = weight + 1;
+    nearest->last_seen_us = std::max(nearest->last_seen_us, timestamp_us);
+    nearest->observations++;
+    nearest->sources |= 1ull << (source_id % 64);
+
+    int64_t new_key = cell_key(to_local(nearest->position));
+    if (new_key != old_key) {
+      remove_from_cell(old_key, nearest->id);
+      add_to_cell(new_key, nearest->id);
+    }
+    observation.cluster_id = nearest->id;
+    return observation;
+  }
+
+  std::vector<FireCluster>
+  FireMap::query(const GeoPoint &center, double radius_m, int64_t now_us) const {
+    std::vector<std::pair<double, FireCluster>> found;
+    if (has_origin) {
+      Local local = to_local(center);
+      int64_t reach = (int64_t)std::ceil(radius_m / params.merge_radius_m);
+      int64_t column = (int64_t)std::floor(local.x / params.merge_radius_m);
+      int64_t row = (int64_t)std::floor(local.y / params.merge_radius_m);
+      for (int64_t dr = -reach; dr <= reach; dr++) {
+        for (int64_t dc = -reach; dc <= reach; dc++) {
+          auto cell = cells.find(((row + dr) << 32) ^ ((column + dc) & 0xffffffff));
+          if (cell == cells.end()) {
+            continue;
+          }
+          for (uint64_t id : cell->second) {
+            FireCluster cluster = cluster_by_id.at(id);
+            Local other = to_local(cluster.position);
+            double distance = std::hypot(other.x - local.x, other.y - local.y);
+            cluster.weight = decayed(cluster, now_us);
+            if (distance <= radius_m && cluster.weight >= params.min_weight) {
+              found.emplace_back(distance, cluster);
+            }
+          }
+        }
+      }
+    }
+    std::sort(found.begin(), found.end(),
+              [](const std::pair<double, FireCluster> &a, const std::pair<double, FireCluster> &b) {
+                return a.first < b.first;
+              });
+    std::vector<FireCluster> result;
+    for (const auto &entry : found) {
+      result.push_back(entry.second);
+    }
+    return result;
+  }
+
+  std::vector<FireCluster>
+  FireMap::clusters(int64_t now_us) const {
+    std::vector<FireCluster> result;
+    for (const auto &entry : cluster_by_id) {
+      FireCluster cluster = entry.second;
+      cluster.weight = decayed(cluster, now_us);
+      if (cluster.weight >= params.min_weight) {
+        result.push_back(cluster);
+      }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const FireCluster &a, const FireCluster &b) { return a.id < b.id; });
+    return result;
+  }
+
+  size_t
+  FireMap::expire(int64_t now_us) {
+    size_t expired = 0;
+    last_expire_us = now_us;
+    for (auto entry = cluster_by_id.begin(); entry != cluster_by_id.end();) {
+      if (decayed(entry->second, now_us) < params.min_weight) {
+        remove_from_cell(cell_key(to_local(entry->second.position)), entry->first);
+        entry = cluster_by_id.erase(entry);
+        expired++;
+      }
+      else {
+        entry++;
+      }
+    }
+    return expired;
+  }
+
+  FireMapBenchmarkResult
+  run_fire_map_benchmark(const FireMapBenchmarkSettings &settings) {
+    FireMapBenchmarkResult result;
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> area(-settings.area_m / 2, settings.area_m / 2);
+    std::normal_distribution<double> noise(0, settings.pixel_noise);
+
+    GeoPoint center;
+    center.latitude = 37.4;
+    center.longitude = -122.1;
+    std::vector<GeoPoint> fires;
+    for (unsigned int i = 0; i < settings.fires; i++) {
+      fires.push_back(geo_offset(center, area(random), area(random)));
+    }
+
+    CameraIntrinsics camera =
+        intrinsics_from_fov(settings.width, settings.height, settings.horizontal_fov_deg);
+    FireMap map(settings.params);
+    std::vector<bool> seen(fires.size(), false);
+    std::vector<int64_t> query_ns;
+    double insert_s = 0;
+    unsigned int frames = (unsigned int)(settings.duration_s * settings.fps);
+
+    for (unsigned int frame = 0; frame < frames; frame++) {
+      double t = frame / settings.fps;
+      int64_t timestamp_us = (int64_t)(t * 1e6);
+
+      for (unsigned int drone = 0; drone < settings.drones; drone++) {
+        // circles of different radius and phase, camera facing the direction of flight
+        double radius = settings.area_m * (0.15 + 0.3 * drone / std::max(1u, settings.drones));
+        double angle = t * 10.0 / radius + 2 * M_PI * drone / std::max(1u, settings.drones);
+        DronePose pose;
+        pose.position = geo_offset(center, radius * std::sin(angle), radius * std::cos(angle));
+        pose.height_m = settings.height_m;
+        pose.pitch_deg = settings.pitch_deg;
+        pose.yaw_deg = std::fmod(angle * 180.0 / M_PI + 90.0, 360.0);
+
+        for (size_t i = 0; i < fires.size(); i++) {
+          double u, v;
+          if (!project_to_image(camera, pose, fires[i], u, v) || u < 0 || v < 0 ||
+              u >= settings.width || v >= settings.height) {
+            continue;
+          }
+          GeoPoint ground;
+          if (!project_to_ground(camera, pose, u + noise(random), v + noise(random), ground)) {
+            continue;
+          }
+          auto start = std::chrono::steady_clock::now();
+          map.insert(ground, drone, timestamp_us);
+          insert_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+          result.inserts++;
+          seen[i] = true;
+        }
+      }
+
+      const GeoPoint &probe = fires[frame % fires.size()];
+      auto start = std::chrono::steady_clock::now();
+      map.query(probe, settings.params.merge_radius_m * 2, timestamp_us);
+      query_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count());
+    }
+
+    int64_t end_us = (int64_t)(settings.duration_s * 1e6);
+    result.inserts_per_s = insert_s > 0 ? result.inserts / insert_s : 0;
+    // queries take well under a microsecond: nanosecond samples come back as microseconds
+    LatencyPercentiles percentiles = latency_percentiles(query_ns);
+    result.query_p50_us = percentiles.p50_ms;
+    result.query_p99_us = percentiles.p99_ms;
+
+    double error_m = 0;
+    for (size_t i = 0; i < fires.size(); i++) {
+      if (!seen[i]) {
+        continue;
+      }
+      result.fires_seen++;
+      std::vector<FireCluster> near = map.query(fires[i], settings.area_m, end_us);
+      error_m += near.empty() ? settings.area_m : geo_distance_m(near.front().position, fires[i]);
+    }
+    result.mean_error_m = result.fires_seen ? error_m / result.fires_seen : 0;
+    result.clusters = map.clusters(end_us).size();
+    return result;
+  }
+}
@@ -0,0 +1,166 @@
+#ifndef __HERMES_FIRE_MAP_H__
+#define __HERMES_FIRE_MAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+/* Ground projection of detections and a map of fires merged across drones.
+ * Kept free of GStreamer and DeepStream types so it builds and runs on the
+ * host alone. Distances use a local flat earth, fine over a few kilometres. */
+namespace WildFireDetection {
+
+  struct GeoPoint {
+    double latitude = 0;
+    double longitude = 0;
+  };
+
+  /* Pinhole model in pixels of the frame the boxes refer to. */
+  struct CameraIntrinsics {
+    double fx = 0;
+    double fy = 0;
+    double cx = 0;
+    double cy = 0;
+  };
+
+  /* Square pixels, principal point at the centre. */
+  CameraIntrinsics
+  intrinsics_from_fov(unsigned int width, unsigned int height, double horizontal_fov_deg);
+
+  struct DronePose {
+    GeoPoint position;
+    // above the (flat) ground
+    double height_m = 0;
+    // heading of the camera, clockwise from north
+    double yaw_deg = 0;
+    // tilt of the camera below the horizon, 90 looks straight down
+    double pitch_deg = 90;
+  };
+
+  /* Point reached by going east_m and north_m from origin. */
+  GeoPoint
+  geo_offset(const GeoPoint &origin, double east_m, double north_m);
+
+  double
+  geo_distance_m(const GeoPoint &a, const GeoPoint &b);
+
+  /* Where the ray through pixel (u, v) meets the ground, false above the
+   * horizon. */
+  bool
+  project_to_ground(const CameraIntrinsics &camera, const DronePose &pose, double u, double v,
+                    GeoPoint &ground);
+
+  /* Pixel a ground point is seen at, false behind the camera. The result may
+   * lie outside the frame. */
+  bool
+  project_to_image(const CameraIntrinsics &camera, const DronePose &pose, const GeoPoint &ground,
+                   double &u, double &v);
+
+  struct FireMapParams {
+    // observations closer than this to a cluster join it
+    double merge_radius_m = 15;
+    // time constant of the exponential decay of cluster weights
+    double decay_s = 120;
+    // clusters fading below this weight are forgotten
+    double min_weight = 0.05;
+  };
+
+  struct FireCluster {
+    uint64_t id = 0;
+    // weighted mean of the observations
+    GeoPoint position;
+    // decayed number of observations, as of last_seen_us
+    double weight = 0;
+    int64_t first_seen_us = 0;
+    int64_t last_seen_us = 0;
+    uint64_t observations = 0;
+    // bit n: seen by source n (modulo 64)
+    uint64_t sources = 0;
+  };
+
+  struct FireObservation {
+    uint64_t cluster_id = 0;
+    // a fire nobody reported before, the one observation worth an alert
+    bool new_cluster = false;
+  };
+
+  /* Clusters in a hash grid of merge_radius_m cells around the first point
+   * inserted; an insert or a query looks at the 3x3 cells around the point
+   * only. Not thread safe. */
+  class FireMap {
+    public:
+      FireMap() {}
+      explicit FireMap(const FireMapParams &params);
+
+      FireObservation insert(const GeoPoint &point, unsigned int source_id, int64_t timestamp_us);
+
+      // Live clusters within radius_m of center, nearest first
+      std::vector<FireCluster> query(const GeoPoint &center, double radius_m, int64_t now_us) const;
+
+      // All live clusters, weights decayed to now_us
+      std::vector<FireCluster> clusters(int64_t now_us) const;
+
+      // Forgets faded clusters, returns how many
+      size_t expire(int64_t now_us);
+
+      size_t size() const { return cluster_by_id.size(); }
+
+    private:
+      struct Local {
+        double x;
+        double y;
+      };
+
+      Local to_local(const GeoPoint &point) const;
+      int64_t cell_key(const Local &local) const;
+      void add_to_cell(int64_t key, uint64_t id);
+      void remove_from_cell(int64_t key, uint64_t id);
+      double decayed(const FireCluster &cluster, int64_t now_us) const;
+
+      FireMapParams params;
+      bool has_origin = false;
+      GeoPoint origin;
+      uint64_t next_id = 1;
+      int64_t last_expire_us = 0;
+      std::unordered_map<uint64_t, FireCluster> cluster_by_id;
+      std::unordered_map<int64_t, std::vector<uint64_t>> cells;
+  };
+
+  struct FireMapBenchmarkSettings {
+    unsigned int drones = 4;
+    unsigned int fires = 20;
+    // square area the fires are scattered over
+    double area_m = 1000;
+    // simulated flight, every drone reports every frame
+    double duration_s = 600;
+    double fps = 30;
+    double height_m = 60;
+    double pitch_deg = 60;
+    unsigned int width = 960;
+    unsigned int height = 720;
+    double horizontal_fov_deg = 82.6;
+    // detector jitter on the box bottom centre
+    double pixel_noise = 2;
+    FireMapParams params;
+  };
+
+  struct FireMapBenchmarkResult {
+    uint64_t inserts = 0;
+    double inserts_per_s = 0;
+    double query_p50_us = 0;
+    double query_p99_us = 0;
+    // clusters left for the fires that were seen, ideally equal
+    unsigned int fires_seen = 0;
+    size_t clusters = 0;
+    double mean_error_m = 0;
+  };
+
+  /* Drones circle over scattered fires, every fire in view yields a noisy
+   * box that is projected and inserted; a query around a random fire
+   * follows every frame. */
+  FireMapBenchmarkResult
+  run_fire_map_benchmark(const FireMapBenchmarkSettings &settings);
+}
+
+#endif // __HERMES_FIRE_MAP_H__
@@ -0,0 +1,183 @@
+#include "governor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace WildFireDetection {
+
+  namespace {
+    // moves smoothed toward reading, a NaN on either side takes the other
+    double
+    smooth(double smoothed, double reading, double weight) {
+      if (std::isnan(reading)) {
+        return smoothed;
+      }
+      if (std::isnan(smoothed)) {
+        return reading;
+      }
+      return smoothed + weight * (reading - smoothed);
+    }
+  }
+
+  Governor::Governor(const GovernorParams &params, unsigned int base_interval)
+      : params(params), smoothed_temp(NAN), smoothed_power(NAN) {
+    GovernorDecision step;
+    step.interval = base_interval;
+    ladder.push_back(step);
+
+    if (params.display_fps) {
+      step.level++;
+      step.display_fps = params.display_fps;
+      ladder.push_back(step);
+    }
+
+    // source_fps / (interval + 1) inferences per second stay at min_detection_fps or above
+    unsigned int max_interval = base_interval;
+    if (params.min_detection_fps > 0 && params.source_fps > params.min_detection_fps) {
+      max_interval = std::max(base_interval,
+                              (unsigned int)(params.source_fps / params.min_detection_fps) - 1);
+    }
+    while (step.interval < max_interval) {
+      step.level++;
+      step.interval = std::min(max_interval, 2 * step.interval + 1);
+      ladder.push_back(step);
+    }
+
+    if (params.fallback_model) {
+      step.level++;
+      step.fallback_model = true;
+      ladder.push_back(step);
+    }
+  }
+
+  GovernorAction
+  Governor::update(const GovernorSample &sample) {
+    counters.samples++;
+    if (last_us >= 0 && current > 0 && sample.time_us > last_us) {
+      counters.throttled_us += sample.time_us - last_us;
+    }
+
+    if (std::isnan(sample.temp_c) && std::isnan(sample.power_w)) {
+      counters.missing++;
+      last_us = sample.time_us;
+      return GovernorAction::NO_READING;
+    }
+    if (!std::isnan(sample.temp_c)) {
+      counters.peak_temp_c = std::max(counters.peak_temp_c, sample.temp_c);
+    }
+    if (!std::isnan(sample.power_w)) {
+      counters.peak_power_w = std::max(counters.peak_power_w, sample.power_w);
+    }
+
+    double weight = 1;
+    if (last_us >= 0 && params.smoothing_s > 0) {
+      double dt_s = std::max<int64_t>(0, sample.time_us - last_us) / 1e6;
+      weight = 1 - std::exp(-dt_s / params.smoothing_s);
+    }
+    smoothed_temp = smooth(smoothed_temp, sample.temp_c, weight);
+    smoothed_power = smooth(smoothed_power, sample.power_w, weight);
+    last_us = sample.time_us;
+
+    unsigned int top = ladder.size() - 1;
+    // Not smoothed, the board shuts down on its own not far above
+    if (sample.temp_c >= params.temp_critical_c) {
+      calm_since_us = -1;
+      if (current == top) {
+        return GovernorAction::HOLD;
+      }
+      current = top;
+      changed_us = sample.time_us;
+      counters.critical++;
+      return GovernorAction::CRITICAL;
+    }
+
+    bool power_limited = params.power_high_w > 0 && !std::isnan(smoothed_power);
+    bool over = smoothed_temp >= params.temp_high_c ||
+                (power_limited && smoothed_power >= params.power_high_w);
+    bool under = !(smoothed_temp > params.temp_high_c - params.temp_hysteresis_c) &&
+                 !(power_limited && smoothed_power > params.power_high_w - params.power_hysteresis_w);
+
+    if (over) {
+      calm_since_us = -1;
+      if (current < top &&
+          (changed_us < 0 || sample.time_us - changed_us >= params.step_up_s * 1e6)) {
+        current++;
+        changed_us = sample.time_us;
+        counters.steps_up++;
+        return GovernorAction::STEP_UP;
+      }
+      return GovernorAction::HOLD;
+    }
+    if (!under) {
+      // between the limits and the hysteresis, where it is
+      calm_since_us = -1;
+      return GovernorAction::HOLD;
+    }
+
+    if (calm_since_us < 0) {
+      calm_since_us = sample.time_us;
+    }
+    if (current > 0 && sample.time_us - calm_since_us >= params.step_down_s * 1e6) {
+      current--;
+      changed_us = sample.time_us;
+      // the next step down waits as long again
+      calm_since_us = sample.time_us;
+      counters.steps_down++;
+      return GovernorAction::STEP_DOWN;
+    }
+    return GovernorAction::HOLD;
+  }
+
+  const char *
+  governor_action_name(GovernorAction action) {
+    switch (action) {
+    case GovernorAction::HOLD:
+      return "hold";
+    case GovernorAction::STEP_UP:
+      return "step up";
+    case GovernorAction::STEP_DOWN:
+      return "step down";
+    case GovernorAction::CRITICAL:
+      return "critical";
+    case GovernorAction::NO_READING:
+      return "no reading";
+    }
+    return "unknown";
+  }
+
+  bool
+  read_sensor(const std::string &path, double scale, double &value) {
+    std::ifstream file(path);
+    double raw;
+    if (!(file >> raw)) {
+      return false;
+    }
+    value = raw * scale;
+    return true;
+  }
+
+  double
+  read_temperature(const std::vector<std::string> &paths, double scale) {
+    double hottest = NAN;
+    for (const std::string &path : paths) {
+      double value;
+      if (read_sensor(path, scale, value) && !(value <= hottest)) {
+        hottest = value;
+      }
+    }
+    return hottest;
+  }
+
+  double
+  read_power(const std::vector<std::string> &paths, double scale) {
+    double total = NAN;
+    for (const std::string &path : paths) {
+      double value;
+      if (read_sensor(path, scale, value)) {
+        total = std::isnan(total) ? value : total + value;
+      }
+    }
+    return total;
+  }
+}
@@ -0,0 +1,132 @@
+#ifndef __HERMES_GOVERNOR_H__
+#define __HERMES_GOVERNOR_H__
+
+#include <stdint.h>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/* Keeps a Jetson inside a temperature and power envelope by having the
+ * pipeline do less: a lower display rate first, then fewer inferences, then
+ * a lighter model, never fewer detections per second than asked for. Kept
+ * free of GStreamer and DeepStream types so it builds and runs on the host
+ * alone, and sensor traces can be replayed through it. */
+namespace WildFireDetection {
+
+  struct GovernorParams {
+    // degrees C of the hottest zone, smoothed, above which work is shed
+    double temp_high_c = 80;
+    // a single reading above it sheds everything at once
+    double temp_critical_c = 90;
+    // watts of all rails, smoothed, 0 for no limit
+    double power_high_w = 0;
+    // how far below the limits readings stay before work comes back
+    double temp_hysteresis_c = 5;
+    double power_hysteresis_w = 1;
+    // time constant of the smoothing, sensors are noisy
+    double smoothing_s = 5;
+    // least time between two steps up
+    double step_up_s = 10;
+    // time below the limits before each step down
+    double step_down_s = 60;
+    // frames per second of every source
+    double source_fps = 30;
+    // inferences per second of every source, the interval stops short of it
+    double min_detection_fps = 2;
+    // display rate once throttled, 0 leaves the display alone
+    unsigned int display_fps = 5;
+    // a lighter model is the last step
+    bool fallback_model = false;
+  };
+
+  /* Readings at one time, NaN for one no sensor could give */
+  struct GovernorSample {
+    int64_t time_us = 0;
+    double temp_c = NAN;
+    double power_w = NAN;
+  };
+
+  /* What the pipeline runs at on one step of the ladder */
+  struct GovernorDecision {
+    // 0 is full work
+    unsigned int level = 0;
+    // frames skipped between inferences, nvinfer's interval
+    unsigned int interval = 0;
+    // 0 for no limit
+    unsigned int display_fps = 0;
+    bool fallback_model = false;
+  };
+
+  enum class GovernorAction {
+    HOLD,
+    STEP_UP,
+    STEP_DOWN,
+    // to the last step at once
+    CRITICAL,
+    // no sensor could be read, nothing changes
+    NO_READING
+  };
+
+  struct GovernorStats {
+    uint64_t samples = 0;
+    uint64_t missing = 0;
+    uint64_t steps_up = 0;
+    uint64_t steps_down = 0;
+    uint64_t critical = 0;
+    // time spent above level 0
+    int64_t throttled_us = 0;
+    double peak_temp_c = 0;
+    double peak_power_w = 0;
+  };
+
+  /* Steps one level at a time, each step halving the inference rate until
+   * min_detection_fps. Readings are smoothed exponentially; going up takes
+   * them over a limit, coming down takes step_down_s under both limits less
+   * the hysteresis. Not thread safe. */
+  class Governor {
+    public:
+      Governor() : Governor(GovernorParams(), 0) {}
+      // base_interval is the interval the detector was configured with
+      Governor(const GovernorParams &params, unsigned int base_interval);
+
+      GovernorAction update(const GovernorSample &sample);
+
+      const GovernorDecision &decision() const { return ladder[current]; }
+      // the steps, full work first
+      const std::vector<GovernorDecision> &steps() const { return ladder; }
+      // smoothed readings, NaN until a sensor gave one
+      double temp_c() const { return smoothed_temp; }
+      double power_w() const { return smoothed_power; }
+      const GovernorStats &stats() const { return counters; }
+
+    private:
+      GovernorParams params;
+      std::vector<GovernorDecision> ladder;
+      unsigned int current = 0;
+      double smoothed_temp;
+      double smoothed_power;
+      int64_t last_us = -1;
+      int64_t changed_us = -1;
+      // since when readings have been under the limits, -1 while over
+      int64_t calm_since_us = -1;
+      GovernorStats counters;
+  };
+
+  const char *
+  governor_action_name(GovernorAction action);
+
+  /* A sysfs reading: the number in the file times scale, false when it
+   * cannot be read */
+  bool
+  read_sensor(const std::string &path, double scale, double &value);
+
+  // The hottest of the zones that can be read, NaN for none
+  double
+  read_temperature(const std::vector<std::string> &paths, double scale);
+
+  // The sum of the rails that can be read, NaN for none
+  double
+  read_power(const std::vector<std::string> &paths, double scale);
+}
+
+#endif // __HERMES_GOVERNOR_H__
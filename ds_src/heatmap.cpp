@@ -0,0 +1,203 @@
+#include "heatmap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace WildFireDetection {
+
+  namespace {
+    // below this a cell is cold, and kept away from denormals
+    const float COLD = 1e-6f;
+
+    /* A plain loop over restrict pointers, vectorized at -O3 (see the
+     * Makefile): a multiply and a select per cell */
+    void
+    decay_cells(float *__restrict__ cells, size_t count, float factor) {
+      for (size_t i = 0; i < count; i++) {
+        float value = cells[i] * factor;
+        cells[i] = value < COLD ? 0.0f : value;
+      }
+    }
+
+    void
+    add_to_row(float *__restrict__ row, unsigned int first, unsigned int last, float amount) {
+      for (unsigned int x = first; x < last; x++) {
+        row[x] += amount;
+      }
+    }
+
+    double
+    percentile(std::vector<double> &samples, double fraction) {
+      if (samples.empty()) {
+        return 0;
+      }
+      size_t index = std::min(samples.size() - 1, (size_t)(samples.size() * fraction));
+      std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+      return samples[index];
+    }
+  }
+
+  Heatmap::Heatmap(const HeatmapParams &params)
+      : params(params), values((size_t)params.width * params.height, 0.0f) {}
+
+  void
+  Heatmap::begin_frame(int64_t timestamp_us) {
+    if (last_us < 0 || timestamp_us < last_us) {
+      // no time has passed that the detections could stand for
+      last_us = timestamp_us;
+      gain = 0;
+      return;
+    }
+    float factor = (float)std::exp(-(timestamp_us - last_us) / (params.decay_s * 1e6));
+    last_us = timestamp_us;
+    gain = 1.0f - factor;
+    decay_cells(values.data(), values.size(), factor);
+  }
+
+  void
+  Heatmap::add(float left, float top, float width, float height, float confidence) {
+    if (values.empty() || !(confidence > 0)) {
+      return;
+    }
+    // wholly outside the frame it touches no cell, not even the nearest edge
+    if (left >= 1 || top >= 1 || left + width < 0 || top + height < 0) {
+      return;
+    }
+    // every cell the box touches, at least one
+    int x0 = std::max(0, (int)std::floor(left * params.width));
+    int y0 = std::max(0, (int)std::floor(top * params.height));
+    int x1 = std::min((int)params.width, std::max(x0 + 1, (int)std::ceil((left + width) * params.width)));
+    int y1 = std::min((int)params.height, std::max(y0 + 1, (int)std::ceil((top + height) * params.height)));
+    float amount = gain * confidence;
+    for (int y = y0; y < y1; y++) {
+      add_to_row(values.data() + (size_t)y * params.width, x0, x1, amount);
+    }
+  }
+
+  float
+  Heatmap::peak(unsigned int &x, unsigned int &y) const {
+    x = y = 0;
+    if (values.empty()) {
+      return 0;
+    }
+    size_t hottest = std::max_element(values.begin(), values.end()) - values.begin();
+    x = hottest % params.width;
+    y = hottest / params.width;
+    return values[hottest];
+  }
+
+  size_t
+  Heatmap::count_above(float threshold) const {
+    return std::count_if(values.begin(), values.end(),
+                         [threshold](float value) { return value >= threshold; });
+  }
+
+  std::vector<HeatmapRun>
+  heatmap_runs(const Heatmap &heatmap, float threshold, float full_scale, unsigned int levels,
+               size_t max_runs) {
+    std::vector<HeatmapRun> runs;
+    levels = std::max(1u, levels);
+    float band = std::max(full_scale - threshold, 1e-6f) / levels;
+
+    for (unsigned int y = 0; y < heatmap.height(); y++) {
+      HeatmapRun run;
+      for (unsigned int x = 0; x <= heatmap.width(); x++) {
+        unsigned int level = 0;
+        if (x < heatmap.width() && heatmap.at(x, y) >= threshold) {
+          level = std::min(levels, 1 + (unsigned int)((heatmap.at(x, y) - threshold) / band));
+        }
+        if (run.level && level == run.level) {
+          run.last = x + 1;
+          continue;
+        }
+        if (run.level) {
+          runs.push_back(run);
+        }
+        run.row = y;
+        run.first = x;
+        run.last = x + 1;
+        run.level = level;
+      }
+    }
+
+    if (runs.size() > max_runs) {
+      std::stable_sort(runs.begin(), runs.end(), [](const HeatmapRun &a, const HeatmapRun &b) {
+        return a.level > b.level;
+      });
+      runs.resize(max_runs);
+    }
+    return runs;
+  }
+
+  std::string
+  heatmap_pgm(const Heatmap &heatmap, float full_scale) {
+    std::string pgm = "P5\n" + std::to_string(heatmap.width()) + " " +
+                      std::to_string(heatmap.height()) + "\n255\n";
+    size_t header = pgm.size();
+    size_t count = (size_t)heatmap.width() * heatmap.height();
+    pgm.resize(header + count);
+    float scale = full_scale > 0 ? 255.0f / full_scale : 0.0f;
+    for (size_t i = 0; i < count; i++) {
+      pgm[header + i] = (char)(uint8_t)std::min(255.0f, heatmap.cells()[i] * scale + 0.5f);
+    }
+    return pgm;
+  }
+
+  HeatmapBenchmarkResult
+  run_heatmap_benchmark(const HeatmapBenchmarkSettings &settings) {
+    HeatmapBenchmarkResult result;
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    struct Fire {
+      float x, y, w, h, vx, vy, confidence;
+    };
+    std::vector<Heatmap> maps(settings.sources, Heatmap(settings.params));
+    std::vector<std::vector<Fire>> fires(settings.sources);
+    for (std::vector<Fire> &source : fires) {
+      for (unsigned int i = 0; i < settings.detections; i++) {
+        source.push_back({unit(random) * 0.9f, unit(random) * 0.9f, 0.02f + 0.08f * unit(random),
+                          0.02f + 0.08f * unit(random), (unit(random) - 0.5f) * 0.002f,
+                          (unit(random) - 0.5f) * 0.002f, 0});
+      }
+    }
+
+    std::vector<double> frame_us;
+    std::vector<double> batch_us;
+    double decay_s = 0;
+    for (unsigned int frame = 0; frame < settings.frames; frame++) {
+      int64_t timestamp_us = (int64_t)(frame * 1e6 / settings.fps);
+      for (std::vector<Fire> &source : fires) {
+        for (Fire &fire : source) {
+          fire.x = std::fmod(fire.x + fire.vx + 1.0f, 1.0f);
+          fire.y = std::fmod(fire.y + fire.vy + 1.0f, 1.0f);
+          fire.confidence = 0.5f + 0.5f * unit(random);
+        }
+      }
+
+      auto batch_start = std::chrono::steady_clock::now();
+      for (unsigned int s = 0; s < settings.sources; s++) {
+        auto start = std::chrono::steady_clock::now();
+        maps[s].begin_frame(timestamp_us);
+        auto decayed = std::chrono::steady_clock::now();
+        for (const Fire &fire : fires[s]) {
+          maps[s].add(fire.x, fire.y, fire.w, fire.h, fire.confidence);
+        }
+        auto end = std::chrono::steady_clock::now();
+        decay_s += std::chrono::duration<double>(decayed - start).count();
+        frame_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+      }
+      batch_us.push_back(std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - batch_start).count());
+    }
+
+    result.frame_p50_us = percentile(frame_us, 0.5);
+    result.frame_p99_us = percentile(frame_us, 0.99);
+    result.batch_p50_us = percentile(batch_us, 0.5);
+    result.batch_p99_us = percentile(batch_us, 0.99);
+    result.decay_ns = frame_us.empty() ? 0 : decay_s * 1e9 / frame_us.size();
+    return result;
+  }
+}
@@ -0,0 +1,105 @@
+#ifndef __HERMES_HEATMAP_H__
+#define __HERMES_HEATMAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Where fire has been detected in a source over time, on a coarse grid over
+ * its frame. Kept free of GStreamer and DeepStream types so it builds and
+ * runs on the host alone. */
+namespace WildFireDetection {
+
+  struct HeatmapParams {
+    unsigned int width = 96;
+    unsigned int height = 54;
+    // time constant of the exponential decay
+    double decay_s = 60;
+  };
+
+  /* An exponential moving average of detection confidence per cell: a fire
+   * detected at confidence c in every frame brings its cells to c, one that
+   * went out fades over decay_s. Cells are a row-major array of floats; a
+   * frame decays all of them at once, a loop the compiler vectorizes. Not
+   * thread safe. */
+  class Heatmap {
+    public:
+      Heatmap() {}
+      explicit Heatmap(const HeatmapParams &params);
+
+      /* Decays the map to timestamp_us, the detections of the frame follow.
+       * The first frame only sets the clock. */
+      void begin_frame(int64_t timestamp_us);
+
+      /* Box in fractions of the frame, the cells it covers take the
+       * confidence in at the rate of the current frame */
+      void add(float left, float top, float width, float height, float confidence);
+
+      unsigned int width() const { return params.width; }
+      unsigned int height() const { return params.height; }
+      const float *cells() const { return values.data(); }
+      float at(unsigned int x, unsigned int y) const { return values[(size_t)y * params.width + x]; }
+
+      // Hottest cell, 0 on an empty map
+      float peak(unsigned int &x, unsigned int &y) const;
+
+      // Cells at or above threshold
+      size_t count_above(float threshold) const;
+
+    private:
+      HeatmapParams params;
+      std::vector<float> values;
+      int64_t last_us = -1;
+      // weight of this frame's detections, 1 - the decay since the last frame
+      float gain = 0;
+  };
+
+  /* Cells of one row next to each other and in the same band, drawn as one
+   * rectangle */
+  struct HeatmapRun {
+    unsigned int row = 0;
+    unsigned int first = 0;
+    // one past the last cell
+    unsigned int last = 0;
+    // 1..levels, bands of equal width from threshold to full_scale
+    unsigned int level = 0;
+  };
+
+  /* Runs of cells at or above threshold, at most max_runs, hottest bands
+   * first when there are more */
+  std::vector<HeatmapRun>
+  heatmap_runs(const Heatmap &heatmap, float threshold, float full_scale, unsigned int levels,
+               size_t max_runs);
+
+  /* Binary PGM of the map, full_scale and above are white */
+  std::string
+  heatmap_pgm(const Heatmap &heatmap, float full_scale);
+
+  struct HeatmapBenchmarkSettings {
+    unsigned int sources = 16;
+    unsigned int frames = 3000;
+    double fps = 30;
+    // detections per frame of every source
+    unsigned int detections = 4;
+    HeatmapParams params;
+  };
+
+  struct HeatmapBenchmarkResult {
+    // one source, decay and its detections
+    double frame_p50_us = 0;
+    double frame_p99_us = 0;
+    // all sources of a batch
+    double batch_p50_us = 0;
+    double batch_p99_us = 0;
+    // the decay alone, per source and frame
+    double decay_ns = 0;
+  };
+
+  /* Fires drifting across the frames of every source, each batch updates
+   * every source's map */
+  HeatmapBenchmarkResult
+  run_heatmap_benchmark(const HeatmapBenchmarkSettings &settings);
+}
+
+#endif // __HERMES_HEATMAP_H__
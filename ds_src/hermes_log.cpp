@@ -0,0 +1,472 @@
+#include "hermes_log.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace WildFireDetection {
+
+  namespace {
+    const size_t LOG_QUEUE_CAPACITY = 512;  // power of two
+    const int LOG_DRAIN_INTERVAL_MS = 20;
+    const int LOG_FLUSH_TIMEOUT_MS = 1000;
+
+    struct LogRecord {
+      int64_t time_us;
+      LogLevel level;
+      const char *file;
+      int line;
+      uint64_t suppressed;
+      char message[LOG_MESSAGE_LEN];
+      size_t field_count;
+      LogField fields[LOG_MAX_FIELDS];
+    };
+
+    // Bounded MPMC queue after Vyukov, used with a single consumer. A cell is
+    // free for position pos when its sequence equals pos and readable when it
+    // equals pos + 1.
+    struct LogCell {
+      std::atomic<uint64_t> sequence;
+      LogRecord record;
+    };
+
+    struct Logger {
+      LogCell cells[LOG_QUEUE_CAPACITY];
+      alignas(64) std::atomic<uint64_t> enqueue_pos{0};
+      alignas(64) std::atomic<uint64_t> written_pos{0};
+      uint64_t dequeue_pos = 0;
+      std::atomic<uint64_t> dropped{0};
+      uint64_t dropped_reported = 0;
+
+      std::atomic<int> min_level{LOG_LEVEL_INFO};
+      std::atomic<unsigned int> burst{5};
+      std::atomic<int64_t> interval_us{10000000};
+      std::atomic<bool> json{false};
+
+      std::once_flag started;
+      std::atomic<bool> running{false};
+      std::atomic<bool> stopping{false};
+      std::thread thread;
+      std::string line;
+
+      Logger() {
+        for (size_t i = 0; i < LOG_QUEUE_CAPACITY; i++) {
+          cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+      }
+    };
+
+    const char *level_names[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+    const char *level_names_json[] = {"debug", "info", "warning", "error"};
+
+    int64_t
+    clock_us(clockid_t clock) {
+      struct timespec ts;
+      clock_gettime(clock, &ts);
+      return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    bool
+    parse_level(const char *text, LogLevel &level) {
+      for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_ERROR; i++) {
+        if (strcasecmp(text, level_names[i]) == 0) {
+          level = (LogLevel)i;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    LogSettings
+    settings_from_env() {
+      LogSettings settings;
+      const char *value;
+      if ((value = getenv("HERMES_LOG_LEVEL")) && !parse_level(value, settings.min_level)) {
+        fprintf(stderr, "HERMES_LOG_LEVEL: unknown level %s\n", value);
+      }
+      if ((value = getenv("HERMES_LOG_FORMAT"))) {
+        settings.json = strcasecmp(value, "json") == 0;
+      }
+      if ((value = getenv("HERMES_LOG_BURST"))) {
+        settings.burst = strtoul(value, NULL, 10);
+      }
+      if ((value = getenv("HERMES_LOG_INTERVAL_MS"))) {
+        settings.interval_ms = strtoul(value, NULL, 10);
+      }
+      return settings;
+    }
+
+    void
+    apply_settings(Logger &logger, const LogSettings &settings) {
+      logger.min_level.store(settings.min_level, std::memory_order_relaxed);
+      logger.burst.store(settings.burst, std::memory_order_relaxed);
+      logger.interval_us.store((int64_t)settings.interval_ms * 1000, std::memory_order_relaxed);
+      logger.json.store(settings.json, std::memory_order_relaxed);
+    }
+
+    // Never destroyed, records may still be written from exit handlers
+    Logger &
+    logger() {
+      static Logger *instance = [] {
+        Logger *created = new Logger();
+        apply_settings(*created, settings_from_env());
+        return created;
+      }();
+      return *instance;
+    }
+
+    void
+    copy_truncated(char *dest, size_t size, const char *src) {
+      if (!src) {
+        src = "(null)";
+      }
+      size_t length = strnlen(src, size - 1);
+      memcpy(dest, src, length);
+      dest[length] = '\0';
+    }
+
+    const char *
+    base_name(const char *path) {
+      const char *slash = strrchr(path, '/');
+      return slash ? slash + 1 : path;
+    }
+
+    bool
+    needs_quotes(const char *value) {
+      if (!*value) {
+        return true;
+      }
+      for (const char *c = value; *c; c++) {
+        if (*c == ' ' || *c == '"' || *c == '=' || *c == '\\' || (unsigned char)*c < 0x20) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void
+    append_escaped(std::string &out, const char *value) {
+      for (const char *c = value; *c; c++) {
+        switch (*c) {
+          case '"': out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n"; break;
+          case '\t': out += "\\t"; break;
+          default:
+            if ((unsigned char)*c < 0x20) {
+              char escaped[8];
+              snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+              out += escaped;
+            }
+            else {
+              out += *c;
+            }
+        }
+      }
+    }
+
+    void
+    append_time(std::string &out, int64_t time_us) {
+      time_t seconds = time_us / 1000000;
+      struct tm local;
+      localtime_r(&seconds, &local);
+      char text[40];
+      size_t length = strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+      snprintf(text + length, sizeof(text) - length, ".%03d", (int)(time_us % 1000000 / 1000));
+      out += text;
+    }
+
+    void
+    format_text(std::string &out, const LogRecord &record) {
+      char site[48];
+      append_time(out, record.time_us);
+      out += ' ';
+      out += level_names[record.level];
+      out += ' ';
+      out += base_name(record.file);
+      snprintf(site, sizeof(site), ":%d ", record.line);
+      out += site;
+      out += record.message;
+      for (size_t i = 0; i < record.field_count; i++) {
+        const LogField &field = record.fields[i];
+        out += ' ';
+        out += field.key;
+        out += '=';
+        if (needs_quotes(field.value)) {
+          out += '"';
+          append_escaped(out, field.value);
+          out += '"';
+        }
+        else {
+          out += field.value;
+        }
+      }
+      if (record.suppressed) {
+        snprintf(site, sizeof(site), " suppressed=%" PRIu64, record.suppressed);
+        out += site;
+      }
+      out += '\n';
+    }
+
+    void
+    format_json(std::string &out, const LogRecord &record) {
+      char number[48];
+      out += "{\"time\":\"";
+      append_time(out, record.time_us);
+      out += "\",\"level\":\"";
+      out += level_names_json[record.level];
+      out += "\",\"site\":\"";
+      append_escaped(out, base_name(record.file));
+      snprintf(number, sizeof(number), ":%d", record.line);
+      out += number;
+      out += "\",\"message\":\"";
+      append_escaped(out, record.message);
+      out += '"';
+      for (size_t i = 0; i < record.field_count; i++) {
+        const LogField &field = record.fields[i];
+        out += ",\"";
+        append_escaped(out, field.key);
+        out += "\":";
+        if (field.number) {
+          out += field.value;
+        }
+        else {
+          out += '"';
+          append_escaped(out, field.value);
+          out += '"';
+        }
+      }
+      if (record.suppressed) {
+        snprintf(number, sizeof(number), ",\"suppressed\":%" PRIu64, record.suppressed);
+        out += number;
+      }
+      out += "}\n";
+    }
+
+    bool
+    enqueue(Logger &logger, LogSite &site, LogLevel level, const char *message,
+            std::initializer_list<LogField> fields, uint64_t suppressed) {
+      uint64_t pos = logger.enqueue_pos.load(std::memory_order_relaxed);
+      LogCell *cell;
+      for (;;) {
+        cell = &logger.cells[pos & (LOG_QUEUE_CAPACITY - 1)];
+        uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)sequence - (int64_t)pos;
+        if (diff == 0) {
+          if (logger.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        }
+        else if (diff < 0) {
+          return false;
+        }
+        else {
+          pos = logger.enqueue_pos.load(std::memory_order_relaxed);
+        }
+      }
+
+      LogRecord &record = cell->record;
+      record.time_us = clock_us(CLOCK_REALTIME);
+      record.level = level;
+      record.file = site.file;
+      record.line = site.line;
+      record.suppressed = suppressed;
+      copy_truncated(record.message, sizeof(record.message), message);
+      record.field_count = 0;
+      for (const LogField &field : fields) {
+        if (record.field_count == LOG_MAX_FIELDS) {
+          break;
+        }
+        record.fields[record.field_count++] = field;
+      }
+      cell->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer side, drain thread only (or the exit handler after it joined)
+    size_t
+    drain(Logger &logger) {
+      size_t count = 0;
+      bool json = logger.json.load(std::memory_order_relaxed);
+      logger.line.clear();
+      for (;;) {
+        LogCell &cell = logger.cells[logger.dequeue_pos & (LOG_QUEUE_CAPACITY - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != logger.dequeue_pos + 1) {
+          break;
+        }
+        if (json) {
+          format_json(logger.line, cell.record);
+        }
+        else {
+          format_text(logger.line, cell.record);
+        }
+        cell.sequence.store(logger.dequeue_pos + LOG_QUEUE_CAPACITY, std::memory_order_release);
+        logger.dequeue_pos++;
+        count++;
+      }
+
+      uint64_t dropped = logger.dropped.load(std::memory_order_relaxed);
+      if (dropped != logger.dropped_reported) {
+        LogRecord note = {};
+        note.time_us = clock_us(CLOCK_REALTIME);
+        note.level = LOG_LEVEL_WARNING;
+        note.file = __FILE__;
+        note.line = __LINE__;
+        copy_truncated(note.message, sizeof(note.message), "Log queue full, records dropped");
+        note.fields[0] = log_field("dropped", dropped - logger.dropped_reported);
+        note.field_count = 1;
+        if (json) {
+          format_json(logger.line, note);
+        }
+        else {
+          format_text(logger.line, note);
+        }
+        logger.dropped_reported = dropped;
+      }
+
+      if (!logger.line.empty()) {
+        fwrite(logger.line.data(), 1, logger.line.size(), stderr);
+        fflush(stderr);
+      }
+      logger.written_pos.store(logger.dequeue_pos, std::memory_order_release);
+      return count;
+    }
+
+    void
+    drain_loop(Logger &logger) {
+      while (!logger.stopping.load(std::memory_order_acquire)) {
+        if (!drain(logger)) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(LOG_DRAIN_INTERVAL_MS));
+        }
+      }
+      drain(logger);
+    }
+
+    void
+    stop_at_exit() {
+      Logger &log = logger();
+      log.stopping.store(true, std::memory_order_release);
+      if (log.thread.joinable()) {
+        log.thread.join();
+      }
+      log.running.store(false, std::memory_order_release);
+      // records queued by other exit handlers after the join
+      drain(log);
+    }
+
+    void
+    start(Logger &logger) {
+      logger.thread = std::thread(drain_loop, std::ref(logger));
+      logger.running.store(true, std::memory_order_release);
+      atexit(stop_at_exit);
+    }
+  }
+
+  LogField
+  log_field(const char *key, const char *value) {
+    LogField field;
+    field.key = key;
+    field.number = false;
+    copy_truncated(field.value, sizeof(field.value), value);
+    return field;
+  }
+
+  LogField
+  log_field_signed(const char *key, long long value) {
+    LogField field;
+    field.key = key;
+    field.number = true;
+    snprintf(field.value, sizeof(field.value), "%lld", value);
+    return field;
+  }
+
+  LogField
+  log_field_unsigned(const char *key, unsigned long long value) {
+    LogField field;
+    field.key = key;
+    field.number = true;
+    snprintf(field.value, sizeof(field.value), "%llu", value);
+    return field;
+  }
+
+  LogField
+  log_field_double(const char *key, double value) {
+    LogField field;
+    field.key = key;
+    // JSON has no nan or inf
+    field.number = value == value && value - value == 0;
+    snprintf(field.value, sizeof(field.value), "%.6g", value);
+    return field;
+  }
+
+  void
+  log_configure(const LogSettings &settings) {
+    apply_settings(logger(), settings);
+  }
+
+  bool
+  log_enabled(LogLevel level) {
+    return level >= logger().min_level.load(std::memory_order_relaxed);
+  }
+
+  bool
+  log_admit(LogSite &site) {
+    Logger &log = logger();
+    int64_t interval_us = log.interval_us.load(std::memory_order_relaxed);
+    if (interval_us <= 0) {
+      return true;
+    }
+    int64_t now = clock_us(CLOCK_MONOTONIC);
+    int64_t window_start = site.window_start_us.load(std::memory_order_relaxed);
+    if (now - window_start >= interval_us &&
+        site.window_start_us.compare_exchange_strong(window_start, now, std::memory_order_relaxed)) {
+      site.window_count.store(0, std::memory_order_relaxed);
+    }
+    if (site.window_count.fetch_add(1, std::memory_order_relaxed) <
+        log.burst.load(std::memory_order_relaxed)) {
+      return true;
+    }
+    site.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  void
+  log_write(LogSite &site, LogLevel level, const char *message,
+            std::initializer_list<LogField> fields) {
+    Logger &log = logger();
+    std::call_once(log.started, start, std::ref(log));
+    uint64_t suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    if (!enqueue(log, site, level, message, fields, suppressed)) {
+      // count the suppressed ones again so the next record still reports them
+      site.suppressed.fetch_add(suppressed, std::memory_order_relaxed);
+      log.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void
+  log_flush() {
+    Logger &log = logger();
+    if (!log.running.load(std::memory_order_acquire)) {
+      return;
+    }
+    uint64_t target = log.enqueue_pos.load(std::memory_order_acquire);
+    int64_t deadline = clock_us(CLOCK_MONOTONIC) + LOG_FLUSH_TIMEOUT_MS * 1000;
+    while (log.written_pos.load(std::memory_order_acquire) < target &&
+           clock_us(CLOCK_MONOTONIC) < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  uint64_t
+  log_dropped() {
+    return logger().dropped.load(std::memory_order_relaxed);
+  }
+}
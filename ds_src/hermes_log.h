@@ -0,0 +1,130 @@
+#ifndef __HERMES_LOG_H__
+#define __HERMES_LOG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+
+/* Logging for the streaming threads. A call copies its record into a slot of
+ * a bounded lock-free queue and returns; a background thread formats and
+ * writes it to stderr. A full queue drops the record and counts it instead
+ * of waiting. Every call site is rate limited on its own and reports what it
+ * suppressed with the next record it lets through.
+ *
+ * Records are a constant message plus key/value fields:
+ *
+ *   HERMES_LOG(LOG_LEVEL_WARNING, "Num classes mismatch",
+ *              log_field("configured", configured), log_field("network", classes));
+ *
+ * Environment: HERMES_LOG_LEVEL (debug, info, warning, error),
+ * HERMES_LOG_FORMAT (text, json), HERMES_LOG_BURST and HERMES_LOG_INTERVAL_MS
+ * (records a call site may emit per interval). */
+namespace WildFireDetection {
+
+  enum LogLevel {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR
+  };
+
+  const size_t LOG_MESSAGE_LEN = 128;
+  const size_t LOG_VALUE_LEN = 64;
+  const size_t LOG_MAX_FIELDS = 8;
+
+  struct LogField {
+    const char *key;            // string literal, not copied
+    char value[LOG_VALUE_LEN];  // truncated
+    bool number;
+  };
+
+  struct LogSettings {
+    LogLevel min_level = LOG_LEVEL_INFO;
+    unsigned int burst = 5;
+    unsigned int interval_ms = 10000;
+    bool json = false;
+  };
+
+  /* State of one HERMES_LOG call site, constant initialized. The level is
+   * not part of it, a site may log at a level chosen per call. */
+  struct LogSite {
+    constexpr LogSite(const char *file, int line)
+        : file(file), line(line) {}
+    const char *file;
+    int line;
+    std::atomic<int64_t> window_start_us{0};
+    std::atomic<uint32_t> window_count{0};
+    std::atomic<uint64_t> suppressed{0};
+  };
+
+  LogField
+  log_field(const char *key, const char *value);
+
+  inline LogField
+  log_field(const char *key, const std::string &value) {
+    return log_field(key, value.c_str());
+  }
+
+  LogField
+  log_field_signed(const char *key, long long value);
+
+  LogField
+  log_field_unsigned(const char *key, unsigned long long value);
+
+  LogField
+  log_field_double(const char *key, double value);
+
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  LogField
+  log_field(const char *key, T value) {
+    if constexpr (std::is_floating_point<T>::value) {
+      return log_field_double(key, value);
+    }
+    else if constexpr (std::is_signed<T>::value) {
+      return log_field_signed(key, value);
+    }
+    else {
+      return log_field_unsigned(key, value);
+    }
+  }
+
+  /* Replaces the settings read from the environment */
+  void
+  log_configure(const LogSettings &settings);
+
+  bool
+  log_enabled(LogLevel level);
+
+  /* Rate limit check for site, false when the record is to be suppressed */
+  bool
+  log_admit(LogSite &site);
+
+  void
+  log_write(LogSite &site, LogLevel level, const char *message,
+            std::initializer_list<LogField> fields);
+
+  /* Waits until everything queued so far is written, not for streaming threads */
+  void
+  log_flush();
+
+  uint64_t
+  log_dropped();
+}
+
+/* Fields are only evaluated for records that are actually queued. level is
+ * evaluated once per call and may differ from call to call. */
+#define HERMES_LOG(level, message, ...)                                                    \
+  do {                                                                                     \
+    static WildFireDetection::LogSite hermes_log_site(__FILE__, __LINE__);                 \
+    const WildFireDetection::LogLevel hermes_log_level = (level);                         \
+    if (WildFireDetection::log_enabled(hermes_log_level) &&                                \
+        WildFireDetection::log_admit(hermes_log_site)) {                                   \
+      WildFireDetection::log_write(hermes_log_site, hermes_log_level, message, {__VA_ARGS__}); \
+    }                                                                                      \
+  } while (0)
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef __HERMES_SHM_H__
+#define __HERMES_SHM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Writer side of the shm:// frame source, for capture processes. Plain C so
+ * it can be called from C, C++ or Python ctypes; build libhermes_shm.so with
+ * make shm. Frames go into a POSIX shared memory ring of numbered slots,
+ * hermes-app reads the newest one and skips what it missed. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pixel layouts, rows packed in the ring */
+enum hermes_shm_format {
+  HERMES_SHM_BGR = 0,
+  HERMES_SHM_RGBA = 1,
+  HERMES_SHM_I420 = 2,
+  HERMES_SHM_NV12 = 3
+};
+
+typedef struct hermes_shm_writer hermes_shm_writer;
+
+/* Creates the ring read as shm://name, replacing a ring of the same name.
+ * fps is what the source nominally delivers, 0 if unknown. slots of 3 or more
+ * let the reader copy a frame while the next one is written. NULL on error,
+ * with errno set. */
+hermes_shm_writer *
+hermes_shm_writer_open(const char *name, uint32_t width, uint32_t height, int format,
+                       uint32_t fps, uint32_t slots);
+
+/* Publishes one frame. stride is the bytes between rows of data, 0 when
+ * packed; planar formats must be packed. 0 on success, -1 on error. */
+int
+hermes_shm_writer_write(hermes_shm_writer *writer, const void *data, size_t stride,
+                        uint64_t timestamp_ns);
+
+/* Removes the ring, readers see no more frames */
+void
+hermes_shm_writer_close(hermes_shm_writer *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HERMES_SHM_H__
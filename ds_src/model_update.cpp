@@ -0,0 +1,87 @@
+#include "model_update.h"
+
+namespace WildFireDetection {
+
+  const char *
+  model_update_state_name(ModelUpdateState state) {
+    switch (state) {
+    case ModelUpdateState::IDLE:
+      return "idle";
+    case ModelUpdateState::LOADING:
+      return "loading";
+    case ModelUpdateState::PROBATION:
+      return "probation";
+    case ModelUpdateState::ROLLING_BACK:
+      return "rolling back";
+    }
+    return "unknown";
+  }
+
+  ModelUpdater::ModelUpdater(const ModelVersion &initial)
+    : active_version(initial) {
+  }
+
+  bool
+  ModelUpdater::begin(const ModelVersion &candidate, const ModelHealthPolicy &policy,
+                      std::string &error) {
+    if (current_state != ModelUpdateState::IDLE) {
+      error = std::string("an update is ") + model_update_state_name(current_state);
+      return false;
+    }
+    if (candidate.version <= active_version.version) {
+      error = "version " + std::to_string(candidate.version) + " is not newer than " +
+              std::to_string(active_version.version);
+      return false;
+    }
+    if (rejected(candidate.version)) {
+      error = "version " + std::to_string(candidate.version) + " was rejected before";
+      return false;
+    }
+    candidate_version = candidate;
+    this->policy = policy;
+    batches = unhealthy = 0;
+    current_state = ModelUpdateState::LOADING;
+    return true;
+  }
+
+  void
+  ModelUpdater::loaded(bool ok) {
+    switch (current_state) {
+    case ModelUpdateState::LOADING:
+      if (ok) {
+        current_state = ModelUpdateState::PROBATION;
+      }
+      else {
+        rejected_versions.insert(candidate_version.version);
+        current_state = ModelUpdateState::IDLE;
+      }
+      break;
+    case ModelUpdateState::ROLLING_BACK:
+      // a failed rollback leaves the candidate serving, nothing better is left
+      current_state = ModelUpdateState::IDLE;
+      break;
+    default:
+      break;
+    }
+  }
+
+  ProbationVerdict
+  ModelUpdater::batch(bool healthy) {
+    if (current_state != ModelUpdateState::PROBATION) {
+      return ProbationVerdict::PENDING;
+    }
+    batches++;
+    unhealthy += healthy ? 0 : 1;
+    if (unhealthy >= policy.max_unhealthy && policy.max_unhealthy > 0) {
+      rejected_versions.insert(candidate_version.version);
+      current_state = ModelUpdateState::ROLLING_BACK;
+      return ProbationVerdict::ROLLBACK;
+    }
+    if (batches >= policy.probation_batches) {
+      active_version = candidate_version;
+      current_state = ModelUpdateState::IDLE;
+      return ProbationVerdict::COMMIT;
+    }
+    return ProbationVerdict::PENDING;
+  }
+}
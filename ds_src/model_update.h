@@ -0,0 +1,81 @@
+#ifndef __HERMES_MODEL_UPDATE_H__
+#define __HERMES_MODEL_UPDATE_H__
+
+#include <set>
+#include <string>
+
+/* Versioning and rollback of in-place model updates of the detector. Kept
+ * free of GStreamer and DeepStream types so it builds and runs on the host
+ * alone; the caller loads whatever config this decides on. */
+namespace WildFireDetection {
+
+  struct ModelVersion {
+    // 0 is the model the app started with
+    unsigned int version = 0;
+    // nvinfer config that loads this version
+    std::string config_path;
+  };
+
+  struct ModelHealthPolicy {
+    // batches a new model is watched for after it is swapped in
+    unsigned int probation_batches = 30;
+    // unhealthy batches among them that send it back
+    unsigned int max_unhealthy = 3;
+  };
+
+  enum class ModelUpdateState {
+    IDLE,
+    // the candidate is being loaded, the active model still serves
+    LOADING,
+    // the candidate serves, the active model is kept for rollback
+    PROBATION,
+    // the active model is being loaded back
+    ROLLING_BACK,
+  };
+
+  enum class ProbationVerdict {
+    PENDING,
+    COMMIT,
+    ROLLBACK,
+  };
+
+  const char *
+  model_update_state_name(ModelUpdateState state);
+
+  /* IDLE -> LOADING -> PROBATION -> IDLE (committed) or
+   * PROBATION -> ROLLING_BACK -> IDLE (rejected). A load failure of the
+   * candidate goes straight back to IDLE, the active model never stopped
+   * serving. Rejected versions are not retried. Not thread safe. */
+  class ModelUpdater {
+    public:
+      ModelUpdater() {}
+      explicit ModelUpdater(const ModelVersion &initial);
+
+      /* Starts loading candidate, refused while another update is under way
+       * and for versions not newer than the active one or already rejected. */
+      bool begin(const ModelVersion &candidate, const ModelHealthPolicy &policy,
+                 std::string &error);
+
+      /* Outcome of the load started by begin() or of the rollback. */
+      void loaded(bool ok);
+
+      /* One batch inferred while in PROBATION, ignored otherwise. */
+      ProbationVerdict batch(bool healthy);
+
+      ModelUpdateState state() const { return current_state; }
+      const ModelVersion &active() const { return active_version; }
+      const ModelVersion &candidate() const { return candidate_version; }
+      bool rejected(unsigned int version) const { return rejected_versions.count(version) > 0; }
+
+    private:
+      ModelUpdateState current_state = ModelUpdateState::IDLE;
+      ModelVersion active_version;
+      ModelVersion candidate_version;
+      ModelHealthPolicy policy;
+      unsigned int batches = 0;
+      unsigned int unhealthy = 0;
+      std::set<unsigned int> rejected_versions;
+  };
+}
+
+#endif // __HERMES_MODEL_UPDATE_H__
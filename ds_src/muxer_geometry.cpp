@@ -0,0 +1,148 @@
+#include "muxer_geometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace WildFireDetection {
+
+  namespace {
+    unsigned int
+    align_up(double value, unsigned int alignment) {
+      unsigned int v = (unsigned int)std::ceil(value);
+      return (v + alignment - 1) / alignment * alignment;
+    }
+
+    unsigned int
+    align_down(double value, unsigned int alignment) {
+      unsigned int v = (unsigned int)std::floor(value);
+      return std::max(alignment, v / alignment * alignment);
+    }
+
+    double
+    aspect(unsigned int width, unsigned int height) {
+      return (double)width / height;
+    }
+
+    /* Scales width x height down into max_width x max_height, keeping its
+     * aspect */
+    void
+    clamp_to(double &width, double &height, unsigned int max_width, unsigned int max_height) {
+      double scale = std::min({1.0, max_width / width, max_height / height});
+      width *= scale;
+      height *= scale;
+    }
+  }
+
+  MuxerGeometry
+  choose_muxer_geometry(const std::vector<SourceGeometry> &sources,
+                        const MuxerPolicySettings &settings) {
+    MuxerGeometry geometry;
+    unsigned int alignment = std::max(1u, settings.alignment);
+
+    std::vector<SourceGeometry> known;
+    for (const SourceGeometry &source : sources) {
+      if (source.width && source.height) {
+        known.push_back(source);
+      }
+    }
+
+    if (settings.policy == MuxerPolicy::FIXED || known.empty()) {
+      geometry.width = settings.fixed_width;
+      geometry.height = settings.fixed_height;
+      geometry.reason = settings.policy == MuxerPolicy::FIXED ? "fixed" : "no source size known";
+    }
+    else {
+      // the largest source sets the aspect, the others are letterboxed into it
+      const SourceGeometry &largest = *std::max_element(known.begin(), known.end(),
+          [](const SourceGeometry &a, const SourceGeometry &b) {
+            return (unsigned long)a.width * a.height < (unsigned long)b.width * b.height;
+          });
+      double width = 0, height = 0;
+
+      if (settings.policy == MuxerPolicy::NATIVE_MAX) {
+        for (const SourceGeometry &source : known) {
+          width = std::max(width, (double)source.width);
+          height = std::max(height, (double)source.height);
+        }
+        geometry.reason = "largest source";
+      }
+      else {
+        // cover the network input at the aspect of the largest source
+        double source_aspect = aspect(largest.width, largest.height);
+        if (aspect(settings.network_width, settings.network_height) > source_aspect) {
+          width = settings.network_width;
+          height = width / source_aspect;
+        }
+        else {
+          height = settings.network_height;
+          width = height * source_aspect;
+        }
+        geometry.reason = "network input";
+        if (width > largest.width || height > largest.height) {
+          width = largest.width;
+          height = largest.height;
+          geometry.reason = "largest source, smaller than the network input";
+        }
+      }
+
+      if (width > settings.max_width || height > settings.max_height) {
+        clamp_to(width, height, settings.max_width, settings.max_height);
+        geometry.width = align_down(width, alignment);
+        geometry.height = align_down(height, alignment);
+        geometry.reason += ", limited to the maximum";
+      }
+      else {
+        geometry.width = align_up(width, alignment);
+        geometry.height = align_up(height, alignment);
+      }
+    }
+
+    // sources of the muxer's aspect fill the frame either way
+    geometry.padding = settings.padding;
+    for (const SourceGeometry &source : known) {
+      if (source.width < geometry.width && source.height < geometry.height) {
+        geometry.upscaled = true;
+      }
+    }
+    return geometry;
+  }
+
+  void
+  muxer_to_source_scale(const MuxerGeometry &geometry, unsigned int source_width,
+                        unsigned int source_height, double &scale_x, double &scale_y) {
+    scale_x = (double)source_width / geometry.width;
+    scale_y = (double)source_height / geometry.height;
+    if (geometry.padding) {
+      scale_x = scale_y = std::max(scale_x, scale_y);
+    }
+  }
+
+  bool
+  muxer_geometry_differs(const MuxerGeometry &a, const MuxerGeometry &b) {
+    return a.width != b.width || a.height != b.height || a.padding != b.padding;
+  }
+
+  bool
+  parse_muxer_policy(const std::string &name, MuxerPolicy &policy) {
+    for (MuxerPolicy candidate : {MuxerPolicy::FIXED, MuxerPolicy::NATIVE_MAX,
+                                  MuxerPolicy::NETWORK_ALIGNED}) {
+      if (name == muxer_policy_name(candidate)) {
+        policy = candidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const char *
+  muxer_policy_name(MuxerPolicy policy) {
+    switch (policy) {
+    case MuxerPolicy::NATIVE_MAX:
+      return "native-max";
+    case MuxerPolicy::NETWORK_ALIGNED:
+      return "network-aligned";
+    default:
+      return "fixed";
+    }
+  }
+}
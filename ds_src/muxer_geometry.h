@@ -0,0 +1,83 @@
+#ifndef __HERMES_MUXER_GEOMETRY_H__
+#define __HERMES_MUXER_GEOMETRY_H__
+
+#include <string>
+#include <vector>
+
+/* Resolution of the batches nvstreammux forms, chosen from what the sources
+ * deliver. Every source is scaled to this size before anything else runs, so
+ * it sets the cost of the muxer copy, inference scaling, tracking and OSD.
+ * Kept free of GStreamer and DeepStream types so it builds and runs on the
+ * host alone. */
+namespace WildFireDetection {
+
+  enum class MuxerPolicy {
+    // fixed_width x fixed_height whatever the sources are
+    FIXED,
+    // the largest source, nothing is downscaled in the muxer
+    NATIVE_MAX,
+    // the smallest frame at the sources' aspect that still covers what the
+    // detector looks at, nothing is upscaled in the muxer
+    NETWORK_ALIGNED
+  };
+
+  /* Size of one source, 0 x 0 while unknown */
+  struct SourceGeometry {
+    unsigned int width = 0;
+    unsigned int height = 0;
+  };
+
+  struct MuxerPolicySettings {
+    MuxerPolicy policy = MuxerPolicy::FIXED;
+    unsigned int fixed_width = 1920;
+    unsigned int fixed_height = 1080;
+    // upper bound of the adaptive policies
+    unsigned int max_width = 3840;
+    unsigned int max_height = 2160;
+    /* Pixels the detector needs per frame: its input size, times the slice
+     * grid under tiled inference */
+    unsigned int network_width = 416;
+    unsigned int network_height = 416;
+    // width and height of the adaptive policies are multiples of this
+    unsigned int alignment = 8;
+    // letterbox sources whose aspect differs from the muxer's, else stretch
+    bool padding = false;
+  };
+
+  struct MuxerGeometry {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    // enable-padding of nvstreammux
+    bool padding = false;
+    // some known source is smaller than the muxer frame
+    bool upscaled = false;
+    // why this size, for the startup report
+    std::string reason;
+  };
+
+  /* Muxer size for the sources under settings. Sources of unknown size are
+   * left out; when none is known the fixed size is used. */
+  MuxerGeometry
+  choose_muxer_geometry(const std::vector<SourceGeometry> &sources,
+                        const MuxerPolicySettings &settings);
+
+  /* Factors taking muxer pixels of a source_width x source_height source
+   * back to source pixels. With padding nvstreammux keeps the aspect and
+   * pads right and bottom, so both factors are the same. */
+  void
+  muxer_to_source_scale(const MuxerGeometry &geometry, unsigned int source_width,
+                        unsigned int source_height, double &scale_x, double &scale_y);
+
+  /* Whether a and b configure nvstreammux differently */
+  bool
+  muxer_geometry_differs(const MuxerGeometry &a, const MuxerGeometry &b);
+
+  /* fixed, native-max or network-aligned */
+  bool
+  parse_muxer_policy(const std::string &name, MuxerPolicy &policy);
+
+  const char *
+  muxer_policy_name(MuxerPolicy policy);
+}
+
+#endif // __HERMES_MUXER_GEOMETRY_H__
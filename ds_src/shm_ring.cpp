@@ -0,0 +1,387 @@
+#include "shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+struct hermes_shm_writer {
+  std::string object_name;
+  WildFireDetection::ShmRingHeader *header;
+  size_t mapped_size;
+  uint64_t seq;
+};
+
+namespace WildFireDetection {
+
+  static_assert(sizeof(ShmRingHeader) <= SHM_SLOT_DATA_OFFSET &&
+                sizeof(ShmSlotHeader) <= SHM_SLOT_DATA_OFFSET, "ring headers outgrew their space");
+
+  namespace {
+    size_t
+    ring_size(uint32_t slot_count, uint64_t slot_stride) {
+      return SHM_SLOT_DATA_OFFSET + slot_count * slot_stride;
+    }
+
+    ShmSlotHeader *
+    slot_at(ShmRingHeader *header, uint64_t seq) {
+      return (ShmSlotHeader *)((char *)header + SHM_SLOT_DATA_OFFSET +
+                               (seq % header->slot_count) * header->slot_stride);
+    }
+
+    char *
+    slot_data(ShmSlotHeader *slot) {
+      return (char *)slot + SHM_SLOT_DATA_OFFSET;
+    }
+
+    // The ring is shared between processes, no FUTEX_PRIVATE_FLAG
+    void
+    futex_wait(std::atomic<uint32_t> *word, uint32_t value, int timeout_ms) {
+      struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+      syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, value, &timeout, NULL, 0);
+    }
+
+    void
+    futex_wake(std::atomic<uint32_t> *word) {
+      syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+  }
+
+  size_t
+  shm_frame_size(uint32_t width, uint32_t height, int format) {
+    size_t pixels = (size_t)width * height;
+    switch (format) {
+      case HERMES_SHM_BGR:
+        return pixels * 3;
+      case HERMES_SHM_RGBA:
+        return pixels * 4;
+      case HERMES_SHM_I420:
+      case HERMES_SHM_NV12:
+        // chroma at half resolution, rounded up for odd sizes
+        return pixels + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+      default:
+        return 0;
+    }
+  }
+
+  const char *
+  shm_format_name(int format) {
+    switch (format) {
+      case HERMES_SHM_BGR:
+        return "BGR";
+      case HERMES_SHM_RGBA:
+        return "RGBA";
+      case HERMES_SHM_I420:
+        return "I420";
+      case HERMES_SHM_NV12:
+        return "NV12";
+      default:
+        return NULL;
+    }
+  }
+
+  std::string
+  shm_object_name(const std::string &name) {
+    return "/hermes-" + name;
+  }
+
+  uint64_t
+  shm_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+  }
+
+  bool
+  ShmRingReader::open(const std::string &name, std::string &error) {
+    close();
+    object_name = shm_object_name(name);
+
+    int fd = shm_open(object_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      error = object_name + ": " + strerror(errno);
+      return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(ShmRingHeader)) {
+      error = object_name + ": no ring written yet";
+      ::close(fd);
+      return false;
+    }
+    void *memory = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+      error = object_name + ": " + strerror(errno);
+      return false;
+    }
+
+    ShmRingHeader *ring = (ShmRingHeader *)memory;
+    if (ring->magic.load(std::memory_order_acquire) != SHM_RING_MAGIC ||
+        ring->version != SHM_RING_VERSION || !ring->slot_count ||
+        ring->frame_size != shm_frame_size(ring->width, ring->height, ring->format) ||
+        ring->slot_stride < SHM_SLOT_DATA_OFFSET + ring->frame_size ||
+        ring_size(ring->slot_count, ring->slot_stride) > (size_t)status.st_size) {
+      error = object_name + ": not a frame ring of this version";
+      munmap(memory, status.st_size);
+      return false;
+    }
+
+    header = ring;
+    mapped_size = status.st_size;
+    inode = status.st_ino;
+    // only frames from now on
+    last_seq = header->write_seq.load(std::memory_order_acquire);
+    last_seq = last_seq ? last_seq - 1 : 0;
+    return true;
+  }
+
+  void
+  ShmRingReader::close() {
+    if (header) {
+      munmap(header, mapped_size);
+      header = NULL;
+    }
+  }
+
+  bool
+  ShmRingReader::replaced() const {
+    struct stat status;
+    int fd = shm_open(object_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      return false;
+    }
+    bool other = fstat(fd, &status) == 0 && (uint64_t)status.st_ino != inode;
+    ::close(fd);
+    return other;
+  }
+
+  bool
+  ShmRingReader::read_latest(void *dest, int timeout_ms, uint64_t &timestamp_ns) {
+    uint32_t notify = header->notify.load(std::memory_order_acquire);
+    uint64_t seq = header->write_seq.load(std::memory_order_acquire);
+    if (seq == last_seq) {
+      futex_wait(&header->notify, notify, timeout_ms);
+      seq = header->write_seq.load(std::memory_order_acquire);
+      if (seq == last_seq) {
+        return false;
+      }
+    }
+
+    for (;;) {
+      ShmSlotHeader *slot = slot_at(header, seq);
+      if (slot->seq.load(std::memory_order_acquire) == seq) {
+        uint64_t timestamp = slot->timestamp_ns;
+        memcpy(dest, slot_data(slot), header->frame_size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->seq.load(std::memory_order_relaxed) == seq) {
+          frames_skipped += seq - last_seq - 1;
+          frames_read++;
+          last_seq = seq;
+          timestamp_ns = timestamp;
+          return true;
+        }
+      }
+      // lapped while copying, the newest frame is in another slot by now
+      torn_reads++;
+      seq = header->write_seq.load(std::memory_order_acquire);
+    }
+  }
+
+  namespace {
+    // Frame number at both ends of the frame, a torn copy has two different ones
+    void
+    draw_frame(std::vector<uint8_t> &frame, uint64_t number, uint32_t width) {
+      uint8_t shade = (uint8_t)number;
+      size_t row = frame.size() / std::max(1u, width);
+      for (size_t i = 0; i + row <= frame.size(); i += row) {
+        frame[i] = shade++;
+      }
+      memcpy(frame.data(), &number, sizeof(number));
+      memcpy(frame.data() + frame.size() - sizeof(number), &number, sizeof(number));
+    }
+
+    double
+    percentile_us(std::vector<uint64_t> &samples_ns, unsigned int percent) {
+      if (samples_ns.empty()) {
+        return 0;
+      }
+      size_t rank = std::min(samples_ns.size() - 1, samples_ns.size() * percent / 100);
+      std::nth_element(samples_ns.begin(), samples_ns.begin() + rank, samples_ns.end());
+      return samples_ns[rank] / 1000.0;
+    }
+  }
+
+  ShmBenchmarkResult
+  run_shm_benchmark(const std::string &name, const ShmBenchmarkSettings &settings) {
+    ShmBenchmarkResult result;
+    size_t frame_size = shm_frame_size(settings.width, settings.height, settings.format);
+    hermes_shm_writer *writer = hermes_shm_writer_open(name.c_str(), settings.width,
+        settings.height, settings.format, settings.fps, settings.slots);
+    if (!writer || !frame_size) {
+      if (writer) {
+        hermes_shm_writer_close(writer);
+      }
+      return result;
+    }
+
+    std::atomic<bool> writing{true};
+    std::vector<uint64_t> latencies_ns;
+    ShmRingReader reader;
+    std::string error;
+    reader.open(name, error);
+
+    std::thread consumer([&]() {
+      std::vector<uint8_t> frame(frame_size);
+      uint64_t timestamp_ns;
+      for (;;) {
+        if (!reader.read_latest(frame.data(), 100, timestamp_ns)) {
+          if (!writing) {
+            break;
+          }
+          continue;
+        }
+        latencies_ns.push_back(shm_now_ns() - timestamp_ns);
+        if (memcmp(frame.data(), frame.data() + frame_size - 8, 8) != 0) {
+          result.corrupt_frames++;
+        }
+        if (settings.reader_work_us) {
+          std::this_thread::sleep_for(std::chrono::microseconds(settings.reader_work_us));
+        }
+      }
+    });
+
+    std::vector<uint8_t> frame(frame_size, 0);
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration<double>(settings.duration_s);
+    double write_s = 0;
+    for (uint64_t number = 1; std::chrono::steady_clock::now() < end; number++) {
+      draw_frame(frame, number, settings.width);
+      auto write_start = std::chrono::steady_clock::now();
+      hermes_shm_writer_write(writer, frame.data(), 0, shm_now_ns());
+      write_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start).count();
+      result.frames_written++;
+      if (settings.fps) {
+        std::this_thread::sleep_until(start + std::chrono::duration<double>(number / (double)settings.fps));
+      }
+    }
+    writing = false;
+    consumer.join();
+    hermes_shm_writer_close(writer);
+
+    result.frames_read = reader.frames_read;
+    result.frames_skipped = reader.frames_skipped;
+    result.torn_reads = reader.torn_reads;
+    result.latency_p50_us = percentile_us(latencies_ns, 50);
+    result.latency_p99_us = percentile_us(latencies_ns, 99);
+    result.write_mb_per_s = write_s > 0 ? result.frames_written * frame_size / write_s / 1e6 : 0;
+    return result;
+  }
+}
+
+using namespace WildFireDetection;
+
+extern "C" hermes_shm_writer *
+hermes_shm_writer_open(const char *name, uint32_t width, uint32_t height, int format,
+                       uint32_t fps, uint32_t slots) {
+  size_t frame_size = shm_frame_size(width, height, format);
+  if (!name || !*name || strchr(name, '/') || !frame_size || slots < 1) {
+    errno = EINVAL;
+    return NULL;
+  }
+  // slot data starts cache line aligned
+  uint64_t slot_stride = (SHM_SLOT_DATA_OFFSET + frame_size + 63) / 64 * 64;
+  size_t size = ring_size(slots, slot_stride);
+  std::string object_name = shm_object_name(name);
+
+  // A new object, readers of an old one notice it was replaced
+  shm_unlink(object_name.c_str());
+  int fd = shm_open(object_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (ftruncate(fd, size) != 0) {
+    int saved = errno;
+    close(fd);
+    shm_unlink(object_name.c_str());
+    errno = saved;
+    return NULL;
+  }
+  void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    int saved = errno;
+    shm_unlink(object_name.c_str());
+    errno = saved;
+    return NULL;
+  }
+
+  // ftruncate zero fills: every slot seq and write_seq start at 0
+  ShmRingHeader *header = (ShmRingHeader *)memory;
+  header->version = SHM_RING_VERSION;
+  header->width = width;
+  header->height = height;
+  header->format = format;
+  header->fps = fps;
+  header->slot_count = slots;
+  header->frame_size = frame_size;
+  header->slot_stride = slot_stride;
+  header->magic.store(SHM_RING_MAGIC, std::memory_order_release);
+
+  return new hermes_shm_writer{object_name, header, size, 0};
+}
+
+extern "C" int
+hermes_shm_writer_write(hermes_shm_writer *writer, const void *data, size_t stride,
+                        uint64_t timestamp_ns) {
+  if (!writer || !data) {
+    errno = EINVAL;
+    return -1;
+  }
+  ShmRingHeader *header = writer->header;
+  size_t row = header->frame_size / header->height;
+  bool packed = !stride || stride == row;
+  if (!packed && (header->format == HERMES_SHM_I420 || header->format == HERMES_SHM_NV12)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  uint64_t seq = ++writer->seq;
+  ShmSlotHeader *slot = slot_at(header, seq);
+  slot->seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  if (packed) {
+    memcpy(slot_data(slot), data, header->frame_size);
+  }
+  else {
+    for (uint32_t y = 0; y < header->height; y++) {
+      memcpy(slot_data(slot) + y * row, (const char *)data + y * stride, row);
+    }
+  }
+  slot->timestamp_ns = timestamp_ns;
+  slot->seq.store(seq, std::memory_order_release);
+  header->write_seq.store(seq, std::memory_order_release);
+  header->notify.fetch_add(1, std::memory_order_release);
+  futex_wake(&header->notify);
+  return 0;
+}
+
+extern "C" void
+hermes_shm_writer_close(hermes_shm_writer *writer) {
+  if (!writer) {
+    return;
+  }
+  munmap(writer->header, writer->mapped_size);
+  shm_unlink(writer->object_name.c_str());
+  delete writer;
+}
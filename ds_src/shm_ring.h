@@ -0,0 +1,131 @@
+#ifndef __HERMES_SHM_RING_H__
+#define __HERMES_SHM_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#include "hermes_shm.h"
+
+/* Layout and reader of the shared memory frame ring behind shm:// sources.
+ * The writer side is the C interface in hermes_shm.h. */
+namespace WildFireDetection {
+
+  const uint32_t SHM_RING_MAGIC = 0x4d485348; // "HSHM"
+  const uint32_t SHM_RING_VERSION = 1;
+
+  /* At the start of the shared memory, slots follow at slot_stride apart */
+  struct ShmRingHeader {
+    // written last, a reader never sees a half initialized ring
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t fps;
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint64_t frame_size;
+    uint64_t slot_stride;
+    // sequence number of the newest complete frame, 0 before the first one
+    std::atomic<uint64_t> write_seq;
+    // bumped with every frame, readers sleep on it as a futex
+    std::atomic<uint32_t> notify;
+  };
+
+  /* Frame seq is in slot seq % slot_count. seq is 0 while the slot is
+   * being written, a copy taken between two equal reads of it is whole. */
+  struct ShmSlotHeader {
+    std::atomic<uint64_t> seq;
+    uint64_t timestamp_ns;
+  };
+
+  const size_t SHM_SLOT_DATA_OFFSET = 64;
+
+  /* Bytes of one packed frame, 0 for an unknown format */
+  size_t
+  shm_frame_size(uint32_t width, uint32_t height, int format);
+
+  /* GStreamer video/x-raw format of a ring format, NULL if unknown */
+  const char *
+  shm_format_name(int format);
+
+  /* "/hermes-<name>", the POSIX name behind shm://name */
+  std::string
+  shm_object_name(const std::string &name);
+
+  uint64_t
+  shm_now_ns();
+
+  class ShmRingReader {
+    public:
+      ShmRingReader() {}
+      ~ShmRingReader() { close(); }
+
+      ShmRingReader(const ShmRingReader &) = delete;
+      ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+      bool open(const std::string &name, std::string &error);
+      void close();
+      bool is_open() const { return header != NULL; }
+
+      // Whether the name now belongs to another ring, the writer restarted
+      bool replaced() const;
+
+      uint32_t width() const { return header->width; }
+      uint32_t height() const { return header->height; }
+      int format() const { return header->format; }
+      uint32_t fps() const { return header->fps; }
+      size_t frame_size() const { return header->frame_size; }
+
+      // Copies the newest frame not read yet into dest, frame_size() bytes.
+      // Waits up to timeout_ms for one, false if none came.
+      bool read_latest(void *dest, int timeout_ms, uint64_t &timestamp_ns);
+
+      // frames written but never read, overtaken by newer ones
+      uint64_t frames_read = 0;
+      uint64_t frames_skipped = 0;
+      // copies redone because the writer lapped the reader mid-copy
+      uint64_t torn_reads = 0;
+
+    private:
+      std::string object_name;
+      ShmRingHeader *header = NULL;
+      size_t mapped_size = 0;
+      uint64_t inode = 0;
+      uint64_t last_seq = 0;
+  };
+
+  struct ShmBenchmarkSettings {
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    int format = HERMES_SHM_BGR;
+    // 0 writes as fast as the ring takes them
+    uint32_t fps = 30;
+    uint32_t slots = 4;
+    double duration_s = 10;
+    // time the reader spends on every frame, as the pipeline would
+    uint32_t reader_work_us = 0;
+  };
+
+  struct ShmBenchmarkResult {
+    uint64_t frames_written = 0;
+    uint64_t frames_read = 0;
+    uint64_t frames_skipped = 0;
+    uint64_t torn_reads = 0;
+    // copies that passed the slot check yet hold two different frames, must be 0
+    uint64_t corrupt_frames = 0;
+    // from the write call to the frame copied out
+    double latency_p50_us = 0;
+    double latency_p99_us = 0;
+    double write_mb_per_s = 0;
+  };
+
+  /* Writer and reader threads in this process on the ring name. The
+   * producer draws a moving gradient, the reader checks every copy. */
+  ShmBenchmarkResult
+  run_shm_benchmark(const std::string &name, const ShmBenchmarkSettings &settings);
+}
+
+#endif // __HERMES_SHM_RING_H__
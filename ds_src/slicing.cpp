@@ -0,0 +1,146 @@
+#include "slicing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace WildFireDetection {
+
+  namespace {
+    float
+    area(const SliceRect &r) {
+      return std::max(0.0f, r.width) * std::max(0.0f, r.height);
+    }
+
+    float
+    intersection(const SliceRect &a, const SliceRect &b) {
+      float w = std::min(a.left + a.width, b.left + b.width) - std::max(a.left, b.left);
+      float h = std::min(a.top + a.height, b.top + b.height) - std::max(a.top, b.top);
+      return (w > 0 && h > 0) ? w * h : 0.0f;
+    }
+
+    SliceRect
+    bounding_union(const SliceRect &a, const SliceRect &b) {
+      SliceRect r;
+      r.left = std::min(a.left, b.left);
+      r.top = std::min(a.top, b.top);
+      r.width = std::max(a.left + a.width, b.left + b.width) - r.left;
+      r.height = std::max(a.top + a.height, b.top + b.height) - r.top;
+      return r;
+    }
+
+    // Start offsets of count windows of size length over extent, evenly
+    // spread with the last one flush with the far edge
+    std::vector<float>
+    window_offsets(unsigned int extent, unsigned int count, float length) {
+      std::vector<float> offsets(count, 0.0f);
+      if (count > 1) {
+        float step = (extent - length) / (count - 1);
+        for (unsigned int i = 0; i < count; i++) {
+          offsets[i] = std::round(i * step);
+        }
+      }
+      return offsets;
+    }
+  }
+
+  std::vector<SliceRect>
+  compute_slices(unsigned int frame_width, unsigned int frame_height, const SliceGrid &grid) {
+    std::vector<SliceRect> slices;
+    unsigned int rows = std::max(1u, grid.rows);
+    unsigned int columns = std::max(1u, grid.columns);
+    float overlap = std::min(std::max(grid.overlap, 0.0f), 0.9f);
+
+    // n slices of size s overlapping by overlap * s cover s * (n - (n - 1) * overlap)
+    float slice_width = std::min<float>(frame_width,
+        std::ceil(frame_width / (columns - (columns - 1) * overlap)));
+    float slice_height = std::min<float>(frame_height,
+        std::ceil(frame_height / (rows - (rows - 1) * overlap)));
+
+    std::vector<float> lefts = window_offsets(frame_width, columns, slice_width);
+    std::vector<float> tops = window_offsets(frame_height, rows, slice_height);
+
+    if (rows > 1 || columns > 1) {
+      for (float top : tops) {
+        for (float left : lefts) {
+          slices.push_back({left, top, slice_width, slice_height});
+        }
+      }
+    }
+    if (grid.full_frame || slices.empty()) {
+      slices.push_back({0.0f, 0.0f, (float)frame_width, (float)frame_height});
+    }
+    return slices;
+  }
+
+  SliceRect
+  slice_to_frame(const SliceRect &slice, const SliceRect &box) {
+    float x0 = std::min(std::max(box.left, 0.0f), slice.width);
+    float y0 = std::min(std::max(box.top, 0.0f), slice.height);
+    float x1 = std::min(std::max(box.left + box.width, 0.0f), slice.width);
+    float y1 = std::min(std::max(box.top + box.height, 0.0f), slice.height);
+    return {slice.left + x0, slice.top + y0, x1 - x0, y1 - y0};
+  }
+
+  float
+  slice_iou(const SliceRect &a, const SliceRect &b) {
+    float inter = intersection(a, b);
+    float uni = area(a) + area(b) - inter;
+    return uni > 0 ? inter / uni : 0.0f;
+  }
+
+  float
+  slice_ios(const SliceRect &a, const SliceRect &b) {
+    float smaller = std::min(area(a), area(b));
+    return smaller > 0 ? intersection(a, b) / smaller : 0.0f;
+  }
+
+  std::vector<MergedDetection>
+  merge_slice_detections(const std::vector<SliceDetection> &detections,
+                         const SliceMergeParams &params) {
+    std::vector<int> order(detections.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return detections[a].confidence > detections[b].confidence;
+    });
+
+    std::vector<bool> used(detections.size(), false);
+    std::vector<MergedDetection> merged;
+
+    for (size_t i = 0; i < order.size(); i++) {
+      const int leader = order[i];
+      if (used[leader]) {
+        continue;
+      }
+      used[leader] = true;
+      MergedDetection out;
+      out.detection = detections[leader];
+      out.leader = leader;
+
+      for (size_t j = i + 1; j < order.size(); j++) {
+        const int other = order[j];
+        const SliceDetection &cand = detections[other];
+        if (used[other] || cand.class_id != out.detection.class_id) {
+          continue;
+        }
+        // compare against the leader's own box so merging does not snowball
+        const SliceRect &lead_box = detections[leader].box;
+        bool same_slice = cand.slice_index >= 0 &&
+                          cand.slice_index == detections[leader].slice_index;
+
+        if (slice_iou(lead_box, cand.box) >= params.iou_threshold) {
+          used[other] = true;
+          if (!same_slice) {
+            out.detection.box = bounding_union(out.detection.box, cand.box);
+          }
+        }
+        else if (!same_slice && slice_ios(lead_box, cand.box) >= params.ios_threshold) {
+          used[other] = true;
+          out.detection.box = bounding_union(out.detection.box, cand.box);
+        }
+      }
+      merged.push_back(out);
+    }
+    return merged;
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef __HERMES_SLICING_H__
+#define __HERMES_SLICING_H__
+
+#include <vector>
+
+/* Geometry and merge logic of tiled inference. Kept free of GStreamer and
+ * DeepStream types so it builds and runs on the host alone. */
+namespace WildFireDetection {
+
+  struct SliceRect {
+    float left = 0;
+    float top = 0;
+    float width = 0;
+    float height = 0;
+  };
+
+  /* How one source frame is cut. Neighbouring slices share overlap (as a
+   * fraction of the slice size) so objects on a seam are seen whole by at
+   * least one slice. full_frame adds the whole frame as an extra slice to
+   * keep large objects detectable. */
+  struct SliceGrid {
+    unsigned int rows = 1;
+    unsigned int columns = 1;
+    float overlap = 0.2f;
+    bool full_frame = false;
+  };
+
+  struct SliceDetection {
+    SliceRect box;   // frame coordinates
+    float confidence = 0;
+    int class_id = 0;
+    int slice_index = -1;  // -1 when the originating slice is unknown
+  };
+
+  struct SliceMergeParams {
+    // same object found twice, drop the weaker box
+    float iou_threshold = 0.5f;
+    // part of an object cut by a seam, grow the stronger box over it
+    float ios_threshold = 0.6f;
+  };
+
+  struct MergedDetection {
+    SliceDetection detection;
+    // input detection the result is built from (its highest confidence)
+    int leader = -1;
+  };
+
+  /* Slices covering a frame_width x frame_height frame, row major, followed
+   * by the full frame slice if requested. Slices keep within the frame and
+   * the last row and column are aligned to its right and bottom edges. */
+  std::vector<SliceRect>
+  compute_slices(unsigned int frame_width, unsigned int frame_height, const SliceGrid &grid);
+
+  /* Maps a box relative to the slice's top-left corner to frame coordinates,
+   * clipped to the slice. */
+  SliceRect
+  slice_to_frame(const SliceRect &slice, const SliceRect &box);
+
+  float
+  slice_iou(const SliceRect &a, const SliceRect &b);
+
+  /* Intersection over the smaller of the two areas. */
+  float
+  slice_ios(const SliceRect &a, const SliceRect &b);
+
+  /* Greedy, per class merge of detections from all slices of one frame,
+   * strongest first: boxes over iou_threshold are duplicates, boxes from a
+   * different slice over ios_threshold are fragments and are absorbed into
+   * the union of both. */
+  std::vector<MergedDetection>
+  merge_slice_detections(const std::vector<SliceDetection> &detections,
+                         const SliceMergeParams &params);
+}
+
+#endif // __HERMES_SLICING_H__
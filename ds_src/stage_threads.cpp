@@ -0,0 +1,102 @@
+#include "stage_threads.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace WildFireDetection {
+
+  bool
+  parse_cpu_list(const std::string &list, std::vector<unsigned int> &cores) {
+    std::vector<unsigned int> parsed;
+    std::stringstream stream(list);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+      const char *begin = item.c_str();
+      char *end = NULL;
+      while (*begin == ' ') {
+        begin++;
+      }
+      if (!*begin) {
+        continue;
+      }
+      unsigned long first = strtoul(begin, &end, 10);
+      unsigned long last = first;
+      if (end == begin) {
+        return false;
+      }
+      if (*end == '-') {
+        const char *second = end + 1;
+        last = strtoul(second, &end, 10);
+        if (end == second || last < first) {
+          return false;
+        }
+      }
+      while (*end == ' ') {
+        end++;
+      }
+      if (*end || last >= CPU_SETSIZE) {
+        return false;
+      }
+      for (unsigned long core = first; core <= last; core++) {
+        parsed.push_back(core);
+      }
+    }
+    cores = parsed;
+    return true;
+  }
+
+  std::string
+  format_cpu_list(const std::vector<unsigned int> &cores) {
+    if (cores.empty()) {
+      return "any";
+    }
+    std::string text;
+    for (unsigned int core : cores) {
+      text += (text.empty() ? "" : ",") + std::to_string(core);
+    }
+    return text;
+  }
+
+  long
+  current_thread_id() {
+    return syscall(SYS_gettid);
+  }
+
+  bool
+  apply_thread_spec(const ThreadSpec &spec, std::string &error) {
+    bool ret = true;
+    error.clear();
+
+    if (!spec.cpu_cores.empty()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (unsigned int core : spec.cpu_cores) {
+        CPU_SET(core, &set);
+      }
+      int status = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      if (status) {
+        error += "cpu affinity " + format_cpu_list(spec.cpu_cores) + ": " + strerror(status);
+        ret = false;
+      }
+    }
+
+    if (spec.set_priority) {
+      // nice is per thread on Linux when given the thread id
+      if (setpriority(PRIO_PROCESS, current_thread_id(), spec.priority)) {
+        error += std::string(error.empty() ? "" : ", ") + "priority " +
+                 std::to_string(spec.priority) + ": " + strerror(errno);
+        ret = false;
+      }
+    }
+    return ret;
+  }
+}
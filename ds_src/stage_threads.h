@@ -0,0 +1,44 @@
+#ifndef __HERMES_STAGE_THREADS_H__
+#define __HERMES_STAGE_THREADS_H__
+
+#include <string>
+#include <vector>
+
+/* Scheduling of the pipeline's streaming threads. Kept free of GStreamer and
+ * DeepStream types, it only deals with the calling thread. */
+namespace WildFireDetection {
+
+  /* A thread boundary: the queue that starts the thread and how the thread
+   * is scheduled once it runs. */
+  struct ThreadSpec {
+    // buffers held by the queue, a batch each after the muxer
+    unsigned int queue_depth = 2;
+    // as the queue "leaky" property: 0 no, 1 upstream, 2 downstream
+    int leaky = 0;
+    // pinned to these cores, all cores when empty
+    std::vector<unsigned int> cpu_cores;
+    bool set_priority = false;
+    // nice value, -20 (highest) to 19
+    int priority = 0;
+  };
+
+  /* Parses a core list such as "2,3" or "0-1,4". */
+  bool
+  parse_cpu_list(const std::string &list, std::vector<unsigned int> &cores);
+
+  /* "2,3" style rendering of a core list, "any" when empty. */
+  std::string
+  format_cpu_list(const std::vector<unsigned int> &cores);
+
+  /* Kernel id of the calling thread, as shown by top -H. */
+  long
+  current_thread_id();
+
+  /* Pins and reprioritizes the calling thread. Failures (missing cores,
+   * negative nice without CAP_SYS_NICE) are described in error, whatever
+   * could be applied stays applied. */
+  bool
+  apply_thread_spec(const ThreadSpec &spec, std::string &error);
+}
+
+#endif // __HERMES_STAGE_THREADS_H__
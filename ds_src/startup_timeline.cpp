@@ -0,0 +1,113 @@
+#include "startup_timeline.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace WildFireDetection {
+
+  StartupTimeline::StartupTimeline()
+    : origin(std::chrono::steady_clock::now()) {
+  }
+
+  int64_t
+  StartupTimeline::now_us() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - origin).count();
+  }
+
+  void
+  StartupTimeline::mark(const std::string &name) {
+    std::lock_guard<std::mutex> guard(lock);
+    StartupEvent event;
+    event.name = name;
+    event.start_us = event.end_us = now_us();
+    event.finished = true;
+    events.push_back(event);
+  }
+
+  void
+  StartupTimeline::begin(const std::string &name) {
+    std::lock_guard<std::mutex> guard(lock);
+    StartupEvent event;
+    event.name = name;
+    event.start_us = event.end_us = now_us();
+    events.push_back(event);
+  }
+
+  void
+  StartupTimeline::end(const std::string &name) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto event = events.rbegin(); event != events.rend(); event++) {
+      if (event->name == name && !event->finished) {
+        event->end_us = now_us();
+        event->finished = true;
+        return;
+      }
+    }
+  }
+
+  bool
+  StartupTimeline::has(const std::string &name) const {
+    std::lock_guard<std::mutex> guard(lock);
+    return std::any_of(events.begin(), events.end(),
+                       [&](const StartupEvent &event) { return event.name == name; });
+  }
+
+  std::string
+  StartupTimeline::report() const {
+    std::vector<StartupEvent> sorted;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      sorted = events;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const StartupEvent &a, const StartupEvent &b) {
+                       return a.start_us < b.start_us;
+                     });
+
+    int64_t total_us = 0;
+    const StartupEvent *longest = NULL;
+    for (const StartupEvent &event : sorted) {
+      total_us = std::max(total_us, event.end_us);
+      if (event.end_us > event.start_us &&
+          (!longest || event.end_us - event.start_us > longest->end_us - longest->start_us)) {
+        longest = &event;
+      }
+    }
+
+    std::string text = "Startup timeline (ms since launch):\n";
+    char line[256];
+    for (const StartupEvent &event : sorted) {
+      if (!event.finished) {
+        snprintf(line, sizeof(line), "  %9.1f %9s %9s        %s (unfinished)\n",
+                 event.start_us / 1e3, "", "", event.name.c_str());
+      }
+      else if (event.end_us == event.start_us) {
+        snprintf(line, sizeof(line), "  %9.1f %9s %9s        %s\n", event.start_us / 1e3, "", "",
+                 event.name.c_str());
+      }
+      else {
+        int64_t duration_us = event.end_us - event.start_us;
+        snprintf(line, sizeof(line), "  %9.1f %9.1f %9.1f %5.1f%% %s\n", event.start_us / 1e3,
+                 event.end_us / 1e3, duration_us / 1e3,
+                 total_us ? 100.0 * duration_us / total_us : 0.0, event.name.c_str());
+      }
+      text += line;
+    }
+
+    if (longest) {
+      std::string overlapping;
+      for (const StartupEvent &event : sorted) {
+        if (&event != longest && event.end_us > event.start_us &&
+            event.start_us < longest->end_us && event.end_us > longest->start_us) {
+          overlapping += (overlapping.empty() ? "" : ", ") + event.name;
+        }
+      }
+      snprintf(line, sizeof(line), "Longest phase: %s, %.1f ms, concurrent with: %s\n",
+               longest->name.c_str(), (longest->end_us - longest->start_us) / 1e3,
+               overlapping.empty() ? "nothing" : overlapping.c_str());
+      text += line;
+    }
+    return text;
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef __HERMES_STARTUP_TIMELINE_H__
+#define __HERMES_STARTUP_TIMELINE_H__
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Timestamps of the startup phases, from launch to the first detection.
+ * Phases may run on any thread and overlap. Kept free of GStreamer and
+ * DeepStream types so it builds and runs on the host alone. */
+namespace WildFireDetection {
+
+  struct StartupEvent {
+    std::string name;
+    // microseconds since the timeline was created, end == start for marks
+    int64_t start_us = 0;
+    int64_t end_us = 0;
+    bool finished = false;
+  };
+
+  class StartupTimeline {
+    public:
+      StartupTimeline();
+
+      // An instant, such as the first buffer out of an element
+      void mark(const std::string &name);
+
+      // A phase, begin and end may be called from different threads
+      void begin(const std::string &name);
+      void end(const std::string &name);
+
+      bool has(const std::string &name) const;
+
+      /* Events by start time with their duration and the share of the time
+       * to the last event they cover, then the phases that ran concurrently
+       * with the longest one. */
+      std::string report() const;
+
+    private:
+      int64_t now_us() const;
+
+      std::chrono::steady_clock::time_point origin;
+      mutable std::mutex lock;
+      std::vector<StartupEvent> events;
+  };
+}
+
+#endif // __HERMES_STARTUP_TIMELINE_H__
@@ -0,0 +1,194 @@
+#include <stdio.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../event_ring.h"
+
+/* Checks the pre-event ring of the event clips on any Linux box:
+ *
+ *   hermes-event-ring-test
+ *
+ * Synthetic encoded streams go through the ring: groups of pictures of
+ * varying size and length, a group larger than the ring, and a steady
+ * stream against the pre-event horizon. Prints a line per failed case and
+ * exits with 1 if there was any. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  EventPacket
+  packet(size_t size, bool keyframe, int64_t arrival_us) {
+    EventPacket packet;
+    packet.data = std::shared_ptr<const void>(new char[size ? size : 1],
+                                              [](const void *p) { delete[] (const char *)p; });
+    packet.size = size;
+    packet.keyframe = keyframe;
+    packet.arrival_us = arrival_us;
+    return packet;
+  }
+
+  /* What must hold after every push: whole groups, oldest first, bytes
+   * counted right and within the bound */
+  bool
+  consistent(const EventRing &ring, std::string &why) {
+    std::vector<EventPacket> held = ring.snapshot();
+    size_t bytes = 0;
+    for (size_t i = 0; i < held.size(); i++) {
+      bytes += held[i].size;
+      if (i && held[i].arrival_us < held[i - 1].arrival_us) {
+        why = "packets out of order";
+        return false;
+      }
+    }
+    if (!held.empty() && !held.front().keyframe) {
+      why = "snapshot starts at a delta frame";
+    }
+    else if (bytes != ring.bytes() || held.size() != ring.packets()) {
+      why = "bytes or packets miscounted";
+    }
+    else if (ring.bytes() > ring.settings().max_bytes ||
+             ring.stats().peak_bytes > ring.settings().max_bytes) {
+      why = "more than max_bytes held";
+    }
+    else if (!held.empty() &&
+             ring.span_us() != held.back().arrival_us - held.front().arrival_us) {
+      why = "span";
+    }
+    else {
+      return true;
+    }
+    return false;
+  }
+
+  void
+  check_bound() {
+    EventRingParams params;
+    params.max_bytes = 600000;
+    params.pre_event_us = 10000000;
+    EventRing ring(params);
+    std::mt19937 random(3);
+    std::uniform_int_distribution<size_t> delta_size(500, 6000);
+    std::uniform_int_distribution<unsigned int> gop_length(10, 90);
+
+    // a delta frame before any keyframe has nothing to decode from
+    expect(!ring.push(packet(1000, false, 0)) && ring.packets() == 0 &&
+           ring.stats().dropped == 1, "delta frame on an empty ring dropped");
+
+    std::string why;
+    bool ok = true;
+    int64_t arrival_us = 0;
+    unsigned int until_keyframe = 0;
+    for (unsigned int frame = 0; frame < 20000 && ok; frame++, arrival_us += 33333) {
+      bool keyframe = until_keyframe == 0;
+      until_keyframe = keyframe ? gop_length(random) : until_keyframe - 1;
+      ring.push(packet(keyframe ? 30000 : delta_size(random), keyframe, arrival_us));
+      ok = consistent(ring, why);
+    }
+    expect(ok, "bound over a varying stream: " + why);
+    expect(ring.stats().peak_bytes > params.max_bytes / 2, "the bound was reached at all");
+    expect(ring.stats().overflows == 0, "no group outgrew the ring");
+  }
+
+  void
+  check_overflow() {
+    EventRingParams params;
+    params.max_bytes = 1000;
+    EventRing ring(params);
+    expect(ring.push(packet(400, true, 0)) && ring.push(packet(300, false, 1)) &&
+           ring.push(packet(300, false, 2)) && ring.bytes() == 1000, "group filling the ring");
+    // the group grows past max_bytes with no keyframe to cut at
+    expect(!ring.push(packet(300, false, 3)), "packet overflowing the ring refused");
+    expect(ring.packets() == 0 && ring.bytes() == 0 && ring.stats().overflows == 1,
+           "overflow empties the ring and is counted");
+    uint64_t dropped = ring.stats().dropped;
+    expect(!ring.push(packet(100, false, 4)) && ring.stats().dropped == dropped + 1,
+           "deltas after an overflow wait for a keyframe");
+    expect(ring.push(packet(400, true, 5)) && ring.packets() == 1, "keyframe starts over");
+
+    // with a later keyframe in the ring the oldest group gives way instead
+    EventRing cut(params);
+    cut.push(packet(400, true, 0));
+    cut.push(packet(300, false, 1));
+    cut.push(packet(200, true, 2));
+    expect(cut.push(packet(300, false, 3)) && cut.packets() == 2 && cut.bytes() == 500 &&
+           cut.snapshot().front().arrival_us == 2 && cut.stats().overflows == 0,
+           "oldest group dropped to stay within max_bytes");
+
+    // a keyframe alone larger than the ring
+    EventRing tiny(params);
+    expect(!tiny.push(packet(1001, true, 0)) && tiny.packets() == 0 &&
+           tiny.stats().overflows == 1, "keyframe larger than the ring");
+  }
+
+  void
+  check_horizon() {
+    EventRingParams params;
+    params.max_bytes = 64 << 20;
+    params.pre_event_us = 10000000;
+    EventRing ring(params);
+    // 10 fps, a keyframe every 2 s
+    const int64_t frame_us = 100000;
+    const int64_t gop_us = 2000000;
+    bool covers = true, bounded = true;
+    for (int64_t arrival_us = 0; arrival_us <= 60000000; arrival_us += frame_us) {
+      ring.push(packet(1000, arrival_us % gop_us == 0, arrival_us));
+      if (arrival_us < params.pre_event_us) {
+        // nothing old enough to drop yet
+        covers &= ring.span_us() == arrival_us;
+        continue;
+      }
+      // the clip starts at the newest keyframe at or before the horizon
+      covers &= ring.span_us() >= params.pre_event_us;
+      bounded &= ring.span_us() < params.pre_event_us + gop_us;
+    }
+    expect(covers, "ring reaches back to pre_event_us");
+    expect(bounded, "ring holds no more than a group past pre_event_us");
+    std::vector<EventPacket> held = ring.snapshot();
+    expect(!held.empty() && held.front().keyframe && held.front().arrival_us == 50000000 &&
+           held.back().arrival_us == 60000000, "front keyframe on the horizon");
+
+    // the horizon moves just past that keyframe, the clip still needs it
+    ring.push(packet(1000, false, 60000000 + frame_us));
+    expect(ring.snapshot().front().arrival_us == 50000000, "horizon just after a keyframe");
+  }
+
+  void
+  check_sharing() {
+    EventRing ring{EventRingParams()};
+    EventPacket key = packet(100, true, 0);
+    ring.push(key);
+    std::vector<EventPacket> clip = ring.snapshot();
+    ring.clear();
+    // the clip still holds the packet after the ring let go of it
+    expect(ring.packets() == 0 && ring.bytes() == 0 && clip.size() == 1 &&
+           clip[0].data == key.data && key.data.use_count() == 2, "snapshot shares packets");
+  }
+}
+
+int
+main() {
+  check_bound();
+  check_overflow();
+  check_horizon();
+  check_sharing();
+
+  if (failures) {
+    printf("%u event ring checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS event ring\n");
+  return 0;
+}
@@ -0,0 +1,255 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../fire_map.h"
+
+/* Checks and times the fire map on synthetic drone flights on any Linux box:
+ *
+ *   hermes-fire-map-bench [--drones N] [--fires N] [--duration S] [--fps N]
+ *                         [--merge-radius M] [--decay S] [--min-weight W] [--check]
+ *
+ * The checks run first on known geometry: projections at set pitch, yaw,
+ * height and field of view, and the merge radius, decay and multi-drone
+ * merging of the map. Any failure is printed and the exit code is 1.
+ * Then drones circle over scattered fires, every fire in view is projected
+ * and inserted, and a query around a random fire follows every frame.
+ * --check skips the timing. The clustering options are the keys of
+ * models/config_fire_map.txt. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  // geo_offset and geo_distance_m share the flat earth, centimetres are exact enough
+  bool
+  near_m(const GeoPoint &a, const GeoPoint &b, double tolerance_m = 0.01) {
+    return geo_distance_m(a, b) < tolerance_m;
+  }
+
+  const GeoPoint ORIGIN = {-33.865, 151.209};
+
+  DronePose
+  pose(double height_m, double yaw_deg, double pitch_deg, const GeoPoint &position = ORIGIN) {
+    DronePose pose;
+    pose.position = position;
+    pose.height_m = height_m;
+    pose.yaw_deg = yaw_deg;
+    pose.pitch_deg = pitch_deg;
+    return pose;
+  }
+
+  /* Ground point of pixel (u, v), or expects it to miss the ground */
+  void
+  expect_ground(const CameraIntrinsics &camera, const DronePose &pose, double u, double v,
+                double east_m, double north_m, const std::string &what) {
+    GeoPoint ground;
+    bool hit = project_to_ground(camera, pose, u, v, ground);
+    expect(hit && near_m(ground, geo_offset(pose.position, east_m, north_m)), what);
+    double back_u = 0, back_v = 0;
+    expect(hit && project_to_image(camera, pose, ground, back_u, back_v) &&
+           std::fabs(back_u - u) < 1e-3 && std::fabs(back_v - v) < 1e-3,
+           what + ", back to the image");
+  }
+
+  void
+  check_projection() {
+    // 90 degrees across 960 pixels: fx = 480, one pixel offset per metre of height
+    CameraIntrinsics camera = intrinsics_from_fov(960, 720, 90);
+    expect(std::fabs(camera.fx - 480) < 1e-9 && camera.fy == camera.fx && camera.cx == 480 &&
+           camera.cy == 360, "intrinsics of a 90 degree field of view");
+
+    // straight down, the right edge is as far east as the drone is high
+    expect_ground(camera, pose(100, 0, 90), 480, 360, 0, 0, "nadir centre");
+    expect_ground(camera, pose(100, 0, 90), 960, 360, 100, 0, "nadir right edge, heading north");
+    expect_ground(camera, pose(50, 0, 90), 960, 360, 50, 0, "nadir right edge at half height");
+    expect_ground(camera, pose(100, 0, 90), 480, 0, 0, 75, "nadir top edge, heading north");
+    // turning the camera turns the image: heading east, the right of the image is south
+    expect_ground(camera, pose(100, 90, 90), 960, 360, 0, -100, "nadir right edge, heading east");
+    expect_ground(camera, pose(100, 180, 90), 960, 360, -100, 0, "nadir right edge, heading south");
+
+    // tilted, the centre lands height / tan(pitch) ahead
+    expect_ground(camera, pose(100, 0, 45), 480, 360, 0, 100, "45 degrees, heading north");
+    expect_ground(camera, pose(100, 90, 45), 480, 360, 100, 0, "45 degrees, heading east");
+    expect_ground(camera, pose(60, 0, 60), 480, 360, 0, 60 / std::tan(M_PI / 3),
+                  "60 degrees at 60 m");
+    // a narrower lens reaches less far to the side
+    CameraIntrinsics narrow = intrinsics_from_fov(960, 720, 2 * std::atan(0.5) * 180 / M_PI);
+    expect_ground(narrow, pose(100, 0, 90), 960, 360, 50, 0, "narrow lens right edge");
+
+    GeoPoint ground;
+    expect(!project_to_ground(camera, pose(100, 0, 0), 480, 360, ground),
+           "level camera centre misses the ground");
+    expect(!project_to_ground(camera, pose(100, 0, 30), 480, 0, ground),
+           "above the horizon misses the ground");
+    expect(!project_to_ground(camera, pose(0, 0, 90), 480, 360, ground),
+           "a drone on the ground sees nothing");
+    double u, v;
+    expect(!project_to_image(camera, pose(100, 0, 10), geo_offset(ORIGIN, 0, -200), u, v),
+           "a point behind the camera has no pixel");
+  }
+
+  void
+  check_map() {
+    FireMapParams params;
+    params.merge_radius_m = 15;
+    params.decay_s = 100;
+    params.min_weight = 0.05;
+
+    // within the radius the cluster takes the mean, outside a new one starts
+    FireMap map(params);
+    FireObservation first = map.insert(ORIGIN, 0, 0);
+    FireObservation close = map.insert(geo_offset(ORIGIN, 10, 0), 0, 0);
+    FireObservation outside = map.insert(geo_offset(ORIGIN, 0, 30), 0, 0);
+    expect(first.new_cluster && !close.new_cluster && close.cluster_id == first.cluster_id,
+           "observation within the merge radius joins the cluster");
+    expect(outside.new_cluster && outside.cluster_id != first.cluster_id && map.size() == 2,
+           "observation outside the merge radius starts a cluster");
+    std::vector<FireCluster> found = map.query(ORIGIN, 6, 0);
+    expect(found.size() == 1 && found[0].id == first.cluster_id && found[0].observations == 2 &&
+           near_m(found[0].position, geo_offset(ORIGIN, 5, 0)) &&
+           std::fabs(found[0].weight - 2) < 1e-9, "cluster at the mean of its observations");
+    found = map.query(geo_offset(ORIGIN, 0, 20), 50, 0);
+    expect(found.size() == 2 && found[0].id == outside.cluster_id, "query nearest first");
+
+    FireMap edge(params);
+    edge.insert(ORIGIN, 0, 0);
+    expect(!edge.insert(geo_offset(ORIGIN, 14.9, 0), 0, 0).new_cluster,
+           "just inside the merge radius");
+    FireMap beyond(params);
+    beyond.insert(ORIGIN, 0, 0);
+    expect(beyond.insert(geo_offset(ORIGIN, 0, -15.1), 0, 0).new_cluster,
+           "just outside the merge radius");
+
+    // one observation fades by e every decay_s, and is forgotten below min_weight
+    FireMap fading(params);
+    fading.insert(ORIGIN, 0, 0);
+    std::vector<FireCluster> live = fading.clusters(100 * 1000000LL);
+    expect(live.size() == 1 && std::fabs(live[0].weight - std::exp(-1.0)) < 1e-9,
+           "weight after one decay time");
+    // ln 20 decay times bring 1 to 0.05
+    int64_t faded_us = (int64_t)(100 * std::log(20.0) * 1e6) + 1000000;
+    expect(fading.clusters(faded_us).empty() && fading.size() == 1,
+           "faded cluster hidden before it is expired");
+    expect(fading.expire(faded_us) == 1 && fading.size() == 0, "faded cluster expired");
+    FireMap revived(params);
+    FireObservation old_fire = revived.insert(ORIGIN, 0, 0);
+    FireObservation again = revived.insert(ORIGIN, 0, faded_us);
+    expect(again.new_cluster && again.cluster_id != old_fire.cluster_id,
+           "a faded cluster takes no observations");
+
+    // two drones on opposite sides see the same fire: one cluster, both sources
+    CameraIntrinsics camera = intrinsics_from_fov(960, 720, 82.6);
+    GeoPoint fire = geo_offset(ORIGIN, 40, 25);
+    DronePose drones[] = {pose(60, 30, 50, geo_offset(fire, -40, -70)),
+                          pose(80, 250, 65, geo_offset(fire, 35, 10))};
+    FireMap shared(params);
+    std::vector<FireObservation> seen;
+    for (unsigned int source = 0; source < 2; source++) {
+      double u, v;
+      GeoPoint ground;
+      bool ok = project_to_image(camera, drones[source], fire, u, v) &&
+          u >= 0 && u < 960 && v >= 0 && v < 720 &&
+          // a few pixels of detector jitter
+          project_to_ground(camera, drones[source], u + 3, v - 2, ground);
+      expect(ok, "fire in view of drone " + std::to_string(source));
+      if (ok) {
+        seen.push_back(shared.insert(ground, source, source * 1000));
+      }
+    }
+    live = shared.clusters(1000);
+    expect(seen.size() == 2 && seen[0].new_cluster && !seen[1].new_cluster &&
+           live.size() == 1 && live[0].sources == 3 && live[0].observations == 2 &&
+           geo_distance_m(live[0].position, fire) < 2, "drones report one fire once");
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  FireMapBenchmarkSettings settings;
+  bool check_only = false;
+  const struct option options[] = {
+    {"drones", required_argument, NULL, 'n'},
+    {"fires", required_argument, NULL, 'f'},
+    {"duration", required_argument, NULL, 't'},
+    {"fps", required_argument, NULL, 'r'},
+    {"merge-radius", required_argument, NULL, 'm'},
+    {"decay", required_argument, NULL, 'k'},
+    {"min-weight", required_argument, NULL, 'w'},
+    {"check", no_argument, NULL, 'c'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch (option) {
+      case 'n':
+        settings.drones = atoi(optarg);
+        break;
+      case 'f':
+        settings.fires = atoi(optarg);
+        break;
+      case 't':
+        settings.duration_s = atof(optarg);
+        break;
+      case 'r':
+        settings.fps = atof(optarg);
+        break;
+      case 'm':
+        settings.params.merge_radius_m = atof(optarg);
+        break;
+      case 'k':
+        settings.params.decay_s = atof(optarg);
+        break;
+      case 'w':
+        settings.params.min_weight = atof(optarg);
+        break;
+      case 'c':
+        check_only = true;
+        break;
+      default:
+        return 1;
+    }
+  }
+  if (!settings.drones || !settings.fires || settings.duration_s <= 0 || settings.fps <= 0 ||
+      settings.params.merge_radius_m <= 0 || settings.params.decay_s <= 0 ||
+      settings.params.min_weight <= 0) {
+    fprintf(stderr, "Invalid settings\n");
+    return 1;
+  }
+
+  check_projection();
+  check_map();
+  if (failures) {
+    printf("%u fire map checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS fire map\n");
+  if (check_only) {
+    return 0;
+  }
+
+  printf("%u drones over %u fires, %.0f s at %.0f fps, merge radius %.1f m, decay %.0f s\n",
+         settings.drones, settings.fires, settings.duration_s, settings.fps,
+         settings.params.merge_radius_m, settings.params.decay_s);
+  FireMapBenchmarkResult result = run_fire_map_benchmark(settings);
+  printf("Inserts: %lu | %.0f per second | query p50: %.2f us | query p99: %.2f us\n",
+         (unsigned long)result.inserts, result.inserts_per_s, result.query_p50_us,
+         result.query_p99_us);
+  printf("Fires seen: %u | clusters: %zu | mean error: %.2f m\n", result.fires_seen,
+         result.clusters, result.mean_error_m);
+  return 0;
+}
@@ -0,0 +1,330 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../governor.h"
+
+/* Replays a sensor trace through the thermal governor on any Linux box:
+ *
+ *   hermes-governor-replay TRACE [--temp-high C] [--temp-critical C] [--power-high W]
+ *       [--step-up S] [--step-down S] [--smoothing S] [--interval N]
+ *       [--min-detection-fps N] [--display-fps N] [--fallback-model]
+ *   hermes-governor-replay --check
+ *
+ * TRACE has a line per sample, "seconds,celsius,watts", either reading left
+ * empty when its sensor gave none; lines starting with # are skipped. Every
+ * decision that changes the pipeline is printed with the readings behind it.
+ * --check replays scripted traces instead, with the steps up and down,
+ * critical jumps and hysteresis each is expected to give, and checks the
+ * ladders of a few settings. Prints a line per failed check and exits with
+ * 1 if there was any. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  /* A change of the pipeline: when, what and to which level */
+  struct GovernorEvent {
+    double time_s;
+    GovernorAction action;
+    unsigned int level;
+
+    bool
+    operator==(const GovernorEvent &other) const {
+      return std::fabs(time_s - other.time_s) < 1e-6 && action == other.action &&
+          level == other.level;
+    }
+  };
+
+  /* Samples a second apart from from_s to to_s, both included */
+  void
+  hold_at(std::vector<GovernorSample> &trace, int from_s, int to_s, double temp_c,
+          double power_w = NAN) {
+    for (int t = from_s; t <= to_s; t++) {
+      GovernorSample sample;
+      sample.time_us = (int64_t)t * 1000000;
+      sample.temp_c = temp_c;
+      sample.power_w = power_w;
+      trace.push_back(sample);
+    }
+  }
+
+  std::string
+  describe(const std::vector<GovernorEvent> &events) {
+    std::string text;
+    for (const GovernorEvent &event : events) {
+      char item[64];
+      snprintf(item, sizeof(item), " %.0f s %s to %u;", event.time_s,
+               governor_action_name(event.action), event.level);
+      text += item;
+    }
+    return text.empty() ? " none" : text;
+  }
+
+  Governor
+  replay(const GovernorParams &params, const std::vector<GovernorSample> &trace,
+         const std::vector<GovernorEvent> &expected, const std::string &what) {
+    Governor governor(params, 0);
+    std::vector<GovernorEvent> events;
+    for (const GovernorSample &sample : trace) {
+      GovernorAction action = governor.update(sample);
+      if (action != GovernorAction::HOLD && action != GovernorAction::NO_READING) {
+        events.push_back({sample.time_us / 1e6, action, governor.decision().level});
+      }
+    }
+    expect(events == expected, what + ": got" + describe(events) + " expected" +
+           describe(expected));
+    return governor;
+  }
+
+  /* Raw readings unless smoothing is under test, thresholds of the shipped
+   * config: 80 C high, 5 C hysteresis, 90 C critical, 10 s up, 60 s down.
+   * The ladder from interval 0 at 30 fps: display at 5 fps, then intervals
+   * 1, 3, 7 and 14, the last keeping 2 detections per second. */
+  GovernorParams
+  scripted_params() {
+    GovernorParams params;
+    params.smoothing_s = 0;
+    return params;
+  }
+
+  void
+  check_ladders() {
+    Governor standard(scripted_params(), 0);
+    std::vector<unsigned int> intervals, display;
+    for (const GovernorDecision &step : standard.steps()) {
+      intervals.push_back(step.interval);
+      display.push_back(step.display_fps);
+      expect(30.0 / (step.interval + 1) >= 2, "a step detecting less than min-detection-fps");
+    }
+    expect(intervals == std::vector<unsigned int>{0, 0, 1, 3, 7, 14} &&
+           display == std::vector<unsigned int>{0, 5, 5, 5, 5, 5}, "ladder from interval 0");
+
+    GovernorParams params = scripted_params();
+    params.fallback_model = true;
+    Governor fallback(params, 4);
+    intervals.clear();
+    for (const GovernorDecision &step : fallback.steps()) {
+      intervals.push_back(step.interval);
+    }
+    expect(intervals == std::vector<unsigned int>{4, 4, 9, 14, 14} &&
+           fallback.steps().back().fallback_model && !fallback.steps()[3].fallback_model,
+           "ladder from interval 4 with the fallback model");
+
+    // what start_governor runs without
+    params = scripted_params();
+    params.display_fps = 0;
+    expect(Governor(params, 14).steps().size() == 1, "nothing to shed at interval 14");
+  }
+
+  void
+  check_traces() {
+    const GovernorAction UP = GovernorAction::STEP_UP, DOWN = GovernorAction::STEP_DOWN,
+        CRITICAL = GovernorAction::CRITICAL;
+    GovernorParams params = scripted_params();
+
+    // Over the limit: a step every step_up_s, up to the last
+    std::vector<GovernorSample> trace;
+    hold_at(trace, 0, 60, 85);
+    std::vector<GovernorEvent> climb = {{0, UP, 1}, {10, UP, 2}, {20, UP, 3}, {30, UP, 4},
+                                        {40, UP, 5}};
+    Governor governor = replay(params, trace, climb, "step up");
+    expect(governor.stats().steps_up == 5 && governor.stats().throttled_us == 60000000,
+           "step up stats");
+
+    // Within the hysteresis it stays; below it, a step every step_down_s
+    hold_at(trace, 61, 200, 78);
+    hold_at(trace, 201, 520, 70);
+    std::vector<GovernorEvent> down = climb;
+    for (unsigned int level = 4, t = 261; t <= 501; level--, t += 60) {
+      down.push_back({(double)t, DOWN, level});
+    }
+    replay(params, trace, down, "step down");
+
+    // A reading back in the hysteresis band restarts the wait
+    trace.clear();
+    hold_at(trace, 0, 0, 85);
+    hold_at(trace, 1, 100, 76);
+    hold_at(trace, 101, 150, 74);
+    hold_at(trace, 151, 151, 77);
+    hold_at(trace, 152, 220, 74);
+    replay(params, trace, {{0, UP, 1}, {212, DOWN, 0}}, "hysteresis");
+
+    // One reading at the critical temperature goes to the last step at once
+    trace.clear();
+    hold_at(trace, 0, 10, 70);
+    hold_at(trace, 11, 12, 92);
+    hold_at(trace, 13, 80, 70);
+    governor = replay(params, trace, {{11, CRITICAL, 5}, {73, DOWN, 4}}, "critical");
+    expect(governor.stats().critical == 1 && governor.stats().peak_temp_c == 92,
+           "critical stats");
+
+    // Power alone, and missing readings change nothing
+    params.power_high_w = 10;
+    trace.clear();
+    hold_at(trace, 0, 15, NAN, 12);
+    hold_at(trace, 16, 20, NAN, NAN);
+    hold_at(trace, 21, 90, NAN, 8.5);
+    governor = replay(params, trace, {{0, UP, 1}, {10, UP, 2}, {81, DOWN, 1}}, "power limit");
+    expect(governor.stats().missing == 5 && governor.stats().peak_power_w == 12,
+           "missing readings counted");
+
+    // Smoothed over 5 s: a one second spike passes, a lasting rise is
+    // followed once the average crosses the limit, the sixth reading at 85 C
+    // (70.8 C + 14.2 C * (1 - exp(-6 / 5)) = 80.5 C, after five 79.8 C)
+    params = scripted_params();
+    params.smoothing_s = 5;
+    trace.clear();
+    hold_at(trace, 0, 1, 70);
+    hold_at(trace, 2, 2, 88);
+    hold_at(trace, 3, 9, 70);
+    hold_at(trace, 10, 30, 85);
+    replay(params, trace, {{15, UP, 1}, {25, UP, 2}}, "smoothing");
+  }
+
+  // an empty field is a missing reading
+  double
+  parse_reading(const char *field) {
+    char *end;
+    double value = strtod(field, &end);
+    return end == field ? NAN : value;
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  GovernorParams params;
+  unsigned int base_interval = 0;
+  bool check = false;
+  const struct option options[] = {
+    {"temp-high", required_argument, NULL, 't'},
+    {"temp-critical", required_argument, NULL, 'c'},
+    {"power-high", required_argument, NULL, 'p'},
+    {"step-up", required_argument, NULL, 'u'},
+    {"step-down", required_argument, NULL, 'd'},
+    {"smoothing", required_argument, NULL, 's'},
+    {"interval", required_argument, NULL, 'i'},
+    {"min-detection-fps", required_argument, NULL, 'm'},
+    {"display-fps", required_argument, NULL, 'f'},
+    {"fallback-model", no_argument, NULL, 'l'},
+    {"check", no_argument, NULL, 'k'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch (option) {
+      case 't':
+        params.temp_high_c = atof(optarg);
+        break;
+      case 'c':
+        params.temp_critical_c = atof(optarg);
+        break;
+      case 'p':
+        params.power_high_w = atof(optarg);
+        break;
+      case 'u':
+        params.step_up_s = atof(optarg);
+        break;
+      case 'd':
+        params.step_down_s = atof(optarg);
+        break;
+      case 's':
+        params.smoothing_s = atof(optarg);
+        break;
+      case 'i':
+        base_interval = atoi(optarg);
+        break;
+      case 'm':
+        params.min_detection_fps = atof(optarg);
+        break;
+      case 'f':
+        params.display_fps = atoi(optarg);
+        break;
+      case 'l':
+        params.fallback_model = true;
+        break;
+      case 'k':
+        check = true;
+        break;
+      default:
+        return 1;
+    }
+  }
+  if (check) {
+    check_ladders();
+    check_traces();
+    if (failures) {
+      printf("%u governor checks failed\n", failures);
+      return 1;
+    }
+    printf("PASS governor\n");
+    return 0;
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "Usage: %s TRACE [options] | --check\n", argv[0]);
+    return 1;
+  }
+  FILE *trace = fopen(argv[optind], "r");
+  if (!trace) {
+    fprintf(stderr, "Could not open %s\n", argv[optind]);
+    return 1;
+  }
+
+  Governor governor(params, base_interval);
+  printf("%zu steps above full work, detections every %u frames at most\n",
+         governor.steps().size() - 1, governor.steps().back().interval + 1);
+
+  char line[256];
+  unsigned int number = 0;
+  while (fgets(line, sizeof(line), trace)) {
+    number++;
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    char *temp = strchr(line, ',');
+    char *power = temp ? strchr(temp + 1, ',') : NULL;
+    if (!power) {
+      fprintf(stderr, "Line %u: expected seconds,celsius,watts\n", number);
+      fclose(trace);
+      return 1;
+    }
+    GovernorSample sample;
+    sample.time_us = (int64_t)(atof(line) * 1e6);
+    sample.temp_c = parse_reading(temp + 1);
+    sample.power_w = parse_reading(power + 1);
+
+    GovernorAction action = governor.update(sample);
+    if (action == GovernorAction::HOLD || action == GovernorAction::NO_READING) {
+      continue;
+    }
+    const GovernorDecision &decision = governor.decision();
+    printf("%8.1f s | %.1f C %.1f W | %s to level %u: interval %u, display %u fps%s\n",
+           sample.time_us / 1e6, governor.temp_c(), governor.power_w(),
+           governor_action_name(action), decision.level, decision.interval,
+           decision.display_fps, decision.fallback_model ? ", fallback model" : "");
+  }
+  fclose(trace);
+
+  const GovernorStats &stats = governor.stats();
+  printf("Samples: %lu | missing: %lu | up: %lu | down: %lu | critical: %lu | throttled: %.1f s\n",
+         (unsigned long)stats.samples, (unsigned long)stats.missing,
+         (unsigned long)stats.steps_up, (unsigned long)stats.steps_down,
+         (unsigned long)stats.critical, stats.throttled_us / 1e6);
+  printf("Peak: %.1f C %.1f W\n", stats.peak_temp_c, stats.peak_power_w);
+  return 0;
+}
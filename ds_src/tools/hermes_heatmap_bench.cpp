@@ -0,0 +1,259 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../heatmap.h"
+
+/* Checks and times the per-source fire heatmaps on any Linux box:
+ *
+ *   hermes-heatmap-bench [--sources N] [--frames N] [--detections N] [--size WxH] [--decay S]
+ *                        [--check]
+ *
+ * The checks run first: the vectorized decay against a scalar exponential in
+ * double precision, and boxes at and beyond the edges of the map. Any
+ * failure is printed and the exit code is 1. Then every frame of every
+ * source decays its map and adds a few drifting detections, as the
+ * analytics branch does. --check skips the timing. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  /* The map cell by cell in double precision, with the same cold cutoff */
+  struct ScalarHeatmap {
+    unsigned int width;
+    unsigned int height;
+    double decay_s;
+    std::vector<double> cells;
+    int64_t last_us = -1;
+    double gain = 0;
+
+    ScalarHeatmap(const HeatmapParams &params)
+        : width(params.width), height(params.height), decay_s(params.decay_s),
+          cells((size_t)params.width * params.height, 0.0) {}
+
+    void
+    begin_frame(int64_t timestamp_us) {
+      if (last_us < 0 || timestamp_us < last_us) {
+        last_us = timestamp_us;
+        gain = 0;
+        return;
+      }
+      double factor = std::exp(-(timestamp_us - last_us) / (decay_s * 1e6));
+      last_us = timestamp_us;
+      gain = 1 - factor;
+      for (double &cell : cells) {
+        cell *= factor;
+        cell = cell < 1e-6 ? 0 : cell;
+      }
+    }
+
+    /* Cells whose square overlaps the box; a box thinner than a cell still
+     * takes the one it starts in */
+    void
+    add(double left, double top, double box_width, double box_height, double confidence) {
+      for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+          double x0 = left * width, x1 = (left + box_width) * width;
+          double y0 = top * height, y1 = (top + box_height) * height;
+          bool column = (x < x1 && x + 1 > x0) || (x == std::floor(x0) && x0 == x1);
+          bool row = (y < y1 && y + 1 > y0) || (y == std::floor(y0) && y0 == y1);
+          if (column && row) {
+            cells[(size_t)y * width + x] += gain * confidence;
+          }
+        }
+      }
+    }
+  };
+
+  bool
+  same_cells(const Heatmap &map, const ScalarHeatmap &reference, double &worst) {
+    worst = 0;
+    for (size_t i = 0; i < reference.cells.size(); i++) {
+      double error = std::fabs(map.cells()[i] - reference.cells[i]);
+      worst = std::max(worst, error / std::max(1e-3, reference.cells[i]));
+    }
+    return worst < 1e-4;
+  }
+
+  void
+  check_decay() {
+    // odd sizes leave a tail after the vectorized part of the loop
+    for (const HeatmapParams params : {HeatmapParams{96, 54, 60}, HeatmapParams{7, 3, 2},
+                                       HeatmapParams{33, 1, 0.5}}) {
+      std::string size = std::to_string(params.width) + "x" + std::to_string(params.height);
+      std::mt19937 random(7);
+      std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+      Heatmap map(params);
+      ScalarHeatmap reference(params);
+      int64_t timestamp_us = 1000000;
+      double worst = 0;
+      bool same = true;
+      for (unsigned int frame = 0; frame < 600 && same; frame++) {
+        // 30 fps with dropped frames and now and then a stall long enough to
+        // take every cell below the cold cutoff
+        timestamp_us += frame % 97 == 96 ? (int64_t)(params.decay_s * 20e6) :
+            (int64_t)(33333 * (1 + (unsigned int)(unit(random) * 3)));
+        map.begin_frame(timestamp_us);
+        reference.begin_frame(timestamp_us);
+        for (unsigned int i = 0; i < 3; i++) {
+          float left = unit(random) * 0.9f, top = unit(random) * 0.9f;
+          float width = 0.02f + unit(random) * 0.2f, height = 0.02f + unit(random) * 0.2f;
+          float confidence = unit(random);
+          map.add(left, top, width, height, confidence);
+          reference.add(left, top, width, height, confidence);
+        }
+        same = same_cells(map, reference, worst);
+      }
+      expect(same, size + " map against the scalar exponential, worst error " +
+             std::to_string(worst));
+    }
+
+    // a steady fire settles at its confidence, out it fades by e per decay_s
+    HeatmapParams params;
+    params.width = 8;
+    params.height = 8;
+    params.decay_s = 2;
+    Heatmap map(params);
+    int64_t timestamp_us = 0;
+    for (unsigned int frame = 0; frame < 30 * 30; frame++) {
+      timestamp_us = frame * 33333;
+      map.begin_frame(timestamp_us);
+      map.add(0.25f, 0.25f, 0.25f, 0.25f, 0.8f);
+    }
+    expect(std::fabs(map.at(2, 2) - 0.8f) < 1e-4 && map.at(0, 0) == 0, "steady fire settles");
+    map.begin_frame(timestamp_us + 2000000);
+    expect(std::fabs(map.at(3, 3) - 0.8f * std::exp(-1.0f)) < 1e-4, "fire out for decay_s");
+    map.begin_frame(timestamp_us + 2000000 * 30);
+    expect(map.count_above(1e-30f) == 0, "cold cells are zero");
+    // a clock going back restarts without decaying or taking anything in
+    map.add(0, 0, 1, 1, 1);
+    float before = map.at(0, 0);
+    map.begin_frame(timestamp_us);
+    map.add(0, 0, 1, 1, 1);
+    expect(before > 0 && map.at(0, 0) == before, "clock going back");
+  }
+
+  /* Cells a single box marks on a 10x5 map */
+  std::vector<std::pair<unsigned int, unsigned int>>
+  marked(float left, float top, float width, float height) {
+    HeatmapParams params;
+    params.width = 10;
+    params.height = 5;
+    Heatmap map(params);
+    map.begin_frame(0);
+    map.begin_frame(1000000);
+    map.add(left, top, width, height, 1);
+    std::vector<std::pair<unsigned int, unsigned int>> cells;
+    for (unsigned int y = 0; y < map.height(); y++) {
+      for (unsigned int x = 0; x < map.width(); x++) {
+        if (map.at(x, y) > 0) {
+          cells.emplace_back(x, y);
+        }
+      }
+    }
+    return cells;
+  }
+
+  void
+  check_edges() {
+    typedef std::vector<std::pair<unsigned int, unsigned int>> Cells;
+    expect(marked(0, 0, 0.1f, 0.2f) == Cells{{0, 0}}, "top left cell");
+    expect(marked(0.9f, 0.8f, 0.1f, 0.2f) == Cells{{9, 4}}, "bottom right cell");
+    expect(marked(0.95f, 0.9f, 0.3f, 0.4f) == Cells{{9, 4}}, "box past the bottom right corner");
+    expect(marked(-0.2f, -0.4f, 0.25f, 0.5f) == Cells{{0, 0}}, "box past the top left corner");
+    expect(marked(0, 0, 1, 1).size() == 50, "whole frame");
+    expect(marked(-1, -1, 3, 3).size() == 50, "box larger than the frame");
+    expect(marked(0.999f, 0.999f, 0, 0) == Cells{{9, 4}}, "empty box at the far corner");
+    expect(marked(0.42f, 0.5f, 0.001f, 0.001f) == Cells{{4, 2}}, "box inside one cell");
+    expect(marked(0.35f, 0.1f, 0.1f, 0.1f) == Cells{{3, 0}, {4, 0}}, "box across a cell border");
+    expect(marked(1.0f, 0.5f, 0.2f, 0.2f).empty(), "box right of the frame");
+    expect(marked(0.5f, 1.0f, 0.2f, 0.2f).empty(), "box below the frame");
+    expect(marked(-0.5f, 0.5f, 0.2f, 0.2f).empty(), "box left of the frame");
+    expect(marked(0.5f, -0.5f, 0.2f, 0.2f).empty(), "box above the frame");
+    expect(marked(0.5f, 0.5f, 0.2f, 0.2f).size() == 2 * 1 + 2, "box of 2x2 cells");
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  HeatmapBenchmarkSettings settings;
+  bool check_only = false;
+  const struct option options[] = {
+    {"sources", required_argument, NULL, 'n'},
+    {"frames", required_argument, NULL, 'f'},
+    {"detections", required_argument, NULL, 'd'},
+    {"size", required_argument, NULL, 's'},
+    {"decay", required_argument, NULL, 'k'},
+    {"check", no_argument, NULL, 'c'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch (option) {
+      case 'n':
+        settings.sources = atoi(optarg);
+        break;
+      case 'f':
+        settings.frames = atoi(optarg);
+        break;
+      case 'd':
+        settings.detections = atoi(optarg);
+        break;
+      case 's':
+        if (sscanf(optarg, "%ux%u", &settings.params.width, &settings.params.height) != 2) {
+          fprintf(stderr, "--size takes WIDTHxHEIGHT\n");
+          return 1;
+        }
+        break;
+      case 'k':
+        settings.params.decay_s = atof(optarg);
+        break;
+      case 'c':
+        check_only = true;
+        break;
+      default:
+        return 1;
+    }
+  }
+  if (!settings.sources || !settings.frames || !settings.params.width ||
+      !settings.params.height || settings.params.decay_s <= 0) {
+    fprintf(stderr, "Invalid settings\n");
+    return 1;
+  }
+
+  check_decay();
+  check_edges();
+  if (failures) {
+    printf("%u heatmap checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS heatmap\n");
+  if (check_only) {
+    return 0;
+  }
+
+  printf("%u sources, %ux%u cells, %u detections per frame, %.0f s decay, %u frames\n",
+         settings.sources, settings.params.width, settings.params.height, settings.detections,
+         settings.params.decay_s, settings.frames);
+  HeatmapBenchmarkResult result = run_heatmap_benchmark(settings);
+  printf("Frame p50: %.2f us | p99: %.2f us | decay: %.0f ns\n", result.frame_p50_us,
+         result.frame_p99_us, result.decay_ns);
+  printf("Batch p50: %.2f us | p99: %.2f us\n", result.batch_p50_us, result.batch_p99_us);
+  return 0;
+}
@@ -0,0 +1,226 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../hermes_log.h"
+
+/* Checks the logging queue and the per-site rate limiter on any Linux box:
+ *
+ *   hermes-log-test
+ *
+ * stderr goes to a pipe that is read back and parsed. Nobody reads the pipe
+ * at first, so the background writer blocks on it while four producers fill
+ * the queue: records past its capacity are dropped and counted, the rest
+ * arrive in order per producer. Then the rate limiter runs against a
+ * reading pipe: levels chosen per call, bursts, suppression counts, and
+ * log_flush writing everything before it returns. Prints a line per failed
+ * check and exits with 1 if there was any. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  const unsigned int PRODUCERS = 4;
+  const unsigned int RECORDS_PER_PRODUCER = 2000;
+
+  /* A text record: date time LEVEL file:line message key=value... */
+  struct Line {
+    std::string level;
+    std::string message;
+    std::map<std::string, std::string> fields;
+  };
+
+  std::vector<Line>
+  parse(const std::string &output) {
+    std::vector<Line> lines;
+    std::istringstream rows(output);
+    std::string row;
+    while (std::getline(rows, row)) {
+      std::istringstream tokens(row);
+      std::string date, time, site, token;
+      Line line;
+      tokens >> date >> time >> line.level >> site >> line.message;
+      while (tokens >> token) {
+        size_t equals = token.find('=');
+        if (equals != std::string::npos) {
+          line.fields[token.substr(0, equals)] = token.substr(equals + 1);
+        }
+        else {
+          // words of a message with spaces
+          line.message += " " + token;
+        }
+      }
+      lines.push_back(line);
+    }
+    return lines;
+  }
+
+  std::vector<Line>
+  with_message(const std::vector<Line> &lines, const std::string &message) {
+    std::vector<Line> found;
+    for (const Line &line : lines) {
+      if (line.message == message) {
+        found.push_back(line);
+      }
+    }
+    return found;
+  }
+
+  void
+  produce(unsigned int producer) {
+    for (unsigned int seq = 0; seq < RECORDS_PER_PRODUCER; seq++) {
+      HERMES_LOG(LOG_LEVEL_INFO, "produced", log_field("producer", producer), log_field("seq", seq));
+    }
+  }
+
+  void
+  leveled(LogLevel level, int i) {
+    HERMES_LOG(level, "leveled", log_field("i", i));
+  }
+
+  void
+  limited(int i) {
+    HERMES_LOG(LOG_LEVEL_WARNING, "limited", log_field("i", i));
+  }
+
+  void
+  check_producers(const std::vector<Line> &lines) {
+    std::vector<Line> produced = with_message(lines, "produced");
+    std::vector<long> last(PRODUCERS, -1);
+    bool ordered = true;
+    for (const Line &line : produced) {
+      unsigned int producer = std::stoul(line.fields.at("producer"));
+      long seq = std::stol(line.fields.at("seq"));
+      ordered &= producer < PRODUCERS && seq > last[producer];
+      if (producer < PRODUCERS) {
+        last[producer] = seq;
+      }
+    }
+    expect(ordered, "records of a producer arrive once and in order");
+
+    uint64_t dropped = log_dropped();
+    expect(dropped > 0, "a full queue drops records");
+    expect(produced.size() + dropped == PRODUCERS * RECORDS_PER_PRODUCER,
+           "every record is written or counted as dropped: " + std::to_string(produced.size()) +
+           " written, " + std::to_string(dropped) + " dropped");
+    uint64_t reported = 0;
+    for (const Line &line : with_message(lines, "Log queue full, records dropped")) {
+      reported += std::stoull(line.fields.at("dropped"));
+    }
+    expect(reported == dropped, "dropped records are reported");
+  }
+
+  void
+  check_rate_limit(const std::vector<Line> &lines) {
+    std::vector<Line> found = with_message(lines, "leveled");
+    expect(found.size() == 3 && found[0].level == "WARNING" && found[0].fields["i"] == "0" &&
+           found[1].level == "INFO" && found[1].fields["i"] == "1" &&
+           found[2].level == "ERROR" && found[2].fields["i"] == "3",
+           "level chosen per call, debug filtered");
+
+    found = with_message(lines, "limited");
+    expect(found.size() == 4 && found[0].fields["i"] == "0" && found[2].fields["i"] == "2" &&
+           !found[2].fields.count("suppressed") && found[3].fields["i"] == "10",
+           "burst of a site, then the next window");
+    expect(found.size() == 4 && found[3].fields["suppressed"] == "7",
+           "next record of a site reports the suppressed ones");
+    expect(with_message(lines, "other site").size() == 1, "sites are limited on their own");
+    expect(with_message(lines, "flushed").size() == 1, "log_flush writes what was queued");
+  }
+}
+
+int
+main() {
+  int pipe_fds[2];
+  int saved_stderr = dup(STDERR_FILENO);
+  if (pipe(pipe_fds) != 0 || saved_stderr < 0) {
+    perror("pipe");
+    return 1;
+  }
+  // a small pipe fills after a few records
+  fcntl(pipe_fds[1], F_SETPIPE_SZ, 4096);
+  dup2(pipe_fds[1], STDERR_FILENO);
+  close(pipe_fds[1]);
+
+  std::atomic<bool> reading{false};
+  std::string output;
+  std::thread reader([&] {
+    while (!reading.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(pipe_fds[0], buffer, sizeof(buffer))) > 0) {
+      output.append(buffer, length);
+    }
+  });
+
+  LogSettings settings;
+  settings.interval_ms = 0;
+  log_configure(settings);
+  std::vector<std::thread> producers;
+  for (unsigned int producer = 0; producer < PRODUCERS; producer++) {
+    producers.emplace_back(produce, producer);
+  }
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  reading.store(true);
+  log_flush();
+  // reports the drops counted after the last drain
+  HERMES_LOG(LOG_LEVEL_INFO, "producers done");
+  log_flush();
+
+  settings.burst = 3;
+  settings.interval_ms = 60000;
+  log_configure(settings);
+  leveled(LOG_LEVEL_WARNING, 0);
+  leveled(LOG_LEVEL_INFO, 1);
+  leveled(LOG_LEVEL_DEBUG, 2);
+  leveled(LOG_LEVEL_ERROR, 3);
+  for (int i = 0; i < 10; i++) {
+    limited(i);
+  }
+  HERMES_LOG(LOG_LEVEL_WARNING, "other site");
+  settings.interval_ms = 1;
+  log_configure(settings);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  limited(10);
+  HERMES_LOG(LOG_LEVEL_INFO, "flushed");
+  log_flush();
+
+  // whatever log_flush left queued now goes to the real stderr
+  dup2(saved_stderr, STDERR_FILENO);
+  close(saved_stderr);
+  reader.join();
+  close(pipe_fds[0]);
+
+  std::vector<Line> lines = parse(output);
+  check_producers(lines);
+  check_rate_limit(lines);
+
+  if (failures) {
+    printf("%u log checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS log\n");
+  return 0;
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "../model_update.h"
+
+/* Checks the versioning and rollback of in-place model updates on any
+ * Linux box:
+ *
+ *   hermes-model-update-test
+ *
+ * A stand-in detector takes the place of nvinfer: setting a config loads it
+ * or fails to, and every batch it infers is healthy or not depending on the
+ * model serving. Prints a line per failed case and exits with 1 if there
+ * was any. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  /* What the app does with nvinfer: config-file-path starts a load, the
+   * model-updated signal reports it, the health probe judges the batches */
+  struct StandInDetector {
+    std::string serving;
+    std::set<std::string> broken;
+    std::set<std::string> unhealthy;
+
+    void
+    set_config(const std::string &config_path, ModelUpdater &updater) {
+      bool ok = !broken.count(config_path);
+      if (ok) {
+        serving = config_path;
+      }
+      updater.loaded(ok);
+    }
+
+    bool
+    infer() const {
+      return !unhealthy.count(serving);
+    }
+  };
+
+  ModelVersion
+  version(unsigned int number) {
+    ModelVersion v;
+    v.version = number;
+    v.config_path = "config_infer_primary_yolov3_v" + std::to_string(number) + ".txt";
+    return v;
+  }
+
+  /* Feeds batches until a verdict or the limit, returns the verdict */
+  ProbationVerdict
+  run_batches(ModelUpdater &updater, StandInDetector &detector, unsigned int limit,
+              unsigned int &batches) {
+    for (batches = 1; batches <= limit; batches++) {
+      ProbationVerdict verdict = updater.batch(detector.infer());
+      if (verdict != ProbationVerdict::PENDING) {
+        return verdict;
+      }
+    }
+    return ProbationVerdict::PENDING;
+  }
+
+  void
+  check_commit() {
+    ModelUpdater updater(version(0));
+    StandInDetector detector;
+    detector.serving = version(0).config_path;
+    ModelHealthPolicy policy;
+    std::string error;
+
+    expect(updater.state() == ModelUpdateState::IDLE, "starts idle");
+    expect(updater.batch(true) == ProbationVerdict::PENDING, "batches ignored while idle");
+
+    expect(updater.begin(version(1), policy, error), "trigger version 1: " + error);
+    expect(updater.state() == ModelUpdateState::LOADING, "loading after the trigger");
+    // the running model serves until the load completes
+    expect(updater.batch(true) == ProbationVerdict::PENDING && updater.active().version == 0,
+           "active model serves while loading");
+
+    detector.set_config(updater.candidate().config_path, updater);
+    expect(updater.state() == ModelUpdateState::PROBATION, "probation after the load");
+    expect(updater.active().version == 0 && updater.candidate().version == 1,
+           "previous model kept for rollback");
+
+    unsigned int batches;
+    ProbationVerdict verdict = run_batches(updater, detector, 100, batches);
+    expect(verdict == ProbationVerdict::COMMIT && batches == policy.probation_batches,
+           "commit after " + std::to_string(policy.probation_batches) + " healthy batches, got " +
+           std::to_string(batches));
+    expect(updater.state() == ModelUpdateState::IDLE && updater.active().version == 1 &&
+           updater.active().config_path == version(1).config_path, "version 1 committed");
+  }
+
+  void
+  check_versioning() {
+    ModelUpdater updater(version(3));
+    StandInDetector detector;
+    ModelHealthPolicy policy;
+    std::string error;
+
+    expect(!updater.begin(version(3), policy, error), "same version refused");
+    expect(!updater.begin(version(2), policy, error), "older version refused");
+    expect(updater.state() == ModelUpdateState::IDLE, "refusals leave the updater idle");
+
+    expect(updater.begin(version(5), policy, error), "newer version accepted: " + error);
+    expect(!updater.begin(version(6), policy, error), "refused while loading");
+    detector.set_config(updater.candidate().config_path, updater);
+    expect(!updater.begin(version(6), policy, error), "refused on probation");
+    expect(updater.candidate().version == 5, "refusals keep the candidate");
+
+    // a version may skip ahead, the next has to be newer than it
+    unsigned int batches;
+    run_batches(updater, detector, 100, batches);
+    expect(updater.active().version == 5, "version 5 committed");
+    expect(!updater.begin(version(4), policy, error), "version below the committed refused");
+
+    // a broken file never leaves the loading state for probation
+    detector.broken.insert(version(6).config_path);
+    expect(updater.begin(version(6), policy, error), "version 6 accepted: " + error);
+    detector.set_config(updater.candidate().config_path, updater);
+    expect(updater.state() == ModelUpdateState::IDLE && updater.active().version == 5 &&
+           detector.serving == version(5).config_path, "failed load keeps version 5");
+    expect(updater.rejected(6) && !updater.begin(version(6), policy, error),
+           "failed version not retried");
+    expect(updater.begin(version(7), policy, error), "later version after a failure: " + error);
+  }
+
+  void
+  check_rollback() {
+    ModelUpdater updater(version(1));
+    StandInDetector detector;
+    detector.serving = version(1).config_path;
+    detector.unhealthy.insert(version(2).config_path);
+    ModelHealthPolicy policy;
+    policy.probation_batches = 10;
+    policy.max_unhealthy = 3;
+    std::string error;
+
+    expect(updater.begin(version(2), policy, error), "trigger version 2: " + error);
+    detector.set_config(updater.candidate().config_path, updater);
+
+    unsigned int batches;
+    ProbationVerdict verdict = run_batches(updater, detector, 100, batches);
+    expect(verdict == ProbationVerdict::ROLLBACK && batches == policy.max_unhealthy,
+           "rollback after " + std::to_string(policy.max_unhealthy) + " unhealthy batches");
+    expect(updater.state() == ModelUpdateState::ROLLING_BACK && updater.rejected(2),
+           "rolling back, version 2 rejected");
+    expect(updater.batch(false) == ProbationVerdict::PENDING,
+           "batches ignored while rolling back");
+
+    // the app loads the active config back into the detector
+    detector.set_config(updater.active().config_path, updater);
+    expect(updater.state() == ModelUpdateState::IDLE && updater.active().version == 1 &&
+           detector.serving == version(1).config_path && detector.infer(),
+           "version 1 serves again");
+    expect(!updater.begin(version(2), policy, error), "rolled back version not retried");
+
+    // unhealthy batches below the limit still commit
+    expect(updater.begin(version(3), policy, error), "trigger version 3: " + error);
+    detector.set_config(updater.candidate().config_path, updater);
+    for (unsigned int i = 0; i < policy.probation_batches - 1; i++) {
+      verdict = updater.batch(i >= policy.max_unhealthy - 1);
+    }
+    verdict = updater.batch(true);
+    expect(verdict == ProbationVerdict::COMMIT && updater.active().version == 3,
+           "commit with fewer unhealthy batches than the limit");
+
+    // no limit, nothing is rolled back
+    policy.max_unhealthy = 0;
+    detector.unhealthy.insert(version(4).config_path);
+    expect(updater.begin(version(4), policy, error), "trigger version 4: " + error);
+    detector.set_config(updater.candidate().config_path, updater);
+    verdict = run_batches(updater, detector, 100, batches);
+    expect(verdict == ProbationVerdict::COMMIT, "no unhealthy limit commits");
+
+    // a rollback that fails to load leaves the updater idle, ready for the next
+    policy.max_unhealthy = 1;
+    detector.unhealthy.insert(version(5).config_path);
+    expect(updater.begin(version(5), policy, error), "trigger version 5: " + error);
+    detector.set_config(updater.candidate().config_path, updater);
+    verdict = updater.batch(detector.infer());
+    expect(verdict == ProbationVerdict::ROLLBACK, "version 5 rolled back");
+    detector.broken.insert(updater.active().config_path);
+    detector.set_config(updater.active().config_path, updater);
+    expect(updater.state() == ModelUpdateState::IDLE && detector.serving == version(5).config_path,
+           "failed rollback leaves version 5 serving");
+    expect(updater.begin(version(6), policy, error), "update after a failed rollback: " + error);
+  }
+
+  void
+  check_state_names() {
+    expect(std::string(model_update_state_name(ModelUpdateState::IDLE)) == "idle" &&
+           std::string(model_update_state_name(ModelUpdateState::LOADING)) == "loading" &&
+           std::string(model_update_state_name(ModelUpdateState::PROBATION)) == "probation" &&
+           std::string(model_update_state_name(ModelUpdateState::ROLLING_BACK)) == "rolling back",
+           "state names");
+  }
+}
+
+int
+main() {
+  check_commit();
+  check_versioning();
+  check_rollback();
+  check_state_names();
+
+  if (failures) {
+    printf("%u model update checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS model update\n");
+  return 0;
+}
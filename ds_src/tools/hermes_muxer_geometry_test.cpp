@@ -0,0 +1,222 @@
+#include <stdio.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../muxer_geometry.h"
+
+/* Checks the muxer size policies of models/config_muxer.txt on any Linux box:
+ *
+ *   hermes-muxer-geometry-test
+ *
+ * Prints a line per failed case and exits with 1 if there was any. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  void
+  expect_geometry(const std::string &what, const MuxerGeometry &geometry, unsigned int width,
+                  unsigned int height, bool padding, bool upscaled) {
+    bool ok = geometry.width == width && geometry.height == height &&
+        geometry.padding == padding && geometry.upscaled == upscaled;
+    if (!ok) {
+      printf("FAIL %s: %ux%u padding %d upscaled %d (%s), expected %ux%u padding %d "
+             "upscaled %d\n", what.c_str(), geometry.width, geometry.height, geometry.padding,
+             geometry.upscaled, geometry.reason.c_str(), width, height, padding, upscaled);
+      failures++;
+    }
+  }
+
+  bool
+  near(double a, double b) {
+    return std::fabs(a - b) < 1e-9;
+  }
+
+  MuxerPolicySettings
+  policy_settings(MuxerPolicy policy) {
+    MuxerPolicySettings settings;
+    settings.policy = policy;
+    return settings;
+  }
+
+  void
+  check_fixed() {
+    MuxerPolicySettings settings = policy_settings(MuxerPolicy::FIXED);
+    expect_geometry("fixed, no sources", choose_muxer_geometry({}, settings), 1920, 1080,
+                    false, false);
+    expect_geometry("fixed, sources ignored",
+                    choose_muxer_geometry({{3840, 2160}, {1920, 1080}}, settings), 1920, 1080,
+                    false, false);
+    expect_geometry("fixed, small source upscaled",
+                    choose_muxer_geometry({{1280, 720}}, settings), 1920, 1080, false, true);
+
+    // the fixed size is taken as it is, not aligned
+    settings.fixed_width = 1000;
+    settings.fixed_height = 750;
+    settings.padding = true;
+    MuxerGeometry geometry = choose_muxer_geometry({{1920, 1080}}, settings);
+    expect_geometry("fixed, unaligned with padding", geometry, 1000, 750, true, false);
+    expect(geometry.reason == "fixed", "fixed, reason \"" + geometry.reason + "\"");
+  }
+
+  void
+  check_native_max() {
+    MuxerPolicySettings settings = policy_settings(MuxerPolicy::NATIVE_MAX);
+    expect_geometry("native-max, one source", choose_muxer_geometry({{1280, 720}}, settings),
+                    1280, 720, false, false);
+    expect_geometry("native-max, smaller source upscaled",
+                    choose_muxer_geometry({{1280, 720}, {1920, 1080}}, settings), 1920, 1080,
+                    false, true);
+    // width and height come from different sources
+    expect_geometry("native-max, largest of each side",
+                    choose_muxer_geometry({{1920, 1080}, {1440, 1440}}, settings), 1920, 1440,
+                    false, false);
+    // aligning up scales the source by a few pixels
+    expect_geometry("native-max, aligned up",
+                    choose_muxer_geometry({{1021, 700}}, settings), 1024, 704, false, true);
+
+    MuxerGeometry geometry = choose_muxer_geometry({{0, 0}, {0, 1080}}, settings);
+    expect_geometry("native-max, no size known", geometry, 1920, 1080, false, false);
+    expect(geometry.reason == "no source size known",
+           "native-max, no size known, reason \"" + geometry.reason + "\"");
+    expect_geometry("native-max, unknown sources left out",
+                    choose_muxer_geometry({{0, 0}, {640, 480}}, settings), 640, 480, false,
+                    false);
+
+    // 4096x2160 scaled into 3840x2160 is 3840x2025, aligned down
+    geometry = choose_muxer_geometry({{4096, 2160}}, settings);
+    expect_geometry("native-max, limited to the maximum", geometry, 3840, 2024, false, false);
+    expect(geometry.reason.find("limited to the maximum") != std::string::npos,
+           "native-max, limited, reason \"" + geometry.reason + "\"");
+
+    settings.padding = true;
+    expect_geometry("native-max, padding",
+                    choose_muxer_geometry({{1920, 1080}, {640, 480}}, settings), 1920, 1080,
+                    true, true);
+  }
+
+  void
+  check_network_aligned() {
+    MuxerPolicySettings settings = policy_settings(MuxerPolicy::NETWORK_ALIGNED);
+
+    // 416 high at 16:9 is 739.6 wide, aligned up to 744
+    MuxerGeometry geometry = choose_muxer_geometry({{1920, 1080}}, settings);
+    expect_geometry("network-aligned, full HD", geometry, 744, 416, false, false);
+    expect(geometry.reason == "network input",
+           "network-aligned, reason \"" + geometry.reason + "\"");
+
+    settings.alignment = 32;
+    expect_geometry("network-aligned, alignment 32",
+                    choose_muxer_geometry({{1920, 1080}}, settings), 768, 416, false, false);
+    settings.alignment = 0;
+    expect_geometry("network-aligned, alignment 0 taken as 1",
+                    choose_muxer_geometry({{1920, 1080}}, settings), 740, 416, false, false);
+    settings.alignment = 8;
+
+    // a 2x1 slice grid is wider than 16:9, the width decides: 832 x 468 -> 472
+    settings.network_width = 832;
+    expect_geometry("network-aligned, wide slice grid",
+                    choose_muxer_geometry({{1920, 1080}}, settings), 832, 472, false, false);
+    settings.network_width = 416;
+
+    // portrait sources cover the network with their width
+    expect_geometry("network-aligned, portrait",
+                    choose_muxer_geometry({{1080, 1920}}, settings), 416, 744, false, false);
+
+    // never upscaled in the muxer, the largest source is used as it is
+    geometry = choose_muxer_geometry({{640, 360}}, settings);
+    expect_geometry("network-aligned, source below the network", geometry, 640, 360, false,
+                    false);
+    expect(geometry.reason == "largest source, smaller than the network input",
+           "network-aligned, small source, reason \"" + geometry.reason + "\"");
+
+    // the largest source sets the aspect; the others are only upscaled when
+    // smaller on both sides
+    expect_geometry("network-aligned, mixed sources",
+                    choose_muxer_geometry({{640, 480}, {1920, 1080}}, settings), 744, 416,
+                    false, false);
+    expect_geometry("network-aligned, small source upscaled",
+                    choose_muxer_geometry({{320, 240}, {1920, 1080}}, settings), 744, 416,
+                    false, true);
+
+    settings.max_width = 640;
+    settings.max_height = 640;
+    settings.network_width = 1248;
+    settings.network_height = 1248;
+    geometry = choose_muxer_geometry({{3840, 2160}}, settings);
+    expect_geometry("network-aligned, limited to the maximum", geometry, 640, 360, false, false);
+    expect(geometry.reason == "network input, limited to the maximum",
+           "network-aligned, limited, reason \"" + geometry.reason + "\"");
+  }
+
+  void
+  check_padding() {
+    MuxerPolicySettings settings = policy_settings(MuxerPolicy::NETWORK_ALIGNED);
+    settings.padding = true;
+    MuxerGeometry padded = choose_muxer_geometry({{1920, 1080}, {640, 480}}, settings);
+    expect_geometry("padding, network-aligned", padded, 744, 416, true, false);
+
+    // a 4:3 source letterboxed into 744x416 keeps its aspect: one factor
+    double scale_x, scale_y;
+    muxer_to_source_scale(padded, 640, 480, scale_x, scale_y);
+    expect(near(scale_x, 480.0 / 416) && near(scale_y, 480.0 / 416),
+           "padding, 4:3 source scale");
+    muxer_to_source_scale(padded, 1920, 1080, scale_x, scale_y);
+    expect(near(scale_x, 1080.0 / 416) && near(scale_y, 1080.0 / 416),
+           "padding, 16:9 source scale");
+
+    // stretched, each side has its own factor
+    settings.padding = false;
+    MuxerGeometry stretched = choose_muxer_geometry({{1920, 1080}, {640, 480}}, settings);
+    muxer_to_source_scale(stretched, 640, 480, scale_x, scale_y);
+    expect(near(scale_x, 640.0 / 744) && near(scale_y, 480.0 / 416),
+           "no padding, 4:3 source scale");
+
+    expect(muxer_geometry_differs(padded, stretched), "padding alone changes the muxer");
+    MuxerGeometry renamed = stretched;
+    renamed.reason = "other";
+    renamed.upscaled = true;
+    expect(!muxer_geometry_differs(stretched, renamed),
+           "reason and upscaled leave the muxer as it is");
+  }
+
+  void
+  check_policy_names() {
+    for (MuxerPolicy policy : {MuxerPolicy::FIXED, MuxerPolicy::NATIVE_MAX,
+                               MuxerPolicy::NETWORK_ALIGNED}) {
+      MuxerPolicy parsed = MuxerPolicy::FIXED;
+      expect(parse_muxer_policy(muxer_policy_name(policy), parsed) && parsed == policy,
+             std::string("policy name ") + muxer_policy_name(policy));
+    }
+    MuxerPolicy parsed = MuxerPolicy::NATIVE_MAX;
+    expect(!parse_muxer_policy("native_max", parsed) && parsed == MuxerPolicy::NATIVE_MAX,
+           "unknown policy name");
+  }
+}
+
+int
+main() {
+  check_fixed();
+  check_native_max();
+  check_network_aligned();
+  check_padding();
+  check_policy_names();
+
+  if (failures) {
+    printf("%u muxer geometry checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS muxer geometry\n");
+  return 0;
+}
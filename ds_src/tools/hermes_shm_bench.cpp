@@ -0,0 +1,132 @@
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../shm_ring.h"
+
+/* Benchmarks the shm:// frame ring on any Linux box, or feeds a running
+ * hermes-app with synthetic frames:
+ *
+ *   hermes-shm-bench [--size WxH] [--fps N] [--slots N] [--duration S] [--work-us N]
+ *   hermes-shm-bench --produce NAME [--size WxH] [--fps N] [--duration S]
+ *
+ * The first writes and reads the ring in one process and prints what got
+ * through. The second only writes, shm://NAME in inputsources.txt reads it. */
+
+using namespace WildFireDetection;
+
+static int
+produce(const std::string &name, const ShmBenchmarkSettings &settings) {
+  hermes_shm_writer *writer = hermes_shm_writer_open(name.c_str(), settings.width,
+      settings.height, HERMES_SHM_BGR, settings.fps, settings.slots);
+  if (!writer) {
+    fprintf(stderr, "Could not create shm://%s: %s\n", name.c_str(), strerror(errno));
+    return 1;
+  }
+  printf("Writing %ux%u BGR at %u fps to shm://%s\n", settings.width, settings.height,
+         settings.fps, name.c_str());
+
+  // A bar sweeping across a grey frame
+  std::vector<uint8_t> frame(shm_frame_size(settings.width, settings.height, HERMES_SHM_BGR), 96);
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t number = 1;; number++) {
+    uint32_t bar = (number * 8) % settings.width;
+    uint32_t previous = ((number - 1) * 8) % settings.width;
+    for (uint32_t y = 0; y < settings.height; y++) {
+      uint8_t *row = frame.data() + (size_t)y * settings.width * 3;
+      for (uint32_t x = 0; x < 8; x++) {
+        memset(row + (previous + x) % settings.width * 3, 96, 3);
+        memset(row + (bar + x) % settings.width * 3, 255, 3);
+      }
+    }
+    hermes_shm_writer_write(writer, frame.data(), 0, shm_now_ns());
+
+    auto next = start + std::chrono::duration<double>(number / (double)settings.fps);
+    if (settings.duration_s > 0 &&
+        next - start > std::chrono::duration<double>(settings.duration_s)) {
+      break;
+    }
+    std::this_thread::sleep_until(next);
+  }
+  hermes_shm_writer_close(writer);
+  return 0;
+}
+
+int
+main(int argc, char *argv[]) {
+  ShmBenchmarkSettings settings;
+  std::string producer;
+  const struct option options[] = {
+    {"produce", required_argument, NULL, 'p'},
+    {"size", required_argument, NULL, 's'},
+    {"fps", required_argument, NULL, 'f'},
+    {"slots", required_argument, NULL, 'n'},
+    {"duration", required_argument, NULL, 'd'},
+    {"work-us", required_argument, NULL, 'w'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch (option) {
+      case 'p':
+        producer = optarg;
+        // runs until stopped unless told otherwise
+        settings.duration_s = 0;
+        break;
+      case 's':
+        if (sscanf(optarg, "%ux%u", &settings.width, &settings.height) != 2) {
+          fprintf(stderr, "--size takes WIDTHxHEIGHT\n");
+          return 1;
+        }
+        break;
+      case 'f':
+        settings.fps = atoi(optarg);
+        break;
+      case 'n':
+        settings.slots = atoi(optarg);
+        break;
+      case 'd':
+        settings.duration_s = atof(optarg);
+        break;
+      case 'w':
+        settings.reader_work_us = atoi(optarg);
+        break;
+      default:
+        return 1;
+    }
+  }
+  if (settings.width < 8 || settings.height < 1 || settings.slots < 1 ||
+      (!producer.empty() && !settings.fps)) {
+    fprintf(stderr, "Invalid settings\n");
+    return 1;
+  }
+
+  if (!producer.empty()) {
+    return produce(producer, settings);
+  }
+
+  printf("%ux%u BGR, %u fps%s, %u slots, %.0f s, reader busy %u us per frame\n",
+         settings.width, settings.height, settings.fps, settings.fps ? "" : " (unpaced)",
+         settings.slots, settings.duration_s, settings.reader_work_us);
+  ShmBenchmarkResult result = run_shm_benchmark("bench-" + std::to_string(getpid()), settings);
+  if (!result.frames_written) {
+    fprintf(stderr, "Could not create the ring: %s\n", strerror(errno));
+    return 1;
+  }
+  printf("Written: %lu | read: %lu | skipped: %lu | torn copies: %lu | corrupt: %lu\n",
+         (unsigned long)result.frames_written, (unsigned long)result.frames_read,
+         (unsigned long)result.frames_skipped, (unsigned long)result.torn_reads,
+         (unsigned long)result.corrupt_frames);
+  printf("Latency p50: %.1f us | p99: %.1f us | write: %.0f MB/s\n", result.latency_p50_us,
+         result.latency_p99_us, result.write_mb_per_s);
+  return result.corrupt_frames ? 1 : 0;
+}
@@ -0,0 +1,391 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../slicing.h"
+
+/* Checks and times the tiled inference geometry and merge on any Linux box:
+ *
+ *   hermes-slicing-bench [--size WxH] [--rows N] [--columns N] [--overlap F]
+ *                        [--full-frame 0|1] [--fires N] [--frames N] [--check]
+ *
+ * The checks run first; any failure is printed and the exit code is 1.
+ * Then every frame scatters fires over the frame and each slice reports the
+ * part of every fire it sees; the slices and the merge of their detections
+ * are timed, as the slicing probes run them. --check skips the timing.
+ * The grid options are the keys of models/YOLOv3WildFires/config_slicing.txt. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  bool
+  near(float a, float b) {
+    return std::fabs(a - b) < 1e-3f;
+  }
+
+  bool
+  same_rect(const SliceRect &a, const SliceRect &b) {
+    return near(a.left, b.left) && near(a.top, b.top) && near(a.width, b.width) &&
+        near(a.height, b.height);
+  }
+
+  bool
+  contains(const SliceRect &outer, const SliceRect &inner) {
+    return inner.left >= outer.left && inner.top >= outer.top &&
+        inner.left + inner.width <= outer.left + outer.width &&
+        inner.top + inner.height <= outer.top + outer.height;
+  }
+
+  SliceRect
+  intersect(const SliceRect &a, const SliceRect &b) {
+    float left = std::max(a.left, b.left);
+    float top = std::max(a.top, b.top);
+    float right = std::min(a.left + a.width, b.left + b.width);
+    float bottom = std::min(a.top + a.height, b.top + b.height);
+    return {left, top, std::max(0.0f, right - left), std::max(0.0f, bottom - top)};
+  }
+
+  /* What the detector reports for fires on every slice: the part of the fire
+   * the slice sees, mapped back to the frame, weaker when the fire is cut */
+  void
+  detect_fires(const std::vector<SliceRect> &slices, const std::vector<SliceRect> &fires,
+               std::mt19937 &random, std::vector<SliceDetection> &detections) {
+    std::uniform_real_distribution<float> score(0.0f, 0.1f);
+    detections.clear();
+    for (size_t s = 0; s < slices.size(); s++) {
+      for (const SliceRect &fire : fires) {
+        SliceRect seen = intersect(slices[s], fire);
+        if (seen.width <= 0 || seen.height <= 0) {
+          continue;
+        }
+        SliceRect relative = {seen.left - slices[s].left, seen.top - slices[s].top, seen.width,
+                              seen.height};
+        SliceDetection detection;
+        detection.box = slice_to_frame(slices[s], relative);
+        detection.confidence = (contains(slices[s], fire) ? 0.8f : 0.4f) + score(random);
+        detection.slice_index = s;
+        detections.push_back(detection);
+      }
+    }
+  }
+
+  /* Fires on a jittered lattice, far enough apart that no two are merged */
+  std::vector<SliceRect>
+  scatter_fires(unsigned int width, unsigned int height, unsigned int count, float size,
+                std::mt19937 &random) {
+    std::vector<SliceRect> fires;
+    unsigned int per_row = std::max(1u, (unsigned int)std::ceil(std::sqrt((double)count)));
+    float cell_width = (float)width / per_row;
+    float cell_height = (float)height / per_row;
+    float fire_width = std::min(size, cell_width / 2);
+    float fire_height = std::min(size, cell_height / 2);
+    std::uniform_real_distribution<float> jitter(0.0f, 1.0f);
+    for (unsigned int i = 0; i < count; i++) {
+      float left = (i % per_row) * cell_width + jitter(random) * (cell_width - fire_width);
+      float top = (i / per_row) * cell_height + jitter(random) * (cell_height - fire_height);
+      fires.push_back({left, top, fire_width, fire_height});
+    }
+    return fires;
+  }
+
+  void
+  check_slices(unsigned int width, unsigned int height, const SliceGrid &grid) {
+    char what[128];
+    snprintf(what, sizeof(what), "slices of %ux%u, %ux%u grid, %.2f overlap%s", width, height,
+             grid.rows, grid.columns, grid.overlap, grid.full_frame ? ", full frame" : "");
+    std::vector<SliceRect> slices = compute_slices(width, height, grid);
+    unsigned int tiles = grid.rows * grid.columns;
+    size_t expected = tiles > 1 ? tiles + grid.full_frame : 1;
+    if (slices.size() != expected) {
+      expect(false, std::string(what) + ": " + std::to_string(slices.size()) + " slices");
+      return;
+    }
+    SliceRect frame = {0.0f, 0.0f, (float)width, (float)height};
+    if (grid.full_frame || tiles == 1) {
+      expect(same_rect(slices.back(), frame), std::string(what) + ": last slice is not the frame");
+    }
+    if (tiles == 1) {
+      return;
+    }
+
+    for (unsigned int i = 0; i < tiles; i++) {
+      expect(contains(frame, slices[i]), std::string(what) + ": slice outside the frame");
+    }
+    // the last column and row are flush with the far edges
+    const SliceRect &last = slices[tiles - 1];
+    expect(near(last.left + last.width, width) && near(last.top + last.height, height),
+           std::string(what) + ": last slice not flush with the frame");
+    // neighbours share at least the overlap, so their union covers the frame
+    float overlap = std::min(std::max(grid.overlap, 0.0f), 0.9f);
+    for (unsigned int row = 0; row < grid.rows; row++) {
+      for (unsigned int column = 0; column < grid.columns; column++) {
+        const SliceRect &slice = slices[row * grid.columns + column];
+        if (column + 1 < grid.columns) {
+          const SliceRect &right = slices[row * grid.columns + column + 1];
+          expect(slice.left + slice.width - right.left >= std::floor(overlap * slice.width) - 1,
+                 std::string(what) + ": columns overlap too little");
+        }
+        if (row + 1 < grid.rows) {
+          const SliceRect &below = slices[(row + 1) * grid.columns + column];
+          expect(slice.top + slice.height - below.top >= std::floor(overlap * slice.height) - 1,
+                 std::string(what) + ": rows overlap too little");
+        }
+      }
+    }
+  }
+
+  void
+  check_geometry() {
+    for (unsigned int rows : {1u, 2u, 3u}) {
+      for (unsigned int columns : {1u, 2u, 4u}) {
+        for (float overlap : {0.0f, 0.2f, 0.5f, 1.5f}) {
+          for (bool full_frame : {false, true}) {
+            SliceGrid grid;
+            grid.rows = rows;
+            grid.columns = columns;
+            grid.overlap = overlap;
+            grid.full_frame = full_frame;
+            check_slices(1920, 1080, grid);
+            check_slices(1021, 767, grid);
+          }
+        }
+      }
+    }
+
+    // 1920 / (2 - 0.2) = 1066.7, rounded up; the second column starts at 1920 - 1067
+    SliceGrid grid;
+    grid.rows = 2;
+    grid.columns = 2;
+    std::vector<SliceRect> slices = compute_slices(1920, 1080, grid);
+    expect(slices.size() == 4 && same_rect(slices[0], {0, 0, 1067, 600}) &&
+           same_rect(slices[1], {853, 0, 1067, 600}) && same_rect(slices[2], {0, 480, 1067, 600}) &&
+           same_rect(slices[3], {853, 480, 1067, 600}), "2x2 slices of full HD");
+
+    // boxes relative to the slice, clipped to it
+    SliceRect slice = {853, 480, 1067, 600};
+    expect(same_rect(slice_to_frame(slice, {10, 20, 30, 40}), {863, 500, 30, 40}),
+           "slice box to frame");
+    expect(same_rect(slice_to_frame(slice, {-10, 580, 30, 40}), {853, 1060, 20, 20}),
+           "slice box clipped to the slice");
+
+    SliceRect a = {0, 0, 10, 10}, b = {5, 0, 10, 10}, inner = {2, 2, 4, 4};
+    expect(near(slice_iou(a, b), 50.0f / 150) && near(slice_iou(a, a), 1) &&
+           near(slice_iou(a, {20, 20, 5, 5}), 0), "iou");
+    expect(near(slice_ios(a, inner), 1) && near(slice_ios(a, b), 0.5f) &&
+           near(slice_ios(a, {0, 0, 0, 0}), 0), "ios");
+  }
+
+  SliceDetection
+  detection(SliceRect box, float confidence, int slice_index, int class_id = 0) {
+    SliceDetection d;
+    d.box = box;
+    d.confidence = confidence;
+    d.slice_index = slice_index;
+    d.class_id = class_id;
+    return d;
+  }
+
+  void
+  check_merge() {
+    SliceMergeParams params;
+
+    // the same fire seen by two slices is kept once, grown over both boxes
+    std::vector<MergedDetection> merged = merge_slice_detections(
+        {detection({100, 100, 50, 50}, 0.6f, 0), detection({102, 100, 50, 50}, 0.9f, 1)}, params);
+    expect(merged.size() == 1 && merged[0].leader == 1 &&
+           same_rect(merged[0].detection.box, {100, 100, 52, 50}) &&
+           near(merged[0].detection.confidence, 0.9f), "duplicate across slices");
+
+    // duplicates within a slice are suppressed, not grown
+    merged = merge_slice_detections(
+        {detection({100, 100, 50, 50}, 0.9f, 0), detection({102, 100, 50, 50}, 0.6f, 0)}, params);
+    expect(merged.size() == 1 && same_rect(merged[0].detection.box, {100, 100, 50, 50}),
+           "duplicate within a slice");
+
+    // a fire cut by a seam: the fragment is joined to the whole
+    merged = merge_slice_detections(
+        {detection({100, 100, 80, 40}, 0.9f, 0), detection({150, 100, 30, 40}, 0.5f, 1)}, params);
+    expect(merged.size() == 1 && same_rect(merged[0].detection.box, {100, 100, 80, 40}),
+           "fragment on a seam");
+    // the same fragment from the same slice is another object
+    merged = merge_slice_detections(
+        {detection({100, 100, 80, 40}, 0.9f, 0), detection({150, 100, 30, 40}, 0.5f, 0)}, params);
+    expect(merged.size() == 2, "fragment within a slice");
+    // unknown slices are never the same slice
+    merged = merge_slice_detections(
+        {detection({100, 100, 80, 40}, 0.9f, -1), detection({150, 100, 30, 40}, 0.5f, -1)}, params);
+    expect(merged.size() == 1, "fragment of unknown slices");
+
+    // classes are merged separately
+    merged = merge_slice_detections(
+        {detection({100, 100, 50, 50}, 0.9f, 0, 0), detection({100, 100, 50, 50}, 0.8f, 1, 1)},
+        params);
+    expect(merged.size() == 2, "different classes");
+
+    // below both thresholds the boxes stay apart
+    merged = merge_slice_detections(
+        {detection({100, 100, 50, 50}, 0.9f, 0), detection({140, 100, 50, 50}, 0.8f, 1)}, params);
+    expect(merged.size() == 2, "neighbouring fires");
+
+    // equal confidence keeps the input order, results come strongest first
+    merged = merge_slice_detections(
+        {detection({0, 0, 10, 10}, 0.5f, 0), detection({100, 0, 10, 10}, 0.7f, 0),
+         detection({200, 0, 10, 10}, 0.5f, 0)}, params);
+    expect(merged.size() == 3 && merged[0].leader == 1 && merged[1].leader == 0 &&
+           merged[2].leader == 2, "merge order");
+    expect(merge_slice_detections({}, params).empty(), "no detections");
+
+    // fires scattered over a tiled frame come back whole, once each
+    std::mt19937 random(7);
+    for (unsigned int rows : {2u, 3u}) {
+      SliceGrid grid;
+      grid.rows = rows;
+      grid.columns = rows + 1;
+      grid.full_frame = true;
+      std::vector<SliceRect> slices = compute_slices(1920, 1080, grid);
+      for (unsigned int round = 0; round < 50; round++) {
+        // smaller than the overlap, so some slice sees each fire whole
+        std::vector<SliceRect> fires = scatter_fires(1920, 1080, 30, 60, random);
+        std::vector<SliceDetection> detections;
+        detect_fires(slices, fires, random, detections);
+        merged = merge_slice_detections(detections, params);
+
+        bool ok = merged.size() == fires.size();
+        for (const SliceRect &fire : fires) {
+          unsigned int found = 0;
+          for (const MergedDetection &m : merged) {
+            found += same_rect(m.detection.box, fire);
+          }
+          ok = ok && found == 1;
+        }
+        if (!ok) {
+          expect(false, "scattered fires on a " + std::to_string(grid.rows) + "x" +
+                 std::to_string(grid.columns) + " grid: " + std::to_string(merged.size()) +
+                 " merged boxes for " + std::to_string(fires.size()) + " fires");
+          break;
+        }
+      }
+    }
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  unsigned int width = 1920, height = 1080;
+  unsigned int fires = 20, frames = 20000;
+  bool check_only = false;
+  SliceGrid grid;
+  grid.rows = 2;
+  grid.columns = 2;
+  grid.full_frame = true;
+  const struct option options[] = {
+    {"size", required_argument, NULL, 's'},
+    {"rows", required_argument, NULL, 'r'},
+    {"columns", required_argument, NULL, 'c'},
+    {"overlap", required_argument, NULL, 'o'},
+    {"full-frame", required_argument, NULL, 'f'},
+    {"fires", required_argument, NULL, 'n'},
+    {"frames", required_argument, NULL, 'i'},
+    {"check", no_argument, NULL, 'k'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch (option) {
+      case 's':
+        if (sscanf(optarg, "%ux%u", &width, &height) != 2) {
+          fprintf(stderr, "--size takes WIDTHxHEIGHT\n");
+          return 1;
+        }
+        break;
+      case 'r':
+        grid.rows = atoi(optarg);
+        break;
+      case 'c':
+        grid.columns = atoi(optarg);
+        break;
+      case 'o':
+        grid.overlap = atof(optarg);
+        break;
+      case 'f':
+        grid.full_frame = atoi(optarg);
+        break;
+      case 'n':
+        fires = atoi(optarg);
+        break;
+      case 'i':
+        frames = atoi(optarg);
+        break;
+      case 'k':
+        check_only = true;
+        break;
+      default:
+        return 1;
+    }
+  }
+  if (!width || !height || !grid.rows || !grid.columns || !frames) {
+    fprintf(stderr, "Invalid settings\n");
+    return 1;
+  }
+
+  check_geometry();
+  check_merge();
+  if (failures) {
+    printf("%u slicing checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS slicing\n");
+  if (check_only) {
+    return 0;
+  }
+
+  std::mt19937 random(42);
+  std::vector<int64_t> frame_ns;
+  std::vector<SliceDetection> detections;
+  uint64_t total_detections = 0, total_merged = 0;
+  double total_s = 0;
+  frame_ns.reserve(frames);
+  printf("%ux%u frames, %ux%u slices, %.0f%% overlap%s, %u fires\n", width, height, grid.rows,
+         grid.columns, grid.overlap * 100, grid.full_frame ? " plus full frame" : "", fires);
+
+  for (unsigned int frame = 0; frame < frames; frame++) {
+    // the detector is not timed, only what the probes do around it
+    std::vector<SliceRect> scattered = scatter_fires(width, height, fires, 40, random);
+    detect_fires(compute_slices(width, height, grid), scattered, random, detections);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SliceRect> slices = compute_slices(width, height, grid);
+    std::vector<MergedDetection> merged = merge_slice_detections(detections, SliceMergeParams());
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    frame_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    total_s += std::chrono::duration<double>(elapsed).count();
+    total_detections += detections.size();
+    total_merged += merged.size();
+  }
+
+  // nanosecond samples come back as microseconds
+  LatencyPercentiles percentiles = latency_percentiles(frame_ns);
+  printf("Frames: %.0f per second | p50: %.2f us | p99: %.2f us\n", frames / total_s,
+         percentiles.p50_ms, percentiles.p99_ms);
+  printf("Slice detections: %.1f per frame | merged: %.1f per frame\n",
+         (double)total_detections / frames, (double)total_merged / frames);
+  return 0;
+}
@@ -0,0 +1,429 @@
+#include <getopt.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "../stage_threads.h"
+
+/* Checks the stage threads of models/config_threading.txt on GStreamer
+ * stand-ins, no DeepStream needed:
+ *
+ *   hermes-threading-check [--config FILE] [--stage-us N] [--frames N] [--pin]
+ *
+ * A videotestsrc named stream-muxer feeds identity elements named after the
+ * trunk stages, each sleeping --stage-us per buffer in place of its work.
+ * The pipeline runs once with every stage on the source thread, then with a
+ * queue in front of every stage that has a [thread-<name>] group, as the app
+ * puts them. The enable key is not read, the groups are what is checked:
+ * the stages after a boundary run on the thread of its queue, each thread
+ * runs on the cores of its group, and the threaded run gets at least 80% of
+ * the speedup its mapping allows. --pin gives threads without cpu-cores a
+ * core each, in turn. Prints a line per failed check and exits with 1 if
+ * there was any. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  // Names of the app, see wildfiredetection.h
+  const char *SOURCE_NAME = "stream-muxer";
+  const char *STAGE_NAMES[] = {"primary-yolo-nvinference-engine", "tracker",
+                               "secondary-fire-classifier"};
+  const char *THREAD_GROUP_PREFIX = "thread-";
+  // the queue of the display branch, the only one allowed to drop
+  const char *DISPLAY_THREAD_GROUP = "thread-nvtiler";
+
+  /* A streaming thread of a run: the element owning its task and the stages
+   * it carries */
+  struct StandInThread {
+    std::string owner;
+    ThreadSpec spec;
+    bool configured = false;
+    std::vector<std::string> stages;
+  };
+
+  struct Run {
+    std::vector<StandInThread> threads;
+    std::mutex lock;
+    // seen on the first buffer of every stage
+    std::map<std::string, long> stage_tids;
+    std::map<std::string, std::vector<unsigned int>> stage_cores;
+    // threads whose spec could not be applied on this host
+    std::map<std::string, std::string> not_applied;
+  };
+
+  bool
+  read_thread_spec(GKeyFile *key_file, const gchar *group, ThreadSpec &spec) {
+    GError *error = NULL;
+    if (g_key_file_has_key(key_file, group, "queue-depth", NULL)) {
+      spec.queue_depth = g_key_file_get_integer(key_file, group, "queue-depth", &error);
+    }
+    if (!error && g_key_file_has_key(key_file, group, "leaky", NULL)) {
+      spec.leaky = g_key_file_get_integer(key_file, group, "leaky", &error);
+    }
+    if (!error && g_key_file_has_key(key_file, group, "priority", NULL)) {
+      spec.priority = g_key_file_get_integer(key_file, group, "priority", &error);
+      spec.set_priority = true;
+    }
+    if (!error && g_key_file_has_key(key_file, group, "cpu-cores", NULL)) {
+      gchar *cores = g_key_file_get_string(key_file, group, "cpu-cores", &error);
+      if (cores && !parse_cpu_list(cores, spec.cpu_cores)) {
+        fprintf(stderr, "Invalid cpu-cores in [%s]\n", group);
+        g_free(cores);
+        return false;
+      }
+      g_free(cores);
+    }
+    if (error) {
+      fprintf(stderr, "[%s]: %s\n", group, error->message);
+      g_error_free(error);
+      return false;
+    }
+    if (spec.leaky && strcmp(group, DISPLAY_THREAD_GROUP) != 0) {
+      fprintf(stderr, "leaky is only allowed in [%s], not in [%s]\n", DISPLAY_THREAD_GROUP,
+              group);
+      return false;
+    }
+    return true;
+  }
+
+  /* The [thread-<name>] groups of the config by name, with the [threading]
+   * defaults applied as the app does */
+  bool
+  load_boundaries(const std::string &path, std::map<std::string, ThreadSpec> &boundaries) {
+    GError *error = NULL;
+    GKeyFile *key_file = g_key_file_new();
+    if (!g_key_file_load_from_file(key_file, path.c_str(), G_KEY_FILE_NONE, &error)) {
+      fprintf(stderr, "%s: %s\n", path.c_str(), error->message);
+      g_error_free(error);
+      g_key_file_free(key_file);
+      return false;
+    }
+
+    bool ok = true;
+    ThreadSpec defaults;
+    if (g_key_file_has_group(key_file, "threading")) {
+      ok = read_thread_spec(key_file, "threading", defaults);
+    }
+    gchar **groups = g_key_file_get_groups(key_file, NULL);
+    for (gchar **group = groups; ok && *group; group++) {
+      if (g_str_has_prefix(*group, THREAD_GROUP_PREFIX)) {
+        ThreadSpec spec = defaults;
+        ok = read_thread_spec(key_file, *group, spec);
+        boundaries[*group + strlen(THREAD_GROUP_PREFIX)] = spec;
+      }
+    }
+    g_strfreev(groups);
+    g_key_file_free(key_file);
+    return ok;
+  }
+
+  /* Stages on their threads, as build_topology maps the trunk */
+  std::vector<StandInThread>
+  map_threads(const std::map<std::string, ThreadSpec> &boundaries, bool pin) {
+    std::vector<StandInThread> threads;
+    auto start_thread = [&](const std::string &owner, const std::string &boundary) {
+      StandInThread thread;
+      thread.owner = owner;
+      auto it = boundaries.find(boundary);
+      if (it != boundaries.end()) {
+        thread.spec = it->second;
+        thread.configured = true;
+      }
+      // the trunk never drops a batch
+      thread.spec.leaky = 0;
+      threads.push_back(thread);
+    };
+
+    start_thread(SOURCE_NAME, SOURCE_NAME);
+    for (const char *stage : STAGE_NAMES) {
+      if (boundaries.count(stage)) {
+        start_thread(std::string(stage) + "-queue", stage);
+      }
+      threads.back().stages.push_back(stage);
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    for (unsigned int i = 0; pin && cores > 1 && i < threads.size(); i++) {
+      if (threads[i].spec.cpu_cores.empty()) {
+        threads[i].spec.cpu_cores.push_back(i % cores);
+        threads[i].configured = true;
+      }
+    }
+    return threads;
+  }
+
+  std::vector<unsigned int>
+  current_cores() {
+    std::vector<unsigned int> cores;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+      for (unsigned int core = 0; core < CPU_SETSIZE; core++) {
+        if (CPU_ISSET(core, &set)) {
+          cores.push_back(core);
+        }
+      }
+    }
+    return cores;
+  }
+
+  void
+  stage_handoff(GstElement *identity, GstBuffer *buffer, gpointer data) {
+    Run *run = (Run *)data;
+    std::lock_guard<std::mutex> guard(run->lock);
+    std::string stage = GST_ELEMENT_NAME(identity);
+    if (!run->stage_tids.count(stage)) {
+      run->stage_tids[stage] = current_thread_id();
+      run->stage_cores[stage] = current_cores();
+    }
+  }
+
+  /* As Hermes::stream_status_handler: schedules each thread from within */
+  GstBusSyncReply
+  stream_status(GstBus *bus, GstMessage *msg, gpointer data) {
+    Run *run = (Run *)data;
+    GstStreamStatusType type;
+    GstElement *owner = NULL;
+
+    if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_STREAM_STATUS) {
+      return GST_BUS_PASS;
+    }
+    gst_message_parse_stream_status(msg, &type, &owner);
+    if (type != GST_STREAM_STATUS_TYPE_ENTER || !owner) {
+      return GST_BUS_PASS;
+    }
+    for (const StandInThread &thread : run->threads) {
+      std::string error;
+      if (thread.owner == GST_ELEMENT_NAME(owner) && thread.configured &&
+          !apply_thread_spec(thread.spec, error)) {
+        std::lock_guard<std::mutex> guard(run->lock);
+        run->not_applied[thread.owner] = error;
+      }
+    }
+    return GST_BUS_PASS;
+  }
+
+  GstElement *
+  add_element(GstElement *pipeline, GstElement *previous, const gchar *factory,
+              const std::string &name) {
+    GstElement *element = gst_element_factory_make(factory, name.c_str());
+    if (!element) {
+      fprintf(stderr, "%s (%s) could not be created\n", name.c_str(), factory);
+      return NULL;
+    }
+    gst_bin_add(GST_BIN(pipeline), element);
+    if (previous && !gst_element_link(previous, element)) {
+      fprintf(stderr, "Elements could not be linked: %s -> %s\n",
+              GST_ELEMENT_NAME(previous), name.c_str());
+      return NULL;
+    }
+    return element;
+  }
+
+  /* Runs frames buffers through the stand-ins, returns the milliseconds from
+   * PLAYING to EOS or a negative value on failure */
+  double
+  run_pipeline(Run &run, unsigned int frames, unsigned int stage_us) {
+    GstElement *pipeline = gst_pipeline_new("stand-in");
+    GstElement *previous = add_element(pipeline, NULL, "videotestsrc", SOURCE_NAME);
+    if (previous) {
+      g_object_set(G_OBJECT(previous), "num-buffers", frames, NULL);
+    }
+    for (const StandInThread &thread : run.threads) {
+      if (previous && thread.owner != SOURCE_NAME) {
+        previous = add_element(pipeline, previous, "queue", thread.owner);
+        if (previous) {
+          g_object_set(G_OBJECT(previous), "max-size-buffers", thread.spec.queue_depth,
+                       "max-size-bytes", 0, "max-size-time", (guint64)0,
+                       "leaky", thread.spec.leaky, NULL);
+        }
+      }
+      for (const std::string &stage : thread.stages) {
+        previous = previous ? add_element(pipeline, previous, "identity", stage) : NULL;
+        if (previous) {
+          g_object_set(G_OBJECT(previous), "sleep-time", stage_us, NULL);
+          g_signal_connect(previous, "handoff", G_CALLBACK(stage_handoff), &run);
+        }
+      }
+    }
+    GstElement *sink = previous ? add_element(pipeline, previous, "fakesink", "sink") : NULL;
+    if (!sink) {
+      gst_object_unref(pipeline);
+      return -1;
+    }
+    g_object_set(G_OBJECT(sink), "sync", FALSE, NULL);
+
+    GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+    gst_bus_set_sync_handler(bus, stream_status, &run, NULL);
+    auto start = std::chrono::steady_clock::now();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    GstMessage *msg = gst_bus_timed_pop_filtered(
+        bus, GST_CLOCK_TIME_NONE, (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    double elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+      GError *error = NULL;
+      gst_message_parse_error(msg, &error, NULL);
+      fprintf(stderr, "%s: %s\n", GST_OBJECT_NAME(msg->src), error->message);
+      g_error_free(error);
+      elapsed = -1;
+    }
+    gst_message_unref(msg);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_bus_set_sync_handler(bus, NULL, NULL, NULL);
+    gst_object_unref(bus);
+    gst_object_unref(pipeline);
+    return elapsed;
+  }
+
+  void
+  report(const char *name, Run &run, unsigned int frames, double elapsed) {
+    printf("%s: %zu thread%s, %u frames in %.1f ms\n", name, run.threads.size(),
+           run.threads.size() > 1 ? "s" : "", frames, elapsed);
+    for (const StandInThread &thread : run.threads) {
+      std::string stages;
+      for (const std::string &stage : thread.stages) {
+        stages += (stages.empty() ? "" : ", ") + stage;
+      }
+      long tid = thread.stages.empty() ? 0 : run.stage_tids[thread.stages.front()];
+      printf("  %s [cpus %s] tid %ld: %s\n", thread.owner.c_str(),
+             format_cpu_list(thread.spec.cpu_cores).c_str(), tid, stages.c_str());
+    }
+  }
+
+  /* Every thread carries its stages and nothing else, on its cores */
+  void
+  check_mapping(const char *name, Run &run) {
+    std::map<long, std::string> owners;
+    for (const StandInThread &thread : run.threads) {
+      for (const std::string &stage : thread.stages) {
+        expect(run.stage_tids.count(stage) > 0, std::string(name) + ": no buffer reached " + stage);
+        long tid = run.stage_tids[stage];
+        auto seen = owners.find(tid);
+        expect(seen == owners.end() || seen->second == thread.owner,
+               std::string(name) + ": " + stage + " shares a thread with " +
+               (seen == owners.end() ? "" : seen->second));
+        owners[tid] = thread.owner;
+        expect(stage == thread.stages.front() || tid == run.stage_tids[thread.stages.front()],
+               std::string(name) + ": " + stage + " left the thread of " + thread.owner);
+
+        if (!thread.configured || thread.spec.cpu_cores.empty()) {
+          continue;
+        }
+        if (run.not_applied.count(thread.owner)) {
+          printf("  %s: not checked, could not set %s\n", thread.owner.c_str(),
+                 run.not_applied[thread.owner].c_str());
+          continue;
+        }
+        std::vector<unsigned int> expected = thread.spec.cpu_cores;
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        expect(run.stage_cores[stage] == expected,
+               std::string(name) + ": " + stage + " on cpus " +
+               format_cpu_list(run.stage_cores[stage]) + ", configured " +
+               format_cpu_list(expected));
+      }
+    }
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  std::string config = "models/config_threading.txt";
+  unsigned int stage_us = 2000;
+  unsigned int frames = 200;
+  bool pin = false;
+
+  const struct option options[] = {
+    {"config", required_argument, NULL, 'c'},
+    {"stage-us", required_argument, NULL, 's'},
+    {"frames", required_argument, NULL, 'f'},
+    {"pin", no_argument, NULL, 'p'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch (option) {
+      case 'c':
+        config = optarg;
+        break;
+      case 's':
+        stage_us = atoi(optarg);
+        break;
+      case 'f':
+        frames = atoi(optarg);
+        break;
+      case 'p':
+        pin = true;
+        break;
+      default:
+        return 1;
+    }
+  }
+  if (!stage_us || !frames) {
+    fprintf(stderr, "Invalid settings\n");
+    return 1;
+  }
+
+  gst_init(&argc, &argv);
+  std::map<std::string, ThreadSpec> boundaries;
+  if (!load_boundaries(config, boundaries)) {
+    return 1;
+  }
+
+  Run serial;
+  serial.threads = map_threads({}, false);
+  double serial_ms = run_pipeline(serial, frames, stage_us);
+  expect(serial_ms > 0, "serial run");
+  report("serial", serial, frames, serial_ms);
+  check_mapping("serial", serial);
+
+  Run threaded;
+  threaded.threads = map_threads(boundaries, pin);
+  double threaded_ms = run_pipeline(threaded, frames, stage_us);
+  expect(threaded_ms > 0, "threaded run");
+  report("threaded", threaded, frames, threaded_ms);
+  check_mapping("threaded", threaded);
+
+  // The busiest thread sets the pace
+  size_t busiest = 0;
+  for (const StandInThread &thread : threaded.threads) {
+    busiest = std::max(busiest, thread.stages.size());
+  }
+  double allowed = (double)(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0])) / busiest;
+  if (serial_ms > 0 && threaded_ms > 0) {
+    double speedup = serial_ms / threaded_ms;
+    printf("speedup %.2fx, the mapping allows %.2fx\n", speedup, allowed);
+    expect(speedup >= 0.8 * allowed, "threaded run too slow for its mapping");
+  }
+
+  if (failures) {
+    printf("%u threading checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS threading\n");
+  return 0;
+}
@@ -0,0 +1,378 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../track_gate.h"
+
+/* Checks the classifier gate, then replays synthetic tracks through it on
+ * any Linux box:
+ *
+ *   hermes-track-gate-replay [--sources N] [--tracks N] [--frames N] [--fires F]
+ *       [--confirm-threshold S] [--max-attempts N] [--retry-interval N]
+ *       [--recheck-interval N] [--max-crops-per-batch N] [--max-age N] [--check]
+ *
+ * Every source keeps --tracks objects in view that come and go, --fires of
+ * them real fires. Each batch goes through select, a noisy stand-in
+ * classifier scores the chosen crops and record takes the scores, as the
+ * probes around the secondary classifier do. The crops classified and the
+ * verdicts reached are printed. The gate options are the keys of
+ * models/config_classifier.txt. Any failed check is printed and the exit
+ * code is 1; --check stops after the checks. */
+
+using namespace WildFireDetection;
+
+namespace {
+  unsigned int failures = 0;
+
+  void
+  expect(bool ok, const std::string &what) {
+    if (!ok) {
+      printf("FAIL %s\n", what.c_str());
+      failures++;
+    }
+  }
+
+  TrackObservation
+  observe(unsigned int source_id, uint64_t object_id, int64_t frame) {
+    TrackObservation observation;
+    observation.source_id = source_id;
+    observation.object_id = object_id;
+    observation.frame = frame;
+    return observation;
+  }
+
+  // whether the single detection of a batch is selected
+  bool
+  selected(TrackGate &gate, unsigned int source_id, uint64_t object_id, int64_t frame) {
+    return gate.select({observe(source_id, object_id, frame)})[0];
+  }
+
+  void
+  check_retry_and_confirm() {
+    TrackGateParams params;
+    params.retry_interval = 15;
+    TrackGate gate(params);
+
+    expect(selected(gate, 0, 1, 0), "new track selected");
+    expect(gate.verdict(0, 1) == TrackVerdict::UNCONFIRMED, "unconfirmed before a score");
+    expect(gate.record(0, 1, 0.2f) == TrackVerdict::UNCONFIRMED, "one low score is not a verdict");
+    expect(!selected(gate, 0, 1, 1) && !selected(gate, 0, 1, 14), "not due before the retry");
+    expect(selected(gate, 0, 1, 15), "due at the retry interval");
+
+    // a selected crop the classifier skipped comes up again after the interval
+    expect(!selected(gate, 0, 1, 16), "skipped crop waits for the retry");
+    expect(selected(gate, 0, 1, 30), "skipped crop retried");
+
+    expect(gate.record(0, 1, 0.5f) == TrackVerdict::CONFIRMED, "confirmed at the threshold");
+    expect(gate.verdict(0, 1) == TrackVerdict::CONFIRMED, "verdict kept");
+    bool any = false;
+    for (int64_t frame = 31; frame < 250; frame++) {
+      any |= selected(gate, 0, 1, frame);
+    }
+    expect(!any, "confirmed track never classified again");
+
+    const TrackGateStats &stats = gate.stats();
+    expect(stats.classified == 3 && stats.confirmed == 1 && stats.rejected == 0 &&
+           stats.cached == 3 + 219, "counters after a confirmation");
+  }
+
+  void
+  check_reject_and_recheck() {
+    TrackGateParams params;
+    params.max_attempts = 3;
+    params.retry_interval = 10;
+    params.recheck_interval = 100;
+    TrackGate gate(params);
+
+    int64_t frame = 0;
+    for (unsigned int attempt = 1; attempt <= params.max_attempts; attempt++, frame += 10) {
+      expect(selected(gate, 0, 7, frame), "attempt " + std::to_string(attempt) + " selected");
+      TrackVerdict verdict = gate.record(0, 7, 0.1f);
+      expect(verdict == (attempt < params.max_attempts ? TrackVerdict::UNCONFIRMED
+                                                       : TrackVerdict::REJECTED),
+             "verdict after attempt " + std::to_string(attempt));
+    }
+    // the last attempt was at frame 20
+    expect(!selected(gate, 0, 7, 30) && !selected(gate, 0, 7, 119), "rejected track not retried");
+    expect(selected(gate, 0, 7, 120), "rejected track rechecked");
+    expect(gate.record(0, 7, 0.1f) == TrackVerdict::REJECTED, "low recheck stays rejected");
+    expect(selected(gate, 0, 7, 220), "rejected track rechecked again");
+    expect(gate.record(0, 7, 0.9f) == TrackVerdict::CONFIRMED, "recheck turns into a fire");
+    expect(gate.stats().rejected == 1 && gate.stats().confirmed == 1, "counters after a recheck");
+
+    params.recheck_interval = 0;
+    TrackGate never(params);
+    for (frame = 0; frame < 30; frame += 10) {
+      selected(never, 0, 7, frame);
+      never.record(0, 7, 0.0f);
+    }
+    bool any = false;
+    for (; frame < 1000; frame++) {
+      any |= selected(never, 0, 7, frame);
+    }
+    expect(never.verdict(0, 7) == TrackVerdict::REJECTED && !any,
+           "recheck interval 0 never looks again");
+  }
+
+  void
+  check_untracked() {
+    TrackGate gate;
+    for (int64_t frame = 0; frame < 5; frame++) {
+      expect(selected(gate, 0, UNTRACKED_TRACK, frame), "untracked selected every time");
+    }
+    expect(gate.record(0, UNTRACKED_TRACK, 0.7f) == TrackVerdict::CONFIRMED &&
+           gate.record(0, UNTRACKED_TRACK, 0.3f) == TrackVerdict::REJECTED,
+           "untracked verdict from its score alone");
+    expect(gate.size() == 0 && gate.verdict(0, UNTRACKED_TRACK) == TrackVerdict::UNCONFIRMED,
+           "untracked not remembered");
+    expect(gate.stats().confirmed == 0 && gate.stats().rejected == 0,
+           "untracked verdicts not counted");
+  }
+
+  void
+  check_crop_limit() {
+    TrackGateParams params;
+    params.max_crops_per_batch = 2;
+    params.retry_interval = 15;
+    TrackGate gate(params);
+
+    std::vector<bool> chosen = gate.select({observe(0, 1, 0), observe(1, 2, 0)});
+    expect(chosen[0] && chosen[1], "first tracks within the limit");
+
+    // both old tracks are due again, two new ones come first
+    chosen = gate.select({observe(0, 1, 15), observe(1, 2, 15), observe(0, 3, 15),
+                          observe(1, 4, 15)});
+    expect(!chosen[0] && !chosen[1] && chosen[2] && chosen[3], "new tracks first");
+    expect(gate.stats().deferred == 2, "over the limit deferred");
+
+    // the deferred ones go with the next batch, waiting longest first
+    chosen = gate.select({observe(0, 3, 16), observe(0, 1, 16), observe(1, 4, 16),
+                          observe(1, 2, 16)});
+    expect(!chosen[0] && chosen[1] && !chosen[2] && chosen[3], "deferred tracks next");
+
+    // untracked detections count as new
+    chosen = gate.select({observe(0, 1, 31), observe(0, UNTRACKED_TRACK, 31),
+                          observe(1, 2, 31), observe(1, UNTRACKED_TRACK, 31)});
+    expect(!chosen[0] && chosen[1] && !chosen[2] && chosen[3], "untracked before retries");
+
+    params.max_crops_per_batch = 0;
+    TrackGate unlimited(params);
+    std::vector<TrackObservation> batch;
+    for (uint64_t id = 0; id < 100; id++) {
+      batch.push_back(observe(id % 4, id, 0));
+    }
+    chosen = unlimited.select(batch);
+    unsigned int count = 0;
+    for (bool c : chosen) {
+      count += c;
+    }
+    expect(count == 100 && unlimited.stats().deferred == 0, "no limit");
+  }
+
+  void
+  check_sources_and_restart() {
+    TrackGate gate;
+
+    // object ids are per source
+    selected(gate, 0, 5, 100);
+    selected(gate, 1, 5, 100);
+    gate.record(0, 5, 0.9f);
+    expect(gate.verdict(0, 5) == TrackVerdict::CONFIRMED &&
+           gate.verdict(1, 5) == TrackVerdict::UNCONFIRMED, "same id on two sources");
+    expect(gate.size() == 2, "one track per source");
+
+    // frame numbers going back: the source restarted, its tracks start over
+    expect(selected(gate, 0, 5, 3), "restarted track selected");
+    expect(gate.verdict(0, 5) == TrackVerdict::UNCONFIRMED, "restarted track unconfirmed");
+  }
+
+  void
+  check_expiry() {
+    TrackGateParams params;
+    params.max_age = 100;
+    TrackGate gate(params);
+
+    selected(gate, 0, 1, 0);
+    gate.record(0, 1, 0.9f);
+    selected(gate, 1, 1, 0);
+    // source 0 moves on without track 1; expiry runs every max_age / 4 frames
+    for (int64_t frame = 1; frame <= 125; frame++) {
+      selected(gate, 0, 2, frame);
+    }
+    expect(gate.verdict(0, 1) == TrackVerdict::UNCONFIRMED && gate.size() == 2,
+           "unseen track forgotten");
+    // source 1 has seen no frame since, its track stays
+    expect(gate.expire(1, 100) == 0 && gate.expire(1, 101) == 1, "expiry per source at max-age");
+    expect(gate.size() == 1, "tracks left after expiry");
+  }
+
+  struct ReplayTrack {
+    uint64_t object_id;
+    bool fire;
+    int64_t last_frame;
+  };
+
+  struct ReplaySettings {
+    unsigned int sources = 4;
+    unsigned int tracks = 8;
+    unsigned int frames = 9000;
+    double fires = 0.3;
+  };
+
+  void
+  replay(const ReplaySettings &settings, const TrackGateParams &params) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<int> lifetime(30, 900);
+    // fires score high, sunsets and roofs low, both noisy
+    std::normal_distribution<float> fire_score(0.75f, 0.15f), other_score(0.25f, 0.15f);
+    TrackGate gate(params);
+    std::vector<std::vector<ReplayTrack>> sources(settings.sources);
+    uint64_t next_id = 0, detections = 0, batches_over = 0;
+    uint64_t true_fires = 0, missed_fires = 0, false_fires = 0, finished = 0;
+
+    auto finish = [&](const ReplayTrack &track, unsigned int source_id) {
+      TrackVerdict verdict = gate.verdict(source_id, track.object_id);
+      finished++;
+      true_fires += track.fire && verdict == TrackVerdict::CONFIRMED;
+      missed_fires += track.fire && verdict == TrackVerdict::REJECTED;
+      false_fires += !track.fire && verdict == TrackVerdict::CONFIRMED;
+    };
+
+    for (int64_t frame = 0; frame < settings.frames; frame++) {
+      std::vector<TrackObservation> batch;
+      std::vector<const ReplayTrack *> batch_tracks;
+      for (unsigned int source_id = 0; source_id < settings.sources; source_id++) {
+        std::vector<ReplayTrack> &tracks = sources[source_id];
+        for (ReplayTrack &track : tracks) {
+          if (track.last_frame < frame) {
+            finish(track, source_id);
+            track = {next_id++, uniform(random) < settings.fires, frame + lifetime(random)};
+          }
+        }
+        while (tracks.size() < settings.tracks) {
+          tracks.push_back({next_id++, uniform(random) < settings.fires, frame + lifetime(random)});
+        }
+        for (const ReplayTrack &track : tracks) {
+          batch.push_back(observe(source_id, track.object_id, frame));
+          batch_tracks.push_back(&track);
+        }
+      }
+
+      uint64_t deferred = gate.stats().deferred;
+      std::vector<bool> chosen = gate.select(batch);
+      batches_over += gate.stats().deferred > deferred;
+      detections += batch.size();
+      for (size_t i = 0; i < batch.size(); i++) {
+        // the classifier now and then gives no fire class at all
+        if (!chosen[i] || uniform(random) < 0.02) {
+          continue;
+        }
+        float score = batch_tracks[i]->fire ? fire_score(random) : other_score(random);
+        gate.record(batch[i].source_id, batch[i].object_id, score);
+      }
+    }
+
+    const TrackGateStats &stats = gate.stats();
+    printf("Detections: %lu | crops classified: %lu (%.2f%%) | cached: %lu | deferred: %lu in "
+           "%lu batches\n", (unsigned long)detections, (unsigned long)stats.classified,
+           100.0 * stats.classified / detections, (unsigned long)stats.cached,
+           (unsigned long)stats.deferred, (unsigned long)batches_over);
+    printf("Tracks ended: %lu | fires confirmed: %lu | fires rejected: %lu | "
+           "others confirmed: %lu | tracks held: %zu\n", (unsigned long)finished,
+           (unsigned long)true_fires, (unsigned long)missed_fires, (unsigned long)false_fires,
+           gate.size());
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  ReplaySettings settings;
+  TrackGateParams params;
+  bool check_only = false;
+  const struct option options[] = {
+    {"sources", required_argument, NULL, 'n'},
+    {"tracks", required_argument, NULL, 't'},
+    {"frames", required_argument, NULL, 'f'},
+    {"fires", required_argument, NULL, 'x'},
+    {"confirm-threshold", required_argument, NULL, 'c'},
+    {"max-attempts", required_argument, NULL, 'a'},
+    {"retry-interval", required_argument, NULL, 'r'},
+    {"recheck-interval", required_argument, NULL, 'e'},
+    {"max-crops-per-batch", required_argument, NULL, 'b'},
+    {"max-age", required_argument, NULL, 'g'},
+    {"check", no_argument, NULL, 'k'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch (option) {
+      case 'n':
+        settings.sources = atoi(optarg);
+        break;
+      case 't':
+        settings.tracks = atoi(optarg);
+        break;
+      case 'f':
+        settings.frames = atoi(optarg);
+        break;
+      case 'x':
+        settings.fires = atof(optarg);
+        break;
+      case 'c':
+        params.confirm_threshold = atof(optarg);
+        break;
+      case 'a':
+        params.max_attempts = atoi(optarg);
+        break;
+      case 'r':
+        params.retry_interval = atoi(optarg);
+        break;
+      case 'e':
+        params.recheck_interval = atoi(optarg);
+        break;
+      case 'b':
+        params.max_crops_per_batch = atoi(optarg);
+        break;
+      case 'g':
+        params.max_age = atoi(optarg);
+        break;
+      case 'k':
+        check_only = true;
+        break;
+      default:
+        return 1;
+    }
+  }
+  if (!settings.sources || !settings.tracks || !settings.frames || settings.fires < 0 ||
+      settings.fires > 1) {
+    fprintf(stderr, "Invalid settings\n");
+    return 1;
+  }
+
+  check_retry_and_confirm();
+  check_reject_and_recheck();
+  check_untracked();
+  check_crop_limit();
+  check_sources_and_restart();
+  check_expiry();
+  if (failures) {
+    printf("%u track gate checks failed\n", failures);
+    return 1;
+  }
+  printf("PASS track gate\n");
+  if (check_only) {
+    return 0;
+  }
+
+  printf("%u sources, %u tracks each, %.0f%% fires, %u frames; %u crops per batch at most\n",
+         settings.sources, settings.tracks, settings.fires * 100, settings.frames,
+         params.max_crops_per_batch);
+  replay(settings, params);
+  return 0;
+}
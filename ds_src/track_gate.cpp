@@ -0,0 +1,122 @@
+#include "track_gate.h"
+
+#include <algorithm>
+
+namespace WildFireDetection {
+
+  TrackGate::TrackGate(const TrackGateParams &params) : params(params) {}
+
+  bool
+  TrackGate::due(const Track &track, int64_t frame) const {
+    switch (track.verdict) {
+    case TrackVerdict::CONFIRMED:
+      return false;
+    case TrackVerdict::REJECTED:
+      return params.recheck_interval && frame - track.last_classified >= params.recheck_interval;
+    default:
+      return track.last_classified < 0 || frame - track.last_classified >= params.retry_interval;
+    }
+  }
+
+  std::vector<bool>
+  TrackGate::select(const std::vector<TrackObservation> &batch) {
+    std::vector<bool> chosen(batch.size(), false);
+    // last classification of each due detection, -1 for new and untracked ones
+    std::vector<std::pair<int64_t, size_t>> candidates;
+
+    for (size_t i = 0; i < batch.size(); i++) {
+      const TrackObservation &observation = batch[i];
+      if (observation.object_id == UNTRACKED_TRACK) {
+        candidates.emplace_back(-1, i);
+        continue;
+      }
+      Track &track = tracks[{observation.source_id, observation.object_id}];
+      if (observation.frame < track.last_seen) {
+        track = Track();
+      }
+      track.last_seen = observation.frame;
+      if (due(track, observation.frame)) {
+        candidates.emplace_back(track.last_classified, i);
+      }
+      else {
+        counters.cached++;
+      }
+    }
+
+    size_t limit = candidates.size();
+    if (params.max_crops_per_batch && limit > params.max_crops_per_batch) {
+      limit = params.max_crops_per_batch;
+      std::stable_sort(candidates.begin(), candidates.end(),
+                       [](const std::pair<int64_t, size_t> &a, const std::pair<int64_t, size_t> &b) {
+                         return a.first < b.first;
+                       });
+      counters.deferred += candidates.size() - limit;
+    }
+    for (size_t c = 0; c < limit; c++) {
+      const TrackObservation &observation = batch[candidates[c].second];
+      chosen[candidates[c].second] = true;
+      counters.classified++;
+      if (observation.object_id != UNTRACKED_TRACK) {
+        tracks[{observation.source_id, observation.object_id}].last_classified = observation.frame;
+      }
+    }
+
+    int64_t expire_interval = std::max(1u, params.max_age / 4);
+    for (const TrackObservation &observation : batch) {
+      auto last = last_expire.find(observation.source_id);
+      if (last == last_expire.end() || observation.frame < last->second ||
+          observation.frame - last->second >= expire_interval) {
+        expire(observation.source_id, observation.frame);
+      }
+    }
+    return chosen;
+  }
+
+  TrackVerdict
+  TrackGate::record(unsigned int source_id, uint64_t object_id, float score) {
+    bool fire = score >= params.confirm_threshold;
+    auto it = tracks.find({source_id, object_id});
+    if (it == tracks.end()) {
+      // untracked, a single score is all there will be
+      return fire ? TrackVerdict::CONFIRMED : TrackVerdict::REJECTED;
+    }
+
+    Track &track = it->second;
+    if (fire) {
+      if (track.verdict != TrackVerdict::CONFIRMED) {
+        counters.confirmed++;
+      }
+      track.verdict = TrackVerdict::CONFIRMED;
+      track.attempts = 0;
+    }
+    else if (track.verdict == TrackVerdict::UNCONFIRMED &&
+             ++track.attempts >= std::max(1u, params.max_attempts)) {
+      track.verdict = TrackVerdict::REJECTED;
+      counters.rejected++;
+    }
+    return track.verdict;
+  }
+
+  TrackVerdict
+  TrackGate::verdict(unsigned int source_id, uint64_t object_id) const {
+    auto it = tracks.find({source_id, object_id});
+    return it == tracks.end() ? TrackVerdict::UNCONFIRMED : it->second.verdict;
+  }
+
+  size_t
+  TrackGate::expire(unsigned int source_id, int64_t frame) {
+    last_expire[source_id] = frame;
+    size_t expired = 0;
+    for (auto it = tracks.begin(); it != tracks.end();) {
+      if (it->first.source_id == source_id &&
+          (frame - it->second.last_seen > params.max_age || it->second.last_seen > frame)) {
+        it = tracks.erase(it);
+        expired++;
+      }
+      else {
+        ++it;
+      }
+    }
+    return expired;
+  }
+}
@@ -0,0 +1,125 @@
+#ifndef __HERMES_TRACK_GATE_H__
+#define __HERMES_TRACK_GATE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/* Decides which tracked detections go to the secondary fire classifier and
+ * remembers its verdict per track, so a track is classified a few times at
+ * most instead of every frame. Kept free of GStreamer and DeepStream types
+ * so it builds and runs on the host alone. */
+namespace WildFireDetection {
+
+  // object_id of objects the tracker did not take, same as DeepStream's
+  const uint64_t UNTRACKED_TRACK = ~(uint64_t)0;
+
+  struct TrackGateParams {
+    // classifier score at or above which a track is a fire
+    float confirm_threshold = 0.5;
+    // scores below it before a track is rejected
+    unsigned int max_attempts = 3;
+    // frames between classifications of an unconfirmed track
+    unsigned int retry_interval = 15;
+    // frames between classifications of a rejected track, 0 for never;
+    // smoke that turns into flames gets another chance
+    unsigned int recheck_interval = 300;
+    // crops classified per batch across all sources, 0 for no limit
+    unsigned int max_crops_per_batch = 16;
+    // tracks not seen for this many frames of their source are forgotten
+    unsigned int max_age = 300;
+  };
+
+  enum class TrackVerdict {
+    // not classified yet, or every score so far was low
+    UNCONFIRMED,
+    CONFIRMED,
+    REJECTED
+  };
+
+  /* A detection of the current batch, frame is the frame number of its
+   * source */
+  struct TrackObservation {
+    unsigned int source_id = 0;
+    uint64_t object_id = UNTRACKED_TRACK;
+    int64_t frame = 0;
+  };
+
+  struct TrackGateStats {
+    // crops sent to the classifier
+    uint64_t classified = 0;
+    // detections whose track already had its verdict, or was not due
+    uint64_t cached = 0;
+    // due but over max_crops_per_batch, sent with a later batch
+    uint64_t deferred = 0;
+    // verdicts reached
+    uint64_t confirmed = 0;
+    uint64_t rejected = 0;
+  };
+
+  /* Untracked detections are classified every time and never cached. Not
+   * thread safe. */
+  class TrackGate {
+    public:
+      TrackGate() {}
+      explicit TrackGate(const TrackGateParams &params);
+
+      /* Which detections of one batch to classify: new tracks first, then
+       * the ones waiting longest for a retry, max_crops_per_batch in all.
+       * Every detection counts as its track being seen, a frame number
+       * going back means its source restarted and starts the track over. */
+      std::vector<bool> select(const std::vector<TrackObservation> &batch);
+
+      /* Score of the fire class for a selected detection, 0 when the
+       * classifier put the crop in another class. Selected detections the
+       * classifier skipped are not recorded and come up again after
+       * retry_interval. */
+      TrackVerdict record(unsigned int source_id, uint64_t object_id, float score);
+
+      TrackVerdict verdict(unsigned int source_id, uint64_t object_id) const;
+
+      // Forgets the tracks of source_id not seen since frame - max_age, returns how many
+      size_t expire(unsigned int source_id, int64_t frame);
+
+      const TrackGateStats &stats() const { return counters; }
+
+      size_t size() const { return tracks.size(); }
+
+    private:
+      struct Key {
+        unsigned int source_id;
+        uint64_t object_id;
+        bool operator==(const Key &other) const {
+          return source_id == other.source_id && object_id == other.object_id;
+        }
+      };
+
+      struct KeyHash {
+        size_t operator()(const Key &key) const {
+          return std::hash<uint64_t>()(key.object_id * 0x9e3779b97f4a7c15ull ^ key.source_id);
+        }
+      };
+
+      struct Track {
+        TrackVerdict verdict = TrackVerdict::UNCONFIRMED;
+        // low scores since the last verdict
+        unsigned int attempts = 0;
+        int64_t last_seen = 0;
+        // -1 while never classified
+        int64_t last_classified = -1;
+      };
+
+      // whether track is due for a classification at frame
+      bool due(const Track &track, int64_t frame) const;
+
+      TrackGateParams params;
+      std::unordered_map<Key, Track, KeyHash> tracks;
+      // frame of the last expiry of each source, select expires every max_age / 4 frames
+      std::unordered_map<unsigned int, int64_t> last_expire;
+      TrackGateStats counters;
+  };
+}
+
+#endif // __HERMES_TRACK_GATE_H__
@@ -1,5 +1,7 @@
 #include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
 #include <glib.h>
+#include <glib-unix.h>
 
 #include "gstnvdsmeta.h"
 #include "nvdsmeta_schema.h"
@@ -22,8 +24,17 @@
 #include <thread>
 #include <future>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <array>
 #include <map>
+#include <list>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <algorithm>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -31,8 +42,27 @@
 
 #include <curl/curl.h>
 
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <signal.h>
+
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "slicing.h"
+#include "stage_threads.h"
+#include "benchmark.h"
+#include "startup_timeline.h"
+#include "model_update.h"
+#include "fire_map.h"
+#include "shm_ring.h"
+#include "hermes_log.h"
+#include "muxer_geometry.h"
+#include "track_gate.h"
+#include "heatmap.h"
+#include "event_ring.h"
+#include "governor.h"
 
 using namespace std;
 using namespace std::chrono;
@@ -40,19 +70,93 @@ using namespace cv;
 
 #define SOURCE_PATH "inputsources.txt"
 
+#define BENCHMARK_CONFIG_FILE "models/config_benchmark.txt"
+
+/* Dropping a new version in here swaps the detector model while running,
+ * see models/YOLOv3WildFires/model_update.txt.example */
+#define MODEL_UPDATE_FILE "models/YOLOv3WildFires/model_update.txt"
+#define MODEL_UPDATE_POLL_INTERVAL 5
+
+// Ground positions of detections, merged across sources
+#define FIRE_MAP_CONFIG_FILE "models/config_fire_map.txt"
+#define FIRE_MAP_POSE_POLL_MS 200
+#define FIRE_MAP_REPORT_INTERVAL 10
+
+// Per source fire heatmaps, drawn over the display branch and exported
+#define HEATMAP_CONFIG_FILE "models/config_heatmap.txt"
+#define HEATMAP_FILE_PATTERN "heatmap_%u.pgm"
+// colour bands of the overlay, and rectangles drawn per frame at most
+#define HEATMAP_OVERLAY_LEVELS 4
+#define HEATMAP_MAX_OVERLAY_RECTS 128
+
+// Clips of fire events from the compressed streams, with the seconds before them
+#define EVENT_CONFIG_FILE "models/config_events.txt"
+#define EVENT_REPORT_INTERVAL 10
+// the muxer of a finished clip gets this long to write its index
+#define EVENT_CLIP_EOS_TIMEOUT 10
+
+// Thermal and power governor of Jetson deployments, the file is optional
+#define GOVERNOR_CONFIG_FILE "models/config_governor.txt"
+
+// shm://name sources, frames from a shared memory ring (hermes_shm.h)
+#define SHM_SOURCE_PREFIX "shm://"
+#define SHM_SOURCE_WAIT_MS 100
+// no frame for this long, check whether the writer restarted
+#define SHM_SOURCE_REOPEN_MS 1000
+
+// Offline processing of recorded flights, hermes-app --survey
+#define SURVEY_CONFIG_FILE "models/config_survey.txt"
+#define SURVEY_SUMMARY_FILE "summary.csv"
+
+// Secondary fire classifier on tracked detections, the file is optional
+#define CLASSIFIER_CONFIG_FILE "models/config_classifier.txt"
+// misc_obj_info slot keeping the component id of a detection sent to the classifier
+#define CLASSIFIER_GATE_SLOT 0
+
+// Low-level tracker, one directory of models/Trackers per tracker
+#define TRACKER_CONFIG_PATTERN "models/Trackers/%s/ds_tracker_config.txt"
+#define DEFAULT_TRACKER "DCF"
+
 #define PERF_INTERVAL 2
 
 #define MAX_DISPLAY_LEN 64
 
-// Network Compute Mode
-#define COMPUTE_MODE "fp32"
+/* Explicit batch engines serve every batch of 1..PGIE_MAX_BATCH_SIZE frames,
+ * so a single model_b16_gpu0_<mode>.engine covers up to 16 sources. */
+#define PGIE_MAX_BATCH_SIZE 16
+
+/* Tells the engine builder in the custom parser library which nvinfer config
+ * holds its [builder] group */
+#define INFER_CONFIG_ENV "HERMES_INFER_CONFIG"
+
+// Network Compute Mode, taken from network-mode of the nvinfer config
+#define CONFIG_GROUP_PROPERTY "property"
+#define CONFIG_NETWORK_MODE "network-mode"
+#define CONFIG_BATCH_SIZE "batch-size"
+#define CONFIG_MODEL_ENGINE_FILE "model-engine-file"
+#define CONFIG_MODEL_FILE "model-file"
 
 #define MAX_TRACKING_ID_LEN 16
 
-// Muxer Resolution
+// Muxer Resolution of the fixed policy, see models/config_muxer.txt
 #define MUXER_OUTPUT_WIDTH 1920
 #define MUXER_OUTPUT_HEIGHT 1080
 
+// Muxer resolution policy, the file is optional
+#define MUXER_CONFIG_FILE "models/config_muxer.txt"
+#define CONFIG_GROUP_MUXER "muxer"
+#define CONFIG_MUXER_POLICY "policy"
+#define CONFIG_MUXER_WIDTH "width"
+#define CONFIG_MUXER_HEIGHT "height"
+#define CONFIG_MUXER_MAX_WIDTH "max-width"
+#define CONFIG_MUXER_MAX_HEIGHT "max-height"
+#define CONFIG_MUXER_ALIGNMENT "alignment"
+#define CONFIG_MUXER_PADDING "padding"
+#define CONFIG_MUXER_PROBE_TIMEOUT "probe-timeout"
+// Input size of the detector, from the [net] group of its darknet cfg
+#define CONFIG_CUSTOM_NETWORK_CONFIG "custom-network-config"
+#define DARKNET_GROUP_NET "[net]"
+
 /* Muxer batch formation timeout, for e.g. 40 millisec. Should ideally be set
  * based on the fastest source's framerate. */
 #define MUXER_BATCH_TIMEOUT_USEC 4000000
@@ -79,13 +183,345 @@ using namespace cv;
 #define CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS "enable-batch-process"
 #define CONFIG_GPU_ID "gpu-id"
 
+// Tiled inference, see models/YOLOv3WildFires/config_slicing.txt
+#define CONFIG_GROUP_SLICING "slicing"
+#define CONFIG_GROUP_SLICING_SOURCE "source-%u"
+#define CONFIG_SLICING_ENABLE "enable"
+#define CONFIG_SLICING_ROWS "rows"
+#define CONFIG_SLICING_COLUMNS "columns"
+#define CONFIG_SLICING_OVERLAP "overlap"
+#define CONFIG_SLICING_FULL_FRAME "full-frame"
+#define CONFIG_SLICING_MERGE_IOU "merge-iou-threshold"
+#define CONFIG_SLICING_MERGE_IOS "merge-ios-threshold"
+
+// Stage threading, see models/config_threading.txt
+#define CONFIG_GROUP_THREADING "threading"
+#define CONFIG_GROUP_THREAD_PREFIX "thread-"
+#define CONFIG_THREADING_ENABLE "enable"
+#define CONFIG_THREAD_QUEUE_DEPTH "queue-depth"
+#define CONFIG_THREAD_LEAKY "leaky"
+#define CONFIG_THREAD_CPU_CORES "cpu-cores"
+#define CONFIG_THREAD_PRIORITY "priority"
+
+// --benchmark, see models/config_benchmark.txt
+#define CONFIG_GROUP_BENCHMARK "benchmark"
+#define CONFIG_BENCHMARK_WIDTH "width"
+#define CONFIG_BENCHMARK_HEIGHT "height"
+#define CONFIG_BENCHMARK_FPS "fps"
+#define CONFIG_BENCHMARK_CODEC "codec"
+#define CONFIG_BENCHMARK_START_SOURCES "start-sources"
+#define CONFIG_BENCHMARK_MAX_SOURCES "max-sources"
+#define CONFIG_BENCHMARK_SOURCE_STEP "source-step"
+#define CONFIG_BENCHMARK_WARMUP "warmup"
+#define CONFIG_BENCHMARK_DURATION "duration"
+#define CONFIG_BENCHMARK_MIN_EFFICIENCY "min-efficiency"
+#define CONFIG_BENCHMARK_STAND_IN "stand-in"
+#define CONFIG_BENCHMARK_STAND_IN_WORK "stand-in-work-us"
+#define CONFIG_BENCHMARK_CSV_FILE "csv-file"
+#define CONFIG_BENCHMARK_JSON_FILE "json-file"
+
+// Model updates, in MODEL_UPDATE_FILE
+#define CONFIG_GROUP_MODEL_UPDATE "model-update"
+#define CONFIG_MODEL_UPDATE_VERSION "version"
+#define CONFIG_MODEL_UPDATE_PROBATION "probation-batches"
+#define CONFIG_MODEL_UPDATE_MAX_UNHEALTHY "max-unhealthy-batches"
+#define CONFIG_MODEL_UPDATE_MAX_OBJECTS "max-objects-per-frame"
+
+// Fire map config, [source-N] for the N-th source, [pose] in pose files
+#define CONFIG_GROUP_FIRE_MAP "fire-map"
+#define CONFIG_GROUP_FIRE_MAP_SOURCE "source-%u"
+#define CONFIG_GROUP_POSE "pose"
+#define CONFIG_FIRE_MAP_ENABLE "enable"
+#define CONFIG_FIRE_MAP_MERGE_RADIUS "merge-radius"
+#define CONFIG_FIRE_MAP_DECAY "decay"
+#define CONFIG_FIRE_MAP_MIN_WEIGHT "min-weight"
+#define CONFIG_FIRE_MAP_WIDTH "width"
+#define CONFIG_FIRE_MAP_HEIGHT "height"
+#define CONFIG_FIRE_MAP_HFOV "horizontal-fov"
+#define CONFIG_FIRE_MAP_POSE_FILE "pose-file"
+#define CONFIG_POSE_LATITUDE "latitude"
+#define CONFIG_POSE_LONGITUDE "longitude"
+#define CONFIG_POSE_ALTITUDE "altitude"
+#define CONFIG_POSE_YAW "yaw"
+#define CONFIG_POSE_PITCH "pitch"
+
+// Classifier config, in CLASSIFIER_CONFIG_FILE
+#define CONFIG_GROUP_CLASSIFIER "classifier"
+#define CONFIG_CLASSIFIER_ENABLE "enable"
+#define CONFIG_CLASSIFIER_INFER_CONFIG "infer-config"
+#define CONFIG_CLASSIFIER_FIRE_CLASS "fire-class-id"
+#define CONFIG_CLASSIFIER_CONFIRM_THRESHOLD "confirm-threshold"
+#define CONFIG_CLASSIFIER_MAX_ATTEMPTS "max-attempts"
+#define CONFIG_CLASSIFIER_RETRY_INTERVAL "retry-interval"
+#define CONFIG_CLASSIFIER_RECHECK_INTERVAL "recheck-interval"
+#define CONFIG_CLASSIFIER_MAX_CROPS "max-crops-per-batch"
+#define CONFIG_CLASSIFIER_MAX_AGE "max-age"
+#define CONFIG_CLASSIFIER_REQUIRE_CONFIRMATION "require-confirmation"
+
+// Heatmap config
+#define CONFIG_GROUP_HEATMAP "heatmap"
+#define CONFIG_HEATMAP_ENABLE "enable"
+#define CONFIG_HEATMAP_WIDTH "width"
+#define CONFIG_HEATMAP_HEIGHT "height"
+#define CONFIG_HEATMAP_DECAY "decay"
+#define CONFIG_HEATMAP_OVERLAY "overlay"
+#define CONFIG_HEATMAP_THRESHOLD "threshold"
+#define CONFIG_HEATMAP_EXPORT_DIR "export-dir"
+#define CONFIG_HEATMAP_REPORT_INTERVAL "report-interval"
+
+// Events config
+#define CONFIG_GROUP_EVENTS "events"
+#define CONFIG_EVENTS_ENABLE "enable"
+#define CONFIG_EVENTS_PRE_EVENT "pre-event"
+#define CONFIG_EVENTS_POST_EVENT "post-event"
+#define CONFIG_EVENTS_MAX_CLIP "max-clip"
+#define CONFIG_EVENTS_RING_SIZE "ring-size"
+#define CONFIG_EVENTS_CONTAINER "container"
+#define CONFIG_EVENTS_OUTPUT_DIR "output-dir"
+#define CONFIG_EVENTS_TRIGGER_CONFIDENCE "trigger-confidence"
+
+// Governor config
+#define CONFIG_GROUP_GOVERNOR "governor"
+#define CONFIG_GOVERNOR_ENABLE "enable"
+#define CONFIG_GOVERNOR_PERIOD "period"
+#define CONFIG_GOVERNOR_TEMP_PATHS "temp-paths"
+#define CONFIG_GOVERNOR_TEMP_SCALE "temp-scale"
+#define CONFIG_GOVERNOR_POWER_PATHS "power-paths"
+#define CONFIG_GOVERNOR_POWER_SCALE "power-scale"
+#define CONFIG_GOVERNOR_TEMP_HIGH "temp-high"
+#define CONFIG_GOVERNOR_TEMP_CRITICAL "temp-critical"
+#define CONFIG_GOVERNOR_TEMP_HYSTERESIS "temp-hysteresis"
+#define CONFIG_GOVERNOR_POWER_HIGH "power-high"
+#define CONFIG_GOVERNOR_POWER_HYSTERESIS "power-hysteresis"
+#define CONFIG_GOVERNOR_SMOOTHING "smoothing"
+#define CONFIG_GOVERNOR_STEP_UP "step-up"
+#define CONFIG_GOVERNOR_STEP_DOWN "step-down"
+#define CONFIG_GOVERNOR_SOURCE_FPS "source-fps"
+#define CONFIG_GOVERNOR_MIN_DETECTION_FPS "min-detection-fps"
+#define CONFIG_GOVERNOR_DISPLAY_FPS "display-fps"
+#define CONFIG_GOVERNOR_FALLBACK_CONFIG "fallback-infer-config"
+#define CONFIG_GOVERNOR_METRICS_FILE "metrics-file"
+
+// Survey config
+#define CONFIG_GROUP_SURVEY "survey"
+#define CONFIG_SURVEY_SLOTS "slots"
+#define CONFIG_SURVEY_LOG_DIR "log-dir"
+#define CONFIG_SURVEY_EXTENSIONS "extensions"
+
+// Element names, topologies refer to elements by name
+#define PGIE_ELEMENT_NAME "primary-yolo-nvinference-engine"
+#define TRACKER_ELEMENT_NAME "tracker"
+#define SGIE_ELEMENT_NAME "secondary-fire-classifier"
+#define TILER_ELEMENT_NAME "nvtiler"
+#define SINK_ELEMENT_NAME "nvvideo-renderer"
+#define ANALYTICS_SINK_ELEMENT_NAME "analytics-sink"
+#define TEE_ELEMENT_NAME "branch-tee"
+
+// Analytics and display branches after the tee
+#define ANALYTICS_BRANCH "analytics"
+#define DISPLAY_BRANCH "display"
+
 enum PGIE_CLASS {FIRE = 0};
 
-enum GIE_UID {FIRE_DETECTOR = 1};
+/* SLICER tags the slice objects pgie_yolo_detector infers on in tiled mode,
+ * CLASSIFIER_GATE the detections sgie_fire_classifier infers on */
+enum GIE_UID {FIRE_DETECTOR = 1, SLICER = 2, FIRE_CLASSIFIER = 5, CLASSIFIER_GATE = 6};
 
 int num_sources = 0;
 
 namespace WildFireDetection {
+  /* One element of a topology, linked after the previous one */
+  struct StageSpec {
+    const gchar *factory;
+    const gchar *name;
+  };
+
+  /* A chain fed by the trunk. With more than one branch, or any rate limit
+   * or leaky branch, each one gets a tee src pad and a queue of its own. The
+   * metadata probe sits on the sink pad of the first stage. */
+  struct BranchSpec {
+    const gchar *name;
+    std::vector<StageSpec> stages;
+    // whether OSD boxes and text are generated
+    gboolean display_meta;
+    // drop frames when the branch falls behind instead of stalling the trunk
+    gboolean leaky;
+    // frames per second let into the branch, 0 for all
+    guint max_fps;
+  };
+
+  /* Declarative description of the pipeline after the streammux */
+  struct TopologySpec {
+    const gchar *name;
+    // trunk, linked after the streammux
+    std::vector<StageSpec> stages;
+    std::vector<BranchSpec> branches;
+  };
+
+  /* Per branch counters, updated from the branch streaming threads */
+  struct BranchMetrics {
+    std::string name;
+    gboolean display_meta = FALSE;
+    // from the topology, the governor may lower it
+    guint max_fps = 0;
+    std::atomic<gint64> min_interval_us{0};
+    gint64 last_admitted_us = 0;
+    std::atomic<guint64> batches{0};
+    std::atomic<guint64> frames{0};
+    std::atomic<guint64> rate_dropped{0};
+    std::atomic<guint64> queue_dropped{0};
+    guint64 reported_frames = 0;
+  };
+
+  /* An object of an analytics frame, copied out of the batch meta */
+  struct ObjectRecord {
+    guint64 object_id = 0;
+    gint class_id = 0;
+    // the detector's, below 0 on frames it skipped (interval)
+    gfloat confidence = 0;
+    gfloat tracker_confidence = 0;
+    // muxer resolution
+    gfloat left = 0;
+    gfloat top = 0;
+    gfloat width = 0;
+    gfloat height = 0;
+  };
+
+  /* What the analytics branch works on of one frame. Copied under the batch
+   * meta lock, so mapping, heatmaps, events and survey logs run without it
+   * and never hold up the display branch. */
+  struct FrameRecord {
+    guint source_id = 0;
+    guint64 buf_pts = 0;
+    guint source_frame_width = 0;
+    guint source_frame_height = 0;
+    std::vector<ObjectRecord> objects;
+  };
+
+  /* A streaming thread of the pipeline and the stages it runs. owner is the
+   * element whose src pad task drives it, a queue or the streammux. */
+  struct StageThread {
+    std::string owner;
+    ThreadSpec spec;
+    // from a [thread-*] group, otherwise left to the scheduler
+    gboolean configured = FALSE;
+    std::vector<std::string> stages;
+  };
+
+  /* Time spent by buffers in one stage of a benchmarked pipeline. Stages
+   * keep buffer order, so entries are matched first in, first out. */
+  struct StageProbe {
+    std::string name;
+    std::mutex lock;
+    std::deque<gint64> entries;
+    std::vector<int64_t> samples_us;
+  };
+
+  /* Camera and latest pose of one source. Static from the config or
+   * refreshed from the pose file a telemetry bridge keeps writing. */
+  struct SourcePose {
+    DronePose pose;
+    CameraIntrinsics camera;
+    // frame size the intrinsics are in
+    guint width = 0;
+    guint height = 0;
+    std::string pose_file;
+    // nanoseconds, telemetry rewrites the file several times a second
+    gint64 pose_mtime = 0;
+  };
+
+  /* A shm:// source: a thread copies the newest frame of the ring into a
+   * buffer of the appsrc of its source bin */
+  struct ShmSource {
+    std::string name;
+    // position in inputsources.txt
+    guint index = 0;
+    GstElement *appsrc = NULL;
+    ShmRingReader reader;
+    std::thread thread;
+    std::atomic<gboolean> running{TRUE};
+    // frames not pushed, the pipeline had not taken the previous one yet
+    std::atomic<guint64> dropped{0};
+  };
+
+  /* Encoded packets of a uridecodebin source, taken after its parser, and
+   * the clip being recorded from them. A recorder thread muxes a clip from
+   * pending: the ring at the event, then live packets until
+   * record_until_us. */
+  struct EventSource {
+    guint index = 0;
+    std::mutex lock;
+    EventRing ring;
+    // parser output, the clip is muxed from the same caps
+    GstCaps *caps = NULL;
+    // factory of the parser, the clip pipeline parses again before the muxer
+    std::string parser;
+    std::thread recorder;
+    std::condition_variable wake;
+    // shares the packets with the ring, at most max_bytes of them
+    std::deque<EventPacket> pending;
+    size_t pending_bytes = 0;
+    // the recorder thread is running
+    gboolean recording = FALSE;
+    // live packets are taken until then, 0 once the clip is cut
+    gint64 record_until_us = 0;
+    // max-clip after the first packet of the clip
+    gint64 record_limit_us = 0;
+    std::string clip_path;
+    guint64 clips = 0;
+    guint64 failed = 0;
+    // cut short, the recorder fell max_bytes behind
+    guint64 truncated = 0;
+  };
+
+  struct SurveySettings {
+    // files decoded at once, the batch of the pipeline
+    guint slots = 4;
+    std::string log_dir = "survey";
+    // of the files taken from a directory
+    std::vector<std::string> extensions = {"mp4", "mkv", "mov", "avi", "ts", "h264", "h265"};
+  };
+
+  /* A recorded flight going through the survey pipeline */
+  struct SurveyFile {
+    std::string path;
+    std::ofstream log;
+    // frames out of the source bin, final once finished
+    guint64 frames_in = 0;
+    guint64 frames_logged = 0;
+    guint64 detections = 0;
+    gint64 first_pts = -1;
+    gint64 last_pts = -1;
+    // decoding is over, at EOS or an error
+    gboolean finished = FALSE;
+    gboolean failed = FALSE;
+  };
+
+  /* One source of the survey pipeline, sink_<index> of the streammux. Files
+   * are decoded one after another, the next is taken from the shared queue
+   * as the previous one ends. */
+  struct SurveySlot {
+    guint index = 0;
+    GstElement *bin = NULL;
+    // being replaced on the main loop
+    gboolean swapping = FALSE;
+    // taken from the queue when the current file ended
+    std::string next_path;
+    // still in the pipeline, oldest first: the front one is being logged,
+    // the back one decoded
+    std::list<SurveyFile> files;
+  };
+
+  /* Measurement window of one benchmark step, after the warmup */
+  struct BenchmarkWindow {
+    GMainLoop *loop = NULL;
+    gint64 start_us = 0;
+    gint64 end_us = 0;
+    struct rusage start_usage;
+    struct rusage end_usage;
+    gboolean finished = FALSE;
+  };
+
   class Hermes {
     private:
       gchar pgie_yolo_classes_str[1][10] = {
@@ -99,25 +535,216 @@ namespace WildFireDetection {
         gint display_fps;
       };
 
-      inline static fps_calculator fps[16];
+      // one per source, sized by setPaths as benchmark steps change the count
+      inline static std::vector<fps_calculator> fps;
 
       inline static char *PGIE_YOLO_DETECTOR_CONFIG_FILE_PATH;
 
       inline static char *TRACKER_CONFIG_FILE;
 
+      inline static char *SLICING_CONFIG_FILE;
+
+      inline static char *THREADING_CONFIG_FILE;
+
+      // Set from the topology, off when nothing renders the OSD
+      inline static gboolean display_meta_enabled = TRUE;
+
+      // One entry per branch of the running topology, addresses are stable
+      inline static std::list<BranchMetrics> branch_metrics;
+
+      // Tiled inference settings, default grid plus per source overrides
+      inline static gboolean slicing_enabled = FALSE;
+      inline static SliceGrid slice_grid;
+      inline static std::map<guint, SliceGrid> source_slice_grids;
+      inline static SliceMergeParams slice_merge_params;
+
+      // Thread boundaries keyed by the element the new thread starts at
+      inline static gboolean threading_enabled = FALSE;
+      inline static ThreadSpec thread_defaults;
+      inline static std::map<std::string, ThreadSpec> thread_boundaries;
+
+      // Streaming threads of the running topology, in pipeline order
+      inline static std::vector<StageThread> stage_threads;
+
+      inline static gboolean startup_reported = FALSE;
+
+      // In-place model updates of pgie_yolo_detector, guarded by model_update_lock
+      inline static ModelUpdater model_updater;
+      inline static std::mutex model_update_lock;
+      inline static time_t model_update_mtime = 0;
+      // more objects than this in one frame is not a fire, it is a broken model
+      inline static guint max_objects_per_frame = 100;
+
+      // Offline survey, files and slots guarded by survey_lock
+      inline static std::mutex survey_lock;
+      inline static std::deque<std::string> survey_queue;
+      inline static std::list<SurveySlot> survey_slots;
+      inline static SurveySettings survey_settings;
+      inline static std::ofstream survey_summary;
+      inline static GstElement *survey_pipeline = NULL;
+      inline static GstElement *survey_streammux = NULL;
+      inline static guint survey_files_total = 0;
+      inline static guint survey_files_started = 0;
+      inline static guint survey_files_done = 0;
+      inline static guint survey_files_failed = 0;
+      inline static guint64 survey_frames = 0;
+      inline static guint64 survey_reported_frames = 0;
+      inline static gdouble survey_media_s = 0;
+      inline static gint64 survey_start_us = 0;
+
+      // Reader threads of shm:// sources, addresses are stable
+      inline static std::list<ShmSource> shm_sources;
+
+      // RTSP and other live sources, connected while the engine loads
+      inline static std::vector<GstElement *> live_source_bins;
+
+      // Benchmark probes, stage latencies followed by the whole pipeline
+      inline static std::list<StageProbe> benchmark_stages;
+      inline static std::atomic<guint64> benchmark_frames{0};
+      inline static std::atomic<gboolean> benchmark_measuring{FALSE};
+      inline static GstElement *benchmark_pipeline = NULL;
+
+      // Fire clusters from the analytics branch, guarded by fire_map_lock
+      inline static FireMapParams fire_map_params;
+      inline static FireMap fire_map;
+      inline static std::mutex fire_map_lock;
+      inline static std::map<guint, SourcePose> source_poses;
+
+      // Fire heatmap of every source from the analytics branch, guarded by heatmap_lock
+      inline static HeatmapParams heatmap_params;
+      inline static std::map<guint, Heatmap> heatmaps;
+      inline static std::mutex heatmap_lock;
+      inline static gboolean heatmap_overlay = TRUE;
+      // cells below it are neither drawn nor counted as hot
+      inline static gdouble heatmap_threshold = 0.05;
+      inline static std::string heatmap_export_dir;
+
+      /* Muxer resolution, chosen before the pipeline is configured. nvstreammux
+       * cannot change it while running, sizes seen later only count as
+       * mismatches. Source sizes guarded by muxer_lock */
+      inline static MuxerPolicySettings muxer_settings;
+      inline static MuxerGeometry muxer_geometry =
+          choose_muxer_geometry({}, MuxerPolicySettings());
+      inline static guint muxer_probe_timeout = 5;
+      inline static std::mutex muxer_lock;
+      inline static std::vector<SourceGeometry> muxer_sources;
+      inline static std::atomic<guint64> muxer_mismatches{0};
+
+      /* Secondary classifier after the tracker. A track is classified until
+       * confirmed or rejected, not every frame; gate guarded by
+       * classifier_lock */
+      inline static gchar *classifier_infer_config = NULL;
+      inline static guint classifier_fire_class = 0;
+      // hide tracks until the classifier confirms them, not only rejected ones
+      inline static gboolean require_confirmation = FALSE;
+      inline static TrackGateParams track_gate_params;
+      inline static TrackGate track_gate;
+      inline static std::mutex classifier_lock;
+
+      /* Pre-event clips, see EVENT_CONFIG_FILE. The map is guarded by
+       * events_lock, entries are never removed and each is guarded by its
+       * own lock */
+      inline static EventRingParams event_ring_params;
+      inline static std::map<guint, EventSource> event_sources;
+      inline static std::mutex events_lock;
+      inline static gint64 event_post_us = 10000000;
+      inline static gint64 event_max_clip_us = 60000000;
+      // mp4 or mkv
+      inline static std::string event_container = "mp4";
+      inline static std::string event_output_dir = "events";
+      inline static gdouble event_trigger_confidence = 0.5;
+
+      /* Thermal governor, a thread of its own sampling the sensors. Governor
+       * and model swap state guarded by governor_lock */
+      inline static GovernorParams governor_params;
+      inline static Governor governor;
+      inline static std::mutex governor_lock;
+      inline static std::condition_variable governor_wake;
+      inline static std::thread governor_thread;
+      inline static gboolean governor_running = FALSE;
+      inline static guint governor_period_ms = 1000;
+      inline static std::vector<std::string> governor_temp_paths;
+      inline static std::vector<std::string> governor_power_paths;
+      // sysfs gives millidegrees and milliwatts
+      inline static gdouble governor_temp_scale = 0.001;
+      inline static gdouble governor_power_scale = 0.001;
+      inline static std::string governor_fallback_config;
+      // Prometheus text format, rewritten every period
+      inline static std::string governor_metrics_file;
+      inline static GstElement *governor_detector = NULL;
+      // the display branch, NULL when headless
+      inline static BranchMetrics *governor_display = NULL;
+      // the fallback model serves, a swap is on the main loop, or it failed to load
+      inline static gboolean governor_fallback_active = FALSE;
+      inline static gboolean governor_swap_pending = FALSE;
+      inline static gboolean governor_fallback_failed = FALSE;
+
     public:
+      // Launch to first detection, created with the other statics at launch
+      inline static StartupTimeline startup;
+
+      // pgie_yolo_detector, for model updates from the main loop
+      inline static GstElement *model_update_target = NULL;
+
+      // From FIRE_MAP_CONFIG_FILE, main starts the pose and report timers
+      inline static gboolean fire_map_enabled = FALSE;
+
+      // From HEATMAP_CONFIG_FILE, main starts the report timer
+      inline static gboolean heatmap_enabled = FALSE;
+      inline static guint heatmap_report_interval = 10;
+
+      // From CLASSIFIER_CONFIG_FILE, adds sgie_fire_classifier to the topology
+      inline static gboolean classifier_enabled = FALSE;
+
+      // From EVENT_CONFIG_FILE, main starts the report timer and SIGUSR1 handler
+      inline static gboolean events_enabled = FALSE;
+
+      // From GOVERNOR_CONFIG_FILE, adds a rate limit to the display branch
+      inline static gboolean governor_enabled = FALSE;
+
       // To save the frames
       gint frame_number;
 
       gboolean display_off;
 
-      GOptionEntry entries[2] = {
+      // Display branch frame rate limit, 0 for none
+      gint display_fps;
+
+      // Sweep synthetic sources instead of reading inputsources.txt
+      gboolean benchmark;
+
+      // Work queue of recorded flights, a directory or a file listing them
+      gchar *survey;
+
+      // nvstreammux waits for live sources in real time, files do not
+      gboolean live_sources;
+
+      // Directory of models/Trackers to take the tracker config from
+      gchar *tracker;
+
+      GOptionEntry entries[6] = {
         {"no-display", 0, 0, G_OPTION_ARG_NONE, &display_off, "Disable display", NULL},
+        {"display-fps", 0, 0, G_OPTION_ARG_INT, &display_fps,
+         "Limit the display branch to N frames per second, analytics runs at full rate", "N"},
+        {"benchmark", 0, 0, G_OPTION_ARG_NONE, &benchmark,
+         "Find how many synthetic sources the pipeline sustains, see " BENCHMARK_CONFIG_FILE, NULL},
+        {"survey", 0, 0, G_OPTION_ARG_FILENAME, &survey,
+         "Process the recorded flights in a directory or list file as fast as possible, see "
+         SURVEY_CONFIG_FILE, "PATH"},
+        {"tracker", 0, 0, G_OPTION_ARG_STRING, &tracker,
+         "Low-level tracker: DCF (default), KLT, or IOU which needs no GPU, see models/Trackers",
+         "NAME"},
         {NULL}
       };
 
       std::string PGIE_YOLO_ENGINE_PATH;
 
+      // fp32, int8 or fp16, as used by nvinfer in engine file names
+      std::string compute_mode;
+
+      // batch-size of pgie_yolo_detector, the max batch of its engine
+      guint pgie_batch_size;
+
       static void
       update_fps (gint id);
 
@@ -135,9 +762,41 @@ namespace WildFireDetection {
       addDisplayMeta (gpointer batch_meta_data, gpointer frame_meta_data);
 
       static GstPadProbeReturn
-      tiler_src_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
+      metadata_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
           gpointer u_data);
 
+      static GstPadProbeReturn
+      rate_limit_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static void
+      queue_overrun (GstElement *queue, gpointer u_data);
+
+      static gboolean
+      report_branch_metrics (gpointer data);
+
+      static TopologySpec
+      get_topology (gboolean headless, guint display_fps);
+
+      static gboolean
+      build_topology (GstElement *pipeline, GstElement *upstream, const TopologySpec &topology,
+                      std::map<std::string, GstElement *> &elements);
+
+      static gboolean
+      read_thread_spec (GKeyFile *key_file, const gchar *group, ThreadSpec &spec);
+
+      static gboolean
+      load_threading_config ();
+
+      static GstElement *
+      make_stage_queue (const gchar *name, const ThreadSpec &spec);
+
+      static void
+      report_stage_threads ();
+
+      static GstBusSyncReply
+      stream_status_handler (GstBus * bus, GstMessage * msg, gpointer data);
+
       static gboolean
       bus_call (GstBus * bus, GstMessage * msg, gpointer data);
 
@@ -151,12 +810,263 @@ namespace WildFireDetection {
       static GstElement *
       create_source_bin (guint index, gchar * uri);
 
+      static GstElement *
+      create_shm_source_bin (guint index, const gchar *name);
+
+      static void
+      shm_source_loop (ShmSource *source);
+
+      static void
+      stop_shm_sources ();
+
+      static void
+      source_setup (GstElement *uri_decode_bin, GstElement *source, gpointer data);
+
+      static void
+      source_described (GstElement *source, gpointer sdp, gpointer data);
+
+      static GstPadProbeReturn
+      startup_mark_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static GstPadProbeReturn
+      first_detection_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static void
+      report_startup ();
+
+      static gboolean
+      validate_model_file (const gchar *path, std::string &error);
+
+      std::string
+      write_model_config (guint version, const gchar *engine_file, const gchar *weights_file);
+
+      static gboolean
+      check_model_update (gpointer data);
+
+      static void
+      model_updated (GstElement *pgie_yolo_detector, gint error, const gchar *config_file,
+                     gpointer data);
+
+      static GstPadProbeReturn
+      model_health_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static gboolean
+      rollback_model (gpointer data);
+
+      static gboolean
+      start_pipeline (GstElement *pipeline, GstElement *pgie_yolo_detector, GstElement *nvtracker);
+
       static gchar *
       get_absolute_file_path (gchar *cfg_file_path, gchar *file_path);
 
       static gboolean
       set_tracker_properties (GstElement *nvtracker);
 
+      static gboolean
+      read_slice_grid (GKeyFile *key_file, const gchar *group, SliceGrid &grid);
+
+      static gboolean
+      load_slicing_config ();
+
+      static gboolean
+      read_network_size (guint &width, guint &height);
+
+      static gboolean
+      load_muxer_config ();
+
+      static SourceGeometry
+      probe_source_geometry (const std::string &uri);
+
+      static gboolean
+      choose_muxer_resolution ();
+
+      static void
+      note_source_geometry (guint index, guint width, guint height);
+
+      static gboolean
+      load_classifier_config ();
+
+      static gboolean
+      configure_classifier (GstElement *sgie_fire_classifier);
+
+      static gboolean
+      classifier_fire_score (NvDsObjectMeta *obj_meta, gfloat &score);
+
+      static GstPadProbeReturn
+      sgie_sink_pad_gate_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static GstPadProbeReturn
+      sgie_src_pad_verdict_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static void
+      attach_slicing_probes (GstElement *pgie_yolo_detector);
+
+      static GstPadProbeReturn
+      pgie_sink_pad_slice_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static GstPadProbeReturn
+      pgie_src_pad_merge_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static std::string
+      get_compute_mode (const gchar *infer_config_file);
+
+      static gboolean
+      read_benchmark_settings (BenchmarkSettings &settings);
+
+      static gboolean
+      create_synthetic_sources (GstElement *pipeline, GstElement *mux, guint count,
+                                const BenchmarkSettings &settings);
+
+      static GstPadProbeReturn
+      benchmark_stage_entry_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static GstPadProbeReturn
+      benchmark_stage_exit_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static GstPadProbeReturn
+      benchmark_sink_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static gboolean
+      benchmark_start_measuring (gpointer data);
+
+      static gboolean
+      benchmark_stop (gpointer data);
+
+      gboolean
+      run_benchmark_step (guint count, const BenchmarkSettings &settings, BenchmarkStep &step);
+
+      int
+      run_benchmark ();
+
+      static gboolean
+      read_pose (GKeyFile *key_file, const gchar *group, DronePose &pose);
+
+      static gboolean
+      read_camera (GKeyFile *key_file, const gchar *group, SourcePose &source);
+
+      static gboolean
+      load_fire_map_config ();
+
+      static gboolean
+      refresh_poses (gpointer data);
+
+      static void
+      map_fire_detections (const FrameRecord &frame);
+
+      static gboolean
+      report_fire_map (gpointer data);
+
+      static gboolean
+      load_heatmap_config ();
+
+      static void
+      accumulate_heatmap (const FrameRecord &frame);
+
+      static void
+      add_heatmap_display_meta (gpointer batch_meta_data, gpointer frame_meta_data);
+
+      static gboolean
+      report_heatmaps (gpointer data);
+
+      static gboolean
+      load_event_config ();
+
+      static void
+      attach_event_ring (GstElement *parser, GstElement *source_bin);
+
+      static GstPadProbeReturn
+      event_packet_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static void
+      note_fire_event (const FrameRecord &frame);
+
+      static void
+      trigger_event (guint source_id, const gchar *reason);
+
+      static gboolean
+      manual_event (gpointer data);
+
+      static void
+      record_event_clip (EventSource *source);
+
+      static gboolean
+      report_events (gpointer data);
+
+      static void
+      stop_event_recorders ();
+
+      static gboolean
+      load_governor_config ();
+
+      static gboolean
+      start_governor (GstElement *pgie_yolo_detector);
+
+      static void
+      governor_loop ();
+
+      static void
+      apply_governor_decision (const GovernorDecision &decision);
+
+      static gboolean
+      swap_governor_model (gpointer data);
+
+      static void
+      write_governor_metrics ();
+
+      static void
+      stop_governor ();
+
+      static gboolean
+      read_survey_settings (SurveySettings &settings);
+
+      static gboolean
+      load_survey_queue (const gchar *path);
+
+      static gboolean
+      start_survey_file (SurveySlot &slot, const std::string &path);
+
+      static void
+      finish_survey_file (SurveySlot &slot);
+
+      static void
+      retire_survey_files (SurveySlot &slot);
+
+      static GstPadProbeReturn
+      survey_source_probe (GstPad * pad, GstPadProbeInfo * info,
+          gpointer u_data);
+
+      static gboolean
+      survey_next_file (gpointer data);
+
+      static void
+      remove_survey_source (SurveySlot &slot);
+
+      static void
+      survey_source_failed (SurveySlot &slot, const gchar *reason);
+
+      static void
+      log_survey_frame (const FrameRecord &frame);
+
+      static gboolean
+      survey_bus_call (GstBus *bus, GstMessage *msg, gpointer data);
+
+      static gboolean
+      report_survey (gpointer data);
+
+      int
+      run_survey ();
+
       int
       configure_element_properties(int num_sources, GstElement *streammux, GstElement *pgie_yolo_detector,
                            GstElement *nvtracker, GstElement *sink, GstElement *tiler);
@@ -165,15 +1075,12 @@ namespace WildFireDetection {
 
       Hermes() {
 
-        int counter;
-        for (counter = 0; counter < 16; counter++) {
-          fps[counter].fps_timer = system_clock::now();
-          fps[counter].display_timer = system_clock::now();
-          fps[counter].rolling_fps = 0;
-          fps[counter].display_fps = 0;
-        }
-
         display_off = false;
+        display_fps = 0;
+        benchmark = FALSE;
+        survey = NULL;
+        live_sources = TRUE;
+        tracker = NULL;
         frame_number = 0;
       }
       ~Hermes() {}
@@ -11,6 +11,7 @@ import cv2
 import gi
 import struct
 import redis
+import ctypes
 from threading import Thread
 
 gi.require_version('Gst', '1.0')
@@ -68,6 +69,43 @@ class SensorFactory(GstRtspServer.RTSPMediaFactory):
         appsrc = rtsp_media.get_element().get_child_by_name('source')
         appsrc.connect('need-data', self.on_need_data)
 
+class ShmWriter:
+    ''' Frames into the shared memory ring hermes-app reads as shm://name. '''
+
+    BGR = 0
+
+    def __init__(self, name, fps, path=os.environ.get('HERMES_SHM_LIB', './libhermes_shm.so')):
+        self.lib = ctypes.CDLL(path, use_errno=True)
+        self.lib.hermes_shm_writer_open.restype = ctypes.c_void_p
+        self.lib.hermes_shm_writer_open.argtypes = [ctypes.c_char_p, ctypes.c_uint32,
+            ctypes.c_uint32, ctypes.c_int, ctypes.c_uint32, ctypes.c_uint32]
+        self.lib.hermes_shm_writer_write.argtypes = [ctypes.c_void_p, ctypes.c_void_p,
+            ctypes.c_size_t, ctypes.c_uint64]
+        self.lib.hermes_shm_writer_close.argtypes = [ctypes.c_void_p]
+        self.name = name
+        self.fps = fps
+        self.writer = None
+        self.shape = None
+
+    def write(self, frame):
+        # The ring is sized by the first frame, and again if the size changes
+        if frame.shape != self.shape:
+            self.close()
+            h, w = frame.shape[:2]
+            self.writer = self.lib.hermes_shm_writer_open(self.name.encode(), w, h, self.BGR,
+                                                          self.fps, 4)
+            if not self.writer:
+                raise OSError(ctypes.get_errno(), 'shm://' + self.name)
+            self.shape = frame.shape
+        frame = np.ascontiguousarray(frame)
+        self.lib.hermes_shm_writer_write(self.writer, frame.ctypes.data, 0,
+                                         time.monotonic_ns())
+
+    def close(self):
+        if self.writer:
+            self.lib.hermes_shm_writer_close(self.writer)
+            self.writer = None
+
 class GstServer(GstRtspServer.RTSPServer):
     def __init__(self, width, height, fps, endpoint='/stream', port=6969, **properties):
         super(GstServer, self).__init__(**properties)
@@ -91,11 +129,21 @@ class Apollo:
         self.endpoint = '/hermes'
         self.port = 6969
 
+        # Straight to hermes-app as shm://tello when the writer library is built
+        try:
+            self.shm = ShmWriter(self.key, self.fps)
+        except OSError:
+            self.shm = None
+
         capthread = Thread(target=self.capFrames,
                            name='cap_thread')
         capthread.daemon = True
         capthread.start()
 
+        if self.shm:
+            print('Writing frames to shm://' + self.key)
+            return
+
         GstServer(
             self.width,
             self.height,
@@ -111,6 +159,12 @@ class Apollo:
             try:
                 global drone
                 frame = drone.get_frame()
+                if self.shm:
+                    self.shm.write(frame)
+                    # the reader only wants the newest frame, no point in outpacing the camera
+                    time.sleep(1.0 / self.fps)
+                    continue
+
                 h, w = frame.shape[:2]
                 shape = struct.pack('>II', h, w)
                 encoded_frame = shape + frame.tobytes()
@@ -201,6 +255,21 @@ class Drone:
     	}
     	return status_files.items()
 
+    def write_pose(self, path='/tmp/hermes_pose_0.txt', interval=0.2):
+        ''' Keep the pose file of models/config_fire_map.txt up to date. '''
+
+        while True:
+            try:
+                pose = '[pose]\naltitude={}\nyaw={}\n'.format(
+                    pkg.get_height() / 100.0, pkg.get_yaw())
+                # Renamed into place, hermes-app never reads half a file
+                with open(path + '.tmp', 'w') as f:
+                    f.write(pose)
+                os.replace(path + '.tmp', path)
+            except:
+                traceback.print_exc()
+            time.sleep(interval)
+
     def switch_stream_on(self):
     	pkg.streamon()
 
@@ -223,6 +292,10 @@ if __name__ == '__main__':
     drone = Drone()
     drone.switch_stream_on()
 
+    posethread = Thread(target=drone.write_pose, name='pose_thread')
+    posethread.daemon = True
+    posethread.start()
+
     apollo = Apollo.__new__(Apollo)
     apollo.__init__()
 